@@ -1,13 +1,32 @@
 #pragma once
 
 #include <memory>
+#include <span>
 #include <utility>
+#include <vector>
 
 #include "types/Position.h"
 #include "types/Types.h"
 
 namespace Game3 {
-	class Realm;
+	class TileProvider;
 
-	bool simpleAStar(const std::shared_ptr<Realm> &realm, const Position &from, const Position &to, std::vector<Position> &path, size_t loop_max = 1'000);
+	struct PathRequest {
+		Position start;
+		Position goal;
+		size_t loopMax = 1'000;
+		/** On success, every position from start to goal inclusive. */
+		std::vector<Position> path;
+		bool found = false;
+	};
+
+	/** How far outside the box spanned by the start and goal a grid search is allowed to wander. */
+	constexpr Index PATH_WINDOW_MARGIN = 32;
+	/** Searches whose window would cover more tiles than this fail immediately. */
+	constexpr size_t PATH_WINDOW_MAX_AREA = 512 * 512;
+
+	/** A* over a dense window around the start and goal, using the calling thread's scratch buffers. */
+	bool simpleAStar(const TileProvider &, const Position &from, const Position &to, std::vector<Position> &path, size_t loop_max = 1'000);
+	/** Solves every request, sharing the tile locks between them when they're close enough together. */
+	void simpleAStar(const TileProvider &, std::span<PathRequest>);
 }
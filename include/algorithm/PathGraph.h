@@ -0,0 +1,134 @@
+#pragma once
+
+#include "algorithm/AStar.h"
+#include "data/ChunkIndex.h"
+#include "types/ChunkPosition.h"
+#include "types/Position.h"
+#include "types/Types.h"
+
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Game3 {
+	class TileProvider;
+
+	/** Hierarchical pathfinder over a TileProvider's path map. Each chunk gets a cluster of portals (the midpoints of the
+	 *  walkable stretches along its borders) connected by their walking distance within the chunk. Long searches run over
+	 *  the portals and then refine only the chunks along the abstract route. Clusters are built lazily and dropped when
+	 *  a tile in or next to them changes walkability. Finished paths are cached until a chunk they cross changes. The
+	 *  graph is only locked to look up or publish clusters and paths; searches themselves run unlocked on their own
+	 *  scratch, so several threads can search the same realm at once. */
+	class PathGraph {
+		public:
+			/** Searches shorter than this (in Manhattan distance) try a plain A* first, since it gives optimal paths. */
+			constexpr static Index LOCAL_DISTANCE = CHUNK_SIZE;
+			constexpr static size_t MAX_CACHED_PATHS = 4096;
+
+			PathGraph(const TileProvider &);
+
+			PathGraph(const PathGraph &) = delete;
+			PathGraph(PathGraph &&) = delete;
+
+			PathGraph & operator=(const PathGraph &) = delete;
+			PathGraph & operator=(PathGraph &&) = delete;
+
+			/** On success, path holds every position from start to goal inclusive. loop_max limits the expansions done by
+			 *  each stage of the search. */
+			bool findPath(const Position &start, const Position &goal, std::vector<Position> &path, size_t loop_max);
+			/** Solves several requests, running the short ones together. */
+			void findPaths(std::span<PathRequest>);
+
+			/** Call after the walkability of a tile changes. Threadsafe and cheap; the work is deferred to the next search. */
+			void invalidate(Position);
+			/** Call after a whole chunk's path map is remade. */
+			void invalidate(ChunkPosition);
+			void clear();
+
+			inline size_t getCacheHits() const { return cacheHits; }
+			inline size_t getCacheMisses() const { return cacheMisses; }
+			double getCacheHitRate() const;
+
+		private:
+			using Bitset = std::bitset<CHUNK_SIZE * CHUNK_SIZE>;
+
+			struct Portal {
+				Position position;
+				/** The tile in the neighboring chunk that this portal leads to. */
+				Position across;
+				/** Pairs of (portal index, walking distance) for the other portals reachable within the chunk. */
+				std::vector<std::pair<size_t, uint32_t>> links;
+			};
+
+			struct Cluster {
+				ChunkPosition position;
+				Bitset walkable;
+				/** A corner tile can hold two portals, one for each side. */
+				std::vector<Portal> portals;
+			};
+
+			/** Searches hold on to the clusters they use, so a cluster dropped midway through one stays valid. */
+			using ClusterPtr = std::shared_ptr<const Cluster>;
+
+			struct CachedPath {
+				std::vector<Position> positions;
+				std::vector<ChunkPosition> chunks;
+				uint64_t generation = 0;
+			};
+
+			struct PathKey {
+				Position start;
+				Position goal;
+				bool operator==(const PathKey &) const = default;
+			};
+
+			struct PathKeyHash {
+				size_t operator()(const PathKey &) const;
+			};
+
+			const TileProvider &provider;
+			/** Guards the clusters, change stamps and cache. */
+			std::shared_mutex mutex;
+			ChunkIndex<ClusterPtr> clusters;
+			/** The generation at which each chunk's walkability last changed. */
+			ChunkIndex<uint64_t> changedAt;
+			/** The generation at which each chunk's cluster was last dropped. A cluster built from tiles read before then
+			 *  is used by the search that built it but not kept. */
+			ChunkIndex<uint64_t> staleAt;
+			std::unordered_map<PathKey, CachedPath, PathKeyHash> cache;
+			uint64_t generation = 0;
+			/** The generation at which everything was last cleared. */
+			uint64_t clearedAt = 0;
+			/** Guards the pending invalidations. Never held while taking any other lock. */
+			std::mutex pendingMutex;
+			/** Chunks whose walkability changed since the last search. */
+			std::unordered_set<ChunkPosition> pendingChanged;
+			/** Clusters that have to be rebuilt. A change on a chunk's border also makes its neighbor's portals stale. */
+			std::unordered_set<ChunkPosition> pendingStale;
+			std::atomic_size_t cacheHits = 0;
+			std::atomic_size_t cacheMisses = 0;
+
+			/** Must be called with the unique lock held. Returns the current generation. */
+			uint64_t applyInvalidations();
+			ClusterPtr getCluster(ChunkPosition);
+			void buildCluster(Cluster &) const;
+			bool findCachedPath(const PathKey &, std::vector<Position> &);
+			/** The generation is the one the search started at, so changes made while it ran still evict the path. */
+			void cachePath(const PathKey &, const std::vector<Position> &, uint64_t search_generation);
+			bool findAbstractPath(const Position &start, const Position &goal, std::vector<Position> &path, size_t loop_max);
+
+			/** Fills distances with the walking distance within the cluster from the given tile to every other tile, or
+			 *  UINT16_MAX for unreachable tiles. The origin itself doesn't have to be walkable. */
+			static void flood(const Cluster &, Position origin, std::vector<uint16_t> &distances);
+			/** Appends the path from the origin of a flood to the given position, excluding the origin itself. */
+			static bool trace(const Cluster &, const std::vector<uint16_t> &distances, Position to, std::vector<Position> &path);
+			static size_t offset(const Cluster &, Position);
+	};
+}
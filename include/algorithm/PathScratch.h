@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Game3 {
+	/** Per-thread scratch space for grid A*. A cell's cost and parent only mean something while its stamp matches the
+	 *  current generation, so starting a new search is just a matter of bumping the generation. */
+	struct PathScratch {
+		struct HeapEntry {
+			uint32_t priority;
+			uint32_t index;
+		};
+
+		std::vector<uint32_t> stamps;
+		std::vector<uint32_t> costs;
+		std::vector<uint32_t> parents;
+		/** A 4-ary min-heap ordered by priority. */
+		std::vector<HeapEntry> heap;
+		uint32_t generation = 0;
+
+		/** Makes room for the given number of cells and forgets everything from the previous search. */
+		void begin(size_t cells);
+
+		inline bool seen(uint32_t index) const {
+			return stamps[index] == generation;
+		}
+
+		inline void visit(uint32_t index, uint32_t cost, uint32_t parent) {
+			stamps[index] = generation;
+			costs[index] = cost;
+			parents[index] = parent;
+		}
+
+		void push(HeapEntry);
+		HeapEntry pop();
+	};
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "data/ChunkCodec.h"
+#include "data/ChunkSet.h"
+#include "types/ChunkPosition.h"
+#include "types/Types.h"
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <variant>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+namespace Game3 {
+	/** Keeps copies of the chunks a client has seen on disk between sessions, keyed by server, realm and chunk position,
+	 *  along with the update counter and digest they had when they were received. The database is memory-mapped so that
+	 *  lookups don't go through read calls. Lookups and writes happen in order on a thread of their own, so the tick thread
+	 *  never waits on the database. When the cache grows past its capacity, the chunks used least recently are evicted. */
+	class ChunkCache {
+		public:
+			/** Gets the digests of the chunks that were found and the positions of the ones that weren't. */
+			using FindCallback = std::function<void(std::map<ChunkPosition, uint64_t> digests, std::set<ChunkPosition> missing)>;
+			/** Gets nothing if the cached chunk is missing or doesn't have the requested digest. */
+			using LoadCallback = std::function<void(std::optional<ChunkSet>)>;
+
+			constexpr static size_t DEFAULT_CAPACITY = 256 * 1024 * 1024;
+
+			/** The server key distinguishes chunks from different servers that share a cache file. */
+			ChunkCache(const std::filesystem::path &, std::string server_key, size_t capacity = DEFAULT_CAPACITY);
+			/** Finishes everything that's been queued before returning. */
+			~ChunkCache();
+
+			/** Looks up the digests of cached chunks. The callback is called on the cache's thread. */
+			void find(RealmID, std::set<ChunkPosition>, FindCallback);
+			/** Loads a cached chunk, whose pathmap is all zeroes. The callback is called on the cache's thread. */
+			void load(RealmID, ChunkPosition, uint64_t digest, LoadCallback);
+			/** Queues a chunk to be written. Replaces any older copy of the same chunk. The digest is computed on the writer
+			 *  thread with TileProvider::computeDigest and the given salt. */
+			void store(RealmID, ChunkPosition, uint64_t update_counter, std::string salt, ChunkSet);
+			void setCapacity(size_t);
+			/** The combined size of the stored chunks in bytes. */
+			size_t getSize() const;
+			/** Blocks until everything queued so far has been done. */
+			void flush();
+
+		private:
+			struct Store {
+				RealmID realmID;
+				ChunkPosition position;
+				uint64_t updateCounter;
+				std::string salt;
+				ChunkSet chunkSet;
+			};
+
+			struct Find {
+				RealmID realmID;
+				std::set<ChunkPosition> positions;
+				FindCallback callback;
+			};
+
+			struct Load {
+				RealmID realmID;
+				ChunkPosition position;
+				uint64_t digest;
+				LoadCallback callback;
+			};
+
+			using Job = std::variant<Store, Find, Load>;
+
+			/** Eviction removes a little more than it has to so that it doesn't run again on the next store. */
+			constexpr static double EVICTION_TARGET = 0.9;
+
+			std::string serverKey;
+			ChunkCodec codec;
+
+			mutable std::mutex databaseMutex;
+			SQLite::Database database;
+			size_t capacity;
+			size_t size = 0;
+
+			std::mutex jobMutex;
+			std::condition_variable jobReady;
+			std::condition_variable jobDone;
+			std::deque<Job> jobs;
+			size_t submitted = 0;
+			size_t completed = 0;
+			bool stopping = false;
+			std::thread thread;
+
+			void push(Job);
+			void run();
+			void process(const Store &);
+			void process(const Find &);
+			void process(const Load &);
+			std::optional<ChunkSet> loadNow(RealmID, ChunkPosition, uint64_t digest);
+			/** The caller has to hold databaseMutex. */
+			void evict();
+			static int64_t now();
+	};
+}
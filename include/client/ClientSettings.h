@@ -26,6 +26,8 @@ namespace Game3 {
 		bool renderLighting = true;
 		bool hideTimers = true;
 		int logLevel = 1;
+		/** How much disk space chunks kept between sessions may take up, in megabytes. Zero disables the cache. */
+		int chunkCacheSize = 256;
 
 		/** Applies settings to a game instance. */
 		void apply(ClientGame &) const;
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "data/ChunkSet.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+namespace Game3 {
+	/** Stored in the format column of the chunks table. */
+	enum class ChunkFormat: int {
+		/** Terrain, biomes, fluids and pathmap as raw little-endian arrays. */
+		Raw = 0,
+		/** Run-length encoded terrain and biomes and sparse fluids, each compressed with zstd. No pathmap. */
+		Compressed = 1,
+	};
+
+	/** A chunk in the compressed format. Each part is a separate zstd frame. */
+	struct EncodedChunk {
+		std::string terrain;
+		std::string biomes;
+		std::string fluids;
+	};
+
+	/** Converts chunks to and from the compressed storage format. Threadsafe. */
+	class ChunkCodec {
+		public:
+			/** A size that works well for dictionaries trained on a few thousand chunks. */
+			constexpr static size_t DEFAULT_DICTIONARY_SIZE = 112 * 1024;
+			/** zstd recommends about a hundred times the dictionary size in samples. More barely helps. */
+			constexpr static size_t MAX_SAMPLE_BYTES = 100 * DEFAULT_DICTIONARY_SIZE;
+
+			/** Collects the encoded parts of chunks one at a time, so a whole world never has to be held in memory. */
+			class DictionaryTrainer {
+				public:
+					/** Returns false once the sample buffer is full, without adding the chunk. */
+					bool add(const ChunkSet &);
+					/** Returns an empty vector if there weren't enough samples. */
+					std::vector<uint8_t> train(size_t capacity = DEFAULT_DICTIONARY_SIZE) const;
+					inline size_t getChunkCount() const { return chunkCount; }
+
+				private:
+					std::string samples;
+					std::vector<size_t> sampleSizes;
+					size_t chunkCount = 0;
+			};
+
+			ChunkCodec();
+			~ChunkCodec();
+
+			/** Compression uses the most recently added dictionary. Decompression picks whichever one a frame was made with. */
+			void addDictionary(std::span<const uint8_t>);
+			bool hasDictionary() const;
+
+			EncodedChunk encode(const ChunkSet &) const;
+			/** The pathmap of the returned chunk set is all zeroes and has to be remade. */
+			ChunkSet decode(std::span<const char> terrain, std::span<const char> biomes, std::span<const char> fluids) const;
+
+		private:
+			struct CDictDeleter { void operator()(ZSTD_CDict_s *) const; };
+			struct DDictDeleter { void operator()(ZSTD_DDict_s *) const; };
+
+			mutable std::shared_mutex mutex;
+			std::unique_ptr<ZSTD_CDict_s, CDictDeleter> compressionDictionary;
+			std::map<uint32_t, std::unique_ptr<ZSTD_DDict_s, DDictDeleter>> decompressionDictionaries;
+
+			std::string compress(const std::string &) const;
+			std::string decompress(std::span<const char>) const;
+
+			/** The uncompressed forms of each part, which are also what dictionaries are trained on. */
+			static std::string encodeTerrain(const ChunkSet &);
+			static std::string encodeBiomes(const ChunkSet &);
+			static std::string encodeFluids(const ChunkSet &);
+	};
+}
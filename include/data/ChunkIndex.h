@@ -0,0 +1,157 @@
+#pragma once
+
+#include "types/ChunkPosition.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Game3 {
+	/** An open-addressed hash map from chunk positions to heap-allocated values, using linear probing.
+	 *  Values never move once inserted, so pointers to them stay valid until they're erased. Not threadsafe. */
+	template <typename V>
+	class ChunkIndex {
+		public:
+			ChunkIndex() = default;
+
+			V * find(ChunkPosition chunk_position) const {
+				if (slots.empty())
+					return nullptr;
+
+				const size_t mask = slots.size() - 1;
+				for (size_t i = hash(chunk_position) & mask;; i = (i + 1) & mask) {
+					const Slot &slot = slots[i];
+					if (slot.value) {
+						if (slot.position == chunk_position)
+							return slot.value.get();
+					} else if (!slot.tombstone) {
+						return nullptr;
+					}
+				}
+			}
+
+			/** Returns the value at the given position and whether it was just created. */
+			std::pair<V *, bool> tryEmplace(ChunkPosition chunk_position) {
+				return insertWith(chunk_position, [] { return std::make_unique<V>(); });
+			}
+
+			/** Returns the value at the given position and whether it's the given one. If there already was a value there,
+			 *  the given one is freed. */
+			std::pair<V *, bool> tryInsert(ChunkPosition chunk_position, std::unique_ptr<V> value) {
+				return insertWith(chunk_position, [&] { return std::move(value); });
+			}
+
+			/** Returns the removed value, or null if there was nothing at the position. */
+			std::unique_ptr<V> erase(ChunkPosition chunk_position) {
+				if (slots.empty())
+					return nullptr;
+
+				const size_t mask = slots.size() - 1;
+				for (size_t i = hash(chunk_position) & mask;; i = (i + 1) & mask) {
+					Slot &slot = slots[i];
+					if (slot.value) {
+						if (slot.position == chunk_position) {
+							slot.tombstone = true;
+							--count;
+							++tombstones;
+							return std::move(slot.value);
+						}
+					} else if (!slot.tombstone) {
+						return nullptr;
+					}
+				}
+			}
+
+			void clear() {
+				slots.clear();
+				count = 0;
+				tombstones = 0;
+			}
+
+			inline size_t size() const { return count; }
+			inline bool empty() const { return count == 0; }
+
+			/** Calls function(ChunkPosition, V &) for every entry in no particular order. */
+			template <typename F>
+			void forEach(F &&function) const {
+				for (const Slot &slot: slots)
+					if (slot.value)
+						function(slot.position, *slot.value);
+			}
+
+		private:
+			struct Slot {
+				ChunkPosition position;
+				std::unique_ptr<V> value;
+				bool tombstone = false;
+			};
+
+			std::vector<Slot> slots;
+			size_t count = 0;
+			size_t tombstones = 0;
+
+			static size_t hash(ChunkPosition chunk_position) {
+				uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(chunk_position.x)) << 32) | static_cast<uint32_t>(chunk_position.y);
+				key ^= key >> 33;
+				key *= 0xff51afd7ed558ccdull;
+				key ^= key >> 33;
+				key *= 0xc4ceb9fe1a85ec53ull;
+				key ^= key >> 33;
+				return static_cast<size_t>(key);
+			}
+
+			template <typename F>
+			std::pair<V *, bool> insertWith(ChunkPosition chunk_position, F &&make) {
+				if ((count + tombstones + 1) * 4 > slots.size() * 3) {
+					// Grow if live entries are the problem; otherwise rehashing in place clears out the tombstones.
+					size_t capacity = std::max<size_t>(16, slots.size());
+					while ((count + 1) * 2 > capacity)
+						capacity *= 2;
+					rehash(capacity);
+				}
+
+				const size_t mask = slots.size() - 1;
+				Slot *reusable = nullptr;
+
+				for (size_t i = hash(chunk_position) & mask;; i = (i + 1) & mask) {
+					Slot &slot = slots[i];
+					if (slot.value) {
+						if (slot.position == chunk_position)
+							return {slot.value.get(), false};
+					} else if (slot.tombstone) {
+						if (reusable == nullptr)
+							reusable = &slot;
+					} else {
+						if (reusable == nullptr) {
+							reusable = &slot;
+						} else {
+							--tombstones;
+						}
+						reusable->position = chunk_position;
+						reusable->value = make();
+						reusable->tombstone = false;
+						++count;
+						return {reusable->value.get(), true};
+					}
+				}
+			}
+
+			/** The new capacity must be a power of two. */
+			void rehash(size_t capacity) {
+				std::vector<Slot> old_slots = std::exchange(slots, std::vector<Slot>(capacity));
+				tombstones = 0;
+				const size_t mask = capacity - 1;
+				for (Slot &old_slot: old_slots) {
+					if (!old_slot.value)
+						continue;
+					size_t i = hash(old_slot.position) & mask;
+					while (slots[i].value)
+						i = (i + 1) & mask;
+					slots[i].position = old_slot.position;
+					slots[i].value = std::move(old_slot.value);
+				}
+			}
+	};
+}
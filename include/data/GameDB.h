@@ -1,7 +1,9 @@
 #pragma once
 
 #include "types/Types.h"
+#include "data/ChunkCodec.h"
 #include "data/ChunkSet.h"
+#include "data/SnapshotWriter.h"
 #include "game/Chunk.h"
 #include "types/ChunkPosition.h"
 #include "threading/Lockable.h"
@@ -28,8 +30,27 @@ namespace Game3 {
 		private:
 			std::weak_ptr<ServerGame> weakGame;
 			std::filesystem::path path;
+			/** Accumulated by the write methods and reset by writeAllRealms. Guarded by the database lock. */
+			SaveStats saveStats;
+			Lockable<SaveStats> lastSaveStats;
+			ChunkCodec chunkCodec;
+			std::unique_ptr<SnapshotWriter> snapshotWriter;
+
+			/** The chunks and agents of a realm that need saving, with the update counters they had when they were found. */
+			struct UnsavedRealm {
+				std::shared_ptr<Realm> realm;
+				std::vector<std::pair<ChunkPosition, uint64_t>> chunks;
+				std::vector<std::pair<std::shared_ptr<TileEntity>, UpdateCounter>> tileEntities;
+				std::vector<std::pair<std::shared_ptr<Entity>, UpdateCounter>> entities;
+			};
 
 			void bind(SQLite::Statement &, const std::shared_ptr<Player> &);
+			static UnsavedRealm collectUnsaved(const std::shared_ptr<Realm> &, bool full);
+			static void markSaved(const UnsavedRealm &);
+			/** Decodes a chunk from the terrain, biomes, fluids, pathmap and format columns, which have to be in that order. */
+			ChunkSet decodeChunk(SQLite::Statement &, int first_column) const;
+			/** Only chunks in the raw format come with a pathmap. */
+			ChunkSet decodeChunk(ChunkFormat, std::span<const char> terrain, std::span<const char> biomes, std::span<const char> fluids, std::span<const char> pathmap) const;
 
 		public:
 			Lockable<std::unique_ptr<SQLite::Database>, std::recursive_mutex> database;
@@ -45,10 +66,19 @@ namespace Game3 {
 			void writeRules();
 			void readRules();
 
-			/** Writes metadata, chunk data, entity data and tile entity data for all realms. */
-			void writeAllRealms();
+			/** Writes metadata, chunk data, entity data and tile entity data for all realms.
+			 *  Unless full is true, only chunks and agents that changed since they were last saved are written. */
+			void writeAllRealms(bool full = false);
 
-			void writeRealm(const std::shared_ptr<Realm> &);
+			void writeRealm(const std::shared_ptr<Realm> &, bool full = false);
+
+			/** Captures the rules, users, villages and everything unsaved in every realm and hands them to the background
+			 *  writer, which writes them in one transaction. Must be called between ticks on the tick thread. */
+			void snapshotAll();
+			/** Queues chunks to be written by the background writer. They're marked as saved once the write is committed. */
+			void saveChunks(const std::shared_ptr<Realm> &, std::span<const ChunkPosition>);
+			/** Blocks until the background writer has written every snapshot and deletion given to it so far. */
+			void flushSnapshots();
 			void deleteRealm(std::shared_ptr<Realm>);
 
 			void writeChunk(const std::shared_ptr<Realm> &, ChunkPosition, bool use_transaction = true);
@@ -60,8 +90,14 @@ namespace Game3 {
 
 			void writeRealmMeta(const std::shared_ptr<Realm> &, bool use_transaction = true);
 
+			/** Chunks stored in the compressed format come back with an empty pathmap. */
 			std::optional<ChunkSet> getChunk(RealmID, ChunkPosition);
 
+			/** Trains a compression dictionary on up to max_samples loaded chunks, or as many as fit in
+			 *  ChunkCodec::MAX_SAMPLE_BYTES, stores it and starts compressing with it.
+			 *  Returns the size of the dictionary, or 0 if there weren't enough chunks to train on. */
+			size_t trainChunkDictionary(size_t max_samples = 4096);
+
 			bool readUser(const std::string &username, std::string *display_name_out, nlohmann::json *json_out, std::optional<Place> *release_place);
 			void writeUser(const std::string &username, const nlohmann::json &, const std::optional<Place> &release_place);
 			void writeUser(const Player &);
@@ -84,6 +120,9 @@ namespace Game3 {
 			/** Returns whether anything was found. */
 			bool readTilesetMeta(const std::string &hash, nlohmann::json &, bool do_lock = true);
 
+			/** Returns the statistics for the last completed call to writeAllRealms or snapshot. */
+			SaveStats getLastSaveStats();
+
 			inline bool isOpen() {
 				return database != nullptr;
 			}
@@ -100,6 +139,7 @@ namespace Game3 {
 					return;
 
 				assert(database);
+				flushSnapshots();
 				auto db_lock = database.uniqueLock();
 
 				SQLite::Transaction transaction{*database};
@@ -1,47 +1,78 @@
 #pragma once
 
+#include "data/IdentifierTable.h"
+
 #include <format>
+#include <optional>
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 #include <nlohmann/json_fwd.hpp>
 
 namespace Game3 {
 	class Buffer;
 
+	/** A namespaced name like "base:item/sword". Identifiers are interned: each one is a handle into the IdentifierTable,
+	 *  so copying, hashing and comparing for equality never touch the strings. */
 	struct Identifier {
-		std::string space;
-		std::string name;
-
 		Identifier() = default;
-		Identifier(const char *space_, const char *name_): space(space_), name(name_) {}
-		Identifier(std::string space_, std::string name_): space(std::move(space_)), name(std::move(name_)) {}
+		Identifier(std::string_view space_, std::string_view name_): handle(IdentifierTable::get().intern(space_, name_)) {}
+		Identifier(const char *space_, const char *name_): Identifier(std::string_view(space_), std::string_view(name_)) {}
+		Identifier(const std::string &space_, const std::string &name_): Identifier(std::string_view(space_), std::string_view(name_)) {}
 		Identifier(std::string_view);
 		Identifier(const char *);
+		explicit Identifier(IdentifierHandle handle_): handle(handle_) {}
 
 		inline explicit operator bool() const {
 			return !empty();
 		}
 
 		inline bool empty() const {
-			if (space.empty() != name.empty())
+			const IdentifierTable::Entry &entry = getEntry();
+			if (entry.space.empty() != entry.name.empty())
 				throw std::runtime_error("Partially empty identifier");
-			return space.empty();
+			return entry.space.empty();
 		}
 
 		inline explicit operator std::string() const {
-			return space + ':' + name;
+			return getEntry().combined;
 		}
 
 		inline std::string str() const {
-			return static_cast<std::string>(*this);
+			return getEntry().combined;
+		}
+
+		/** The combined string without a copy. Valid for as long as the program runs. */
+		inline const std::string & view() const {
+			return getEntry().combined;
+		}
+
+		inline const std::string & getSpace() const {
+			return getEntry().space;
+		}
+
+		inline const std::string & getName() const {
+			return getEntry().name;
+		}
+
+		inline IdentifierHandle getHandle() const {
+			return handle;
+		}
+
+		inline size_t getHash() const {
+			return getEntry().hash;
 		}
 
 		inline bool inSpace(std::string_view check) const {
-			return std::string_view(space) == check;
+			return std::string_view(getSpace()) == check;
 		}
 
+		/** Returns the identifier for a "space:name" string if it has already been interned. Never interns anything, so
+		 *  it's what untrusted input like packets goes through. */
+		static std::optional<Identifier> find(std::string_view combined);
+
 		/** Returns "foo/bar" for "base:foo/bar/baz". */
 		std::string getPath() const;
 
@@ -51,10 +82,28 @@ namespace Game3 {
 		/** Returns "baz" for "base:foo/bar/baz". */
 		std::string getPostPath() const;
 
+		/** Same as getPath() == path, without building a string. */
+		bool hasPath(std::string_view path) const;
+
+		/** Same as getPathStart() == start, without building a string. */
+		bool hasPathStart(std::string_view start) const;
+
 		bool operator==(const char *) const;
 		bool operator==(std::string_view) const;
-		bool operator==(const Identifier &) const;
+
+		inline bool operator==(const Identifier &other) const {
+			return handle == other.handle;
+		}
+
+		/** Orders by space and then name, as before interning, so that anything sorted by identifier keeps its order. */
 		bool operator<(const Identifier &) const;
+
+		private:
+			IdentifierHandle handle;
+
+			inline const IdentifierTable::Entry & getEntry() const {
+				return IdentifierTable::get()[handle];
+			}
 	};
 
 	std::ostream & operator<<(std::ostream &, const Identifier &);
@@ -75,7 +124,7 @@ namespace Game3 {
 template <>
 struct std::hash<Game3::Identifier> {
 	size_t operator()(const Game3::Identifier &identifier) const {
-		return std::hash<std::string>()(static_cast<std::string>(identifier));
+		return identifier.getHash();
 	}
 };
 
@@ -86,6 +135,6 @@ struct std::formatter<Game3::Identifier> {
 	}
 
 	auto format(const auto &identifier, std::format_context &ctx) const {
-		return std::format_to(ctx.out(), "{}:{}", identifier.space, identifier.name);
+		return std::format_to(ctx.out(), "{}", identifier.view());
 	}
 };
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Game3 {
+	/** An identifier's index in the IdentifierTable. Two handles are equal exactly when their identifiers are. The
+	 *  default handle is the empty identifier. */
+	struct IdentifierHandle {
+		uint32_t index = 0;
+
+		auto operator<=>(const IdentifierHandle &) const = default;
+	};
+
+	/** Every identifier that has ever been constructed, each stored once. Entries are never removed or moved, so their
+	 *  strings can be referred to for as long as the program runs. Reading an entry doesn't lock. Threadsafe. */
+	class IdentifierTable {
+		public:
+			struct Entry {
+				std::string space;
+				std::string name;
+				/** "space:name", which is what identifiers look like in JSON and on the wire. */
+				std::string combined;
+				/** The hash of the combined string, the same value std::hash<Identifier> produced before interning. */
+				size_t hash = 0;
+			};
+
+			/** Interning more identifiers than this throws std::length_error. Identifiers read from the network are only
+			 *  looked up, never interned, so this is a backstop rather than what keeps peers from filling the table. */
+			constexpr static size_t MAX_SIZE = 1 << 20;
+
+			/** Never destroyed, so that identifiers in static storage stay valid during shutdown. */
+			static IdentifierTable & get();
+
+			IdentifierHandle intern(std::string_view space, std::string_view name);
+			/** Looks up a "space:name" string without interning it. */
+			std::optional<IdentifierHandle> find(std::string_view combined) const;
+
+			inline const Entry & operator[](IdentifierHandle handle) const {
+				return blocks[handle.index / BLOCK_SIZE].load(std::memory_order_acquire)[handle.index % BLOCK_SIZE];
+			}
+
+			size_t size() const;
+
+		private:
+			constexpr static size_t BLOCK_SIZE = 4096;
+			constexpr static size_t BLOCK_COUNT = MAX_SIZE / BLOCK_SIZE;
+
+			struct StringHash {
+				using is_transparent = void;
+				inline size_t operator()(std::string_view string) const { return std::hash<std::string_view>()(string); }
+			};
+
+			/** Entries live in fixed-size blocks that are allocated as needed and never freed. */
+			std::array<std::atomic<Entry *>, BLOCK_COUNT> blocks{};
+			mutable std::shared_mutex mutex;
+			/** Keys are views of the entries' combined strings. */
+			std::unordered_map<std::string_view, uint32_t, StringHash, std::equal_to<>> indices;
+			uint32_t count = 0;
+
+			IdentifierTable();
+	};
+}
+
+/** Indices are unique, so they hash to themselves. Unlike std::hash<Identifier>, this depends on the order identifiers
+ *  were interned in, so containers keyed by handles shouldn't be iterated where the order matters. */
+template <>
+struct std::hash<Game3::IdentifierHandle> {
+	size_t operator()(Game3::IdentifierHandle handle) const {
+		return handle.index;
+	}
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Constants.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace Game3 {
+	/** An immutable, compact copy of a chunk's worth of values: a sorted palette of the distinct values and an index into
+	 *  it for each tile, packed into 1, 2, 4 or 8 bits. A chunk with only one distinct value stores no indices at all.
+	 *  Not threadsafe, but safe to read from multiple threads. */
+	template <typename T>
+	class PalettedChunk {
+		public:
+			constexpr static size_t TILE_COUNT = CHUNK_SIZE * CHUNK_SIZE;
+			constexpr static size_t MAX_PALETTE_SIZE = 256;
+
+			PalettedChunk() = default;
+
+			/** Returns nothing if there are too many distinct values or the input isn't a full chunk. */
+			static std::optional<PalettedChunk> pack(std::span<const T> values) {
+				if (values.size() != TILE_COUNT)
+					return std::nullopt;
+
+				PalettedChunk out;
+
+				// Most chunks are a single value throughout, so that case is checked before paying for a sort.
+				if (std::all_of(values.begin() + 1, values.end(), [&](const T &value) { return value == values[0]; })) {
+					out.palette.assign(1, values[0]);
+					return out;
+				}
+
+				out.palette.assign(values.begin(), values.end());
+				std::sort(out.palette.begin(), out.palette.end());
+				out.palette.erase(std::unique(out.palette.begin(), out.palette.end()), out.palette.end());
+				if (MAX_PALETTE_SIZE < out.palette.size())
+					return std::nullopt;
+				out.palette.shrink_to_fit();
+
+				out.bits = 1;
+				while ((size_t(1) << out.bits) < out.palette.size())
+					out.bits *= 2;
+
+				out.words.assign(TILE_COUNT * out.bits / 64, 0);
+				for (size_t i = 0; i < TILE_COUNT; ++i) {
+					const uint64_t index = std::lower_bound(out.palette.begin(), out.palette.end(), values[i]) - out.palette.begin();
+					const size_t bit = i * out.bits;
+					out.words[bit / 64] |= index << (bit % 64);
+				}
+
+				return out;
+			}
+
+			inline T operator[](size_t index) const {
+				if (bits == 0)
+					return palette[0];
+				const size_t bit = index * bits;
+				return palette[(words[bit / 64] >> (bit % 64)) & ((uint64_t(1) << bits) - 1)];
+			}
+
+			void unpack(std::vector<T> &out) const {
+				if (bits == 0) {
+					out.assign(TILE_COUNT, palette[0]);
+					return;
+				}
+
+				out.resize(TILE_COUNT);
+				for (size_t i = 0; i < TILE_COUNT; ++i)
+					out[i] = (*this)[i];
+			}
+
+			inline bool empty() const { return palette.empty(); }
+			inline size_t getBitsPerTile() const { return bits; }
+
+			inline size_t getMemoryUsage() const {
+				return palette.capacity() * sizeof(T) + words.capacity() * sizeof(uint64_t);
+			}
+
+			void clear() {
+				palette = {};
+				words = {};
+				bits = 0;
+			}
+
+		private:
+			std::vector<T> palette;
+			std::vector<uint64_t> words;
+			/** Zero if the palette has a single entry. */
+			uint8_t bits = 0;
+	};
+}
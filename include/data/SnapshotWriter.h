@@ -0,0 +1,165 @@
+#pragma once
+
+#include "data/ChunkSet.h"
+#include "types/ChunkPosition.h"
+#include "types/Position.h"
+#include "types/Types.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+namespace Game3 {
+	class ChunkCodec;
+
+	struct SaveStats {
+		size_t chunks = 0;
+		size_t tileEntities = 0;
+		size_t entities = 0;
+		/** The combined size of the chunk, tile entity and entity data written. */
+		size_t bytes = 0;
+		/** How long the world was held up while the data was gathered. Zero for saves that write as they go. */
+		std::chrono::nanoseconds captureDuration{};
+		std::chrono::nanoseconds duration{};
+	};
+
+	/** Everything an autosave writes, encoded ahead of time so that it can be written without touching the world. */
+	struct WorldSnapshot {
+		struct RealmRow {
+			RealmID realmID;
+			std::string json;
+			std::string tilesetHash;
+		};
+
+		struct TilesetRow {
+			std::string hash;
+			std::string json;
+		};
+
+		struct ChunkRow {
+			RealmID realmID;
+			ChunkPosition position;
+			/** Compressed on the writer thread. */
+			ChunkSet chunkSet;
+		};
+
+		struct TileEntityRow {
+			GlobalID globalID;
+			RealmID realmID;
+			Position position;
+			std::string tileID;
+			std::string tileEntityID;
+			std::vector<uint8_t> encoded;
+		};
+
+		struct EntityRow {
+			GlobalID globalID;
+			RealmID realmID;
+			Position position;
+			std::string type;
+			int direction;
+			std::vector<uint8_t> encoded;
+		};
+
+		struct RuleRow {
+			std::string key;
+			int64_t value;
+		};
+
+		struct UserRow {
+			std::string username;
+			std::string displayName;
+			std::string json;
+		};
+
+		struct VillageRow {
+			int64_t villageID;
+			RealmID realmID;
+			std::string chunkPosition;
+			std::string position;
+			std::string options;
+			std::string richness;
+			std::string resources;
+			std::string name;
+			int64_t labor;
+			double randomValue;
+			double greed;
+		};
+
+		std::vector<RealmRow> realms;
+		std::vector<TilesetRow> tilesets;
+		std::vector<ChunkRow> chunks;
+		std::vector<TileEntityRow> tileEntities;
+		std::vector<EntityRow> entities;
+		std::vector<RuleRow> rules;
+		std::vector<UserRow> users;
+		std::vector<VillageRow> villages;
+		std::chrono::nanoseconds captureDuration{};
+		/** Called on the writer thread once every row has been committed. */
+		std::function<void(const SaveStats &)> onCommit;
+	};
+
+	/** Writes snapshots into the database on a thread of its own, through a separate connection with prepared statements
+	 *  that are reused between snapshots. Each snapshot is written in a single transaction, so the database never holds
+	 *  half of one. Deletions go through the same queue so that they can't be undone by an older snapshot that's still
+	 *  waiting to be written. */
+	class SnapshotWriter {
+		public:
+			/** The database has to exist already and be in WAL mode. The codec has to outlive the writer. */
+			SnapshotWriter(const std::filesystem::path &, const ChunkCodec &);
+			/** Finishes everything that's been queued before returning. */
+			~SnapshotWriter();
+
+			void submit(WorldSnapshot);
+			void deleteTileEntity(GlobalID);
+			void deleteEntity(GlobalID);
+			/** Blocks until everything queued so far has been written. */
+			void flush();
+
+		private:
+			struct Deletion {
+				enum class Kind {TileEntity, Entity};
+				Kind kind;
+				GlobalID globalID;
+			};
+
+			using Job = std::variant<WorldSnapshot, Deletion>;
+
+			const ChunkCodec &codec;
+			SQLite::Database database;
+			SQLite::Statement insertRealm;
+			SQLite::Statement insertTileset;
+			SQLite::Statement insertChunk;
+			SQLite::Statement insertTileEntity;
+			SQLite::Statement insertEntity;
+			SQLite::Statement insertRule;
+			SQLite::Statement insertUser;
+			SQLite::Statement insertVillage;
+			SQLite::Statement removeTileEntity;
+			SQLite::Statement removeEntity;
+
+			std::mutex mutex;
+			std::condition_variable jobReady;
+			std::condition_variable jobDone;
+			std::deque<Job> jobs;
+			size_t submitted = 0;
+			size_t completed = 0;
+			bool stopping = false;
+			std::thread thread;
+
+			void push(Job);
+			void run();
+			void write(WorldSnapshot &);
+			void write(const Deletion &);
+	};
+}
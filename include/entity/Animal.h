@@ -6,7 +6,6 @@
 #include <random>
 
 #include "entity/LivingEntity.h"
-#include "threading/ThreadPool.h"
 
 namespace Game3 {
 	class Building;
@@ -22,7 +21,6 @@ namespace Game3 {
 			void updateRiderOffset(const std::shared_ptr<Entity> &rider) override;
 			bool onInteractOn(const std::shared_ptr<Player> &, Modifiers, const ItemStackPtr &, Hand) override;
 			bool onInteractNextTo(const std::shared_ptr<Player> &, Modifiers, const ItemStackPtr &, Hand) override;
-			void init(const std::shared_ptr<Game> &) override;
 			void tick(const TickArgs &) override;
 			float getMovementSpeed() const override { return 5.f; }
 			HitPoints getMaxHealth() const override;
@@ -36,8 +34,7 @@ namespace Game3 {
 			bool firstWander = true;
 			Tick wanderTick = 0;
 			std::optional<std::list<Direction>> wanderPath;
+			/** Set while a wander pathfind is queued and cleared once the queue is done with it, however that happens. */
 			std::atomic_bool attemptingWander = false;
-
-			static ThreadPool threadPool;
 	};
 }
@@ -45,6 +45,7 @@ namespace Game3 {
 	class Realm;
 	class RemoteClient;
 	class TileEntity;
+	struct PathRequest;
 	struct RendererContext;
 
 	enum class RideType {
@@ -160,6 +161,11 @@ namespace Game3 {
 			void queueDestruction();
 			PathResult pathfind(const Position &start, const Position &goal, std::list<Direction> &, size_t loop_max = 1'000);
 			bool pathfind(const Position &goal, size_t loop_max = 1'000);
+			/** Has the realm solve the path with the rest of its queued pathfinds at the end of the tick.
+			 *  The callback is given the same result pathfind would return. */
+			void queuePathfind(const Position &goal, size_t loop_max = 1'000, std::function<void(bool)> on_done = {});
+			/** Follows a path solved by the realm's batched pathfinding. */
+			bool usePath(const PathRequest &);
 			virtual float getMovementSpeed() const;
 			std::shared_ptr<Game> getGame() const override;
 			bool isVisible() const;
@@ -276,6 +282,9 @@ namespace Game3 {
 			Lockable<WeakSet<Player>> pathSeers;
 
 			bool setHeld(Slot, Held &);
+			PathResult followPath(const Position &goal, const std::vector<Position> &, std::list<Direction> &);
+			/** Sends the new path to visible players if pathfinding succeeded. */
+			bool finishPathfind(PathResult);
 	};
 
 	void to_json(nlohmann::json &, const Entity &);
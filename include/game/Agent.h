@@ -16,6 +16,8 @@ namespace Game3 {
 
 	struct AgentMeta {
 		UpdateCounter updateCounter = 0;
+		/** The update counter as of the last time the agent was written to the database. */
+		std::optional<UpdateCounter> savedCounter;
 		AgentMeta() = default;
 		AgentMeta(UpdateCounter counter): updateCounter(counter) {}
 	};
@@ -71,6 +73,17 @@ namespace Game3 {
 				agentMeta.updateCounter = new_counter;
 			}
 
+			/** Whether the agent has changed since it was last marked as saved. */
+			inline bool isUnsaved() {
+				auto lock = agentMeta.sharedLock();
+				return agentMeta.savedCounter != agentMeta.updateCounter;
+			}
+
+			inline void markSaved(UpdateCounter counter) {
+				auto lock = agentMeta.uniqueLock();
+				agentMeta.savedCounter = counter;
+			}
+
 			bool hasBeenSentTo(const std::shared_ptr<Player> &);
 			void onSend(const std::shared_ptr<Player> &);
 
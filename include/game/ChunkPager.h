@@ -0,0 +1,40 @@
+#pragma once
+
+#include "game/TileProvider.h"
+#include "types/ChunkPosition.h"
+
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Game3 {
+	/** Decides which of a tile provider's chunks to page out. A chunk stays resident while it's pinned and for an idle
+	 *  period afterwards. While more chunks are resident than the budget allows, unpinned chunks go in the order they
+	 *  were last pinned. Not threadsafe. */
+	class ChunkPager {
+		public:
+			using Clock = std::chrono::steady_clock;
+
+			/** How much memory a resident chunk takes up at most. Chunks packed by TileProvider::compact take up much less. */
+			constexpr static size_t CHUNK_BYTES = sizeof(ChunkRecord) + CHUNK_SIZE * CHUNK_SIZE *
+				(LAYER_COUNT * sizeof(TileID) + sizeof(BiomeType) + sizeof(uint8_t) + sizeof(FluidTile));
+
+			struct Settings {
+				/** The most chunks to keep resident, or zero for no limit. */
+				size_t budget = 0;
+				std::chrono::seconds idleTime{300};
+			};
+
+			ChunkPager(const TileProvider &);
+
+			/** Returns the unpinned chunks that should be paged out, least recently pinned first. Chunks with unsaved
+			 *  changes are included; TileProvider::pageOut won't drop those until they've been saved. */
+			std::vector<ChunkPosition> collect(const std::unordered_set<ChunkPosition> &pinned, const Settings &, Clock::time_point now = Clock::now());
+
+		private:
+			const TileProvider &provider;
+			/** Resident chunks that haven't been pinned since they became resident count as pinned when first seen. */
+			std::unordered_map<ChunkPosition, Clock::time_point> lastPinned;
+	};
+}
@@ -1,17 +1,24 @@
 #pragma once
 
+#include "data/ChunkSet.h"
 #include "game/Game.h"
 #include "threading/Atomic.h"
+#include "threading/MPSCQueue.h"
 #include "ui/Modifiers.h"
 #include "ui/Sound.h"
 
 #include <atomic>
 #include <condition_variable>
+#include <filesystem>
 #include <functional>
+#include <map>
 #include <memory>
+#include <optional>
+#include <set>
 #include <thread>
 
 namespace Game3 {
+	class ChunkCache;
 	class HasEnergy;
 	class HasFluids;
 	class HasInventory;
@@ -26,7 +33,7 @@ namespace Game3 {
 			SoundEngine sounds;
 			bool suppressDisconnectionMessage = false;
 
-			ClientGame(Canvas &canvas_): Game(), canvas(canvas_) {}
+			ClientGame(Canvas &);
 			~ClientGame() override;
 
 			double getFrequency() const override;
@@ -47,6 +54,16 @@ namespace Game3 {
 			bool tick() final;
 			void queuePacket(std::shared_ptr<Packet>);
 			void chunkReceived(ChunkPosition);
+			/** Opens the on-disk chunk cache for the server the client is connected to. */
+			void openChunkCache(const std::filesystem::path &, std::string server_key, size_t capacity);
+			inline ChunkCache * getChunkCache() const { return chunkCache.get(); }
+			/** Queues a copy of a chunk to be written to the chunk cache, if there is one. */
+			void cacheChunk(Realm &, ChunkPosition);
+			/** Marks a chunk's cached copy as out of date after a tile or fluid update. It's rewritten a little later. */
+			void chunkChanged(RealmID, ChunkPosition);
+			/** Loads a chunk the server confirmed as current from the chunk cache in the background. It's applied on the tick
+			 *  thread once it's ready, or requested in full if the cached copy is gone. */
+			void loadCachedChunk(RealmID, ChunkPosition, uint64_t update_counter, uint64_t digest);
 			void interactOn(Modifiers, Hand = Hand::None);
 			void interactNextTo(Modifiers, Hand = Hand::None);
 			void putInLimbo(EntityPtr, RealmID, const Position &);
@@ -98,13 +115,33 @@ namespace Game3 {
 			std::thread tickThread;
 			std::optional<Position> lastDragPosition;
 			float lastGarbageCollection = 0;
+			float lastCacheRefresh = 0;
+
+			struct CachedChunk {
+				RealmID realmID;
+				ChunkPosition position;
+				uint64_t updateCounter;
+				std::optional<ChunkSet> chunkSet;
+			};
 
 			Lockable<std::set<ChunkPosition>> missingChunks;
-			MTQueue<std::shared_ptr<Packet>> packetQueue;
+			/** Chunks changed by tile and fluid updates since they were last written to the chunk cache. Tick thread only. */
+			std::set<std::pair<RealmID, ChunkPosition>> staleCachedChunks;
+			/** Chunks being loaded from the chunk cache, and whether an update for them arrived in the meantime. Tick thread only. */
+			std::map<std::pair<RealmID, ChunkPosition>, bool> loadingCachedChunks;
+			/** Filled by the chunk cache's thread. Declared before the cache so that it outlives the cache's last callback. */
+			MPSCQueue<CachedChunk> loadedCachedChunks;
+			std::unique_ptr<ChunkCache> chunkCache;
+			MPSCQueue<std::shared_ptr<Packet>> packetQueue;
 			/** Temporarily stores shared pointers to entities that have moved to a realm we're unaware of to prevent destruction. */
 			Lockable<std::unordered_map<RealmID, std::unordered_map<EntityPtr, Position>>> entityLimbo;
 
 			void garbageCollect();
+			/** Asks for cached chunks by digest and for the rest in full. The cache is consulted on its own thread. */
+			void requestChunks(Realm &, const std::set<ChunkPosition> &);
+			void applyCachedChunks();
+			/** Writes chunks changed since they were cached back to the chunk cache. */
+			void refreshCachedChunks();
 	};
 
 	using ClientGamePtr = std::shared_ptr<ClientGame>;
@@ -11,6 +11,7 @@
 #include "types/TickArgs.h"
 #include "types/Types.h"
 
+#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <functional>
@@ -99,6 +100,7 @@ namespace Game3 {
 			void traverseData(const std::filesystem::path &);
 			void loadData(const nlohmann::json &);
 			void addRecipe(const nlohmann::json &);
+			/** Reserves an unused realm ID. Safe to call from any thread; IDs handed out but not yet added are never reused. */
 			RealmID newRealmID() const;
 			double getTotalSeconds() const;
 			double getHour() const;
@@ -123,7 +125,10 @@ namespace Game3 {
 
 			virtual Side getSide() const = 0;
 
-			inline void clearFluidCache() { fluidCache.clear(); }
+			inline void clearFluidCache() {
+				auto lock = fluidCache.uniqueLock();
+				fluidCache.clear();
+			}
 
 			using GameArgument = std::variant<Canvas *, std::pair<std::shared_ptr<Server>, size_t>>;
 
@@ -162,7 +167,10 @@ namespace Game3 {
 			void associateWithRealm(const VillagePtr &, RealmID) override;
 
 		private:
-			std::unordered_map<FluidID, TileID> fluidCache;
+			/** Filled lazily, possibly by several realm ticks at once. */
+			Lockable<std::unordered_map<FluidID, TileID>> fluidCache;
+			/** The last ID returned by newRealmID. */
+			mutable std::atomic<RealmID> lastRealmID = 1;
 
 		public:
 			std::shared_ptr<TileRegistry> tileRegistry;
@@ -1,14 +1,13 @@
 #pragma once
 
 #include "game/SimulationOptions.h"
+#include "game/TickWheel.h"
 #include "threading/Atomic.h"
-#include "threading/Lockable.h"
 #include "types/Types.h"
 #include "util/Concepts.h"
 
 #include <chrono>
 #include <functional>
-#include <map>
 
 namespace Game3 {
 	template <typename... FunctionArgs>
@@ -32,52 +31,60 @@ namespace Game3 {
 				return currentTick;
 			}
 
+			using TaskHandle = typename TickWheel<FunctionArgs...>::Handle;
+
 			Tick enqueue(std::function<void(FunctionArgs...)> function) {
-				tickQueue.emplace(currentTick + 1, std::move(function));
-				return currentTick + 1;
+				const Tick tick = currentTick + 1;
+				tickWheel.schedule(tick, std::move(function));
+				return tick;
 			}
 
 			template <Duration D>
 			Tick enqueue(std::function<void(FunctionArgs...)> function, D delay) {
 				const Tick tick = currentTick + getDelayTicks(delay);
-				tickQueue.emplace(tick, std::move(function));
+				tickWheel.schedule(tick, std::move(function));
 				return tick;
 			}
 
 			template <typename Function, Duration D>
 			requires (!std::is_same_v<Function, std::function<void(FunctionArgs...)>>)
 			Tick enqueue(Function function, D delay) {
-				auto lock = tickQueue.uniqueLock();
 				const Tick tick = currentTick + getDelayTicks(delay);
-				tickQueue.emplace(tick, [function = std::move(function)](FunctionArgs &&...args) {
-					function(std::forward<FunctionArgs>(args)...);
-				});
+				tickWheel.schedule(tick, std::move(function));
 				return tick;
 			}
 
 			template <typename Function>
 			requires (!std::is_same_v<Function, std::function<void(FunctionArgs...)>>)
 			Tick enqueue(Function function) {
-				auto lock = tickQueue.uniqueLock();
-				tickQueue.emplace(currentTick + 1, [function = std::move(function)](FunctionArgs &&...args) {
-					function(std::forward<FunctionArgs>(args)...);
-				});
-				return currentTick + 1;
+				const Tick tick = currentTick + 1;
+				tickWheel.schedule(tick, std::move(function));
+				return tick;
+			}
+
+			/** Like enqueue, but returns a handle that can be passed to cancel. */
+			template <typename Function, Duration D>
+			TaskHandle schedule(Function function, D delay) {
+				return tickWheel.schedule(currentTick + getDelayTicks(delay), std::move(function));
+			}
+
+			/** Returns whether the task was stopped before it ran. */
+			bool cancel(TaskHandle handle) {
+				return tickWheel.cancel(handle);
+			}
+
+			inline size_t getQueuedCount() const {
+				return tickWheel.size();
 			}
 
 		private:
 			Atomic<Tick> currentTick = 0;
-			Lockable<std::multimap<Tick, std::function<void(FunctionArgs...)>>> tickQueue;
+			TickWheel<FunctionArgs...> tickWheel;
 
 			template <typename... Args>
 			void dequeueAll(Args &&...args) {
-				auto lock = tickQueue.uniqueLock();
-
-				// Call and remove all queued functions that should execute now or should've been executed by now.
-				for (auto iter = tickQueue.begin(); iter != tickQueue.end() && iter->first <= currentTick;) {
-					iter->second(std::forward<Args>(args)...);
-					iter = tickQueue.erase(iter);
-				}
+				// Call all queued functions that should execute now or should've been executed by now.
+				tickWheel.dispatch(currentTick, std::forward<Args>(args)...);
 			}
 
 			template <Duration D>
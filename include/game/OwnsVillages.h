@@ -16,6 +16,7 @@ namespace Game3 {
 	class Village;
 	struct Place;
 	struct VillageOptions;
+	struct WorldSnapshot;
 
 	using VillagePtr = std::shared_ptr<Village>;
 
@@ -26,9 +27,14 @@ namespace Game3 {
 
 			VillageID getNewVillageID();
 			VillagePtr getVillage(VillageID id) const;
+			/** Creates a new village. One created in a staging realm is kept there until its chunks are committed. */
 			VillagePtr addVillage(Game &, ChunkPosition, const Place &, const VillageOptions &);
+			/** Adds a village that was created in a staging realm. */
+			void addVillage(const VillagePtr &);
 			VillagePtr addVillage(Game &, VillageID, std::string name, RealmID, ChunkPosition, const Position &, Resources = {});
 			void saveVillages(SQLite::Database &, bool use_transaction = true);
+			/** Adds every village to a snapshot for the background writer. */
+			void snapshotVillages(WorldSnapshot &) const;
 			void loadVillages(const std::shared_ptr<Game> &, SQLite::Database &);
 
 		protected:
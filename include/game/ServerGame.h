@@ -4,19 +4,24 @@
 #include "entity/ServerPlayer.h"
 #include "game/Fluids.h"
 #include "game/Game.h"
+#include "net/PreencodedPacket.h"
 #include "net/RemoteClient.h"
 #include "threading/Lockable.h"
-#include "threading/MTQueue.h"
+#include "threading/MPSCQueue.h"
 #include "threading/ThreadPool.h"
 
+#include <atomic>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 namespace Game3 {
 	class Packet;
@@ -46,6 +51,8 @@ namespace Game3 {
 			void broadcastFluidUpdate(RealmID, const Position &, FluidTile);
 			Side getSide() const override { return Side::Server; }
 			void queuePacket(std::shared_ptr<RemoteClient>, std::shared_ptr<Packet>);
+			/** Queues every packet decoded from one read at once. */
+			void queuePackets(const std::shared_ptr<RemoteClient> &, std::vector<std::shared_ptr<Packet>> &&);
 			void runCommand(RemoteClient &, const std::string &, GlobalID);
 			void entityChangingRealms(Entity &, const RealmPtr &new_realm, const Position &new_position);
 			void entityTeleported(Entity &, MovementContext);
@@ -64,6 +71,16 @@ namespace Game3 {
 			void removeRealm(RealmPtr) override;
 			bool compareToken(Token);
 			Token getOmnitoken() const;
+			/** Runs the action immediately unless realms are being ticked in parallel, in which case it's run after they've all finished.
+			 *  While realms tick in parallel, a realm's tick may only change that realm directly. It can still use the other
+			 *  realms' queue functions, packet sending, the Lockable player and rule lists, newRealmID, addRealm and the
+			 *  database. Anything else that reaches into another realm (teleports, removing realms) goes through here. */
+			void queueCrossRealmAction(std::function<void()>);
+
+			inline bool isTickingRealmsInParallel() const { return tickingRealmsInParallel; }
+			/** Realms are ticked serially on the tick thread if the pool has no workers. */
+			inline size_t getTickThreadCount() const { return pool.getSize(); }
+			inline ThreadPool & getPagingPool() { return pagingPool; }
 
 			std::shared_ptr<ServerGame> getSelf() { return std::static_pointer_cast<ServerGame>(shared_from_this()); }
 			std::shared_ptr<const ServerGame> getSelf() const { return std::static_pointer_cast<const ServerGame>(shared_from_this()); }
@@ -79,26 +96,38 @@ namespace Game3 {
 				return *database;
 			}
 
+			/** Sends a packet to the players who can see the given place. Only the players subscribed to the place's chunk
+			 *  are checked, and the packet is encoded once for all of them. */
 			template <typename P>
 			void broadcast(const Place &place, const P &packet) {
-				auto lock = players.sharedLock();
-				for (const ServerPlayerPtr &player: players)
-					if (player->canSee(place.realm->id, place.position))
-						if (std::shared_ptr<RemoteClient> client = player->toServer()->weakClient.lock())
-							client->send(packet);
+				std::optional<PreencodedPacket> encoded;
+				for (const PlayerPtr &player: place.realm->getSubscribers(place.position.getChunk())) {
+					if (player->canSee(place.realm->id, place.position)) {
+						if (std::shared_ptr<RemoteClient> client = player->toServer()->weakClient.lock()) {
+							if (!encoded)
+								encoded.emplace(*this, packet);
+							client->send(*encoded);
+						}
+					}
+				}
 			}
 
 			static Token generateRandomToken();
 
 		private:
-			MTQueue<std::pair<std::weak_ptr<RemoteClient>, std::shared_ptr<Packet>>> packetQueue;
-			MTQueue<std::weak_ptr<ServerPlayer>> playerRemovalQueue;
+			MPSCQueue<std::pair<std::weak_ptr<RemoteClient>, std::shared_ptr<Packet>>> packetQueue;
+			MPSCQueue<std::weak_ptr<ServerPlayer>> playerRemovalQueue;
+			MPSCQueue<std::function<void()>> crossRealmQueue;
+			std::atomic_bool tickingRealmsInParallel = false;
 			double timeSinceTimeUpdate = 0;
 			ThreadPool pool;
+			/** Reads paged-out chunks back in the background. */
+			ThreadPool pagingPool{1};
 			std::unique_ptr<GameDB> database;
 			Token omnitoken = generateRandomToken();
 
 			void handlePacket(RemoteClient &, Packet &);
+			void tickRealms();
 			std::tuple<bool, std::string> commandHelper(RemoteClient &, const std::string &);
 	};
 
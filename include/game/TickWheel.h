@@ -0,0 +1,342 @@
+#pragma once
+
+#include "types/Types.h"
+#include "util/Defer.h"
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Game3 {
+	/** A hierarchical timing wheel of callbacks keyed by tick. Scheduling and cancelling are O(1); advancing costs O(1) per
+	 *  elapsed tick plus the tasks that come due. Tasks live in pooled nodes that store small callables inline, so
+	 *  scheduling usually doesn't allocate. Tasks run in the order they come due, and in the order they were scheduled
+	 *  within a tick. Scheduling and cancelling are threadsafe; dispatching has to happen on one thread at a time. */
+	template <typename... Args>
+	class TickWheel {
+		private:
+			struct Task;
+
+		public:
+			/** Identifies a scheduled task. Goes stale once the task has run or been cancelled. */
+			struct Handle {
+				Task *task = nullptr;
+				uint32_t generation = 0;
+
+				explicit operator bool() const { return task != nullptr; }
+			};
+
+			struct DispatchStats {
+				size_t executed = 0;
+				/** Tasks that ran on a later tick than the one they were scheduled for. */
+				size_t late = 0;
+			};
+
+			TickWheel() = default;
+
+			TickWheel(const TickWheel &) = delete;
+			TickWheel(TickWheel &&) = delete;
+
+			~TickWheel() {
+				for (auto &level: slots)
+					for (const List &list: level)
+						destroyList(list);
+				destroyList(overflow);
+				destroyList(running);
+			}
+
+			TickWheel & operator=(const TickWheel &) = delete;
+			TickWheel & operator=(TickWheel &&) = delete;
+
+			/** Tasks scheduled for a tick that has already been dispatched run at the next dispatch. */
+			template <typename F>
+			Handle schedule(Tick due, F &&function) {
+				std::unique_lock lock(mutex);
+				Task *task = allocate();
+				store(*task, std::forward<F>(function));
+				task->due = due;
+				task->state.store(Task::SCHEDULED, std::memory_order_relaxed);
+				insert(task, now + 1);
+				++scheduled;
+				return {task, task->generation};
+			}
+
+			/** Returns whether the task was stopped from running. */
+			bool cancel(Handle handle) {
+				if (!handle)
+					return false;
+
+				std::unique_lock lock(mutex);
+				Task *task = handle.task;
+
+				if (task->generation != handle.generation)
+					return false;
+
+				if (task->list == &running) {
+					// The task has already been handed to the dispatcher, which will skip it.
+					uint8_t expected = Task::SCHEDULED;
+					return task->state.compare_exchange_strong(expected, Task::CANCELLED);
+				}
+
+				unlink(task);
+				release(task);
+				--scheduled;
+				return true;
+			}
+
+			/** Runs every task due at or before the given tick. Tasks are run without the wheel locked, so they're free to
+			 *  schedule more tasks. If a task throws, the exception propagates and the tasks it cut off run at the next
+			 *  dispatch. */
+			template <typename... CallArgs>
+			DispatchStats dispatch(Tick to, CallArgs &&...args) {
+				DispatchStats stats;
+
+				{
+					std::unique_lock lock(mutex);
+					assert(running.head == nullptr);
+					advance(to);
+					if (running.head == nullptr)
+						return stats;
+				}
+
+				Defer finish([this] { finishDispatch(); });
+
+				for (Task *task = running.head; task != nullptr; task = task->next) {
+					uint8_t expected = Task::SCHEDULED;
+					if (!task->state.compare_exchange_strong(expected, Task::RUNNING))
+						continue;
+					++stats.executed;
+					if (task->due < to)
+						++stats.late;
+					task->invoke(*task, args...);
+				}
+
+				return stats;
+			}
+
+			/** The number of tasks waiting to come due. */
+			size_t size() const {
+				std::unique_lock lock(mutex);
+				return scheduled;
+			}
+
+		private:
+			constexpr static size_t BITS = 8;
+			constexpr static size_t SLOTS = size_t(1) << BITS;
+			constexpr static size_t LEVELS = 4;
+			constexpr static Tick MASK = SLOTS - 1;
+			constexpr static size_t INLINE_SIZE = 48;
+			constexpr static size_t BLOCK_SIZE = 256;
+
+			/** Tasks are appended, so each list runs in the order its tasks were scheduled. */
+			struct List {
+				Task *head = nullptr;
+				Task *tail = nullptr;
+			};
+
+			struct Task {
+				constexpr static uint8_t SCHEDULED = 0;
+				constexpr static uint8_t RUNNING   = 1;
+				constexpr static uint8_t CANCELLED = 2;
+
+				Task *prev = nullptr;
+				Task *next = nullptr;
+				/** The list the task is in, or null if it's free. */
+				List *list = nullptr;
+				Tick due = 0;
+				uint32_t generation = 0;
+				std::atomic_uint8_t state = SCHEDULED;
+				void (*invoke)(Task &, Args...) = nullptr;
+				void (*destroy)(Task &) = nullptr;
+				alignas(std::max_align_t) std::byte storage[INLINE_SIZE];
+			};
+
+			mutable std::mutex mutex;
+			std::array<std::array<List, SLOTS>, LEVELS> slots{};
+			/** Tasks too far in the future for the top level. */
+			List overflow;
+			/** Tasks taken out of the wheel by the dispatch in progress, in the order they came due. */
+			List running;
+			/** The last tick that was dispatched. */
+			Tick now = 0;
+			size_t scheduled = 0;
+			std::vector<std::unique_ptr<Task[]>> blocks;
+			Task *freeList = nullptr;
+
+			template <typename F>
+			static void store(Task &task, F &&function) {
+				using Stored = std::decay_t<F>;
+
+				if constexpr (sizeof(Stored) <= INLINE_SIZE && alignof(Stored) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Stored>) {
+					new (task.storage) Stored(std::forward<F>(function));
+					task.invoke = [](Task &self, Args... args) {
+						(*std::launder(reinterpret_cast<Stored *>(self.storage)))(std::forward<Args>(args)...);
+					};
+					task.destroy = [](Task &self) {
+						std::launder(reinterpret_cast<Stored *>(self.storage))->~Stored();
+					};
+				} else {
+					new (task.storage) Stored *(new Stored(std::forward<F>(function)));
+					task.invoke = [](Task &self, Args... args) {
+						(**std::launder(reinterpret_cast<Stored **>(self.storage)))(std::forward<Args>(args)...);
+					};
+					task.destroy = [](Task &self) {
+						delete *std::launder(reinterpret_cast<Stored **>(self.storage));
+					};
+				}
+			}
+
+			Task * allocate() {
+				if (freeList == nullptr) {
+					auto block = std::make_unique<Task[]>(BLOCK_SIZE);
+					for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+						block[i].next = freeList;
+						freeList = &block[i];
+					}
+					blocks.push_back(std::move(block));
+				}
+
+				Task *task = freeList;
+				freeList = task->next;
+				task->next = nullptr;
+				return task;
+			}
+
+			/** The task has to be unlinked already. */
+			void release(Task *task) {
+				task->destroy(*task);
+				task->invoke = nullptr;
+				task->destroy = nullptr;
+				++task->generation;
+				task->next = freeList;
+				freeList = task;
+			}
+
+			void link(Task *task, List &list) {
+				task->prev = list.tail;
+				task->next = nullptr;
+				task->list = &list;
+				if (list.tail != nullptr)
+					list.tail->next = task;
+				else
+					list.head = task;
+				list.tail = task;
+			}
+
+			void linkFront(Task *task, List &list) {
+				task->prev = nullptr;
+				task->next = list.head;
+				task->list = &list;
+				if (list.head != nullptr)
+					list.head->prev = task;
+				else
+					list.tail = task;
+				list.head = task;
+			}
+
+			void unlink(Task *task) {
+				if (task->prev != nullptr)
+					task->prev->next = task->next;
+				else
+					task->list->head = task->next;
+
+				if (task->next != nullptr)
+					task->next->prev = task->prev;
+				else
+					task->list->tail = task->prev;
+
+				task->prev = nullptr;
+				task->next = nullptr;
+				task->list = nullptr;
+			}
+
+			/** Files a task under the highest bits in which its due tick differs from the current one, so it reaches the
+			 *  bottom level no later than the tick it's due. Tasks due before the earliest tick still to be collected go
+			 *  in that tick's slot. */
+			void insert(Task *task, Tick earliest) {
+				if (task->due < earliest) {
+					link(task, slots[0][earliest & MASK]);
+					return;
+				}
+
+				const Tick difference = task->due ^ now;
+
+				for (size_t level = 0; level < LEVELS; ++level) {
+					if ((difference >> (BITS * (level + 1))) == 0) {
+						link(task, slots[level][(task->due >> (BITS * level)) & MASK]);
+						return;
+					}
+				}
+
+				link(task, overflow);
+			}
+
+			/** Keeps the order of the tasks, so ones due on the same tick still run in the order they were scheduled. */
+			void cascade(List &list) {
+				Task *task = list.head;
+				list = {};
+				while (task != nullptr) {
+					Task *next = task->next;
+					task->list = nullptr;
+					// The current tick's slot hasn't been collected yet.
+					insert(task, now);
+					task = next;
+				}
+			}
+
+			void advance(Tick to) {
+				while (now < to) {
+					if (scheduled == 0) {
+						now = to;
+						break;
+					}
+
+					++now;
+
+					if ((now & ((Tick(1) << (BITS * LEVELS)) - 1)) == 0)
+						cascade(overflow);
+
+					for (size_t level = LEVELS - 1; 0 < level; --level)
+						if ((now & ((Tick(1) << (BITS * level)) - 1)) == 0)
+							cascade(slots[level][(now >> (BITS * level)) & MASK]);
+
+					List &slot = slots[0][now & MASK];
+					while (slot.head != nullptr) {
+						Task *task = slot.head;
+						unlink(task);
+						link(task, running);
+						--scheduled;
+					}
+				}
+			}
+
+			/** Frees the tasks that ran or were cancelled. Any that haven't run yet were due by now, so they go back in front
+			 *  of whatever the next tick already holds. */
+			void finishDispatch() {
+				std::unique_lock lock(mutex);
+				List &next = slots[0][(now + 1) & MASK];
+				while (running.tail != nullptr) {
+					Task *task = running.tail;
+					unlink(task);
+					if (task->state.load() == Task::SCHEDULED) {
+						linkFront(task, next);
+						++scheduled;
+					} else {
+						release(task);
+					}
+				}
+			}
+
+			void destroyList(const List &list) {
+				for (Task *task = list.head; task != nullptr; task = task->next)
+					task->destroy(*task);
+			}
+	};
+}
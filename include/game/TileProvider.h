@@ -1,7 +1,15 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
+#include <span>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -10,29 +18,105 @@
 #include "Constants.h"
 #include "types/Position.h"
 #include "types/Types.h"
+#include "data/ChunkIndex.h"
 #include "data/ChunkSet.h"
+#include "data/PalettedChunk.h"
 #include "types/ChunkPosition.h"
 #include "game/Fluids.h"
 #include "threading/Lockable.h"
-#include "threading/MTQueue.h"
+#include "threading/MPSCQueue.h"
 #include "util/Math.h"
 
 namespace Game3 {
 	class Game;
 	class Tileset;
 
-	struct ChunkMeta {
-		uint64_t updateCount = 0;
+	/** A change to one tile or fluid in a chunk. */
+	struct ChunkChange {
+		/** A 1-based tile layer, or 0 for fluids. */
+		uint8_t part = 0;
+		/** The offset of the tile within the chunk. */
+		uint16_t index = 0;
+		/** A TileID, or a FluidInt for fluids. */
+		uint64_t value = 0;
+
+		auto operator<=>(const ChunkChange &) const = default;
+	};
+
+	/** The most recent changes to a chunk and the update counters they brought it to. */
+	struct ChunkJournal {
+		/** Every change after this update counter is in the journal. */
+		uint64_t start = 0;
+		std::deque<std::pair<uint64_t, ChunkChange>> entries;
+	};
+
+	/** Everything a TileProvider stores for one chunk position, so that one lookup serves every layer. */
+	struct ChunkRecord {
+		static constexpr uint8_t BIOMES_PRESENT = 1 << LAYER_COUNT;
+		static constexpr uint8_t PATHS_PRESENT  = BIOMES_PRESENT << 1;
+		static constexpr uint8_t FLUIDS_PRESENT = PATHS_PRESENT << 1;
+		static constexpr uint8_t ALL_PRESENT    = (FLUIDS_PRESENT << 1) - 1;
+		static constexpr uint64_t NEVER_SAVED = UINT64_MAX;
+
+		/** The parts that TileProvider::compact can pack. */
+		static constexpr uint8_t PACKABLE = ALL_PRESENT & ~PATHS_PRESENT;
+
+		std::array<TileChunk, LAYER_COUNT> layers;
+		BiomeChunk biomes;
+		PathChunk paths;
+		FluidChunk fluids;
+		/** Compact copies of parts that haven't changed in a while. A packed part's dense chunk above is empty. */
+		std::array<PalettedChunk<TileID>, LAYER_COUNT> packedLayers;
+		PalettedChunk<BiomeType> packedBiomes;
+		PalettedChunk<FluidTile> packedFluids;
+		std::atomic_uint64_t updateCount = 0;
+		/** The update counter as of the last time the chunk was written to the database. */
+		std::atomic_uint64_t savedCount = NEVER_SAVED;
+		/** The update counter as of the last compaction pass. Only touched by TileProvider::compact. */
+		uint64_t compactedCount = NEVER_SAVED;
+		/** Which of the chunks above have been initialized. The low LAYER_COUNT bits are the tile layers. */
+		std::atomic_uint8_t present = 0;
+		/** Which parts are currently held only in packed form, using the same bits as present. */
+		std::atomic_uint8_t packed = 0;
+		/** Whether any part has been unpacked since the last compaction pass. */
+		std::atomic_bool unpacked = false;
+		/** Guards journal and every change to updateCount. */
+		std::mutex journalMutex;
+		/** Only exists while every change since some update counter has been journaled. */
+		std::unique_ptr<ChunkJournal> journal;
+
+		static inline uint8_t layerBit(Layer layer) {
+			return static_cast<uint8_t>(1 << getIndex(layer));
+		}
+
+		inline bool has(uint8_t bits) const {
+			return (present.load(std::memory_order_acquire) & bits) == bits;
+		}
+
+		inline void mark(uint8_t bits) {
+			present.fetch_or(bits, std::memory_order_release);
+		}
+
+		inline bool isPacked(uint8_t bit) const {
+			return (packed.load(std::memory_order_acquire) & bit) != 0;
+		}
+
+		/** These read from whichever form a part is in. The caller has to hold the part's lock. */
+		inline TileID getTile(size_t layer_index, size_t offset) const {
+			return isPacked(static_cast<uint8_t>(1 << layer_index))? packedLayers[layer_index][offset] : layers[layer_index][offset];
+		}
+
+		inline BiomeType getBiome(size_t offset) const {
+			return isPacked(BIOMES_PRESENT)? packedBiomes[offset] : biomes[offset];
+		}
+
+		inline FluidTile getFluid(size_t offset) const {
+			return isPacked(FLUIDS_PRESENT)? packedFluids[offset] : fluids[offset];
+		}
 	};
 
 	class TileProvider {
 		public:
-			using ChunkMap = std::unordered_map<ChunkPosition, TileChunk>;
-			using BiomeMap = std::unordered_map<ChunkPosition, BiomeChunk>;
-			using PathMap  = std::unordered_map<ChunkPosition, PathChunk>;
-			using FluidMap = std::unordered_map<ChunkPosition, FluidChunk>;
-			using MetaMap  = std::unordered_map<ChunkPosition, ChunkMeta>;
-
 			/** Behavior when accessing a tile in an out-of-bounds chunk.
 			 *  The Create mode will cause a nonexistent chunk to be created on access. */
 			enum class TileMode  {Throw, Create, ReturnEmpty};
@@ -40,33 +124,55 @@ namespace Game3 {
 			enum class PathMode  {Throw, Create};
 			enum class FluidMode {Throw, Create};
 
-			std::array<ChunkMap, LAYER_COUNT> chunkMaps;
-			BiomeMap biomeMap;
-			PathMap pathMap;
-			FluidMap fluidMap;
-			Identifier tilesetID;
-			MTQueue<ChunkPosition> generationQueue;
+			struct CompactionStats {
+				/** How many tile layers, biome chunks and fluid chunks were packed. */
+				size_t packed = 0;
+				/** The sizes of the packed parts before and after packing. */
+				size_t bytesBefore = 0;
+				size_t bytesAfter = 0;
+			};
 
+			Identifier tilesetID;
+			MPSCQueue<ChunkPosition> generationQueue;
+			/** Paged-out chunks that something tried to access, each pushed once per page-out. */
+			mutable MPSCQueue<ChunkPosition> pageFaultQueue;
+			/** Chunks that have been paged back in. Their path maps still have to be remade. */
+			MPSCQueue<ChunkPosition> pagedInQueue;
+			/** Reads a paged-out chunk back from storage. Used when a paged-out chunk has to be accessed right away. */
+			std::function<std::optional<ChunkSet>(ChunkPosition)> pageLoader;
+
+			/** Held by findTile and friends for as long as the caller uses the returned reference. */
 			mutable std::array<std::shared_mutex, LAYER_COUNT> chunkMutexes;
 			mutable std::shared_mutex biomeMutex;
 			mutable std::shared_mutex pathMutex;
 			mutable std::shared_mutex fluidMutex;
-			mutable std::shared_mutex metaMutex;
 
-			TileProvider() = default;
+			TileProvider();
 			TileProvider(Identifier tileset_id);
 
+			/** Must not race with any other access to this provider. */
 			void clear();
 			bool contains(ChunkPosition) const;
 
+			/** How many changes a chunk's journal holds before the oldest ones are dropped. */
+			constexpr static size_t JOURNAL_SIZE = 512;
+
+			/** Increments the chunk's update counter. Clears its journal, since whatever changed isn't in it. */
 			uint64_t updateChunk(ChunkPosition);
-			/** If the chunk position isn't present in the meta map, this returns 0 without adding the chunk position to the meta map. */
+			/** Increments the chunk's update counter and journals the change. */
+			uint64_t updateChunk(ChunkPosition, const ChunkChange &);
+			/** Returns the current update counter and the latest value of everything that changed after the given update
+			 *  counter, ordered by part and index, or nothing if the chunk's journal doesn't go back that far. */
+			std::optional<std::pair<uint64_t, std::vector<ChunkChange>>> getChangesSince(ChunkPosition, uint64_t update_counter) const;
+			/** If there's no record for the chunk position, this returns 0 without creating one. */
 			uint64_t getUpdateCounter(ChunkPosition);
 			void setUpdateCounter(ChunkPosition, uint64_t);
 
-			/** Copies the data from a ChunkSet object into this TileProvider object's terrain, biome and fluid data, then remakes the path map.
+			/** Moves the data from a ChunkSet object into this TileProvider object's terrain, biome, fluid and path data.
 			 *  Doesn't lock any of the ChunkSet object's mutexes. */
 			void absorb(ChunkPosition, ChunkSet);
+			/** Like absorb(ChunkPosition, ChunkSet), but takes each of the provider's locks once for the whole batch. */
+			void absorb(std::vector<std::pair<ChunkPosition, ChunkSet>>);
 
 			std::shared_ptr<Tileset> getTileset(const Game &) const;
 
@@ -92,6 +198,18 @@ namespace Game3 {
 
 			ChunkSet getChunkSet(ChunkPosition) const;
 
+			/** Copies a chunk's tiles, biomes or fluids without unpacking them. Throws std::out_of_range if they're missing.
+			 *  Unlike the get*Chunk methods, these lock the chunk themselves. */
+			std::vector<TileID> copyTileChunk(Layer, ChunkPosition) const;
+			std::vector<BiomeType> copyBiomeChunk(ChunkPosition) const;
+			std::vector<FluidTile> copyFluidChunk(ChunkPosition) const;
+
+			/** Returns a chunk set with only the terrain and fluids filled in, which is all a client has. */
+			ChunkSet copyTilesAndFluids(ChunkPosition) const;
+			/** A digest of a chunk's terrain and fluids that tells whether a client's copy is still current. The salt has to
+			 *  change whenever tile IDs change meaning, so the tileset hash is a good choice. */
+			static uint64_t computeDigest(const ChunkSet &, std::string_view salt);
+
 			/** An empty vector indicates failure. */
 			std::string getRawChunks(ChunkPosition) const;
 
@@ -184,6 +302,52 @@ namespace Game3 {
 
 			void ensureAllChunks(Position);
 
+			/** Returns the offset of a tile within its chunk. */
+			static inline uint16_t getOffset(Position position) {
+				return static_cast<uint16_t>(remainder(position.row) * CHUNK_SIZE + remainder(position.column));
+			}
+
+			/** Returns the positions of every chunk that has terrain. */
+			std::vector<ChunkPosition> getChunkPositions() const;
+
+			/** Returns the positions and current update counters of chunks with terrain that have changed since they were last
+			 *  marked as saved, or of all chunks with terrain if all is true. */
+			std::vector<std::pair<ChunkPosition, uint64_t>> getUnsavedChunks(bool all = false) const;
+			/** Records that the chunk was written to the database as of the given update counter. */
+			void markSaved(ChunkPosition, uint64_t update_counter);
+
+			/** Drops a chunk from memory if it hasn't changed since it was last saved. Accessing it afterwards pushes it onto
+			 *  pageFaultQueue, except for accesses that would create it, which load it synchronously through pageLoader.
+			 *  The emptied record is kept until the chunk is paged back in, so a thread that found it beforehand never sees
+			 *  it freed; it just finds its parts missing once it holds a part lock. */
+			bool pageOut(ChunkPosition);
+			/** Pages out every given chunk that hasn't changed since it was last saved, taking the locks once for all of them.
+			 *  Returns the resident chunks that had to stay because they have unsaved changes. */
+			std::vector<ChunkPosition> pageOut(std::span<const ChunkPosition>);
+			/** Restores a paged-out chunk along with its update counter. Returns false if the chunk wasn't paged out. */
+			bool pageIn(ChunkPosition, ChunkSet);
+			bool isPagedOut(ChunkPosition) const;
+			/** Pushes a paged-out chunk onto pageFaultQueue unless an access already has. Returns whether it's paged out. */
+			bool requestPageIn(ChunkPosition) const;
+			/** Lets the next access to a paged-out chunk fault it again, after reading it back in has failed. */
+			void clearFault(ChunkPosition);
+
+			/** Packs the tile layers, biomes and fluids of up to max_records chunks that haven't changed since the previous
+			 *  call, and frees the dense copies packed by the previous call. Packed parts are unpacked again by anything that
+			 *  needs a reference into them, such as findTile or getTileChunk; copies of single tiles read them as they are. */
+			CompactionStats compact(size_t max_records = SIZE_MAX);
+
+			size_t getResidentCount() const;
+			size_t getPagedOutCount() const;
+			inline size_t getPageFaultCount() const { return pageFaultCount; }
+
+			/** Calls function(ChunkPosition, ChunkRecord &) for every chunk record while holding the index lock. */
+			template <typename F>
+			void forEachChunk(F &&function) const {
+				std::shared_lock lock(indexMutex);
+				chunks.forEach(function);
+			}
+
 			void toJSON(nlohmann::json &, bool full_data = false) const;
 			void absorbJSON(const nlohmann::json &, bool full_data = false);
 
@@ -220,79 +384,131 @@ namespace Game3 {
 			}
 
 		private:
+			friend class TileView;
+
+			struct PagedOutChunk {
+				uint64_t updateCount = 0;
+				/** Whether an access has already been pushed onto pageFaultQueue. */
+				mutable std::atomic_bool faulted = false;
+				/** The emptied record, reused when the chunk is paged back in. */
+				std::unique_ptr<ChunkRecord> record;
+
+				PagedOutChunk(uint64_t update_count, std::unique_ptr<ChunkRecord> record_):
+					updateCount(update_count), record(std::move(record_)) {}
+			};
+
 			mutable std::shared_ptr<Tileset> cachedTileset;
-			MetaMap metaMap;
+			ChunkIndex<ChunkRecord> chunks;
+			/** Guards chunks and pagedOut. */
+			mutable std::shared_mutex indexMutex;
+			std::unordered_map<ChunkPosition, PagedOutChunk> pagedOut;
+			mutable std::atomic_size_t pageFaultCount = 0;
+			/** Dense chunks replaced by packed ones in the last compaction pass. They're kept until the next one for the sake
+			 *  of anything that's still holding a reference into them. Only touched by compact. */
+			std::vector<std::vector<TileID>> retiredTiles;
+			std::vector<std::vector<BiomeType>> retiredBiomes;
+			std::vector<std::vector<FluidTile>> retiredFluids;
+			/** Unique across all providers. Changes whenever records are removed so that per-thread lookup caches can't go stale. */
+			std::atomic_uint64_t epoch;
+
+			/** Returns null if there's no record at the position. Checks the calling thread's last-used record first. */
+			ChunkRecord * findRecord(ChunkPosition) const;
+			ChunkRecord & ensureRecord(ChunkPosition);
+			/** Locks every part exclusively, in the same order as TileView. */
+			std::vector<std::unique_lock<std::shared_mutex>> lockAllParts() const;
+			/** Increments a record's update counter on behalf of a change that can't be journaled. */
+			static uint64_t bumpUnjournaled(ChunkRecord &);
+			/** Initializes whichever of the given parts of the record aren't already present. */
+			void ensureParts(ChunkPosition, ChunkRecord &, uint8_t bits);
+			/** Unpacks whichever of the given parts of the record are packed, taking each part's lock while it does. Must not be
+			 *  called while holding any of those locks. */
+			void unpack(ChunkRecord &, uint8_t bits) const;
+			/** Like unpack, but for callers that already hold the locks of the given parts. */
+			static void unpackLocked(ChunkRecord &, uint8_t bits);
 
 			void validateLayer(Layer) const;
+			static void validateChunkSet(const ChunkSet &);
 			void initTileChunk(Layer, TileChunk &, ChunkPosition);
 			void initBiomeChunk(Chunk<BiomeType> &, ChunkPosition);
 			void initPathChunk(Chunk<uint8_t> &, ChunkPosition);
 			void initFluidChunk(Chunk<FluidTile> &, ChunkPosition);
 
-			template <typename M>
-			auto & findItem(Position position, bool &created, std::shared_lock<std::shared_mutex> *lock_out, M mode, std::shared_mutex &mutex, auto &map, const auto &init) {
-				created = false;
-				const ChunkPosition chunk_position = position.getChunk();
-
-				std::shared_lock shared_lock(mutex);
-
-				if (auto iter = map.find(chunk_position); iter != map.end()) {
-					if (lock_out != nullptr)
-						*lock_out = std::move(shared_lock);
-					return access(iter->second, remainder(position.row), remainder(position.column));
+			/** Returns null if the chunk at the position doesn't have the given part. Unpacks the part if it's packed. */
+			template <typename T>
+			const Chunk<T> * findPart(ChunkPosition chunk_position, uint8_t bit, Chunk<T> ChunkRecord::*member) const {
+				if (ChunkRecord *record = findRecord(chunk_position); record != nullptr && record->has(bit)) {
+					unpack(*record, bit);
+					return &(record->*member);
 				}
+				return nullptr;
+			}
 
-				if (mode == M::Create) {
-					created = true;
-					shared_lock.unlock();
-					std::unique_lock unique_lock(mutex);
-					auto &chunk = map[chunk_position];
-					init(chunk, chunk_position);
-					auto &accessed = access(chunk, remainder(position.row), remainder(position.column)) = {};
+			/** Returns null if the chunk at the position doesn't have the given layer. Unpacks the layer if it's packed. */
+			TileChunk * findTileChunk(ChunkPosition, Layer) const;
 
-					// Transfer the lock sketchily.
-					if (lock_out != nullptr) {
-						unique_lock.unlock();
-						// Yikes.
-						shared_lock.lock();
-						*lock_out = std::move(shared_lock);
-					}
+			template <typename T>
+			const Chunk<T> & getPart(ChunkPosition chunk_position, uint8_t bit, Chunk<T> ChunkRecord::*member, const char *name) const {
+				if (const Chunk<T> *chunk = findPart(chunk_position, bit, member))
+					return *chunk;
+				throw std::out_of_range("Couldn't find " + std::string(name) + " chunk at position " + static_cast<std::string>(chunk_position));
+			}
 
-					return accessed;
+			template <typename M, typename T>
+			T & findItem(Position position, bool &created, std::shared_lock<std::shared_mutex> *lock_out, M mode, std::shared_mutex &mutex, uint8_t bit, Chunk<T> ChunkRecord::*member) {
+				created = false;
+				const ChunkPosition chunk_position = position.getChunk();
+				ChunkRecord *record = nullptr;
+				std::shared_lock<std::shared_mutex> shared_lock;
+
+				// The chunk can be paged out between finding its record and locking the part.
+				while (!shared_lock.owns_lock()) {
+					record = findRecord(chunk_position);
+					if (record == nullptr || !record->has(bit)) {
+						if (mode != M::Create)
+							throw std::out_of_range("Couldn't find item at " + std::string(position));
+						record = &ensureRecord(chunk_position);
+						ensureParts(chunk_position, *record, bit);
+						created = true;
+					}
+					shared_lock = std::shared_lock(mutex);
+					if (!record->has(bit))
+						shared_lock.unlock();
 				}
 
-				throw std::out_of_range("Couldn't find item at " + std::string(position));
+				unpackLocked(*record, bit);
+				T &accessed = access(record->*member, remainder(position.row), remainder(position.column));
+				if (lock_out != nullptr)
+					*lock_out = std::move(shared_lock);
+				return accessed;
 			}
 
-			template <typename M>
-			auto & findItem(Position position, bool &created, std::unique_lock<std::shared_mutex> *lock_out, M mode, std::shared_mutex &mutex, auto &map, const auto &init) {
+			template <typename M, typename T>
+			T & findItem(Position position, bool &created, std::unique_lock<std::shared_mutex> *lock_out, M mode, std::shared_mutex &mutex, uint8_t bit, Chunk<T> ChunkRecord::*member) {
 				created = false;
 				const ChunkPosition chunk_position = position.getChunk();
-
-				std::shared_lock shared_lock(mutex);
-
-				if (auto iter = map.find(chunk_position); iter != map.end()) {
-					if (lock_out != nullptr) {
-						shared_lock.unlock();
-						*lock_out = std::unique_lock(pathMutex);
+				ChunkRecord *record = nullptr;
+				std::unique_lock<std::shared_mutex> unique_lock;
+
+				// The chunk can be paged out between finding its record and locking the part.
+				while (!unique_lock.owns_lock()) {
+					record = findRecord(chunk_position);
+					if (record == nullptr || !record->has(bit)) {
+						if (mode != M::Create)
+							throw std::out_of_range("Couldn't find item at " + std::string(position));
+						record = &ensureRecord(chunk_position);
+						ensureParts(chunk_position, *record, bit);
+						created = true;
 					}
-
-					return access(iter->second, remainder(position.row), remainder(position.column));
-				}
-
-				if (mode == M::Create) {
-					created = true;
-					shared_lock.unlock();
-					std::unique_lock unique_lock(mutex);
-					auto &chunk = map[chunk_position];
-					init(chunk, chunk_position);
-					auto &accessed = access(chunk, remainder(position.row), remainder(position.column)) = {};
-					if (lock_out != nullptr)
-						*lock_out = std::move(unique_lock);
-					return accessed;
+					unique_lock = std::unique_lock(mutex);
+					if (!record->has(bit))
+						unique_lock.unlock();
 				}
 
-				throw std::out_of_range("Couldn't find item at " + std::string(position));
+				unpackLocked(*record, bit);
+				T &accessed = access(record->*member, remainder(position.row), remainder(position.column));
+				if (lock_out != nullptr)
+					*lock_out = std::move(unique_lock);
+				return accessed;
 			}
 	};
 }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "game/Chunk.h"
+#include "game/Fluids.h"
+#include "types/ChunkPosition.h"
+#include "types/Position.h"
+#include "types/Types.h"
+#include "Layer.h"
+
+#include <array>
+#include <cassert>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+
+namespace Game3 {
+	class TileProvider;
+	struct ChunkRecord;
+
+	/** Gives lock-free, hash-free access to a rectangle of a TileProvider's chunks for as long as it lives.
+	 *  It takes shared locks on the provider's mutexes for the requested parts up front, then pins each chunk the first
+	 *  time it's touched. Positions outside the range read as missing. Views aren't threadsafe and should be short-lived,
+	 *  and the thread that owns one mustn't modify the locked parts of the provider until the view is gone. */
+	class TileView {
+		public:
+			static constexpr uint8_t TILES  = 1;
+			static constexpr uint8_t BIOMES = 2;
+			static constexpr uint8_t PATHS  = 4;
+			static constexpr uint8_t FLUIDS = 8;
+			static constexpr uint8_t ALL    = TILES | BIOMES | PATHS | FLUIDS;
+
+			TileView(const TileProvider &, const ChunkRange &, uint8_t parts = ALL);
+
+			TileView(const TileView &) = delete;
+			TileView(TileView &&) = delete;
+
+			TileView & operator=(const TileView &) = delete;
+			TileView & operator=(TileView &&) = delete;
+
+			inline const ChunkRange & getRange() const { return range; }
+
+			std::optional<TileID> tryTile(Layer, Position) const;
+			std::optional<BiomeType> copyBiomeType(Position) const;
+			std::optional<uint8_t> copyPathState(Position) const;
+			std::optional<FluidTile> copyFluidTile(Position) const;
+			bool hasFluid(Position, FluidLevel minimum = 1) const;
+
+		private:
+			using ChunkLock = std::shared_lock<DefaultMutex>;
+
+			struct Slot {
+				const ChunkRecord *record = nullptr;
+				bool resolved = false;
+			};
+
+			const TileProvider &provider;
+			const ChunkRange range;
+			const uint8_t parts;
+			std::array<std::shared_lock<std::shared_mutex>, LAYER_COUNT> layerLocks;
+			std::shared_lock<std::shared_mutex> biomeLock;
+			std::shared_lock<std::shared_mutex> pathLock;
+			std::shared_lock<std::shared_mutex> fluidLock;
+			mutable std::vector<Slot> slots;
+			mutable std::vector<ChunkLock> chunkLocks;
+			mutable ChunkPosition lastPosition;
+			mutable const ChunkRecord *lastRecord = nullptr;
+
+			/** Returns null if the chunk is missing or outside the range. */
+			const ChunkRecord * getRecord(ChunkPosition) const;
+			const ChunkRecord * pin(ChunkPosition) const;
+
+			static inline size_t offset(Position position) {
+				const Index row = position.row % CHUNK_SIZE;
+				const Index column = position.column % CHUNK_SIZE;
+				return static_cast<size_t>((row < 0? row + CHUNK_SIZE : row) * CHUNK_SIZE + (column < 0? column + CHUNK_SIZE : column));
+			}
+	};
+}
@@ -2,19 +2,25 @@
 
 #include "types/Types.h"
 #include "registry/Registerable.h"
+#include "threading/Lockable.h"
 
 #include <filesystem>
 #include <map>
 #include <memory>
 #include <optional>
 #include <set>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <nlohmann/json_fwd.hpp>
 
 namespace Game3 {
+	class Game;
 	class Texture;
+	class Tile;
 
 	struct AutotileSet {
 		Identifier identifier;
@@ -34,6 +40,27 @@ namespace Game3 {
 			start(std::move(start_)), autotileSet(std::move(autotile_set)), tall(tall_) {}
 	};
 
+	/** The Tile object of every TileID in a tileset, so random ticks and neighbor updates don't have to look up names. */
+	struct TileTable {
+		/** Indexed by TileID. Tiles without a registered Tile object get the default tile, as with Game::getTile. */
+		std::vector<std::shared_ptr<Tile>> tiles;
+		/** Whether each TileID's Tile does anything on random ticks. */
+		std::vector<bool> randomTicks;
+		/** The size of the tile registry when the table was built. */
+		size_t registrySize = 0;
+
+		/** Throws std::out_of_range for IDs without a name, like looking up the name would. */
+		inline Tile & operator[](TileID id) const {
+			if (const auto &tile = tiles.at(id))
+				return *tile;
+			throw std::out_of_range("Unknown TileID: " + std::to_string(id));
+		}
+
+		inline bool hasRandomTick(TileID id) const {
+			return randomTicks.at(id);
+		}
+	};
+
 	class Tileset: public NamedRegisterable {
 		public:
 			bool isLand(const Identifier &) const;
@@ -46,17 +73,16 @@ namespace Game3 {
 			TileID getEmptyID() const;
 			const Identifier & getMissing() const;
 			const std::unordered_set<Identifier> & getBrightNames() const;
-			std::vector<TileID> getBrightIDs();
 			std::string getName() const;
 			std::shared_ptr<Texture> getTexture(const Game &);
 			const Identifier & getTextureName() const { return textureName; }
 			bool getItemStack(const std::shared_ptr<Game> &, const Identifier &, ItemStackPtr &) const;
-			bool isMarchable(TileID);
+			bool isMarchable(TileID) const;
 			bool isCategoryMarchable(const Identifier &category) const;
 			const MarchableInfo * getMarchableInfo(const Identifier &tilename) const;
 			void clearCache();
 			const std::unordered_set<Identifier> & getCategories(const Identifier &) const;
-			const std::unordered_set<TileID> getCategoryIDs(const Identifier &) const;
+			const std::unordered_set<TileID> & getCategoryIDs(const Identifier &) const;
 			const std::unordered_set<Identifier> & getTilesByCategory(const Identifier &) const;
 			bool isInCategory(const Identifier &tilename, const Identifier &category) const;
 			bool isInCategory(TileID, const Identifier &category) const;
@@ -69,6 +95,12 @@ namespace Game3 {
 			std::shared_ptr<AutotileSet> getAutotileSet(const Identifier &) const;
 			TileID getUpper(TileID) const;
 			bool hasUpper(TileID) const;
+			/** Precomputes the per-TileID flags and category memberships that the TileID queries read. Has to be called
+			 *  again whenever tiles or categories change. */
+			void buildTables();
+			/** Returns the TileID-indexed table of Tile objects, building it first if this tileset or the game's tile
+			 *  registry has changed since it was last built. */
+			std::shared_ptr<const TileTable> getTileTable(Game &) const;
 
 			const auto & getIDs()          const { return ids;          }
 			const auto & getNames()        const { return names;        }
@@ -101,8 +133,17 @@ namespace Game3 {
 			Identifier textureName;
 			mutable std::optional<TileID> emptyID;
 
+			enum TileFlag: uint8_t {
+				/** Set for every TileID that has a name, so that unknown IDs can still be rejected. */
+				KnownFlag     = 1 << 0,
+				LandFlag      = 1 << 1,
+				WalkableFlag  = 1 << 2,
+				SolidFlag     = 1 << 3,
+				MarchableFlag = 1 << 4,
+			};
+
 			std::shared_ptr<Texture> cachedTexture;
-			// TODO: consider making the sets store TileIDs instead, for performance perhaps
+			/** The sets are what tiles are loaded into; the TileID queries use the tables buildTables makes from them. */
 			std::unordered_set<Identifier> land;
 			std::unordered_set<Identifier> walkable;
 			std::unordered_set<Identifier> solid;
@@ -119,9 +160,14 @@ namespace Game3 {
 			std::unordered_map<Identifier, std::unordered_set<Identifier>> categories;
 			/** Maps tile names to sets of category names. */
 			std::unordered_map<Identifier, std::unordered_set<Identifier>> inverseCategories;
-			std::unordered_set<TileID> marchableCache;
-			std::unordered_set<TileID> unmarchableCache;
-			std::optional<std::vector<TileID>> brightCache;
+			/** TileFlag bits, indexed by TileID. */
+			std::vector<uint8_t> tileFlags;
+			/** Maps category names to bitsets indexed by TileID. */
+			std::unordered_map<Identifier, std::vector<bool>> categoryBits;
+			/** Maps category names to the TileIDs of their tiles. */
+			std::unordered_map<Identifier, std::unordered_set<TileID>> categoryIDs;
+			/** Built on first use, because tiles are registered after tilesets are loaded. */
+			mutable Lockable<std::shared_ptr<const TileTable>> tileTable;
 			/** Maps autotile identifiers to autotile set pointers. */
 			std::unordered_map<Identifier, std::shared_ptr<AutotileSet>> autotileSets;
 			/** Maps tilenames to autotile set pointers. */
@@ -130,6 +176,8 @@ namespace Game3 {
 			std::unordered_map<TileID, TileID> uppers;
 
 			void setAutotile(const Identifier &tilename, const Identifier &autotile_name);
+			/** Throws std::out_of_range for IDs without a name, like looking up the name would. */
+			uint8_t getFlags(TileID) const;
 
 		friend Tileset tileStitcher(const std::filesystem::path &, Identifier, std::string *);
 	};
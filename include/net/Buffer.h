@@ -4,6 +4,7 @@
 #include "util/Concepts.h"
 #include "util/Demangle.h"
 
+#include <algorithm>
 #include <bit>
 #include <cassert>
 #include <concepts>
@@ -188,6 +189,9 @@ namespace Game3 {
 
 		public:
 			std::weak_ptr<BufferContext> context;
+			/** Set for packets from clients. Identifiers decoded from an untrusted buffer have to be interned already, so
+			 *  that a peer can't fill the identifier table. */
+			bool untrusted = false;
 
 			Buffer() = default;
 
@@ -395,8 +399,9 @@ namespace Game3 {
 	C popBuffer(Buffer &buffer) {
 		const auto size = popBuffer<uint32_t>(buffer);
 		C out;
+		// Every element takes at least a byte, so a size larger than what's left is a lie that shouldn't cost memory.
 		if constexpr (Reservable<C>)
-			out.reserve(size);
+			out.reserve(std::min<size_t>(size, buffer.size()));
 
 		for (uint32_t i = 0; i < size; ++i)
 			out.push_back(popBuffer<typename C::value_type>(buffer));
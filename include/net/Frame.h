@@ -0,0 +1,75 @@
+#pragma once
+
+#include "types/Types.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Game3 {
+	class Game;
+	class Packet;
+
+	/** The bytes of a packet with its header (packet ID and payload size) in front, ready to be written to a socket. */
+	using FrameBytes = std::vector<uint8_t>;
+	/** Frames are shared so that a packet encoded once can be queued to any number of clients. When the last reference
+	 *  goes away, the storage goes back to the FramePool. */
+	using SharedFrame = std::shared_ptr<const FrameBytes>;
+
+	/** The packet ID (2 bytes) and the payload size (4 bytes), both little-endian. */
+	constexpr size_t FRAME_HEADER_SIZE = sizeof(PacketID) + sizeof(uint32_t);
+
+	/** Recycles frame storage so that encoding a packet usually doesn't allocate. Threadsafe. */
+	class FramePool {
+		public:
+			struct Counters {
+				std::atomic_size_t frames = 0;
+				std::atomic_size_t bytes = 0;
+				/** Frames whose storage had to be allocated because the pool was empty. */
+				std::atomic_size_t allocations = 0;
+				/** Frames that outgrew the storage they started with while being encoded. */
+				std::atomic_size_t reallocations = 0;
+				/** Bytes copied on the way to the socket. Only raw, non-packet messages are copied. */
+				std::atomic_size_t copiedBytes = 0;
+			};
+
+			/** Storage is only pooled up to this many entries... */
+			constexpr static size_t MAX_FREE = 1024;
+			/** ...and only if it isn't larger than this, so that one huge packet doesn't pin its memory forever. */
+			constexpr static size_t MAX_POOLED_CAPACITY = 256 * 1024;
+			/** Counters for packet IDs at or above this are lumped in with the last one. */
+			constexpr static size_t MAX_COUNTED_ID = 255;
+
+			/** Never destroyed, so that frames released during shutdown still have somewhere to go. */
+			static FramePool & get();
+
+			/** Encodes a packet straight into pooled storage after a reserved header, then fills in the header. */
+			SharedFrame frame(Game &, const Packet &);
+			/** Copies raw bytes into a frame as they are. No header is added. */
+			SharedFrame copy(std::string_view);
+
+			const Counters & getCounters(PacketID) const;
+			inline const Counters & getRawCounters() const { return rawCounters; }
+			/** One line per packet ID that has been framed, plus one for raw messages. */
+			std::string summarize() const;
+
+		private:
+			std::mutex mutex;
+			std::vector<std::unique_ptr<FrameBytes>> free;
+			std::array<Counters, MAX_COUNTED_ID + 1> counters;
+			Counters rawCounters;
+
+			FramePool() = default;
+
+			/** The bool is whether the storage came from the pool. */
+			std::pair<std::unique_ptr<FrameBytes>, bool> acquire();
+			SharedFrame share(std::unique_ptr<FrameBytes>);
+			void release(FrameBytes *);
+			Counters & countersFor(PacketID);
+	};
+}
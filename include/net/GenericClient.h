@@ -5,8 +5,10 @@
 
 #include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <asio.hpp>
 #include <asio/ssl.hpp>
@@ -24,7 +26,8 @@ namespace Game3 {
 			std::mutex networkMutex;
 			asio::ssl::stream<asio::ip::tcp::socket> socket;
 			asio::io_context::strand strand;
-			Lockable<std::deque<std::string>, std::shared_mutex> outbox;
+			/** Frames are shared so that a packet encoded once can be queued to many clients without copying. */
+			Lockable<std::deque<SharedFrame>, std::shared_mutex> outbox;
 
 			GenericClient() = delete;
 			GenericClient(const GenericClient &) = delete;
@@ -37,7 +40,8 @@ namespace Game3 {
 			GenericClient & operator=(GenericClient &&) = delete;
 
 			void start();
-			void queue(std::string);
+			void queue(SharedFrame);
+			void queue(std::vector<SharedFrame>);
 
 			virtual void handleInput(std::string_view) = 0;
 			virtual void onMaxLineSizeExceeded() {}
@@ -48,9 +52,15 @@ namespace Game3 {
 			inline bool isClosed() const { return closed; }
 
 		private:
+			/** At most this many queued frames are handed to a single write. */
+			constexpr static size_t MAX_GATHER = 64;
+
 			size_t bufferSize;
 			std::unique_ptr<char[]> buffer;
 			bool closed = false;
+			/** The frames at the front of the outbox that the write in progress covers. */
+			size_t inFlight = 0;
+			std::vector<asio::const_buffer> gathered;
 
 			void write();
 			void writeHandler(const asio::error_code &, size_t);
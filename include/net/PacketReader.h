@@ -0,0 +1,92 @@
+#pragma once
+
+#include "net/Frame.h"
+#include "net/RingBuffer.h"
+#include "packet/PacketError.h"
+#include "types/Types.h"
+
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace Game3 {
+	/** Splits a byte stream into packets. Received bytes are copied once into a ring buffer, and headers and payloads
+	 *  are parsed where they lie. */
+	class PacketReader {
+		public:
+			/** A packet's payload, in two pieces if it wraps around the end of the ring buffer. Only valid during the
+			 *  handler call it's passed to. */
+			struct Payload {
+				std::span<const uint8_t> first;
+				std::span<const uint8_t> second;
+
+				inline size_t size() const { return first.size() + second.size(); }
+
+				inline void copyTo(std::vector<uint8_t> &out) const {
+					out.assign(first.begin(), first.end());
+					out.insert(out.end(), second.begin(), second.end());
+				}
+			};
+
+			/** The ring buffer has room for two maximum-size packets so that a full one never has to wait for space. */
+			explicit PacketReader(size_t max_payload_size):
+				maxPayloadSize(max_payload_size),
+				ring(2 * (FRAME_HEADER_SIZE + max_payload_size)) {}
+
+			/** Calls `handler(PacketID, const Payload &)` for each packet completed by the given bytes, in order. Throws
+			 *  PacketError if a header announces a payload larger than the limit, after which the reader has to be reset. */
+			template <typename F>
+			void feed(std::span<const uint8_t> bytes, F &&handler) {
+				while (!bytes.empty()) {
+					const size_t written = ring.write(bytes);
+					if (written == 0)
+						throw std::logic_error("PacketReader ring buffer is full");
+					bytes = bytes.subspan(written);
+					parse(handler);
+				}
+			}
+
+			void reset() {
+				ring.clear();
+				haveHeader = false;
+			}
+
+			/** How many bytes of incomplete packets are waiting for more input. */
+			inline size_t getPending() const { return ring.size() + (haveHeader? FRAME_HEADER_SIZE : 0); }
+
+		private:
+			size_t maxPayloadSize;
+			RingBuffer ring;
+			bool haveHeader = false;
+			PacketID packetType = 0;
+			uint32_t payloadSize = 0;
+
+			template <typename F>
+			void parse(F &handler) {
+				for (;;) {
+					if (!haveHeader) {
+						if (ring.size() < FRAME_HEADER_SIZE)
+							return;
+
+						packetType = ring[0] | (static_cast<PacketID>(ring[1]) << 8);
+						payloadSize = ring[2] | (static_cast<uint32_t>(ring[3]) << 8) | (static_cast<uint32_t>(ring[4]) << 16) | (static_cast<uint32_t>(ring[5]) << 24);
+
+						if (maxPayloadSize < payloadSize)
+							throw PacketError(std::format("Payload size of {} bytes for packet type {} is too large", payloadSize, packetType));
+
+						ring.consume(FRAME_HEADER_SIZE);
+						haveHeader = true;
+					}
+
+					if (ring.size() < payloadSize)
+						return;
+
+					auto [first, second] = ring.view(0, payloadSize);
+					handler(packetType, Payload{first, second});
+					ring.consume(payloadSize);
+					haveHeader = false;
+				}
+			}
+	};
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "net/Frame.h"
+#include "types/Types.h"
+
+#include <memory>
+#include <vector>
+
+namespace Game3 {
+	class Game;
+	class Packet;
+
+	/** Holds the fully framed bytes (header plus payload) of a packet so that it can be encoded once and sent to any
+	 *  number of clients without being encoded or copied again. */
+	class PreencodedPacket {
+		public:
+			PreencodedPacket() = default;
+			PreencodedPacket(Game &, const Packet &);
+
+			template <typename P>
+			static std::vector<PreencodedPacket> encodeAll(Game &game, const std::vector<P> &packets) {
+				std::vector<PreencodedPacket> out;
+				out.reserve(packets.size());
+				for (const P &packet: packets)
+					out.emplace_back(game, packet);
+				return out;
+			}
+
+			inline PacketID getID() const { return packetID; }
+			inline const SharedFrame & getFrame() const { return frame; }
+			inline size_t size() const { return frame? frame->size() : 0; }
+			inline explicit operator bool() const { return frame != nullptr; }
+
+		private:
+			PacketID packetID = 0;
+			SharedFrame frame;
+	};
+}
@@ -2,9 +2,12 @@
 
 #include <format>
 #include <memory>
+#include <vector>
 
 #include "net/Buffer.h"
 #include "net/GenericClient.h"
+#include "net/PacketReader.h"
+#include "net/PreencodedPacket.h"
 #include "packet/ErrorPacket.h"
 #include "packet/Packet.h"
 
@@ -32,6 +35,8 @@ namespace Game3 {
 			};
 
 			constexpr static size_t MAX_PACKET_SIZE = 1 << 24;
+			/** Clients have no business sending anything larger. */
+			constexpr static size_t MAX_PAYLOAD_SIZE = 32768;
 
 			RemoteClient() = delete;
 
@@ -41,7 +46,12 @@ namespace Game3 {
 
 			void handleInput(std::string_view) override;
 			bool send(const Packet &);
+			/** Queues already framed bytes without encoding or copying them. Like any other packet, they go into the send
+			 *  buffer while the client is buffering. */
+			bool send(const PreencodedPacket &);
 			void sendChunk(Realm &, ChunkPosition, bool can_request = true, uint64_t counter_threshold = 0);
+			/** Answers a request for a chunk the client has cached with the given digest. */
+			void sendCachedChunk(Realm &, ChunkPosition, uint64_t cached_digest);
 			inline auto getPlayer() const { return weakPlayer.lock(); }
 			inline void setPlayer(const std::shared_ptr<ServerPlayer> &shared) { weakPlayer = shared; }
 			inline auto bufferGuard() { return BufferGuard(*this); }
@@ -63,14 +73,15 @@ namespace Game3 {
 			}
 
 		private:
-			enum class State {Begin, Data};
-			State state = State::Begin;
-			std::vector<uint8_t> headerBytes;
-			uint16_t packetType = 0;
-			uint32_t payloadSize = 0;
 			std::weak_ptr<ServerPlayer> weakPlayer;
+			PacketReader reader{MAX_PAYLOAD_SIZE};
+			/** Reused for every packet so that decoding doesn't allocate once it has grown to fit. */
 			Buffer receiveBuffer;
+			/** The packets decoded from one read, queued together once the read is parsed. */
+			std::vector<std::shared_ptr<Packet>> receivedPackets;
 
+			/** Throws PacketError if the payload isn't a valid packet of the given type. */
+			std::shared_ptr<Packet> decode(PacketID, const PacketReader::Payload &);
 			void mock();
 	};
 }
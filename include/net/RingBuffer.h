@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace Game3 {
+	/** A fixed-capacity byte queue that wraps around instead of shifting its contents as they're consumed. */
+	class RingBuffer {
+		public:
+			explicit RingBuffer(size_t capacity_):
+				storage(capacity_) {}
+
+			inline size_t size() const { return used; }
+			inline size_t capacity() const { return storage.size(); }
+			inline size_t available() const { return capacity() - used; }
+			inline bool empty() const { return used == 0; }
+
+			/** Copies in as much as fits and returns how much that was. */
+			size_t write(std::span<const uint8_t> bytes) {
+				const size_t count = std::min(bytes.size(), available());
+				const size_t end = (start + used) % capacity();
+				const size_t first = std::min(count, capacity() - end);
+				std::memcpy(storage.data() + end, bytes.data(), first);
+				std::memcpy(storage.data(), bytes.data() + first, count - first);
+				used += count;
+				return count;
+			}
+
+			inline uint8_t operator[](size_t offset) const {
+				assert(offset < used);
+				return storage[(start + offset) % capacity()];
+			}
+
+			/** Returns `count` bytes starting `offset` bytes in as up to two contiguous pieces. The second piece is empty
+			 *  unless the bytes wrap around the end of the storage. */
+			std::pair<std::span<const uint8_t>, std::span<const uint8_t>> view(size_t offset, size_t count) const {
+				assert(offset + count <= used);
+				const size_t begin = (start + offset) % capacity();
+				const size_t first = std::min(count, capacity() - begin);
+				return {std::span(storage.data() + begin, first), std::span(storage.data(), count - first)};
+			}
+
+			void consume(size_t count) {
+				assert(count <= used);
+				used -= count;
+				// Starting over at the front keeps the next packet contiguous whenever the buffer drains.
+				start = used == 0? 0 : (start + count) % capacity();
+			}
+
+			void clear() {
+				start = 0;
+				used = 0;
+			}
+
+		private:
+			std::vector<uint8_t> storage;
+			size_t start = 0;
+			size_t used = 0;
+	};
+}
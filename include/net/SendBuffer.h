@@ -1,5 +1,7 @@
 #pragma once
 
+#include "net/Frame.h"
+
 #include <atomic>
 #include <cassert>
 #include <mutex>
@@ -10,7 +12,8 @@ namespace Game3 {
 	struct SendBuffer {
 		std::shared_mutex mutex;
 		std::atomic_size_t depth = 0;
-		std::string bytes;
+		/** Frames are held by reference until the buffer is flushed, so buffering doesn't copy anything. */
+		std::vector<SharedFrame> frames;
 		SendBuffer() = default;
 
 		inline auto sharedLock() { return std::shared_lock(mutex); }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types/Types.h"
+#include "net/Frame.h"
 #include "threading/Lockable.h"
 
 #include <atomic>
@@ -14,6 +15,7 @@
 #include <set>
 #include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <sys/types.h>
 #include <thread>
 #include <unordered_map>
@@ -70,7 +72,12 @@ namespace Game3 {
 			[[nodiscard]] inline int getPort() const { return port; }
 			void handleMessage(RemoteClient &, std::string_view);
 			void mainLoop();
-			void send(RemoteClient &, std::string, bool force = false);
+			/** Copies raw bytes into a frame. Packets should be sent as frames instead. */
+			void send(RemoteClient &, std::string_view, bool force = false);
+			/** Sends a shared, already framed message. Goes into the client's send buffer if it's buffering. */
+			void send(RemoteClient &, SharedFrame, bool force = false);
+			/** Queues several frames to the client's outbox at once, in order. */
+			void send(RemoteClient &, std::vector<SharedFrame>);
 			void run();
 			void stop();
 			bool close(RemoteClientPtr);
@@ -87,7 +94,7 @@ namespace Game3 {
 			template <std::integral T>
 			void send(RemoteClient &client, T value) {
 				const T little = toLittle(value);
-				send(client, std::string(reinterpret_cast<const char *>(&little), sizeof(T)));
+				send(client, std::string_view(reinterpret_cast<const char *>(&little), sizeof(T)));
 			}
 
 			[[nodiscard]]
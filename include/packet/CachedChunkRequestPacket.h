@@ -0,0 +1,28 @@
+#pragma once
+
+#include <map>
+
+#include "types/ChunkPosition.h"
+#include "packet/Packet.h"
+
+namespace Game3 {
+	/** Asks for chunks the client has cached from an earlier session, along with the digests of the cached copies.
+	 *  Chunks whose digests still match are answered with a ChunkUnchangedPacket instead of their contents. */
+	struct CachedChunkRequestPacket: Packet {
+		static PacketID ID() { return 64; }
+
+		RealmID realmID;
+		std::map<ChunkPosition, uint64_t> digests;
+
+		CachedChunkRequestPacket() = default;
+		CachedChunkRequestPacket(RealmID realm_id, std::map<ChunkPosition, uint64_t> digests_):
+			realmID(realm_id), digests(std::move(digests_)) {}
+
+		PacketID getID() const override { return ID(); }
+
+		void encode(Game &, Buffer &buffer) const override;
+		void decode(Game &, Buffer &buffer)       override;
+
+		void handle(const std::shared_ptr<ServerGame> &, RemoteClient &) override;
+	};
+}
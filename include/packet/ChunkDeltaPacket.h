@@ -0,0 +1,36 @@
+#pragma once
+
+#include "types/ChunkPosition.h"
+#include "game/TileProvider.h"
+#include "net/Buffer.h"
+#include "packet/Packet.h"
+
+#include <span>
+
+namespace Game3 {
+	/** Brings a client's copy of a chunk from one update counter to a later one without resending the whole chunk. */
+	struct ChunkDeltaPacket: Packet {
+		static PacketID ID() { return 63; }
+
+		RealmID realmID;
+		ChunkPosition chunkPosition;
+		/** The update counter the client's copy has to be at for the changes to apply. */
+		uint64_t fromCounter = 0;
+		uint64_t toCounter = 0;
+		/** Runs of consecutive tiles in one layer: the layer, the offset of the first tile, the number of tiles, then the tiles. */
+		std::vector<uint16_t> tileRuns;
+		/** Runs of consecutive fluids: the offset of the first fluid, the number of fluids, then the fluids. */
+		std::vector<uint64_t> fluidRuns;
+
+		ChunkDeltaPacket() = default;
+		/** The changes have to be ordered by part and index, like TileProvider::getChangesSince returns them. */
+		ChunkDeltaPacket(RealmID, ChunkPosition, uint64_t from_counter, uint64_t to_counter, std::span<const ChunkChange>);
+
+		PacketID getID() const override { return ID(); }
+
+		void encode(Game &, Buffer &buffer) const override { buffer << realmID << chunkPosition << fromCounter << toCounter << tileRuns << fluidRuns; }
+		void decode(Game &, Buffer &buffer)       override { buffer >> realmID >> chunkPosition >> fromCounter >> toCounter >> tileRuns >> fluidRuns; }
+
+		void handle(const std::shared_ptr<ClientGame> &) override;
+	};
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "game/TileProvider.h"
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace Game3 {
+	/** Packs chunk changes into runs of consecutive offsets. Tile runs are the layer, the offset of the first tile, the
+	 *  number of tiles, then the tiles. Fluid runs are the offset of the first fluid, the number of fluids, then the
+	 *  fluids. The changes have to be ordered by part and index. */
+	void packChunkRuns(std::span<const ChunkChange>, std::vector<uint16_t> &tile_runs, std::vector<uint64_t> &fluid_runs);
+
+	/** Throws PacketError, naming the given packet, if any run is truncated or reaches outside the chunk. */
+	void validateChunkRuns(const std::vector<uint16_t> &tile_runs, const std::vector<uint64_t> &fluid_runs, std::string_view packet_name);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "types/ChunkPosition.h"
+#include "net/Buffer.h"
+#include "packet/Packet.h"
+
+namespace Game3 {
+	/** Tells a client that the copy of a chunk in its chunk cache is still current. */
+	struct ChunkUnchangedPacket: Packet {
+		static PacketID ID() { return 65; }
+
+		RealmID realmID;
+		ChunkPosition chunkPosition;
+		uint64_t updateCounter = 0;
+		uint64_t digest = 0;
+
+		ChunkUnchangedPacket() = default;
+		ChunkUnchangedPacket(RealmID realm_id, ChunkPosition chunk_position, uint64_t update_counter, uint64_t digest_):
+			realmID(realm_id), chunkPosition(chunk_position), updateCounter(update_counter), digest(digest_) {}
+
+		PacketID getID() const override { return ID(); }
+
+		void encode(Game &, Buffer &buffer) const override { buffer << realmID << chunkPosition << updateCounter << digest; }
+		void decode(Game &, Buffer &buffer)       override { buffer >> realmID >> chunkPosition >> updateCounter >> digest; }
+
+		void handle(const std::shared_ptr<ClientGame> &) override;
+	};
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "types/ChunkPosition.h"
+#include "game/TileProvider.h"
+#include "net/Buffer.h"
+#include "packet/Packet.h"
+
+#include <span>
+
+namespace Game3 {
+	/** Every tile and fluid change made to one chunk during a tick, sent in place of a TileUpdatePacket or
+	 *  FluidUpdatePacket per change. Uses the same runs as ChunkDeltaPacket, compressed when they're large. */
+	struct TileBatchPacket: Packet {
+		static PacketID ID() { return 66; }
+
+		/** Runs that encode to more bytes than this are compressed with zstd. */
+		constexpr static size_t COMPRESSION_THRESHOLD = 512;
+
+		RealmID realmID;
+		ChunkPosition chunkPosition;
+		std::vector<uint16_t> tileRuns;
+		std::vector<uint64_t> fluidRuns;
+
+		TileBatchPacket() = default;
+		/** The changes have to be ordered by part and index. */
+		TileBatchPacket(RealmID, ChunkPosition, std::span<const ChunkChange>);
+
+		PacketID getID() const override { return ID(); }
+
+		void encode(Game &, Buffer &) const override;
+		void decode(Game &, Buffer &) override;
+
+		void handle(const std::shared_ptr<ClientGame> &) override;
+	};
+}
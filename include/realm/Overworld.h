@@ -13,6 +13,7 @@ namespace Game3 {
 			using Realm::Realm;
 
 			void generateChunk(const ChunkPosition &) override;
+			void generateChunks(const std::vector<ChunkPosition> &) override;
 
 		protected:
 			void absorbJSON(const nlohmann::json &, bool full_data) override;
@@ -1,10 +1,12 @@
 #pragma once
 
+#include "algorithm/PathGraph.h"
 #include "container/WeakSet.h"
 #include "entity/EntityZCompare.h"
 #include "error/MultipleFoundError.h"
 #include "error/NoneFoundError.h"
 #include "game/BiomeMap.h"
+#include "game/ChunkPager.h"
 #include "game/TileProvider.h"
 #include "game/Village.h"
 #include "graphics/ElementBufferedRenderer.h"
@@ -15,8 +17,9 @@
 #include "packet/TileEntityPacket.h"
 #include "pipes/PipeLoader.h"
 #include "threading/Lockable.h"
-#include "threading/MTQueue.h"
+#include "threading/MPSCQueue.h"
 #include "threading/SharedRecursiveMutex.h"
+#include "threading/ThreadContext.h"
 #include "tileentity/TileEntity.h"
 #include "types/TileUpdateContext.h"
 #include "types/Types.h"
@@ -25,7 +28,10 @@
 
 #include <nlohmann/json_fwd.hpp>
 
+#include <cassert>
+#include <chrono>
 #include <climits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -34,6 +40,7 @@
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace Game3 {
 	constexpr int64_t REALM_DIAMETER = 3;
@@ -41,6 +48,7 @@ namespace Game3 {
 	class Entity;
 	class Game;
 	class RemoteClient;
+	class TileView;
 	struct RendererContext;
 
 	using EntityPtr = std::shared_ptr<Entity>;
@@ -64,16 +72,39 @@ namespace Game3 {
 				~Pauser() { realm->updatesPaused = false; }
 			};
 
+			/** Generation is tracked per thread so that chunks can be generated in the background while the realm ticks normally. */
 			struct GenerationGuard {
 				std::shared_ptr<Realm> realm;
-				GenerationGuard(std::shared_ptr<Realm> realm_): realm(realm_) { ++realm->generationDepth; }
-				~GenerationGuard() { --realm->generationDepth; }
+				GenerationGuard(std::shared_ptr<Realm> realm_): realm(realm_) { ++threadContext.generations[realm.get()].depth; }
+				~GenerationGuard();
 			};
 
 		public:
+			struct GenerationStats {
+				/** Chunks waiting for a generation batch. */
+				std::atomic_size_t queued = 0;
+				/** Chunks being generated in the background. */
+				std::atomic_size_t inFlight = 0;
+				std::atomic_size_t generated = 0;
+				std::atomic_size_t batches = 0;
+				/** Time from a chunk being queued to it being committed, summed over all generated chunks. */
+				std::atomic_uint64_t totalLatencyNanos = 0;
+				std::atomic_uint64_t maxLatencyNanos = 0;
+			};
+
+			/** The maximum number of chunks generated together in one background batch. */
+			constexpr static size_t GENERATION_BATCH_SIZE = 16;
+			/** How often the server looks for chunks to page out. */
+			constexpr static std::chrono::seconds PAGING_INTERVAL{5};
+			/** How long an unpinned chunk stays resident if the chunkIdleTime rule isn't set. */
+			constexpr static ssize_t DEFAULT_CHUNK_IDLE_SECONDS = 300;
+			/** The most chunks packed per paging pass, to bound how long a pass holds up the tick. */
+			constexpr static size_t COMPACTION_BATCH_SIZE = 256;
+
 			RealmID id = -1;
 			RealmType type;
 			TileProvider tileProvider;
+			PathGraph pathGraph{tileProvider};
 			PipeLoader pipeLoader;
 			std::optional<std::array<std::array<ElementBufferedRenderer, REALM_DIAMETER>, REALM_DIAMETER>> baseRenderers;
 			std::optional<std::array<std::array<UpperRenderer, REALM_DIAMETER>, REALM_DIAMETER>> upperRenderers;
@@ -87,8 +118,19 @@ namespace Game3 {
 			/** Whether the realm's rendering should be affected by the day-night cycle. */
 			bool outdoors = true;
 			int64_t seed = 0;
-			std::unordered_set<ChunkPosition> generatedChunks;
+			Lockable<std::unordered_set<ChunkPosition>> generatedChunks;
+			GenerationStats generationStats;
+			/** Villages generated into a staging realm. They're added to the game once their chunks are committed. */
+			Lockable<std::vector<VillagePtr>> stagedVillages;
+			/** Building interiors generated from a staging realm. They're added to the game once their chunks are committed. */
+			Lockable<std::vector<RealmPtr>> stagedRealms;
 			Lockable<std::unordered_set<ChunkPosition>> visibleChunks;
+			/** The players within view of each chunk, rebuilt along with visibleChunks. Lets a broadcast about a position skip
+			 *  every player who's too far away to see it instead of checking them all. Only maintained on the server. */
+			Lockable<std::unordered_map<ChunkPosition, std::vector<std::weak_ptr<Player>>>> chunkSubscribers;
+			/** Players queued for addition here. Entity::canSee already counts them as being in this realm, so they're
+			 *  subscribers everywhere until they arrive and the next recalculation places them. Only maintained on the server. */
+			Lockable<std::vector<std::weak_ptr<Player>>> incomingPlayers;
 			std::atomic_bool wakeupPending = false;
 			std::atomic_bool snoozePending = false;
 
@@ -97,6 +139,9 @@ namespace Game3 {
 
 			std::atomic_bool staticLightingQueued = false;
 
+			/** Set by ServerGame while it ticks this realm alongside others on the pool. */
+			std::atomic_bool tickingInParallel = false;
+
 			Realm(const Realm &) = delete;
 			Realm(Realm &&) = delete;
 
@@ -158,6 +203,7 @@ namespace Game3 {
 			void queueAddition(const EntityPtr &, const Position &);
 			void queueAddition(const TileEntityPtr &);
 			void queue(std::function<void()>);
+			void queuePathfind(const EntityPtr &, const Position &goal, size_t loop_max, std::function<void(bool)> on_done = {});
 			void absorb(const EntityPtr &, const Position &);
 			void setTile(Layer, Index row, Index column, TileID, bool run_helper = true, TileUpdateContext = {});
 			void setTile(Layer, const Position &, TileID, bool run_helper = true, TileUpdateContext = {});
@@ -182,6 +228,7 @@ namespace Game3 {
 			void remakePathMap(Position);
 			void markGenerated(const ChunkRange &);
 			void markGenerated(ChunkPosition);
+			bool isGenerated(ChunkPosition) const;
 			bool isVisible(const Position &);
 			bool hasTileEntity(GlobalID);
 			bool hasEntity(GlobalID);
@@ -209,7 +256,19 @@ namespace Game3 {
 			std::shared_ptr<Lockable<std::unordered_set<TileEntityPtr>>> getTileEntities(ChunkPosition);
 			void sendToMany(const std::unordered_set<std::shared_ptr<RemoteClient>> &, ChunkPosition);
 			void sendToOne(RemoteClient &, ChunkPosition);
+			/** Sends only what changed since the given update counter if the chunk's journal goes back that far. */
+			void sendToOne(RemoteClient &, ChunkPosition, uint64_t client_counter);
+			/** Tells the client its cached copy is current if the digest matches and sends the whole chunk otherwise. */
+			void sendCachedToOne(RemoteClient &, ChunkPosition, uint64_t cached_digest);
 			void recalculateVisibleChunks();
+			/** Sends the tile and fluid changes made since the last flush to the players who can see them, as one packet per
+			 *  chunk. Server only. Called at the end of every tick and before a tile entity is announced or destroyed, since
+			 *  clients expect the tiles under one to be current. Entity packets can go out ahead of a flush: the client
+			 *  applies their positions as sent without looking at tiles. */
+			void flushTileUpdates();
+			/** The players that had the chunk in view when visible chunks were last recalculated, plus any players on their
+			 *  way into the realm. */
+			std::vector<PlayerPtr> getSubscribers(ChunkPosition) const;
 			void queueReupload();
 			void autotile(const Position &, Layer, TileUpdateContext = {});
 			/** Should be called in the UI thread. */
@@ -217,9 +276,14 @@ namespace Game3 {
 			void queueStaticLightingTexture();
 
 			inline const auto & getPlayers() const { return players; }
-			inline void markGenerated(auto x, auto y) { generatedChunks.emplace(x, y); }
+			inline void markGenerated(auto x, auto y) { auto lock = generatedChunks.uniqueLock(); generatedChunks.emplace(x, y); }
 			inline auto pauseUpdates() { return Pauser(shared_from_this()); }
 			inline auto guardGeneration() { return GenerationGuard(shared_from_this()); }
+			/** Whether this realm only exists to have chunks generated into it before they're committed to the live realm. */
+			inline bool isStaging() const { return staging; }
+			/** Adds a realm generated from this one, such as a building's interior, to the game. A staging realm holds on to it
+			 *  until its chunks are committed, so that the game's realms are only added to on the ticking thread. */
+			void addInteriorRealm(const RealmPtr &);
 			inline bool isClient() const { return getSide() == Side::Client; }
 			inline bool isServer() const { return getSide() == Side::Server; }
 
@@ -229,6 +293,9 @@ namespace Game3 {
 			virtual bool rightClick(const Position &, double x, double y);
 			/** Generates additional chunks for the infinite map after the initial worldgen of the realm. */
 			virtual void generateChunk(const ChunkPosition &) {}
+			/** Generates a batch of chunks and remakes their path maps. Called off the tick thread.
+			 *  The default implementation generates the chunks one at a time. */
+			virtual void generateChunks(const std::vector<ChunkPosition> &);
 			virtual bool canSpawnMonsters() const;
 
 			/** Full data doesn't include terrain, entities or tile entities. */
@@ -320,8 +387,10 @@ namespace Game3 {
 			std::atomic_bool focused = false;
 			/** Whether to prevent updateNeighbors from running. */
 			std::atomic_bool updatesPaused = false;
-			std::atomic_int generationDepth = 0;
-			bool isGenerating() const { return generationDepth > 0; }
+			bool isGenerating() const { return threadContext.generations.contains(this); }
+			/** Bumps a chunk's update counter for a change. Under a generation guard, the bump is deferred until the last
+			 *  guard is released so that a generated chunk is bumped once rather than once per tile. */
+			void updateChunk(ChunkPosition, const ChunkChange &);
 
 			Realm(const std::shared_ptr<Game> &);
 			Realm(const std::shared_ptr<Game> &, RealmID, RealmType, Identifier tileset_id, int64_t seed_);
@@ -338,32 +407,89 @@ namespace Game3 {
 				std::vector<TileEntityPacket> tileEntityPackets;
 			};
 
+			struct QueuedPathfind {
+				std::weak_ptr<Entity> entity;
+				Position goal;
+				size_t loopMax;
+				std::function<void(bool)> onDone;
+			};
+
 			std::weak_ptr<Game> weakGame;
 			std::atomic_bool ticking = false;
-			MTQueue<std::weak_ptr<Entity>> entityRemovalQueue;
-			MTQueue<std::weak_ptr<Entity>> entityDestructionQueue;
-			MTQueue<std::pair<std::shared_ptr<Entity>, Position>> entityAdditionQueue;
-			MTQueue<std::pair<EntityPtr, Position>> entityInitializationQueue;
-			MTQueue<std::weak_ptr<TileEntity>> tileEntityRemovalQueue;
-			MTQueue<std::weak_ptr<TileEntity>> tileEntityDestructionQueue;
-			MTQueue<std::weak_ptr<TileEntity>> tileEntityAdditionQueue;
-			MTQueue<std::weak_ptr<Player>> playerRemovalQueue;
-			MTQueue<std::function<void()>> generalQueue;
+
+			/** While realms tick in parallel, a realm may only be changed directly by its own tick. Other realms' ticks have
+			 *  to go through the queue functions or ServerGame::queueCrossRealmAction. */
+			inline void assertTickOwner() const {
+				assert(!tickingInParallel || threadContext.tickingRealm == nullptr || threadContext.tickingRealm == this);
+			}
+			MPSCQueue<std::weak_ptr<Entity>> entityRemovalQueue;
+			MPSCQueue<std::weak_ptr<Entity>> entityDestructionQueue;
+			MPSCQueue<std::pair<std::shared_ptr<Entity>, Position>> entityAdditionQueue;
+			MPSCQueue<std::pair<EntityPtr, Position>> entityInitializationQueue;
+			MPSCQueue<std::weak_ptr<TileEntity>> tileEntityRemovalQueue;
+			MPSCQueue<std::weak_ptr<TileEntity>> tileEntityDestructionQueue;
+			MPSCQueue<std::weak_ptr<TileEntity>> tileEntityAdditionQueue;
+			MPSCQueue<std::weak_ptr<Player>> playerRemovalQueue;
+			MPSCQueue<std::function<void()>> generalQueue;
+			MPSCQueue<QueuedPathfind> pathfindQueue;
 			Lockable<std::unordered_map<ChunkPosition, std::shared_ptr<Lockable<std::set<EntityPtr, EntityZCompare>>>>> entitiesByChunk;
 			Lockable<std::unordered_map<ChunkPosition, std::shared_ptr<Lockable<std::unordered_set<TileEntityPtr>>>>> tileEntitiesByChunk;
 			Lockable<std::unordered_set<VillagePtr>> villages;
 			ChunkPosition lastPlayerChunk{INT32_MIN, INT32_MIN};
 
 			Lockable<std::map<ChunkPosition, WeakSet<RemoteClient>>> chunkRequests;
+			/** Tile and fluid changes waiting for the next flush, by chunk and then by part and offset. Writing the same tile
+			 *  again before the flush replaces the value instead of adding another change. */
+			Lockable<std::unordered_map<ChunkPosition, std::map<std::pair<uint8_t, uint16_t>, uint64_t>>> pendingTileUpdates;
+
+			std::atomic_bool generationBusy = false;
+			/** Chunks handed to the background generator that haven't been committed yet. Only used by the ticking thread. */
+			std::unordered_set<ChunkPosition> chunksInGeneration;
+			/** When each pending chunk was first seen by the generation pipeline. Only used by the ticking thread. */
+			std::unordered_map<ChunkPosition, std::chrono::system_clock::time_point> generationRequestTimes;
+			struct GeneratedBatch {
+				std::vector<ChunkPosition> chunkPositions;
+				/** The realm the chunks were generated into, or null if generating them failed. */
+				std::shared_ptr<Realm> staging;
+			};
+
+			/** Batches that have finished generating and are waiting to be committed at the next tick. */
+			MPSCQueue<GeneratedBatch> generatedBatches;
+			bool staging = false;
+			ChunkPager chunkPager{tileProvider};
+			/** Only used by the ticking thread. */
+			std::chrono::steady_clock::time_point nextPagingPass{};
 
 			SharedRecursiveMutex tileEntityMutex;
 
 			void initRendererRealms();
 			void initRendererTileProviders();
 			bool isWalkable(Index row, Index column, const Tileset &);
+			/** Doesn't lock tileEntities; the caller has to. */
+			bool isWalkable(const TileView &, Position, const Tileset &) const;
 			void setLayerHelper(Index row, Index col, Layer, TileUpdateContext = {});
 			ChunkPackets getChunkPackets(ChunkPosition);
+			void sendEntitiesToOne(RemoteClient &, ChunkPosition);
+			void removeIncomingPlayer(const PlayerPtr &);
+			void queueTileUpdate(ChunkPosition, const ChunkChange &);
 			void initEntity(const EntityPtr &, const Position &);
+			/** Commits finished generation batches, answers chunk requests and starts a new batch if none is running. */
+			void tickGeneration();
+			/** Solves every pathfind queued since the last tick in one batch. */
+			void tickPathfinding();
+			void startGenerationBatch();
+			/** Creates a realm of the same type and settings that the game doesn't know about, for generating chunks into. */
+			std::shared_ptr<Realm> makeStagingRealm();
+			/** Copies generated chunks from a staging realm, then adds the tile entities, entities, villages and interior
+			 *  realms generation created in them and autotiles the edges of the neighboring chunks. */
+			void commitGenerated(Realm &staging_realm, const std::vector<ChunkPosition> &);
+			/** Remakes the path maps of chunks that were paged back in, loads faulted chunks in the background and every
+			 *  PAGING_INTERVAL packs idle chunks and pages out the chunks that aren't needed. */
+			void tickPaging();
+			/** The chunks that mustn't be paged out: the ones players can see, the ones with tile entities (which includes
+			 *  every pipe), the ones around moving entities and along their paths, the ones villages cover and the ones being
+			 *  generated, along with their neighbors. */
+			std::unordered_set<ChunkPosition> getPinnedChunks();
 			bool isActive() const;
 
 			static BiomeType getBiome(int64_t seed);
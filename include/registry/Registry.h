@@ -12,6 +12,7 @@
 #include <set>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -139,9 +140,10 @@ namespace Game3 {
 
 			inline std::shared_ptr<T> add(Identifier new_name, std::shared_ptr<T> new_item) {
 				if (auto [iter, inserted] = items.try_emplace(new_name, std::move(new_item)); inserted) {
-					iter->second->identifier = std::move(new_name);
+					iter->second->identifier = new_name;
 					iter->second->registryID = nextCounter++;
 					byCounter.push_back(iter->second);
+					byHandle.emplace(new_name.getHandle(), iter->second);
 					return iter->second;
 				}
 
@@ -153,22 +155,22 @@ namespace Game3 {
 			}
 
 			inline bool contains(const Identifier &id) const {
-				return items.contains(id);
+				return byHandle.contains(id.getHandle());
 			}
 
 			template <typename S>
 			inline S & get() {
-				return *std::dynamic_pointer_cast<S>(items.at(S::ID()));
+				return *std::dynamic_pointer_cast<S>(byHandle.at(Identifier(S::ID()).getHandle()));
 			}
 
 			template <typename S>
 			inline const S & get() const {
-				return *std::dynamic_pointer_cast<const S>(items.at(S::ID()));
+				return *std::dynamic_pointer_cast<const S>(byHandle.at(Identifier(S::ID()).getHandle()));
 			}
 
 			inline std::shared_ptr<T> maybe(const Identifier &id) const {
-				auto iter = items.find(id);
-				if (iter == items.end())
+				auto iter = byHandle.find(id.getHandle());
+				if (iter == byHandle.end())
 					return {};
 				return iter->second;
 			}
@@ -192,17 +194,16 @@ namespace Game3 {
 			}
 
 			inline std::shared_ptr<T> at(const Identifier &id) const {
-				try {
-					return items.at(id);
-				} catch (const std::out_of_range &) {
-					ERROR("Couldn't find \"{}\" in registry {}", id, identifier);
-					return {};
-				}
+				if (auto iter = byHandle.find(id.getHandle()); iter != byHandle.end())
+					return iter->second;
+				ERROR("Couldn't find \"{}\" in registry {}", id, identifier);
+				return {};
 			}
 
 			inline void clear() {
 				items.clear();
 				byCounter.clear();
+				byHandle.clear();
 				nextCounter = 0;
 			}
 
@@ -225,6 +226,11 @@ namespace Game3 {
 			inline auto rend() const {
 				return items.rend();
 			}
+
+		private:
+			/** Lookups go through here so that they compare integers instead of walking the map's string comparisons.
+			 *  `items` stays ordered by name for iteration. */
+			std::unordered_map<IdentifierHandle, std::shared_ptr<T>> byHandle;
 	};
 
 	struct UnnamedRegistryBase: Registry {
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace Game3 {
+	/** A lock-free, unbounded multi-producer/single-consumer queue (Vyukov's node-based design).
+	 *  Any thread may push; only one thread at a time may call tryTake, steal or empty. */
+	template <typename T>
+	class MPSCQueue {
+		private:
+			struct Node {
+				std::atomic<Node *> next = nullptr;
+				std::optional<T> value;
+
+				Node() = default;
+
+				template <typename... Args>
+				Node(std::in_place_t, Args &&...args):
+					value(std::in_place, std::forward<Args>(args)...) {}
+			};
+
+			/** Producers swap themselves in here. */
+			alignas(64) std::atomic<Node *> head;
+			/** The consumer's sentinel. Its value has already been taken (or never existed). */
+			alignas(64) Node *tail;
+			alignas(64) std::atomic_size_t approximateSize = 0;
+
+			void pushNode(Node *node) {
+				// Counted before the node is published, so the consumer's decrement for it can't come first and wrap the count.
+				approximateSize.fetch_add(1, std::memory_order_relaxed);
+				Node *previous = head.exchange(node, std::memory_order_acq_rel);
+				// Until this store lands, the consumer can't see this node or any pushed after it.
+				previous->next.store(node, std::memory_order_release);
+			}
+
+		public:
+			MPSCQueue():
+				head(new Node), tail(head.load(std::memory_order_relaxed)) {}
+
+			MPSCQueue(const MPSCQueue &) = delete;
+			MPSCQueue(MPSCQueue &&) = delete;
+
+			~MPSCQueue() {
+				while (tail != nullptr) {
+					Node *next = tail->next.load(std::memory_order_relaxed);
+					delete tail;
+					tail = next;
+				}
+			}
+
+			MPSCQueue & operator=(const MPSCQueue &) = delete;
+			MPSCQueue & operator=(MPSCQueue &&) = delete;
+
+			inline void push(T &&value) {
+				pushNode(new Node(std::in_place, std::move(value)));
+			}
+
+			inline void push(const T &value) {
+				pushNode(new Node(std::in_place, value));
+			}
+
+			template <typename... Args>
+			inline void emplace(Args &&...args) {
+				pushNode(new Node(std::in_place, std::forward<Args>(args)...));
+			}
+
+			/** Pushes several values with a single exchange, so they stay together and in order. */
+			void pushAll(std::vector<T> &&values) {
+				if (values.empty())
+					return;
+
+				Node *first = new Node(std::in_place, std::move(values.front()));
+				Node *last = first;
+				for (size_t i = 1; i < values.size(); ++i) {
+					Node *node = new Node(std::in_place, std::move(values[i]));
+					last->next.store(node, std::memory_order_relaxed);
+					last = node;
+				}
+
+				approximateSize.fetch_add(values.size(), std::memory_order_relaxed);
+				Node *previous = head.exchange(last, std::memory_order_acq_rel);
+				previous->next.store(first, std::memory_order_release);
+				values.clear();
+			}
+
+			/** Consumer only. */
+			std::optional<T> tryTake() {
+				Node *next = tail->next.load(std::memory_order_acquire);
+				if (next == nullptr)
+					return std::nullopt;
+				std::optional<T> out = std::move(next->value);
+				next->value.reset();
+				delete tail;
+				tail = next;
+				approximateSize.fetch_sub(1, std::memory_order_relaxed);
+				return out;
+			}
+
+			/** Consumer only. Takes everything currently visible in the queue, in order. */
+			std::vector<T> steal() {
+				std::vector<T> out;
+				out.reserve(approximateSize.load(std::memory_order_relaxed));
+				while (auto value = tryTake())
+					out.push_back(std::move(*value));
+				return out;
+			}
+
+			/** Consumer only. */
+			inline bool empty() const {
+				return tail->next.load(std::memory_order_acquire) == nullptr;
+			}
+
+			/** May be briefly out of date while pushes or takes are in progress. */
+			inline size_t size() const {
+				return approximateSize.load(std::memory_order_relaxed);
+			}
+	};
+}
@@ -1,19 +1,29 @@
 #pragma once
 
+#include "algorithm/PathScratch.h"
 #include "Layer.h"
+#include "types/ChunkPosition.h"
 #include "types/Types.h"
 
 #include <chrono>
 #include <memory>
 #include <random>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace Game3 {
 	class Game;
+	class Realm;
 
 	class ThreadContext {
 		public:
+			struct Generation {
+				size_t depth = 0;
+				/** Chunks changed under the guards, bumped once when the last guard is released. */
+				std::unordered_set<ChunkPosition> dirtyChunks;
+			};
+
 			std::default_random_engine rng;
 			std::thread::id threadID;
 			Index rowMin = -1;
@@ -22,6 +32,11 @@ namespace Game3 {
 			Index colMax = -1;
 			size_t updateNeighborsDepth = 0;
 			std::unordered_set<Layer> updatedLayers;
+			/** The generation guards this thread holds for each realm. */
+			std::unordered_map<const Realm *, Generation> generations;
+			PathScratch pathScratch;
+			/** The realm this thread is ticking while realms tick in parallel, if any. */
+			const Realm *tickingRealm = nullptr;
 			bool valid = false;
 
 			ThreadContext():
@@ -39,6 +54,18 @@ namespace Game3 {
 				valid(true),
 				game(game_) {}
 
+			/** Sets up the thread to work on one region of a realm. Unlike assigning a new context, this leaves the rest of
+			 *  the thread's state (such as its generation guards and path scratch) alone. */
+			void setRegion(const std::shared_ptr<Game> &game_, uint_fast32_t seed, Index row_min, Index row_max, Index col_min, Index col_max) {
+				rng.seed(seed);
+				rowMin = row_min;
+				rowMax = row_max;
+				colMin = col_min;
+				colMax = col_max;
+				valid = true;
+				game = game_;
+			}
+
 			template <std::integral T>
 			/** [min, max] */
 			T random(T min, T max) {
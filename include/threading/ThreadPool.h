@@ -1,22 +1,60 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
-#include <condition_variable>
+#include <exception>
 #include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "Log.h"
 #include "threading/ThreadContext.h"
 #include "threading/MTQueue.h"
+#include "threading/WorkStealingDeque.h"
 
 namespace Game3 {
+	/** Each worker owns a deque: jobs added from inside the pool go onto the adding worker's deque, while jobs added
+	 *  from elsewhere go through a shared injection queue. Idle workers steal from each other. */
 	class ThreadPool {
 		public:
 			using Function = std::function<void(ThreadPool &, size_t)>;
 
+			/** A set of jobs that can be waited on together. Exceptions thrown by the jobs are rethrown by wait(). */
+			class TaskGroup {
+				public:
+					TaskGroup(ThreadPool &);
+					TaskGroup(const TaskGroup &) = delete;
+					TaskGroup(TaskGroup &&) = delete;
+					~TaskGroup();
+
+					TaskGroup & operator=(const TaskGroup &) = delete;
+					TaskGroup & operator=(TaskGroup &&) = delete;
+
+					/** Runs the function on the calling thread if the pool isn't accepting jobs. */
+					void add(std::function<void()>);
+
+					/** Blocks until every job has finished. Called from one of the pool's workers, it runs other jobs while it waits. */
+					void wait();
+
+				private:
+					struct State {
+						std::atomic_size_t remaining = 0;
+						std::mutex exceptionMutex;
+						std::exception_ptr exception;
+					};
+
+					ThreadPool &pool;
+					std::shared_ptr<State> state;
+
+					void waitForJobs();
+			};
+
 			ThreadPool(size_t size_);
 
 			~ThreadPool();
@@ -25,20 +63,63 @@ namespace Game3 {
 			inline auto getSize() const { return size; }
 
 			void start();
+			/** Stops accepting jobs from outside the pool, finishes every queued job and then stops the workers. */
 			void join();
-			bool add(const Function &);
+			/** Returns false if the pool isn't accepting jobs, in which case the caller should run the job itself. */
+			bool add(Function);
+
+			/** Runs the function on the calling thread if the pool isn't accepting jobs. */
+			template <typename F>
+			auto submit(F &&function) {
+				using R = std::invoke_result_t<std::decay_t<F> &>;
+				auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(function));
+				auto future = task->get_future();
+				if (!add([task](ThreadPool &, size_t) { (*task)(); }))
+					(*task)();
+				return future;
+			}
+
+			/** Calls function(i) for every i in [begin, end), in chunks of `grain` indices, and waits for all of them. */
+			template <typename F>
+			void parallelFor(size_t begin, size_t end, F &&function, size_t grain = 1) {
+				if (grain == 0)
+					grain = 1;
+				TaskGroup group(*this);
+				for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += grain) {
+					const size_t chunk_end = std::min(end, chunk_begin + grain);
+					group.add([&function, chunk_begin, chunk_end] {
+						for (size_t i = chunk_begin; i < chunk_end; ++i)
+							function(i);
+					});
+				}
+				group.wait();
+			}
+
+			/** Runs one queued job on the calling thread, if there is one, with a ThreadContext of its own. */
+			bool runPendingJob();
+
+			/** Whether the calling thread is one of this pool's workers. */
+			bool isWorkerThread() const;
 
 			size_t jobCount() const;
 
 		protected:
 			const size_t size;
-			MTQueue<Function> workQueue;
-			std::condition_variable workCV;
-			std::mutex workMutex;
+			MTQueue<Function> injectionQueue;
+			std::vector<std::unique_ptr<WorkStealingDeque<Function>>> deques;
 			std::vector<std::thread> pool;
 			std::atomic_bool active = false;
+			std::atomic_bool accepting = false;
 			std::atomic_bool joining = false;
-			std::atomic_bool newJobReady = false;
-			std::atomic_size_t jobsDone = 0;
+			/** The number of outside threads currently inside add(). join() waits for this to reach zero. */
+			std::atomic_size_t adding = 0;
+			/** Jobs that have been queued but not yet taken by any thread. */
+			std::atomic_size_t pendingJobs = 0;
+			/** Bumped whenever idle workers might have something to do. Workers sleep on it. */
+			std::atomic_uint32_t wakeups = 0;
+
+			std::optional<Function> findJob(size_t thread_index);
+			void runJob(Function &, size_t thread_index);
+			void wake(bool all = false);
 	};
 }
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace Game3 {
+	/** A lock-free Chase-Lev work-stealing deque. The owning thread pushes and pops at the bottom;
+	 *  any other thread may steal from the top. Values are boxed so slots can be swapped atomically. */
+	template <typename T>
+	class WorkStealingDeque {
+		private:
+			struct Ring {
+				const size_t capacity;
+				const size_t mask;
+				std::unique_ptr<std::atomic<T *>[]> slots;
+
+				Ring(size_t capacity_):
+					capacity(capacity_), mask(capacity_ - 1), slots(new std::atomic<T *>[capacity_]) {}
+
+				inline T * get(int64_t index) const {
+					return slots[size_t(index) & mask].load(std::memory_order_relaxed);
+				}
+
+				inline void put(int64_t index, T *value) {
+					slots[size_t(index) & mask].store(value, std::memory_order_relaxed);
+				}
+			};
+
+			alignas(64) std::atomic_int64_t top = 0;
+			alignas(64) std::atomic_int64_t bottom = 0;
+			alignas(64) std::atomic<Ring *> ring;
+			/** Old rings are kept alive until destruction because a thief may still be reading from one. */
+			std::vector<std::unique_ptr<Ring>> rings;
+
+			Ring * grow(Ring *old, int64_t top_index, int64_t bottom_index) {
+				auto &bigger = rings.emplace_back(std::make_unique<Ring>(old->capacity * 2));
+				for (int64_t i = top_index; i < bottom_index; ++i)
+					bigger->put(i, old->get(i));
+				ring.store(bigger.get(), std::memory_order_release);
+				return bigger.get();
+			}
+
+		public:
+			WorkStealingDeque(size_t initial_capacity = 64) {
+				size_t capacity = 1;
+				while (capacity < initial_capacity)
+					capacity *= 2;
+				ring.store(rings.emplace_back(std::make_unique<Ring>(capacity)).get(), std::memory_order_relaxed);
+			}
+
+			WorkStealingDeque(const WorkStealingDeque &) = delete;
+			WorkStealingDeque(WorkStealingDeque &&) = delete;
+
+			~WorkStealingDeque() {
+				while (pop());
+			}
+
+			WorkStealingDeque & operator=(const WorkStealingDeque &) = delete;
+			WorkStealingDeque & operator=(WorkStealingDeque &&) = delete;
+
+			/** Owner only. */
+			template <typename... Args>
+			void emplace(Args &&...args) {
+				const int64_t bottom_index = bottom.load(std::memory_order_relaxed);
+				const int64_t top_index = top.load(std::memory_order_acquire);
+				Ring *current = ring.load(std::memory_order_relaxed);
+
+				if (bottom_index - top_index >= int64_t(current->capacity))
+					current = grow(current, top_index, bottom_index);
+
+				current->put(bottom_index, new T(std::forward<Args>(args)...));
+				std::atomic_thread_fence(std::memory_order_release);
+				bottom.store(bottom_index + 1, std::memory_order_relaxed);
+			}
+
+			/** Owner only. */
+			inline void push(T &&value) {
+				emplace(std::move(value));
+			}
+
+			/** Owner only. */
+			inline void push(const T &value) {
+				emplace(value);
+			}
+
+			/** Owner only. Takes the most recently pushed value. */
+			std::optional<T> pop() {
+				const int64_t bottom_index = bottom.load(std::memory_order_relaxed) - 1;
+				Ring *current = ring.load(std::memory_order_relaxed);
+				bottom.store(bottom_index, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				int64_t top_index = top.load(std::memory_order_relaxed);
+
+				if (bottom_index < top_index) {
+					bottom.store(bottom_index + 1, std::memory_order_relaxed);
+					return std::nullopt;
+				}
+
+				T *boxed = current->get(bottom_index);
+
+				if (top_index == bottom_index) {
+					// Last element: race the thieves for it.
+					const bool won = top.compare_exchange_strong(top_index, top_index + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+					bottom.store(bottom_index + 1, std::memory_order_relaxed);
+					if (!won)
+						return std::nullopt;
+				}
+
+				std::unique_ptr<T> owned(boxed);
+				return std::move(*owned);
+			}
+
+			/** Any thread. Takes the least recently pushed value. May fail spuriously under contention. */
+			std::optional<T> steal() {
+				int64_t top_index = top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				const int64_t bottom_index = bottom.load(std::memory_order_acquire);
+
+				if (bottom_index <= top_index)
+					return std::nullopt;
+
+				T *boxed = ring.load(std::memory_order_acquire)->get(top_index);
+
+				if (!top.compare_exchange_strong(top_index, top_index + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					return std::nullopt;
+
+				std::unique_ptr<T> owned(boxed);
+				return std::move(*owned);
+			}
+
+			inline bool empty() const {
+				return size() == 0;
+			}
+
+			/** Approximate when called from a thread other than the owner. */
+			inline size_t size() const {
+				const int64_t bottom_index = bottom.load(std::memory_order_relaxed);
+				const int64_t top_index = top.load(std::memory_order_relaxed);
+				return bottom_index <= top_index? 0 : size_t(bottom_index - top_index);
+			}
+	};
+}
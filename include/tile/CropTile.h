@@ -15,6 +15,7 @@ namespace Game3 {
 			CropTile(std::shared_ptr<Crop>);
 
 			void randomTick(const Place &) override;
+			bool hasRandomTick() const override { return true; }
 			bool interact(const Place &, Layer, const ItemStackPtr &, Hand) override;
 
 			bool isRipe(const Identifier &) const;
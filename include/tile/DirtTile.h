@@ -10,5 +10,6 @@ namespace Game3 {
 			DirtTile();
 
 			void randomTick(const Place &) override;
+			bool hasRandomTick() const override { return true; }
 	};
 }
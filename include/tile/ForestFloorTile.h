@@ -10,6 +10,7 @@ namespace Game3 {
 			ForestFloorTile();
 
 			void randomTick(const Place &) override;
+			bool hasRandomTick() const override { return true; }
 			bool interact(const Place &, Layer, const ItemStackPtr &, Hand) override;
 	};
 }
@@ -10,5 +10,6 @@ namespace Game3 {
 			GrassTile();
 
 			void randomTick(const Place &) override;
+			bool hasRandomTick() const override { return true; }
 	};
 }
@@ -34,6 +34,9 @@ namespace Game3 {
 			/** Returns true iff renderStaticLighting actually does anything. */
 			virtual bool hasStaticLighting() const { return false; }
 
+			/** Returns true iff randomTick actually does anything. Realm::tick doesn't random tick tiles that return false. */
+			virtual bool hasRandomTick() const;
+
 			/** Returns true if something meaningful happened, or false if Realm::updateNeighbors should default to autotiling. */
 			virtual bool update(const Place &, Layer) { return false; }
 
@@ -2,7 +2,7 @@
 
 #include "client/ClientSettings.h"
 #include "client/ServerWrapper.h"
-#include "threading/MTQueue.h"
+#include "threading/MPSCQueue.h"
 #include "threading/Lockable.h"
 #include "types/Types.h"
 #include "ui/LogOverlay.h"
@@ -118,7 +118,7 @@ namespace Game3 {
 			Gtk::ToggleButton toggleLogButton;
 			Glib::RefPtr<Gtk::Builder> builder;
 			Glib::RefPtr<Gtk::CssProvider> cssProvider;
-			MTQueue<std::function<void()>> functionQueue;
+			MPSCQueue<std::function<void()>> functionQueue;
 			Lockable<std::list<std::function<bool()>>> boolFunctions;
 			Glib::Dispatcher functionQueueDispatcher;
 			Glib::Dispatcher boolFunctionDispatcher;
@@ -13,6 +13,9 @@ namespace Game3 {
 		public:
 			static std::map<std::string, std::chrono::nanoseconds> times;
 			static std::map<std::string, size_t> counts;
+			/** Running totals recorded with count(), alongside how many times each was recorded. */
+			static std::map<std::string, size_t> tallies;
+			static std::map<std::string, size_t> tallySamples;
 			static std::shared_mutex mutex;
 			static std::atomic_bool globalEnabled;
 
@@ -26,6 +29,8 @@ namespace Game3 {
 			void stop();
 			void restart();
 
+			/** Adds to a named tally. The summary reports each tally's total and its average per call. */
+			static void count(const std::string &name, size_t amount);
 			static void summary(double threshold = 0.0);
 			static void clear();
 
@@ -5,11 +5,13 @@
 #include <vector>
 
 namespace Game3 {
-	std::vector<uint8_t>  decompress8 (std::span<const uint8_t> span);
+	/** Throws std::length_error if the data decompresses to more than max_size bytes. */
+	std::vector<uint8_t>  decompress8 (std::span<const uint8_t> span, size_t max_size = SIZE_MAX);
 	std::vector<uint16_t> decompress16(std::span<const uint8_t> span);
 	std::vector<uint32_t> decompress32(std::span<const uint8_t> span);
 	std::vector<uint64_t> decompress64(std::span<const uint8_t> span);
 	std::vector<uint8_t> compress(std::span<const uint8_t > span);
+	std::vector<uint8_t> compress(std::span<const uint8_t > span, int level);
 	std::vector<uint8_t> compress(std::span<const uint16_t> span);
 	std::vector<uint8_t> compress(std::span<const uint32_t> span);
 	std::vector<uint8_t> compress(std::span<const uint64_t> span);
@@ -2,15 +2,19 @@
 
 #include <memory>
 #include <random>
+#include <vector>
 
 #include "types/Types.h"
 
 namespace Game3 {
 	class Realm;
+	struct ChunkPosition;
 	struct ChunkRange;
 	struct WorldGenParams;
 
 	namespace WorldGen {
 		void generateOverworld(const std::shared_ptr<Realm> &, size_t noise_seed, const WorldGenParams &, const ChunkRange &, bool initial_generation);
+		/** Generates an arbitrary set of chunks, one pool job per chunk. */
+		void generateOverworld(const std::shared_ptr<Realm> &, size_t noise_seed, const WorldGenParams &, const std::vector<ChunkPosition> &, bool initial_generation);
 	}
 }
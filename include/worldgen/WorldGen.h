@@ -39,5 +39,7 @@ namespace Game3 {
 
 	namespace WorldGen {
 		extern ThreadPool pool;
+		/** Runs batches of chunk generation off the tick thread. Each batch fans its chunks out onto the main pool. */
+		extern ThreadPool batchPool;
 	}
 }
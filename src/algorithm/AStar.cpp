@@ -1,93 +1,156 @@
 #include "Log.h"
-#include "realm/Realm.h"
+#include "game/TileProvider.h"
+#include "game/TileView.h"
+#include "threading/ThreadContext.h"
 #include "algorithm/AStar.h"
 
 #include <algorithm>
-#include <queue>
+#include <array>
+#include <optional>
 #include <vector>
 
 namespace Game3 {
-	template<typename T, typename Priority>
-	struct PriorityQueue {
-		using Element = std::pair<Priority, T>;
-		std::priority_queue<Element, std::vector<Element>, std::greater<Element>> elements;
+	namespace {
+		/** Batched requests share one TileView only if it would cover at most this many chunks. */
+		constexpr size_t MAX_SHARED_CHUNKS = 1024;
+
+		/** The rectangle of tiles a search is confined to. Cells are indexed row-major from its top left. */
+		struct Window {
+			Index rowMin;
+			Index columnMin;
+			Index width;
+			Index height;
+
+			Window(const Position &start, const Position &goal):
+				rowMin(std::min(start.row, goal.row) - PATH_WINDOW_MARGIN),
+				columnMin(std::min(start.column, goal.column) - PATH_WINDOW_MARGIN),
+				width(std::abs(start.column - goal.column) + 2 * PATH_WINDOW_MARGIN + 1),
+				height(std::abs(start.row - goal.row) + 2 * PATH_WINDOW_MARGIN + 1) {}
+
+			inline size_t area() const {
+				return static_cast<size_t>(width) * static_cast<size_t>(height);
+			}
 
-		inline bool empty() const {
-			return elements.empty();
-		}
+			inline bool contains(const Position &position) const {
+				return rowMin <= position.row && position.row < rowMin + height && columnMin <= position.column && position.column < columnMin + width;
+			}
 
-		inline void put(T item, Priority priority) {
-			elements.emplace(priority, item);
-		}
+			inline uint32_t index(const Position &position) const {
+				return static_cast<uint32_t>((position.row - rowMin) * width + (position.column - columnMin));
+			}
 
-		T get() {
-			T best_item = elements.top().second;
-			elements.pop();
-			return best_item;
+			inline Position position(uint32_t index) const {
+				return {rowMin + index / width, columnMin + index % width};
+			}
+
+			ChunkRange getChunkRange() const {
+				return {ChunkPosition(Position(rowMin, columnMin)), ChunkPosition(Position(rowMin + height - 1, columnMin + width - 1))};
+			}
+		};
+
+		inline uint32_t heuristic(const Position &a, const Position &b) {
+			return static_cast<uint32_t>(a.taxiDistance(b));
 		}
-	};
 
-	namespace {
-		inline size_t heuristic(const Position &a, const Position &b) {
-			return std::abs(a.row - b.row) + std::abs(a.column - b.column);
+		inline bool isOpen(const TileView &view, const Position &position) {
+			auto state = view.copyPathState(position);
+			return state && *state != 0 && !view.hasFluid(position);
 		}
 
-		inline void getNeighbors(const std::shared_ptr<Realm> &realm, const Position &position, std::vector<Position> &next) {
-			next.clear();
+		bool search(const TileView &view, const Window &window, const Position &start, const Position &goal, std::vector<Position> &path, size_t loop_max) {
+			PathScratch &scratch = threadContext.pathScratch;
+			scratch.begin(window.area());
+
+			const uint32_t start_index = window.index(start);
+			const uint32_t goal_index = window.index(goal);
+			scratch.visit(start_index, 0, start_index);
+			scratch.push({heuristic(start, goal), start_index});
+
+			for (size_t loops = 0; loops < loop_max && !scratch.heap.empty(); ++loops) {
+				const auto [priority, current] = scratch.pop();
+				const uint32_t cost = scratch.costs[current];
+				const Position position = window.position(current);
+
+				// Skip entries that were superseded by a cheaper route.
+				if (cost + heuristic(position, goal) < priority)
+					continue;
+
+				if (current == goal_index) {
+					path.clear();
+					for (uint32_t index = goal_index; index != start_index; index = scratch.parents[index])
+						path.push_back(window.position(index));
+					path.push_back(start);
+					std::reverse(path.begin(), path.end());
+					return true;
+				}
+
+				const std::array<Position, 4> neighbors{{
+					{position.row - 1, position.column},
+					{position.row, position.column - 1},
+					{position.row + 1, position.column},
+					{position.row, position.column + 1},
+				}};
 
-			auto check = [&](const Position &pos) {
-				if (auto state = realm->tileProvider.copyPathState(pos); state && *state != 0 && !realm->hasFluid(pos))
-					next.emplace_back(pos);
-			};
+				for (const Position &next: neighbors) {
+					if (!window.contains(next))
+						continue;
 
-			check({position.row - 1, position.column});
-			check({position.row, position.column - 1});
-			check({position.row + 1, position.column});
-			check({position.row, position.column + 1});
-		}
-	}
+					const uint32_t next_index = window.index(next);
+					const uint32_t next_cost = cost + 1;
 
-	// Credit: https://www.redblobgames.com/pathfinding/a-star/implementation.html#cplusplus
-	bool simpleAStar(const std::shared_ptr<Realm> &realm, const Position &start, const Position &goal, std::vector<Position> &path, size_t loop_max) {
-		std::unordered_map<Position, Position> moves;
-		std::unordered_map<Position, size_t> costs;
-		PriorityQueue<Position, size_t> frontier;
-		frontier.put(start, 0);
-
-		moves[start] = start;
-		costs[start] = 0;
-
-		std::vector<Position> next_positions;
-		next_positions.reserve(4);
-
-		for (size_t loops = 0; loops < loop_max && !frontier.empty(); ++loops) {
-			Position current = frontier.get();
-			if (current == goal) {
-				path.clear();
-				path.push_back(goal);
-				auto iter = moves.find(goal);
-				while (iter != moves.end()) {
-					path.push_back(iter->second);
-					if (iter->second == start)
-						break;
-					iter = moves.find(iter->second);
+					if ((scratch.seen(next_index) && scratch.costs[next_index] <= next_cost) || !isOpen(view, next))
+						continue;
+
+					scratch.visit(next_index, next_cost, current);
+					scratch.push({next_cost + heuristic(next, goal), next_index});
 				}
-				std::reverse(path.begin(), path.end());
-				return true;
 			}
 
-			getNeighbors(realm, current, next_positions);
+			return false;
+		}
+	}
+
+	bool simpleAStar(const TileProvider &provider, const Position &start, const Position &goal, std::vector<Position> &path, size_t loop_max) {
+		const Window window(start, goal);
+		if (PATH_WINDOW_MAX_AREA < window.area())
+			return false;
+
+		TileView view(provider, window.getChunkRange(), TileView::PATHS | TileView::FLUIDS);
+		return search(view, window, start, goal, path, loop_max);
+	}
+
+	void simpleAStar(const TileProvider &provider, std::span<PathRequest> requests) {
+		std::optional<ChunkRange> shared_range;
+
+		for (const PathRequest &request: requests) {
+			const Window window(request.start, request.goal);
+			if (PATH_WINDOW_MAX_AREA < window.area())
+				continue;
+
+			const ChunkRange range = window.getChunkRange();
+			if (!shared_range) {
+				shared_range = range;
+			} else {
+				shared_range->topLeft.x = std::min(shared_range->topLeft.x, range.topLeft.x);
+				shared_range->topLeft.y = std::min(shared_range->topLeft.y, range.topLeft.y);
+				shared_range->bottomRight.x = std::max(shared_range->bottomRight.x, range.bottomRight.x);
+				shared_range->bottomRight.y = std::max(shared_range->bottomRight.y, range.bottomRight.y);
+			}
+		}
 
-			for (const Position &next: next_positions) {
-				const auto new_cost = costs[current] + 1;
-				if (!costs.contains(next) || new_cost < costs[next]) {
-					costs[next] = new_cost;
-					frontier.put(next, new_cost + heuristic(next, goal));
-					moves[next] = current;
+		if (shared_range) {
+			const size_t chunk_count = static_cast<size_t>(shared_range->bottomRight.x - shared_range->topLeft.x + 1) * static_cast<size_t>(shared_range->bottomRight.y - shared_range->topLeft.y + 1);
+			if (chunk_count <= MAX_SHARED_CHUNKS) {
+				TileView view(provider, *shared_range, TileView::PATHS | TileView::FLUIDS);
+				for (PathRequest &request: requests) {
+					const Window window(request.start, request.goal);
+					request.found = window.area() <= PATH_WINDOW_MAX_AREA && search(view, window, request.start, request.goal, request.path, request.loopMax);
 				}
+				return;
 			}
 		}
 
-		return false;
+		for (PathRequest &request: requests)
+			request.found = simpleAStar(provider, request.start, request.goal, request.path, request.loopMax);
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,491 @@
+#include "algorithm/PathGraph.h"
+#include "game/TileProvider.h"
+#include "game/TileView.h"
+
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
+#include <array>
+#include <queue>
+
+namespace Game3 {
+	namespace {
+		constexpr uint16_t UNREACHABLE = UINT16_MAX;
+
+		inline uint32_t heuristic(const Position &a, const Position &b) {
+			return static_cast<uint32_t>(a.taxiDistance(b));
+		}
+	}
+
+	PathGraph::PathGraph(const TileProvider &provider_):
+		provider(provider_) {}
+
+	bool PathGraph::findPath(const Position &start, const Position &goal, std::vector<Position> &path, size_t loop_max) {
+		const PathKey key{start, goal};
+		uint64_t search_generation{};
+
+		{
+			std::unique_lock lock(mutex);
+			search_generation = applyInvalidations();
+
+			if (findCachedPath(key, path)) {
+				++cacheHits;
+				return true;
+			}
+		}
+
+		++cacheMisses;
+
+		bool found = false;
+
+		if (start.taxiDistance(goal) <= LOCAL_DISTANCE)
+			found = simpleAStar(provider, start, goal, path, loop_max);
+
+		if (!found)
+			found = findAbstractPath(start, goal, path, loop_max);
+
+		if (found) {
+			std::unique_lock lock(mutex);
+			cachePath(key, path, search_generation);
+		}
+
+		return found;
+	}
+
+	void PathGraph::findPaths(std::span<PathRequest> requests) {
+		std::vector<bool> from_cache(requests.size(), false);
+		std::vector<PathRequest> local;
+		std::vector<size_t> local_indices;
+		uint64_t search_generation{};
+
+		{
+			std::unique_lock lock(mutex);
+			search_generation = applyInvalidations();
+
+			for (size_t i = 0; i < requests.size(); ++i) {
+				PathRequest &request = requests[i];
+
+				if (findCachedPath({request.start, request.goal}, request.path)) {
+					++cacheHits;
+					request.found = true;
+					from_cache[i] = true;
+					continue;
+				}
+
+				++cacheMisses;
+				request.found = false;
+
+				if (request.start.taxiDistance(request.goal) <= LOCAL_DISTANCE) {
+					local.push_back(PathRequest{request.start, request.goal, request.loopMax, {}, false});
+					local_indices.push_back(i);
+				}
+			}
+		}
+
+		simpleAStar(provider, local);
+
+		for (size_t i = 0; i < local.size(); ++i)
+			if (local[i].found)
+				requests[local_indices[i]] = std::move(local[i]);
+
+		for (size_t i = 0; i < requests.size(); ++i) {
+			if (from_cache[i])
+				continue;
+
+			PathRequest &request = requests[i];
+
+			if (!request.found)
+				request.found = findAbstractPath(request.start, request.goal, request.path, request.loopMax);
+		}
+
+		std::unique_lock lock(mutex);
+		for (size_t i = 0; i < requests.size(); ++i)
+			if (!from_cache[i] && requests[i].found)
+				cachePath({requests[i].start, requests[i].goal}, requests[i].path, search_generation);
+	}
+
+	void PathGraph::invalidate(Position position) {
+		const ChunkPosition chunk_position = position.getChunk();
+		const Index row = TileProvider::remainder(position.row);
+		const Index column = TileProvider::remainder(position.column);
+
+		std::unique_lock lock(pendingMutex);
+		pendingChanged.insert(chunk_position);
+		pendingStale.insert(chunk_position);
+
+		if (row == 0)
+			pendingStale.emplace(chunk_position.x, chunk_position.y - 1);
+		else if (row == CHUNK_SIZE - 1)
+			pendingStale.emplace(chunk_position.x, chunk_position.y + 1);
+
+		if (column == 0)
+			pendingStale.emplace(chunk_position.x - 1, chunk_position.y);
+		else if (column == CHUNK_SIZE - 1)
+			pendingStale.emplace(chunk_position.x + 1, chunk_position.y);
+	}
+
+	void PathGraph::invalidate(ChunkPosition chunk_position) {
+		std::unique_lock lock(pendingMutex);
+		pendingChanged.insert(chunk_position);
+		pendingStale.insert(chunk_position);
+		pendingStale.emplace(chunk_position.x, chunk_position.y - 1);
+		pendingStale.emplace(chunk_position.x, chunk_position.y + 1);
+		pendingStale.emplace(chunk_position.x - 1, chunk_position.y);
+		pendingStale.emplace(chunk_position.x + 1, chunk_position.y);
+	}
+
+	void PathGraph::clear() {
+		std::unique_lock lock(mutex);
+		{
+			std::unique_lock pending_lock(pendingMutex);
+			pendingChanged.clear();
+			pendingStale.clear();
+		}
+		clusters.clear();
+		changedAt.clear();
+		staleAt.clear();
+		// Clusters and paths found by searches still running were read before the clear.
+		clearedAt = ++generation;
+		cache.clear();
+	}
+
+	double PathGraph::getCacheHitRate() const {
+		const size_t hits = cacheHits;
+		const size_t total = hits + cacheMisses;
+		return total == 0? 0. : static_cast<double>(hits) / total;
+	}
+
+	size_t PathGraph::PathKeyHash::operator()(const PathKey &key) const {
+		size_t out = std::hash<Position>{}(key.start);
+		boost::hash_combine(out, std::hash<Position>{}(key.goal));
+		return out;
+	}
+
+	uint64_t PathGraph::applyInvalidations() {
+		std::unordered_set<ChunkPosition> changed;
+		std::unordered_set<ChunkPosition> stale;
+
+		{
+			std::unique_lock lock(pendingMutex);
+			changed.swap(pendingChanged);
+			stale.swap(pendingStale);
+		}
+
+		if (changed.empty() && stale.empty())
+			return generation;
+
+		++generation;
+
+		for (const ChunkPosition chunk_position: changed)
+			*changedAt.tryEmplace(chunk_position).first = generation;
+
+		for (const ChunkPosition chunk_position: stale) {
+			clusters.erase(chunk_position);
+			*staleAt.tryEmplace(chunk_position).first = generation;
+		}
+
+		return generation;
+	}
+
+	PathGraph::ClusterPtr PathGraph::getCluster(ChunkPosition chunk_position) {
+		uint64_t built_at{};
+
+		{
+			std::shared_lock lock(mutex);
+			if (const ClusterPtr *cluster = clusters.find(chunk_position))
+				return *cluster;
+			built_at = generation;
+		}
+
+		auto cluster = std::make_shared<Cluster>();
+		cluster->position = chunk_position;
+		buildCluster(*cluster);
+
+		std::unique_lock lock(mutex);
+
+		if (built_at < clearedAt)
+			return cluster;
+
+		if (const uint64_t *stamp = staleAt.find(chunk_position); stamp != nullptr && built_at < *stamp)
+			return cluster;
+
+		auto [stored, inserted] = clusters.tryEmplace(chunk_position);
+		// Another search may have built the same cluster in the meantime.
+		if (inserted)
+			*stored = std::move(cluster);
+		return *stored;
+	}
+
+	void PathGraph::buildCluster(Cluster &cluster) const {
+		const ChunkPosition chunk_position = cluster.position;
+		const Index row_min = chunk_position.y * CHUNK_SIZE;
+		const Index column_min = chunk_position.x * CHUNK_SIZE;
+
+		// The neighbors are included for the tiles just past each border.
+		TileView view(provider, ChunkRange({chunk_position.x - 1, chunk_position.y - 1}, {chunk_position.x + 1, chunk_position.y + 1}), TileView::PATHS | TileView::FLUIDS);
+
+		auto is_walkable = [&](Position position) {
+			auto state = view.copyPathState(position);
+			return state && *state != 0 && !view.hasFluid(position);
+		};
+
+		for (Index row = 0; row < CHUNK_SIZE; ++row)
+			for (Index column = 0; column < CHUNK_SIZE; ++column)
+				cluster.walkable[row * CHUNK_SIZE + column] = is_walkable({row_min + row, column_min + column});
+
+		struct Side {
+			Position first;
+			Position along;
+			Position out;
+		};
+
+		const std::array<Side, 4> sides{{
+			{{row_min, column_min}, {0, 1}, {-1, 0}},
+			{{row_min + CHUNK_SIZE - 1, column_min}, {0, 1}, {1, 0}},
+			{{row_min, column_min}, {1, 0}, {0, -1}},
+			{{row_min, column_min + CHUNK_SIZE - 1}, {1, 0}, {0, 1}},
+		}};
+
+		cluster.portals.clear();
+
+		for (const Side &side: sides) {
+			Index run_start = -1;
+			for (Index i = 0; i <= CHUNK_SIZE; ++i) {
+				bool open = false;
+				if (i < CHUNK_SIZE) {
+					const Position inside = side.first + side.along * i;
+					open = cluster.walkable[offset(cluster, inside)] && is_walkable(inside + side.out);
+				}
+
+				if (open) {
+					if (run_start == -1)
+						run_start = i;
+				} else if (run_start != -1) {
+					// Both chunks see the same run, so they agree on where its midpoint is.
+					const Position inside = side.first + side.along * ((run_start + i - 1) / 2);
+					cluster.portals.push_back(Portal{inside, inside + side.out, {}});
+					run_start = -1;
+				}
+			}
+		}
+
+		std::vector<uint16_t> distances;
+		for (Portal &portal: cluster.portals) {
+			flood(cluster, portal.position, distances);
+			for (size_t i = 0; i < cluster.portals.size(); ++i) {
+				const Position other = cluster.portals[i].position;
+				if (other == portal.position)
+					continue;
+				if (const uint16_t distance = distances[offset(cluster, other)]; distance != UNREACHABLE)
+					portal.links.emplace_back(i, distance);
+			}
+		}
+	}
+
+	bool PathGraph::findCachedPath(const PathKey &key, std::vector<Position> &path) {
+		auto iter = cache.find(key);
+		if (iter == cache.end())
+			return false;
+
+		const CachedPath &cached = iter->second;
+
+		for (const ChunkPosition chunk_position: cached.chunks) {
+			if (const uint64_t *stamp = changedAt.find(chunk_position); stamp != nullptr && cached.generation < *stamp) {
+				cache.erase(iter);
+				return false;
+			}
+		}
+
+		path = cached.positions;
+		return true;
+	}
+
+	void PathGraph::cachePath(const PathKey &key, const std::vector<Position> &path, uint64_t search_generation) {
+		if (search_generation < clearedAt)
+			return;
+
+		if (MAX_CACHED_PATHS <= cache.size())
+			cache.clear();
+
+		CachedPath cached{path, {}, search_generation};
+
+		for (const Position &position: path) {
+			const ChunkPosition chunk_position = position.getChunk();
+			if (cached.chunks.empty() || cached.chunks.back() != chunk_position)
+				cached.chunks.push_back(chunk_position);
+		}
+
+		std::sort(cached.chunks.begin(), cached.chunks.end());
+		cached.chunks.erase(std::unique(cached.chunks.begin(), cached.chunks.end()), cached.chunks.end());
+		cache.insert_or_assign(key, std::move(cached));
+	}
+
+	bool PathGraph::findAbstractPath(const Position &start, const Position &goal, std::vector<Position> &path, size_t loop_max) {
+		const ChunkPosition start_chunk = start.getChunk();
+		const ChunkPosition goal_chunk = goal.getChunk();
+		const ClusterPtr start_cluster = getCluster(start_chunk);
+		const ClusterPtr goal_cluster = getCluster(goal_chunk);
+
+		if (!goal_cluster->walkable[offset(*goal_cluster, goal)])
+			return false;
+
+		std::vector<uint16_t> start_distances;
+		std::vector<uint16_t> goal_distances;
+		flood(*start_cluster, start, start_distances);
+		flood(*goal_cluster, goal, goal_distances);
+
+		struct Node {
+			uint32_t cost;
+			Position parent;
+		};
+
+		using Entry = std::pair<uint32_t, Position>;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> frontier;
+		std::unordered_map<Position, Node> nodes;
+
+		auto visit = [&](const Position &next, const Position &from, uint32_t cost) {
+			auto [iter, inserted] = nodes.try_emplace(next, Node{cost, from});
+			if (!inserted) {
+				if (iter->second.cost <= cost)
+					return;
+				iter->second = {cost, from};
+			}
+			frontier.emplace(cost + heuristic(next, goal), next);
+		};
+
+		nodes.try_emplace(start, Node{0, start});
+		frontier.emplace(heuristic(start, goal), start);
+
+		for (size_t loops = 0; loops < loop_max && !frontier.empty(); ++loops) {
+			const auto [priority, current] = frontier.top();
+			frontier.pop();
+
+			const uint32_t cost = nodes.at(current).cost;
+
+			// Skip entries that were superseded by a cheaper route.
+			if (cost + heuristic(current, goal) < priority)
+				continue;
+
+			if (current == goal) {
+				std::vector<Position> route{goal};
+				for (Position position = goal; position != start;) {
+					position = nodes.at(position).parent;
+					route.push_back(position);
+				}
+				std::reverse(route.begin(), route.end());
+
+				// Refine each leg. Legs within a chunk get walked out; legs between chunks are a single step.
+				path.clear();
+				path.push_back(start);
+				std::vector<uint16_t> distances;
+				for (size_t i = 1; i < route.size(); ++i) {
+					const Position &from = route[i - 1];
+					const Position &to = route[i];
+					const ChunkPosition chunk_position = from.getChunk();
+					if (chunk_position != to.getChunk()) {
+						path.push_back(to);
+						continue;
+					}
+					const ClusterPtr cluster = getCluster(chunk_position);
+					flood(*cluster, from, distances);
+					if (!trace(*cluster, distances, to, path))
+						return false;
+				}
+
+				return true;
+			}
+
+			const ChunkPosition chunk_position = current.getChunk();
+			const ClusterPtr cluster_pointer = getCluster(chunk_position);
+			const Cluster &cluster = *cluster_pointer;
+
+			if (current == start) {
+				for (const Portal &portal: cluster.portals)
+					if (const uint16_t distance = start_distances[offset(cluster, portal.position)]; distance != UNREACHABLE && distance != 0)
+						visit(portal.position, start, cost + distance);
+			}
+
+			for (const Portal &portal: cluster.portals) {
+				if (portal.position != current)
+					continue;
+				visit(portal.across, current, cost + 1);
+				for (const auto [index, distance]: portal.links)
+					visit(cluster.portals[index].position, current, cost + distance);
+			}
+
+			if (chunk_position == goal_chunk) {
+				// The start tile might not be walkable, so the flood from the goal can't be trusted to reach it.
+				const uint16_t distance = current == start? start_distances[offset(cluster, goal)] : goal_distances[offset(cluster, current)];
+				if (distance != UNREACHABLE)
+					visit(goal, current, cost + distance);
+			}
+		}
+
+		return false;
+	}
+
+	void PathGraph::flood(const Cluster &cluster, Position origin, std::vector<uint16_t> &distances) {
+		distances.assign(CHUNK_SIZE * CHUNK_SIZE, UNREACHABLE);
+
+		std::vector<uint16_t> queue;
+		queue.reserve(CHUNK_SIZE * CHUNK_SIZE);
+
+		const size_t origin_offset = offset(cluster, origin);
+		distances[origin_offset] = 0;
+		queue.push_back(static_cast<uint16_t>(origin_offset));
+
+		for (size_t i = 0; i < queue.size(); ++i) {
+			const size_t current = queue[i];
+			const size_t row = current / CHUNK_SIZE;
+			const size_t column = current % CHUNK_SIZE;
+			const uint16_t next_distance = distances[current] + 1;
+
+			auto check = [&](size_t next) {
+				if (cluster.walkable[next] && distances[next] == UNREACHABLE) {
+					distances[next] = next_distance;
+					queue.push_back(static_cast<uint16_t>(next));
+				}
+			};
+
+			if (0 < row)
+				check(current - CHUNK_SIZE);
+			if (row + 1 < CHUNK_SIZE)
+				check(current + CHUNK_SIZE);
+			if (0 < column)
+				check(current - 1);
+			if (column + 1 < CHUNK_SIZE)
+				check(current + 1);
+		}
+	}
+
+	bool PathGraph::trace(const Cluster &cluster, const std::vector<uint16_t> &distances, Position to, std::vector<Position> &path) {
+		size_t current = offset(cluster, to);
+		if (distances[current] == UNREACHABLE)
+			return false;
+
+		const size_t old_size = path.size();
+
+		// Walk downhill from the destination back to the origin of the flood.
+		while (distances[current] != 0) {
+			path.emplace_back(cluster.position.y * CHUNK_SIZE + current / CHUNK_SIZE, cluster.position.x * CHUNK_SIZE + current % CHUNK_SIZE);
+			const size_t row = current / CHUNK_SIZE;
+			const size_t column = current % CHUNK_SIZE;
+			const uint16_t wanted = distances[current] - 1;
+			if (0 < row && distances[current - CHUNK_SIZE] == wanted)
+				current -= CHUNK_SIZE;
+			else if (row + 1 < CHUNK_SIZE && distances[current + CHUNK_SIZE] == wanted)
+				current += CHUNK_SIZE;
+			else if (0 < column && distances[current - 1] == wanted)
+				current -= 1;
+			else
+				current += 1;
+		}
+
+		std::reverse(path.begin() + old_size, path.end());
+		return true;
+	}
+
+	size_t PathGraph::offset(const Cluster &cluster, Position position) {
+		return static_cast<size_t>((position.row - cluster.position.y * CHUNK_SIZE) * CHUNK_SIZE + (position.column - cluster.position.x * CHUNK_SIZE));
+	}
+}
@@ -0,0 +1,72 @@
+#include "algorithm/PathScratch.h"
+
+#include <algorithm>
+
+namespace Game3 {
+	namespace {
+		constexpr size_t ARITY = 4;
+	}
+
+	void PathScratch::begin(size_t cells) {
+		if (stamps.size() < cells) {
+			stamps.resize(cells, 0);
+			costs.resize(cells);
+			parents.resize(cells);
+		}
+
+		// Stamps are zero until something is visited, so zero can never be a live generation.
+		if (++generation == 0) {
+			std::fill(stamps.begin(), stamps.end(), 0);
+			generation = 1;
+		}
+
+		heap.clear();
+	}
+
+	void PathScratch::push(HeapEntry entry) {
+		size_t index = heap.size();
+		heap.push_back(entry);
+
+		while (0 < index) {
+			const size_t parent = (index - 1) / ARITY;
+			if (heap[parent].priority <= entry.priority)
+				break;
+			heap[index] = heap[parent];
+			index = parent;
+		}
+
+		heap[index] = entry;
+	}
+
+	PathScratch::HeapEntry PathScratch::pop() {
+		const HeapEntry top = heap.front();
+		const HeapEntry last = heap.back();
+		heap.pop_back();
+
+		if (heap.empty())
+			return top;
+
+		const size_t size = heap.size();
+		size_t index = 0;
+
+		for (;;) {
+			const size_t first_child = index * ARITY + 1;
+			if (size <= first_child)
+				break;
+
+			size_t best = first_child;
+			for (size_t child = first_child + 1, end = std::min(first_child + ARITY, size); child < end; ++child)
+				if (heap[child].priority < heap[best].priority)
+					best = child;
+
+			if (last.priority <= heap[best].priority)
+				break;
+
+			heap[index] = heap[best];
+			index = best;
+		}
+
+		heap[index] = last;
+		return top;
+	}
+}
@@ -0,0 +1,287 @@
+#include "Log.h"
+#include "client/ChunkCache.h"
+#include "game/TileProvider.h"
+#include "util/Timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace Game3 {
+	ChunkCache::ChunkCache(const std::filesystem::path &path, std::string server_key, size_t capacity_):
+		serverKey(std::move(server_key)),
+		database(path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE),
+		capacity(capacity_) {
+			database.setBusyTimeout(10'000);
+			database.exec("PRAGMA journal_mode = WAL");
+			database.exec("PRAGMA synchronous = NORMAL");
+			database.exec("PRAGMA mmap_size = " + std::to_string(capacity + capacity / 4));
+
+			database.exec(R"(
+				CREATE TABLE IF NOT EXISTS cachedChunks (
+					server VARCHAR(255),
+					realmID INT,
+					x INT,
+					y INT,
+					updateCounter INT8,
+					digest INT8,
+					terrain BLOB,
+					biomes BLOB,
+					fluids BLOB,
+					size INT,
+					lastUsed INT8,
+					PRIMARY KEY (server, realmID, x, y)
+				);
+
+				CREATE INDEX IF NOT EXISTS cachedChunksLastUsed ON cachedChunks (lastUsed);
+			)");
+
+			SQLite::Statement query(database, "SELECT COALESCE(SUM(size), 0) FROM cachedChunks");
+			if (query.executeStep())
+				size = static_cast<size_t>(query.getColumn(0).getInt64());
+
+			thread = std::thread(&ChunkCache::run, this);
+		}
+
+	ChunkCache::~ChunkCache() {
+		{
+			std::unique_lock lock(jobMutex);
+			stopping = true;
+		}
+		jobReady.notify_all();
+		thread.join();
+	}
+
+	void ChunkCache::find(RealmID realm_id, std::set<ChunkPosition> chunk_positions, FindCallback callback) {
+		push(Find{realm_id, std::move(chunk_positions), std::move(callback)});
+	}
+
+	void ChunkCache::load(RealmID realm_id, ChunkPosition chunk_position, uint64_t digest, LoadCallback callback) {
+		push(Load{realm_id, chunk_position, digest, std::move(callback)});
+	}
+
+	void ChunkCache::store(RealmID realm_id, ChunkPosition chunk_position, uint64_t update_counter, std::string salt, ChunkSet chunk_set) {
+		push(Store{realm_id, chunk_position, update_counter, std::move(salt), std::move(chunk_set)});
+	}
+
+	std::optional<ChunkSet> ChunkCache::loadNow(RealmID realm_id, ChunkPosition chunk_position, uint64_t digest) {
+		Timer timer{"ChunkCacheLoad"};
+		std::unique_lock lock(databaseMutex);
+		SQLite::Statement query(database, "SELECT terrain, biomes, fluids FROM cachedChunks WHERE server = ? AND realmID = ? AND x = ? AND y = ? AND digest = ?");
+		query.bind(1, serverKey);
+		query.bind(2, realm_id);
+		query.bind(3, chunk_position.x);
+		query.bind(4, chunk_position.y);
+		query.bind(5, static_cast<int64_t>(digest));
+
+		if (!query.executeStep())
+			return std::nullopt;
+
+		auto span = [&](int column) {
+			const SQLite::Column blob = query.getColumn(column);
+			return std::span<const char>(static_cast<const char *>(blob.getBlob()), blob.getBytes());
+		};
+
+		std::optional<ChunkSet> out;
+
+		try {
+			out = codec.decode(span(0), span(1), span(2));
+		} catch (const std::exception &err) {
+			WARN("Discarding unreadable cached chunk {} in realm {}: {}", static_cast<std::string>(chunk_position), realm_id, err.what());
+			return std::nullopt;
+		}
+
+		SQLite::Statement touch(database, "UPDATE cachedChunks SET lastUsed = ? WHERE server = ? AND realmID = ? AND x = ? AND y = ?");
+		touch.bind(1, now());
+		touch.bind(2, serverKey);
+		touch.bind(3, realm_id);
+		touch.bind(4, chunk_position.x);
+		touch.bind(5, chunk_position.y);
+		touch.exec();
+
+		Timer::count("ChunkCacheHits", 1);
+		return out;
+	}
+
+	void ChunkCache::setCapacity(size_t new_capacity) {
+		std::unique_lock lock(databaseMutex);
+		capacity = new_capacity;
+		database.exec("PRAGMA mmap_size = " + std::to_string(capacity + capacity / 4));
+		evict();
+	}
+
+	size_t ChunkCache::getSize() const {
+		std::unique_lock lock(databaseMutex);
+		return size;
+	}
+
+	void ChunkCache::flush() {
+		std::unique_lock lock(jobMutex);
+		const size_t target = submitted;
+		jobDone.wait(lock, [&] { return target <= completed; });
+	}
+
+	void ChunkCache::push(Job job) {
+		{
+			std::unique_lock lock(jobMutex);
+			jobs.push_back(std::move(job));
+			++submitted;
+		}
+		jobReady.notify_one();
+	}
+
+	void ChunkCache::run() {
+		for (;;) {
+			std::optional<Job> job;
+
+			{
+				std::unique_lock lock(jobMutex);
+				jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+				if (jobs.empty())
+					return;
+				job.emplace(std::move(jobs.front()));
+				jobs.pop_front();
+			}
+
+			try {
+				std::visit([this](const auto &contents) { process(contents); }, *job);
+			} catch (const std::exception &err) {
+				// The chunk will be sent again in full next time, which is all a missing cache entry costs.
+				WARN("Chunk cache job failed: {}", err.what());
+			}
+
+			{
+				std::unique_lock lock(jobMutex);
+				++completed;
+			}
+			jobDone.notify_all();
+		}
+	}
+
+	void ChunkCache::process(const Find &job) {
+		std::map<ChunkPosition, uint64_t> digests;
+		std::set<ChunkPosition> missing;
+
+		try {
+			std::unique_lock lock(databaseMutex);
+			SQLite::Statement query(database, "SELECT digest FROM cachedChunks WHERE server = ? AND realmID = ? AND x = ? AND y = ?");
+			for (const ChunkPosition chunk_position: job.positions) {
+				query.bind(1, serverKey);
+				query.bind(2, job.realmID);
+				query.bind(3, chunk_position.x);
+				query.bind(4, chunk_position.y);
+				if (query.executeStep())
+					digests.emplace(chunk_position, static_cast<uint64_t>(query.getColumn(0).getInt64()));
+				else
+					missing.insert(chunk_position);
+				query.reset();
+			}
+		} catch (const std::exception &err) {
+			// The callback still has to hear about every chunk, or the caller would wait for them forever.
+			WARN("Couldn't look up cached chunks in realm {}: {}", job.realmID, err.what());
+			digests.clear();
+			missing = job.positions;
+		}
+
+		job.callback(std::move(digests), std::move(missing));
+	}
+
+	void ChunkCache::process(const Load &job) {
+		std::optional<ChunkSet> chunk_set;
+
+		try {
+			chunk_set = loadNow(job.realmID, job.position, job.digest);
+		} catch (const std::exception &err) {
+			WARN("Couldn't load cached chunk {} in realm {}: {}", static_cast<std::string>(job.position), job.realmID, err.what());
+		}
+
+		job.callback(std::move(chunk_set));
+	}
+
+	void ChunkCache::process(const Store &job) {
+		Timer timer{"ChunkCacheWrite"};
+		const uint64_t digest = TileProvider::computeDigest(job.chunkSet, job.salt);
+		const EncodedChunk encoded = codec.encode(job.chunkSet);
+		const size_t new_size = encoded.terrain.size() + encoded.biomes.size() + encoded.fluids.size();
+
+		std::unique_lock lock(databaseMutex);
+		SQLite::Transaction transaction(database);
+
+		SQLite::Statement old_size(database, "SELECT size FROM cachedChunks WHERE server = ? AND realmID = ? AND x = ? AND y = ?");
+		old_size.bind(1, serverKey);
+		old_size.bind(2, job.realmID);
+		old_size.bind(3, job.position.x);
+		old_size.bind(4, job.position.y);
+		const size_t replaced = old_size.executeStep()? static_cast<size_t>(old_size.getColumn(0).getInt64()) : 0;
+
+		SQLite::Statement insert(database, "INSERT OR REPLACE INTO cachedChunks VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+		insert.bind(1, serverKey);
+		insert.bind(2, job.realmID);
+		insert.bind(3, job.position.x);
+		insert.bind(4, job.position.y);
+		insert.bind(5, static_cast<int64_t>(job.updateCounter));
+		insert.bind(6, static_cast<int64_t>(digest));
+		insert.bind(7, encoded.terrain.data(), encoded.terrain.size());
+		insert.bind(8, encoded.biomes.data(), encoded.biomes.size());
+		insert.bind(9, encoded.fluids.data(), encoded.fluids.size());
+		insert.bind(10, static_cast<int64_t>(new_size));
+		insert.bind(11, now());
+		insert.exec();
+
+		transaction.commit();
+		size = size - replaced + new_size;
+		Timer::count("ChunkCacheBytes", new_size);
+
+		if (capacity < size)
+			evict();
+	}
+
+	void ChunkCache::evict() {
+		const size_t target = capacity * EVICTION_TARGET;
+		size_t evicted = 0;
+
+		SQLite::Statement query(database, "SELECT server, realmID, x, y, size FROM cachedChunks ORDER BY lastUsed ASC LIMIT 256");
+		SQLite::Statement remove(database, "DELETE FROM cachedChunks WHERE server = ? AND realmID = ? AND x = ? AND y = ?");
+
+		while (target < size) {
+			struct Victim {
+				std::string server;
+				int realmID;
+				int x;
+				int y;
+				size_t size;
+			};
+
+			// Rows are collected before deleting any of them because SQLite doesn't allow modifying a table mid-query.
+			std::vector<Victim> victims;
+			while (query.executeStep())
+				victims.push_back(Victim{query.getColumn(0).getString(), query.getColumn(1).getInt(), query.getColumn(2).getInt(), query.getColumn(3).getInt(), static_cast<size_t>(query.getColumn(4).getInt64())});
+			query.reset();
+
+			if (victims.empty())
+				break;
+
+			SQLite::Transaction transaction(database);
+			for (const Victim &victim: victims) {
+				if (size <= target)
+					break;
+				remove.bind(1, victim.server);
+				remove.bind(2, victim.realmID);
+				remove.bind(3, victim.x);
+				remove.bind(4, victim.y);
+				remove.exec();
+				remove.reset();
+				size -= std::min(size, victim.size);
+				++evicted;
+			}
+			transaction.commit();
+		}
+
+		if (evicted != 0)
+			INFO("Evicted {} chunks from the chunk cache ({} bytes left).", evicted, size);
+	}
+
+	int64_t ChunkCache::now() {
+		return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+}
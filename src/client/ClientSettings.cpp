@@ -1,4 +1,5 @@
 #include "Log.h"
+#include "client/ChunkCache.h"
 #include "client/ClientSettings.h"
 #include "game/ClientGame.h"
 #include "ui/gtk/JSONDialog.h"
@@ -10,6 +11,8 @@
 namespace Game3 {
 	void ClientSettings::apply(ClientGame &game) const {
 		game.canvas.sizeDivisor = sizeDivisor;
+		if (ChunkCache *cache = game.getChunkCache())
+			cache->setCapacity(static_cast<size_t>(chunkCacheSize) * 1024 * 1024);
 	}
 
 	void ClientSettings::apply() const {
@@ -28,6 +31,7 @@ namespace Game3 {
 			{"logLevel",          "slider", "Log Level",            {{"range", {0,     3}}, {"increments", {1,   1}}, {"initial",      logLevel}, {"digits", 0}}},
 			{"sizeDivisor",       "slider", "Size Divisor",         {{"range", {-.5,  4.}}, {"increments", {.1, .5}}, {"initial",   sizeDivisor}, {"digits", 1}}},
 			{"tickFrequency",     "slider", "Tick Frequency",       {{"range", {1,   240}}, {"increments", {1,   4}}, {"initial", tickFrequency}, {"digits", 0}}},
+			{"chunkCacheSize",    "slider", "Chunk Cache (MB)",     {{"range", {0,  4096}}, {"increments", {16, 256}}, {"initial", chunkCacheSize}, {"digits", 0}}},
 			{"ok", "ok", "OK"},
 		});
 
@@ -57,6 +61,8 @@ namespace Game3 {
 			settings.hideTimers = *iter;
 		if (auto iter = json.find("logLevel"); iter != json.end())
 			settings.logLevel = *iter;
+		if (auto iter = json.find("chunkCacheSize"); iter != json.end())
+			settings.chunkCacheSize = *iter;
 	}
 
 	void to_json(nlohmann::json &json, const ClientSettings &settings) {
@@ -70,5 +76,6 @@ namespace Game3 {
 		json["renderLighting"] = settings.renderLighting;
 		json["hideTimers"] = settings.hideTimers;
 		json["logLevel"] = settings.logLevel;
+		json["chunkCacheSize"] = settings.chunkCacheSize;
 	}
 }
@@ -125,7 +125,8 @@ namespace Game3 {
 			server->stop();
 		});
 
-		game = std::dynamic_pointer_cast<ServerGame>(Game::create(Side::Server, std::make_pair(server, size_t(8))));
+		// The built-in server ticks its realms serially.
+		game = std::dynamic_pointer_cast<ServerGame>(Game::create(Side::Server, std::make_pair(server, size_t(0))));
 
 		server->onStop = [this] {
 			running = false;
@@ -192,10 +193,10 @@ namespace Game3 {
 
 				if (running && (forceSave.exchange(false) || save_period <= std::chrono::system_clock::now() - last_save)) {
 					INFOX_(2, "Saving...");
-					game->tickingPaused = true;
-					game->getDatabase().writeAll();
-					game->tickingPaused = false;
-					INFOX_(2, "Saved.");
+					// The snapshot is captured between ticks and written in the background.
+					game->enqueue([](const TickArgs &args) {
+						args.game->toServer().getDatabase().snapshotAll();
+					});
 					last_save = std::chrono::system_clock::now();
 				}
 			}
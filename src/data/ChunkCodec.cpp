@@ -0,0 +1,293 @@
+#include "data/ChunkCodec.h"
+
+#include <array>
+#include <stdexcept>
+
+#include <zdict.h>
+#include <zstd.h>
+
+namespace Game3 {
+	namespace {
+		constexpr int COMPRESSION_LEVEL = 6;
+		constexpr size_t TILE_COUNT = CHUNK_SIZE * CHUNK_SIZE;
+		/** Decompressed parts bigger than this are assumed to be corrupt. */
+		constexpr size_t MAX_DECOMPRESSED_SIZE = TILE_COUNT * (LAYER_COUNT * sizeof(TileID) + sizeof(FluidInt)) * 2;
+
+		struct CCtxDeleter { void operator()(ZSTD_CCtx *context) const { ZSTD_freeCCtx(context); } };
+		struct DCtxDeleter { void operator()(ZSTD_DCtx *context) const { ZSTD_freeDCtx(context); } };
+
+		void putVarint(std::string &out, uint64_t value) {
+			while (0x80 <= value) {
+				out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<char>(value));
+		}
+
+		template <typename T>
+		void putLittle(std::string &out, T value) {
+			for (size_t i = 0; i < sizeof(T); ++i)
+				out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+		}
+
+		/** Reads from the front of an encoded part, throwing if it runs out. */
+		class Reader {
+			public:
+				Reader(const std::string &data_):
+					data(data_) {}
+
+				uint64_t takeVarint() {
+					uint64_t out = 0;
+					for (int shift = 0; shift < 64; shift += 7) {
+						const uint8_t byte = takeByte();
+						out |= static_cast<uint64_t>(byte & 0x7f) << shift;
+						if ((byte & 0x80) == 0)
+							return out;
+					}
+					throw std::runtime_error("Varint too long in encoded chunk");
+				}
+
+				template <typename T>
+				T takeLittle() {
+					uint64_t out = 0;
+					for (size_t i = 0; i < sizeof(T); ++i)
+						out |= static_cast<uint64_t>(takeByte()) << (8 * i);
+					return static_cast<T>(out);
+				}
+
+				bool done() const {
+					return position == data.size();
+				}
+
+			private:
+				const std::string &data;
+				size_t position = 0;
+
+				uint8_t takeByte() {
+					if (position == data.size())
+						throw std::runtime_error("Encoded chunk ended early");
+					return static_cast<uint8_t>(data[position++]);
+				}
+		};
+
+		template <typename T>
+		void putRuns(std::string &out, const Chunk<T> &chunk) {
+			auto lock = chunk.sharedLock();
+			if (chunk.size() != TILE_COUNT)
+				throw std::invalid_argument("Can't encode chunk of size " + std::to_string(chunk.size()));
+
+			for (size_t i = 0; i < TILE_COUNT;) {
+				const T value = chunk[i];
+				size_t end = i + 1;
+				while (end < TILE_COUNT && chunk[end] == value)
+					++end;
+				putVarint(out, end - i);
+				putLittle(out, value);
+				i = end;
+			}
+		}
+
+		template <typename T>
+		void takeRuns(Reader &reader, Chunk<T> &chunk) {
+			chunk.clear();
+			chunk.reserve(TILE_COUNT);
+			while (chunk.size() < TILE_COUNT) {
+				const uint64_t length = reader.takeVarint();
+				const T value = reader.takeLittle<T>();
+				if (length == 0 || TILE_COUNT - chunk.size() < length)
+					throw std::runtime_error("Invalid run length in encoded chunk");
+				chunk.insert(chunk.end(), length, value);
+			}
+		}
+	}
+
+	void ChunkCodec::CDictDeleter::operator()(ZSTD_CDict *dictionary) const {
+		ZSTD_freeCDict(dictionary);
+	}
+
+	void ChunkCodec::DDictDeleter::operator()(ZSTD_DDict *dictionary) const {
+		ZSTD_freeDDict(dictionary);
+	}
+
+	ChunkCodec::ChunkCodec() = default;
+
+	ChunkCodec::~ChunkCodec() = default;
+
+	void ChunkCodec::addDictionary(std::span<const uint8_t> dictionary) {
+		const uint32_t id = ZDICT_getDictID(dictionary.data(), dictionary.size());
+		if (id == 0)
+			throw std::invalid_argument("Not a zstd dictionary");
+
+		std::unique_lock lock(mutex);
+		compressionDictionary.reset(ZSTD_createCDict(dictionary.data(), dictionary.size(), COMPRESSION_LEVEL));
+		decompressionDictionaries[id].reset(ZSTD_createDDict(dictionary.data(), dictionary.size()));
+	}
+
+	bool ChunkCodec::hasDictionary() const {
+		std::shared_lock lock(mutex);
+		return compressionDictionary != nullptr;
+	}
+
+	EncodedChunk ChunkCodec::encode(const ChunkSet &chunk_set) const {
+		return {compress(encodeTerrain(chunk_set)), compress(encodeBiomes(chunk_set)), compress(encodeFluids(chunk_set))};
+	}
+
+	ChunkSet ChunkCodec::decode(std::span<const char> terrain, std::span<const char> biomes, std::span<const char> fluids) const {
+		ChunkSet out;
+
+		{
+			const std::string decompressed = decompress(terrain);
+			Reader reader(decompressed);
+			for (TileChunk &layer: out.terrain)
+				takeRuns(reader, layer);
+			if (!reader.done())
+				throw std::runtime_error("Trailing data after encoded terrain");
+		}
+
+		{
+			const std::string decompressed = decompress(biomes);
+			Reader reader(decompressed);
+			takeRuns(reader, out.biomes);
+			if (!reader.done())
+				throw std::runtime_error("Trailing data after encoded biomes");
+		}
+
+		{
+			const std::string decompressed = decompress(fluids);
+			Reader reader(decompressed);
+			out.fluids.assign(TILE_COUNT, FluidTile{});
+			const uint64_t count = reader.takeVarint();
+			size_t index = 0;
+			for (uint64_t i = 0; i < count; ++i) {
+				// Each index is stored as the distance from the previous one.
+				index += reader.takeVarint();
+				if (TILE_COUNT <= index)
+					throw std::runtime_error("Invalid fluid index in encoded chunk");
+				out.fluids[index] = FluidTile(reader.takeLittle<FluidInt>());
+			}
+			if (!reader.done())
+				throw std::runtime_error("Trailing data after encoded fluids");
+		}
+
+		out.pathmap.assign(TILE_COUNT, 0);
+		return out;
+	}
+
+	bool ChunkCodec::DictionaryTrainer::add(const ChunkSet &chunk_set) {
+		const std::array<std::string, 3> parts{encodeTerrain(chunk_set), encodeBiomes(chunk_set), encodeFluids(chunk_set)};
+
+		size_t size = 0;
+		for (const std::string &part: parts)
+			size += part.size();
+
+		if (MAX_SAMPLE_BYTES < samples.size() + size)
+			return false;
+
+		for (const std::string &part: parts) {
+			samples += part;
+			sampleSizes.push_back(part.size());
+		}
+
+		++chunkCount;
+		return true;
+	}
+
+	std::vector<uint8_t> ChunkCodec::DictionaryTrainer::train(size_t capacity) const {
+		if (sampleSizes.empty())
+			return {};
+
+		std::vector<uint8_t> dictionary(capacity);
+		const size_t size = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), samples.data(), sampleSizes.data(), static_cast<unsigned>(sampleSizes.size()));
+		if (ZDICT_isError(size))
+			return {};
+		dictionary.resize(size);
+		return dictionary;
+	}
+
+	std::string ChunkCodec::compress(const std::string &input) const {
+		thread_local std::unique_ptr<ZSTD_CCtx, CCtxDeleter> context(ZSTD_createCCtx());
+
+		std::string out(ZSTD_compressBound(input.size()), '\0');
+		size_t size{};
+
+		{
+			std::shared_lock lock(mutex);
+			if (compressionDictionary)
+				size = ZSTD_compress_usingCDict(context.get(), out.data(), out.size(), input.data(), input.size(), compressionDictionary.get());
+			else
+				size = ZSTD_compressCCtx(context.get(), out.data(), out.size(), input.data(), input.size(), COMPRESSION_LEVEL);
+		}
+
+		if (ZSTD_isError(size))
+			throw std::runtime_error("Couldn't compress chunk: " + std::string(ZSTD_getErrorName(size)));
+
+		out.resize(size);
+		return out;
+	}
+
+	std::string ChunkCodec::decompress(std::span<const char> input) const {
+		thread_local std::unique_ptr<ZSTD_DCtx, DCtxDeleter> context(ZSTD_createDCtx());
+
+		const unsigned long long content_size = ZSTD_getFrameContentSize(input.data(), input.size());
+		if (content_size == ZSTD_CONTENTSIZE_ERROR || content_size == ZSTD_CONTENTSIZE_UNKNOWN || MAX_DECOMPRESSED_SIZE < content_size)
+			throw std::runtime_error("Invalid compressed chunk");
+
+		std::string out(content_size, '\0');
+		size_t size{};
+
+		{
+			std::shared_lock lock(mutex);
+			const uint32_t id = ZSTD_getDictID_fromFrame(input.data(), input.size());
+			if (id == 0) {
+				size = ZSTD_decompressDCtx(context.get(), out.data(), out.size(), input.data(), input.size());
+			} else {
+				auto iter = decompressionDictionaries.find(id);
+				if (iter == decompressionDictionaries.end())
+					throw std::runtime_error("Missing dictionary " + std::to_string(id) + " for compressed chunk");
+				size = ZSTD_decompress_usingDDict(context.get(), out.data(), out.size(), input.data(), input.size(), iter->second.get());
+			}
+		}
+
+		if (ZSTD_isError(size) || size != content_size)
+			throw std::runtime_error("Couldn't decompress chunk");
+
+		return out;
+	}
+
+	std::string ChunkCodec::encodeTerrain(const ChunkSet &chunk_set) {
+		std::string out;
+		for (const TileChunk &layer: chunk_set.terrain)
+			putRuns(out, layer);
+		return out;
+	}
+
+	std::string ChunkCodec::encodeBiomes(const ChunkSet &chunk_set) {
+		std::string out;
+		putRuns(out, chunk_set.biomes);
+		return out;
+	}
+
+	std::string ChunkCodec::encodeFluids(const ChunkSet &chunk_set) {
+		std::string out;
+		size_t count = 0;
+		std::string entries;
+
+		{
+			auto lock = chunk_set.fluids.sharedLock();
+			size_t previous = 0;
+			for (size_t i = 0; i < chunk_set.fluids.size(); ++i) {
+				const FluidTile &tile = chunk_set.fluids[i];
+				if (tile == FluidTile{})
+					continue;
+				putVarint(entries, i - previous);
+				putLittle(entries, static_cast<FluidInt>(tile));
+				previous = i;
+				++count;
+			}
+		}
+
+		putVarint(out, count);
+		out += entries;
+		return out;
+	}
+}
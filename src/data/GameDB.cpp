@@ -1,6 +1,7 @@
 #include "data/GameDB.h"
 #include "entity/EntityFactory.h"
 #include "entity/Player.h"
+#include "entity/ServerPlayer.h"
 #include "error/FailedMigrationError.h"
 #include "game/ServerGame.h"
 #include "game/Village.h"
@@ -8,6 +9,7 @@
 #include "net/Buffer.h"
 #include "realm/Realm.h"
 #include "tileentity/TileEntity.h"
+#include "threading/ThreadPool.h"
 #include "tileentity/TileEntityFactory.h"
 #include "util/Endian.h"
 #include "util/Timer.h"
@@ -15,11 +17,31 @@
 
 #include <filesystem>
 #include <iomanip>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 
 #include <nlohmann/json.hpp>
+#include <zdict.h>
 
 namespace Game3 {
+	namespace {
+		/** How many chunks of one realm are decoded and absorbed together while loading. */
+		constexpr size_t CHUNK_LOAD_BATCH_SIZE = 64;
+
+		/** A row of the chunks table, copied out of the query so it can be decoded on another thread. */
+		struct StoredChunk {
+			RealmPtr realm;
+			ChunkPosition position;
+			ChunkFormat format{};
+			std::string terrain;
+			std::string biomes;
+			std::string fluids;
+			std::string pathmap;
+		};
+	}
+
 	GameDB::GameDB(const ServerGamePtr &game):
 		weakGame(game) {}
 
@@ -44,9 +66,15 @@ namespace Game3 {
 				biomes  VARBINARY(65535),
 				fluids  VARBINARY(65535),
 				pathmap VARBINARY(65535),
+				format INT NOT NULL DEFAULT 0,
 				PRIMARY KEY (realmID, x, y)
 			);
 
+			CREATE TABLE IF NOT EXISTS chunkDictionaries (
+				id INT8 PRIMARY KEY,
+				data BLOB
+			);
+
 			CREATE TABLE IF NOT EXISTS rules (
 				key VARCHAR(64) PRIMARY KEY,
 				value INT8
@@ -60,9 +88,34 @@ namespace Game3 {
 				releaseRealm INT
 			);
 		)" + Realm::getSQL() + TileEntity::getSQL() + Entity::getSQL() + Tileset::getSQL() + Village::getSQL());
+
+		// Worlds from before chunks were compressed don't have a format column. Their chunks are all raw.
+		bool has_format = false;
+		{
+			SQLite::Statement query{*database, "SELECT name FROM pragma_table_info('chunks')"};
+			while (query.executeStep())
+				has_format = has_format || query.getColumn(0).getString() == "format";
+		}
+		if (!has_format)
+			database->exec("ALTER TABLE chunks ADD COLUMN format INT NOT NULL DEFAULT 0");
+
+		// Dictionaries are added in the order they were trained in, so the newest ends up being used for compression.
+		{
+			SQLite::Statement query{*database, "SELECT data FROM chunkDictionaries ORDER BY rowid"};
+			while (query.executeStep()) {
+				SQLite::Column column = query.getColumn(0);
+				chunkCodec.addDictionary(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(column.getBlob()), column.getBytes()));
+			}
+		}
+
+		// WAL lets the snapshot writer's connection write while this one keeps reading.
+		database->exec("PRAGMA journal_mode = WAL");
+		database->setBusyTimeout(10'000);
+		snapshotWriter = std::make_unique<SnapshotWriter>(path, chunkCodec);
 	}
 
 	void GameDB::close() {
+		snapshotWriter.reset();
 		database.reset();
 	}
 
@@ -81,6 +134,8 @@ namespace Game3 {
 
 	void GameDB::writeRules() {
 		ServerGamePtr game = getGame();
+		// Snapshots carry rules, users and villages too, so a queued one would overwrite what's written here.
+		flushSnapshots();
 		auto rules_lock = game->gameRules.sharedLock();
 		if (game->gameRules.empty())
 			return;
@@ -107,37 +162,66 @@ namespace Game3 {
 		}
 	}
 
-	void GameDB::writeAllRealms() {
+	void GameDB::writeAllRealms(bool full) {
 		Timer timer{"WriteAllRealms"};
 		ServerGamePtr game = getGame();
-		game->iterateRealms([this](const RealmPtr &realm) {
-			writeRealm(realm);
+		const auto start = std::chrono::steady_clock::now();
+
+		// An older snapshot landing after this would overwrite newer data.
+		flushSnapshots();
+
+		{
+			auto lock = database.uniqueLock();
+			saveStats = {};
+		}
+
+		game->iterateRealms([this, full](const RealmPtr &realm) {
+			writeRealm(realm, full);
 		});
+
+		auto lock = database.uniqueLock();
+		saveStats.duration = std::chrono::steady_clock::now() - start;
+		Timer::count("SavedChunks", saveStats.chunks);
+		Timer::count("SavedBytes", saveStats.bytes);
+
+		auto stats_lock = lastSaveStats.uniqueLock();
+		lastSaveStats.getBase() = saveStats;
 	}
 
-	void GameDB::writeRealm(const RealmPtr &realm) {
+	void GameDB::writeRealm(const RealmPtr &realm, bool full) {
 		ServerGamePtr game = getGame();
 		auto lock = database.uniqueLock();
 		SQLite::Transaction transaction{*database};
 
+		const UnsavedRealm unsaved = collectUnsaved(realm, full);
+
 		{
 			Timer timer{"WriteRealmMeta"};
 			writeRealmMeta(realm, false);
 		}
-		{
-			std::shared_lock lock(realm->tileProvider.chunkMutexes[0]);
-			for (const auto &[chunk_position, chunk]: realm->tileProvider.chunkMaps[0]) {
-				Timer timer{"WriteChunk"};
-				writeChunk(realm, chunk_position, false);
-			}
+		for (const auto &[chunk_position, update_counter]: unsaved.chunks) {
+			Timer timer{"WriteChunk"};
+			writeChunk(realm, chunk_position, false);
 		}
 		{
 			Timer timer{"WriteTileEntities"};
-			writeTileEntities(realm, false);
+			auto iter = unsaved.tileEntities.begin();
+			writeTileEntities([&](TileEntityPtr &out) {
+				if (iter == unsaved.tileEntities.end())
+					return false;
+				out = iter++->first;
+				return true;
+			}, false);
 		}
 		{
 			Timer timer{"WriteEntities"};
-			writeEntities(realm, false);
+			auto iter = unsaved.entities.begin();
+			writeEntities([&](EntityPtr &out) {
+				if (iter == unsaved.entities.end())
+					return false;
+				out = iter++->first;
+				return true;
+			}, false);
 		}
 		{
 			Timer timer{"WriteTilesetMeta"};
@@ -150,14 +234,155 @@ namespace Game3 {
 			game->saveVillages(*database, false);
 		}
 
-		Timer timer{"WriteRealmCommit"};
-		transaction.commit();
+		{
+			Timer timer{"WriteRealmCommit"};
+			transaction.commit();
+		}
+
+		// Only advance the watermarks once the data is actually in the database.
+		markSaved(unsaved);
+	}
+
+	void GameDB::snapshotAll() {
+		assert(database);
+		assert(snapshotWriter);
+		ServerGamePtr game = getGame();
+		Timer timer{"SnapshotCapture"};
+		const auto start = std::chrono::steady_clock::now();
+
+		WorldSnapshot snapshot;
+
+		{
+			auto rules_lock = game->gameRules.sharedLock();
+			for (const auto &[key, value]: game->gameRules)
+				snapshot.rules.push_back({key, int64_t(value)});
+		}
+		{
+			auto player_lock = game->players.sharedLock();
+			for (const ServerPlayerPtr &player: game->players)
+				snapshot.users.push_back({player->getUsername(), player->displayName, nlohmann::json(*player).dump()});
+		}
+		game->snapshotVillages(snapshot);
+
+		std::vector<UnsavedRealm> unsaved_realms;
+		std::unordered_set<std::string> tileset_hashes;
+
+		game->iterateRealms([&](const RealmPtr &realm) {
+			UnsavedRealm &unsaved = unsaved_realms.emplace_back(collectUnsaved(realm, false));
+			TileProvider &provider = realm->tileProvider;
+
+			nlohmann::json json;
+			realm->toJSON(json, false);
+			const Tileset &tileset = realm->getTileset();
+			snapshot.realms.push_back({realm->id, json.dump(), tileset.getHash()});
+
+			if (tileset_hashes.insert(tileset.getHash()).second && !hasTileset(tileset.getHash())) {
+				nlohmann::json meta;
+				tileset.getMeta(meta);
+				snapshot.tilesets.push_back({tileset.getHash(), meta.dump()});
+			}
+
+			for (const auto &[chunk_position, update_counter]: unsaved.chunks)
+				snapshot.chunks.push_back({realm->id, chunk_position, provider.getChunkSet(chunk_position)});
+
+			for (const auto &[tile_entity, update_counter]: unsaved.tileEntities) {
+				Buffer buffer;
+				tile_entity->encode(*game, buffer);
+				snapshot.tileEntities.push_back({tile_entity->getGID(), tile_entity->realmID, tile_entity->getPosition(), tile_entity->tileID.str(), tile_entity->tileEntityID.str(), std::move(buffer.bytes)});
+			}
+
+			for (const auto &[entity, update_counter]: unsaved.entities) {
+				if (!entity->shouldPersist() || entity->isPlayer())
+					continue;
+				Buffer buffer;
+				entity->encode(buffer);
+				snapshot.entities.push_back({entity->getGID(), entity->realmID, entity->getPosition(), entity->type.str(), int(entity->direction.load()), std::move(buffer.bytes)});
+			}
+		});
+
+		snapshot.captureDuration = std::chrono::steady_clock::now() - start;
+		snapshot.onCommit = [this, unsaved_realms = std::move(unsaved_realms)](const SaveStats &stats) {
+			for (const UnsavedRealm &unsaved: unsaved_realms)
+				markSaved(unsaved);
+			auto lock = lastSaveStats.uniqueLock();
+			lastSaveStats.getBase() = stats;
+		};
+
+		snapshotWriter->submit(std::move(snapshot));
+	}
+
+	void GameDB::saveChunks(const RealmPtr &realm, std::span<const ChunkPosition> chunk_positions) {
+		assert(snapshotWriter);
+		const auto start = std::chrono::steady_clock::now();
+		TileProvider &provider = realm->tileProvider;
+		UnsavedRealm unsaved{realm, {}, {}, {}};
+		WorldSnapshot snapshot;
+
+		for (const ChunkPosition chunk_position: chunk_positions) {
+			// As in collectUnsaved, the counter is read before the chunk is copied.
+			unsaved.chunks.emplace_back(chunk_position, provider.getUpdateCounter(chunk_position));
+			snapshot.chunks.push_back({realm->id, chunk_position, provider.getChunkSet(chunk_position)});
+		}
+
+		snapshot.captureDuration = std::chrono::steady_clock::now() - start;
+		snapshot.onCommit = [unsaved = std::move(unsaved)](const SaveStats &) {
+			markSaved(unsaved);
+		};
+
+		snapshotWriter->submit(std::move(snapshot));
+	}
+
+	void GameDB::flushSnapshots() {
+		if (snapshotWriter)
+			snapshotWriter->flush();
+	}
+
+	SaveStats GameDB::getLastSaveStats() {
+		auto lock = lastSaveStats.sharedLock();
+		return lastSaveStats;
+	}
+
+	GameDB::UnsavedRealm GameDB::collectUnsaved(const RealmPtr &realm, bool full) {
+		// Update counters are captured before anything is encoded so that changes made during the save stay unsaved.
+		UnsavedRealm unsaved{realm, realm->tileProvider.getUnsavedChunks(full), {}, {}};
+
+		{
+			auto lock = realm->tileEntities.sharedLock();
+			for (const auto &[position, tile_entity]: realm->tileEntities)
+				if (full || tile_entity->isUnsaved())
+					unsaved.tileEntities.emplace_back(tile_entity, tile_entity->getUpdateCounter());
+		}
+
+		{
+			auto lock = realm->entities.sharedLock();
+			for (const EntityPtr &entity: realm->entities)
+				if (full || entity->isUnsaved())
+					unsaved.entities.emplace_back(entity, entity->getUpdateCounter());
+		}
+
+		return unsaved;
+	}
+
+	void GameDB::markSaved(const UnsavedRealm &unsaved) {
+		TileProvider &provider = unsaved.realm->tileProvider;
+
+		for (const auto &[chunk_position, update_counter]: unsaved.chunks)
+			provider.markSaved(chunk_position, update_counter);
+
+		for (const auto &[tile_entity, update_counter]: unsaved.tileEntities)
+			tile_entity->markSaved(update_counter);
+
+		for (const auto &[entity, update_counter]: unsaved.entities)
+			entity->markSaved(update_counter);
 	}
 
 	void GameDB::deleteRealm(RealmPtr realm) {
 		assert(database);
 		auto db_lock = database.uniqueLock();
 
+		// A pending snapshot could bring the realm's chunks back after they're deleted.
+		flushSnapshots();
+
 		{
 			auto lock = realm->tileEntities.sharedLock();
 			for (const auto &[position, tile_entity]: realm->tileEntities)
@@ -192,58 +417,33 @@ namespace Game3 {
 		if (use_transaction)
 			transaction.emplace(*database);
 
-		SQLite::Statement statement{*database, "INSERT OR REPLACE INTO chunks VALUES (?, ?, ?, ?, ?, ?, ?)"};
+		SQLite::Statement statement{*database, "INSERT OR REPLACE INTO chunks VALUES (?, ?, ?, ?, ?, ?, ?, ?)"};
 
-		std::string raw_terrain;
-		std::string raw_biomes;
-		std::string raw_fluids;
-		std::string raw_pathmap;
+		EncodedChunk encoded;
 
 		{
-			Timer timer{"GetRawTerrain"};
-			raw_terrain = provider.getRawTerrain(chunk_position);
-		}
-
-		{
-			Timer timer{"GetRawBiomes"};
-			raw_biomes = provider.getRawBiomes(chunk_position);
-		}
-
-		{
-			Timer timer{"GetRawFluids"};
-			raw_fluids = provider.getRawFluids(chunk_position);
-		}
-
-		{
-			Timer timer{"GetRawPathmap"};
-			raw_pathmap = provider.getRawPathmap(chunk_position);
+			Timer timer{"EncodeChunk"};
+			encoded = chunkCodec.encode(provider.getChunkSet(chunk_position));
 		}
 
 		statement.bind(1, realm->id);
 		statement.bind(2, chunk_position.x);
 		statement.bind(3, chunk_position.y);
-		{
-			Timer timer{"BindTerrain"};
-			statement.bind(4, raw_terrain);
-		}
-		{
-			Timer timer{"BindBiomes"};
-			statement.bind(5, raw_biomes);
-		}
-		{
-			Timer timer{"BindFluids"};
-			statement.bind(6, raw_fluids);
-		}
-		{
-			Timer timer{"BindPathmap"};
-			statement.bind(7, raw_pathmap);
-		}
+		statement.bind(4, encoded.terrain.data(), encoded.terrain.size());
+		statement.bind(5, encoded.biomes.data(), encoded.biomes.size());
+		statement.bind(6, encoded.fluids.data(), encoded.fluids.size());
+		// The pathmap is remade on load.
+		statement.bind(7);
+		statement.bind(8, static_cast<int>(ChunkFormat::Compressed));
 
 		{
 			Timer timer{"ExecStatement"};
 			statement.exec();
 		}
 
+		++saveStats.chunks;
+		saveStats.bytes += encoded.terrain.size() + encoded.biomes.size() + encoded.fluids.size();
+
 		if (transaction) {
 			Timer timer{"CommitTransaction"};
 			transaction->commit();
@@ -255,42 +455,82 @@ namespace Game3 {
 		ServerGamePtr game = getGame();
 		auto db_lock = database.uniqueLock();
 
-		SQLite::Statement chunk_query{*database, "SELECT * FROM chunks"};
-		Timer chunk_query_timer{"ExecuteChunkStep"};
+		// This thread streams rows out of the database and hands them to the pool in batches, one realm per batch. The
+		// workers decode the batches and absorb each one into its realm's tile provider in one go.
+		ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+		pool.start();
 
-		while (chunk_query.executeStep()) {
-			chunk_query_timer.stop();
-			{
-				Timer iteration_timer{"ChunkLoad"};
-				RealmID realm_id = chunk_query.getColumn(0);
-				ChunkPosition::IntType x = chunk_query.getColumn(1);
-				ChunkPosition::IntType y = chunk_query.getColumn(2);
-				const void *terrain = chunk_query.getColumn(3);
-				const void *biomes  = chunk_query.getColumn(4);
-				const void *fluids  = chunk_query.getColumn(5);
-				const void *pathmap = chunk_query.getColumn(6);
-				Timer chunk_set_timer{"ChunkSet"};
-				ChunkSet chunk_set{
-					std::span<const char>(reinterpret_cast<const char *>(terrain), chunk_query.getColumn(3).getBytes()),
-					std::span<const char>(reinterpret_cast<const char *>(biomes),  chunk_query.getColumn(4).getBytes()),
-					std::span<const char>(reinterpret_cast<const char *>(fluids),  chunk_query.getColumn(5).getBytes()),
-					std::span<const char>(reinterpret_cast<const char *>(pathmap), chunk_query.getColumn(6).getBytes())
-				};
-				chunk_set_timer.stop();
-				RealmPtr realm;
-				{
-					Timer get_realm_timer{"GetRealm"};
-					realm = game->getRealm(realm_id, [&] { return loadRealm(realm_id, false); });
+		// Chunks stored without a pathmap get theirs remade once tile migration is done.
+		std::mutex pathless_mutex;
+		std::vector<std::pair<RealmPtr, ChunkPosition>> pathless_chunks;
+
+		{
+			Timer load_timer{"LoadChunks"};
+			ThreadPool::TaskGroup group(pool);
+			std::unordered_map<RealmID, std::shared_ptr<std::vector<StoredChunk>>> batches;
+
+			auto submit = [&](const std::shared_ptr<std::vector<StoredChunk>> &batch) {
+				group.add([this, batch, &pathless_mutex, &pathless_chunks] {
+					std::vector<std::pair<ChunkPosition, ChunkSet>> decoded;
+					std::vector<ChunkPosition> pathless;
+					decoded.reserve(batch->size());
+
+					for (const StoredChunk &stored: *batch) {
+						decoded.emplace_back(stored.position, decodeChunk(stored.format, stored.terrain, stored.biomes, stored.fluids, stored.pathmap));
+						if (stored.format != ChunkFormat::Raw)
+							pathless.push_back(stored.position);
+					}
+
+					const RealmPtr &realm = batch->front().realm;
+					TileProvider &provider = realm->tileProvider;
+					provider.absorb(std::move(decoded));
+
+					for (const StoredChunk &stored: *batch)
+						provider.markSaved(stored.position, provider.getUpdateCounter(stored.position));
+
+					if (!pathless.empty()) {
+						std::unique_lock lock(pathless_mutex);
+						for (const ChunkPosition chunk_position: pathless)
+							pathless_chunks.emplace_back(realm, chunk_position);
+					}
+
+					Timer::count("LoadedChunks", batch->size());
+				});
+			};
+
+			SQLite::Statement chunk_query{*database, "SELECT realmID, x, y, terrain, biomes, fluids, pathmap, format FROM chunks"};
+
+			while (chunk_query.executeStep()) {
+				const RealmID realm_id = chunk_query.getColumn(0);
+				auto &batch = batches[realm_id];
+
+				if (!batch) {
+					batch = std::make_shared<std::vector<StoredChunk>>();
+					batch->reserve(CHUNK_LOAD_BATCH_SIZE);
 				}
-				{
-					Timer absorb_timer{"Absorb"};
-					realm->tileProvider.absorb(ChunkPosition(x, y), std::move(chunk_set));
+
+				StoredChunk &stored = batch->emplace_back();
+				// Realms are loaded on this thread because loading them needs the database.
+				stored.realm = batch->size() == 1? game->getRealm(realm_id, [&] { return loadRealm(realm_id, false); }) : batch->front().realm;
+				stored.position = {chunk_query.getColumn(1).getInt(), chunk_query.getColumn(2).getInt()};
+				stored.terrain = chunk_query.getColumn(3).getString();
+				stored.biomes = chunk_query.getColumn(4).getString();
+				stored.fluids = chunk_query.getColumn(5).getString();
+				stored.pathmap = chunk_query.getColumn(6).getString();
+				stored.format = static_cast<ChunkFormat>(chunk_query.getColumn(7).getInt());
+
+				if (batch->size() == CHUNK_LOAD_BATCH_SIZE) {
+					submit(batch);
+					batch.reset();
 				}
 			}
-			chunk_query_timer.restart();
-		}
 
-		chunk_query_timer.stop();
+			for (const auto &[realm_id, batch]: batches)
+				if (batch)
+					submit(batch);
+
+			group.wait();
+		}
 
 		// If a realm has no chunks, it won't get loaded above, so we have to go through all realms
 		// and load the ones that haven't been loaded yet.
@@ -357,9 +597,13 @@ namespace Game3 {
 
 			for (const Layer layer: allLayers) {
 				std::unique_lock chunk_map_lock{provider.chunkMutexes.at(getIndex(layer))};
-				TileProvider::ChunkMap &chunk_map = provider.chunkMaps.at(getIndex(layer));
-				for (auto &[chunk_position, chunk]: chunk_map) {
+				provider.forEachChunk([&](ChunkPosition, ChunkRecord &record) {
+					if (!record.has(ChunkRecord::layerBit(layer)))
+						return;
+
+					TileChunk &chunk = record.layers[getIndex(layer)];
 					std::unique_lock chunk_lock = chunk.uniqueLock();
+					bool changed = false;
 					for (TileID &tile_id: chunk) {
 						const TileID old_tile = tile_id;
 						if (auto iter = migration_map.find(tile_id); iter != migration_map.end()) {
@@ -371,23 +615,37 @@ namespace Game3 {
 								new_tile += old_tile % 16;
 
 							tile_id = new_tile;
+							changed = changed || new_tile != old_tile;
 							if (new_tile != old_tile && covered.insert(old_tile).second)
 								INFO("{} ({}) → {} ({})", old_map.at(old_tile), old_tile, tileset.getNames().at(new_tile), new_tile);
 						} else if (force_migrate) {
 							if (warned.insert(old_tile).second)
 								WARN("Replacing tile {} ({}) with nothing.", old_map.at(old_tile), old_tile);
 							tile_id = 0;
+							changed = true;
 						} else {
 							Identifier tilename = old_map.at(old_tile);
 							ERROR("Canceling tile migration; tile {} ({}) is missing from the new tileset. Create .force-migrate to force migration.", tilename, old_tile);
 							throw FailedMigrationError("Migration failed due to missing tile " + tilename.str() + " (" + std::to_string(old_tile) + ')');
 						}
 					}
-				}
+
+					// Migrated chunks have to be written back even though nothing else touched them.
+					if (changed)
+						++record.updateCount;
+				});
 			}
 
 			SUCCESS("Finished tile migration for realm {}", realm->getID());
 		});
+
+		{
+			Timer pathmap_timer{"RemakeLoadedPathMaps"};
+			pool.parallelFor(0, pathless_chunks.size(), [&](size_t index) {
+				const auto &[realm, chunk_position] = pathless_chunks[index];
+				realm->remakePathMap(chunk_position);
+			}, CHUNK_LOAD_BATCH_SIZE);
+		}
 	}
 
 	RealmPtr GameDB::loadRealm(RealmID realm_id, bool do_lock) {
@@ -437,6 +695,7 @@ namespace Game3 {
 				realm->addToMaps(tile_entity);
 				realm->attach(tile_entity);
 				tile_entity->onSpawn();
+				tile_entity->markSaved(tile_entity->getUpdateCounter());
 			}
 		}
 
@@ -473,6 +732,7 @@ namespace Game3 {
 				}
 
 				realm->attach(entity);
+				entity->markSaved(entity->getUpdateCounter());
 			}
 		}
 
@@ -508,28 +768,65 @@ namespace Game3 {
 
 		auto db_lock = database.uniqueLock();
 
-		SQLite::Statement query{*database, "SELECT terrain, biomes, fluids, pathmap FROM chunks WHERE realmID = ? AND x = ? AND y = ? LIMIT 1"};
+		SQLite::Statement query{*database, "SELECT terrain, biomes, fluids, pathmap, format FROM chunks WHERE realmID = ? AND x = ? AND y = ? LIMIT 1"};
 
 		query.bind(1, realm_id);
 		query.bind(2, chunk_position.x);
 		query.bind(3, chunk_position.y);
 
-		if (query.executeStep()) {
-			const void *terrain = query.getColumn(0);
-			const void *biomes  = query.getColumn(1);
-			const void *fluids  = query.getColumn(2);
-			const void *pathmap = query.getColumn(3);
-			return ChunkSet{
-				std::span<const char>(reinterpret_cast<const char *>(terrain), query.getColumn(0).getBytes()),
-				std::span<const char>(reinterpret_cast<const char *>(biomes),  query.getColumn(1).getBytes()),
-				std::span<const char>(reinterpret_cast<const char *>(fluids),  query.getColumn(2).getBytes()),
-				std::span<const char>(reinterpret_cast<const char *>(pathmap), query.getColumn(3).getBytes())
-			};
-		}
+		if (query.executeStep())
+			return decodeChunk(query, 0);
 
 		return std::nullopt;
 	}
 
+	ChunkSet GameDB::decodeChunk(SQLite::Statement &query, int first_column) const {
+		auto get_span = [&](int offset) {
+			SQLite::Column column = query.getColumn(first_column + offset);
+			return std::span<const char>(reinterpret_cast<const char *>(column.getBlob()), column.getBytes());
+		};
+
+		const auto format = static_cast<ChunkFormat>(query.getColumn(first_column + 4).getInt());
+		return decodeChunk(format, get_span(0), get_span(1), get_span(2), get_span(3));
+	}
+
+	ChunkSet GameDB::decodeChunk(ChunkFormat format, std::span<const char> terrain, std::span<const char> biomes, std::span<const char> fluids, std::span<const char> pathmap) const {
+		if (format == ChunkFormat::Raw)
+			return ChunkSet{terrain, biomes, fluids, pathmap};
+
+		if (format == ChunkFormat::Compressed)
+			return chunkCodec.decode(terrain, biomes, fluids);
+
+		throw std::runtime_error("Unknown chunk format: " + std::to_string(static_cast<int>(format)));
+	}
+
+	size_t GameDB::trainChunkDictionary(size_t max_samples) {
+		assert(database);
+		ServerGamePtr game = getGame();
+		ChunkCodec::DictionaryTrainer trainer;
+		bool full = false;
+
+		game->iterateRealms([&](const RealmPtr &realm) {
+			for (const ChunkPosition chunk_position: realm->tileProvider.getChunkPositions()) {
+				if (full || max_samples <= trainer.getChunkCount())
+					return;
+				full = !trainer.add(realm->tileProvider.getChunkSet(chunk_position));
+			}
+		});
+
+		const std::vector<uint8_t> dictionary = trainer.train();
+		if (dictionary.empty())
+			return 0;
+
+		auto db_lock = database.uniqueLock();
+		SQLite::Statement statement{*database, "INSERT OR REPLACE INTO chunkDictionaries VALUES (?, ?)"};
+		statement.bind(1, static_cast<int64_t>(ZDICT_getDictID(dictionary.data(), dictionary.size())));
+		statement.bind(2, dictionary.data(), dictionary.size());
+		statement.exec();
+		chunkCodec.addDictionary(dictionary);
+		return dictionary.size();
+	}
+
 	bool GameDB::readUser(const std::string &username, std::string *display_name_out, nlohmann::json *json_out, std::optional<Place> *release_place) {
 		assert(database);
 		auto db_lock = database.uniqueLock();
@@ -562,6 +859,7 @@ namespace Game3 {
 
 	void GameDB::writeUser(const std::string &username, const nlohmann::json &json, const std::optional<Place> &release_place) {
 		assert(database);
+		flushSnapshots();
 		auto db_lock = database.uniqueLock();
 
 		SQLite::Transaction transaction{*database};
@@ -590,6 +888,7 @@ namespace Game3 {
 
 	void GameDB::writeReleasePlace(const std::string &username, const std::optional<Place> &release_place) {
 		assert(database);
+		flushSnapshots();
 		auto db_lock = database.uniqueLock();
 
 		SQLite::Transaction transaction{*database};
@@ -664,6 +963,8 @@ namespace Game3 {
 			statement.bind(7, buffer.bytes.data(), buffer.bytes.size());
 			statement.exec();
 			statement.reset();
+			++saveStats.tileEntities;
+			saveStats.bytes += buffer.bytes.size();
 		}
 
 		if (transaction)
@@ -687,6 +988,12 @@ namespace Game3 {
 
 	void GameDB::deleteTileEntity(const TileEntityPtr &tile_entity) {
 		assert(database);
+
+		if (snapshotWriter) {
+			snapshotWriter->deleteTileEntity(tile_entity->getGID());
+			return;
+		}
+
 		auto db_lock = database.uniqueLock();
 		SQLite::Transaction transaction{*database};
 		SQLite::Statement statement{*database, "DELETE FROM tileEntities WHERE globalID = ?"};
@@ -720,6 +1027,8 @@ namespace Game3 {
 			statement.bind(7, buffer.bytes.data(), buffer.bytes.size());
 			statement.exec();
 			statement.reset();
+			++saveStats.entities;
+			saveStats.bytes += buffer.bytes.size();
 		}
 
 		if (transaction)
@@ -743,6 +1052,12 @@ namespace Game3 {
 
 	void GameDB::deleteEntity(const EntityPtr &entity) {
 		assert(database);
+
+		if (snapshotWriter) {
+			snapshotWriter->deleteEntity(entity->getGID());
+			return;
+		}
+
 		auto db_lock = database.uniqueLock();
 		SQLite::Transaction transaction{*database};
 		SQLite::Statement statement{*database, "DELETE FROM entities WHERE globalID = ?"};
@@ -4,18 +4,41 @@
 #include <nlohmann/json.hpp>
 
 namespace Game3 {
-	Identifier::Identifier(std::string_view combined) {
-		const size_t colon = combined.find(':');
-		if (colon == std::string_view::npos)
-			throw std::invalid_argument("Not a valid identifier: " + std::string(combined));
-		space = std::string(combined.substr(0, colon));
-		name  = std::string(combined.substr(colon + 1));
-	}
+	namespace {
+		IdentifierHandle internCombined(std::string_view combined) {
+			const size_t colon = combined.find(':');
+			if (colon == std::string_view::npos)
+				throw std::invalid_argument("Not a valid identifier: " + std::string(combined));
+			return IdentifierTable::get().intern(combined.substr(0, colon), combined.substr(colon + 1));
+		}
+
+		/** Identifiers from clients are never interned, since a peer could otherwise fill the table. Any identifier a
+		 *  packet can legitimately name is already known from the registries. Saved data can name identifiers that are
+		 *  no longer registered, so trusted buffers intern as usual. */
+		Identifier decodeIdentifier(const Buffer &buffer, std::string_view combined) {
+			if (!buffer.untrusted)
+				return Identifier(combined);
+			if (std::optional<Identifier> identifier = Identifier::find(combined))
+				return *identifier;
+			constexpr size_t MAX_SHOWN = 64;
+			throw std::invalid_argument("Unknown identifier in buffer: " + std::string(combined.substr(0, MAX_SHOWN)));
+		}
+	}
+
+	Identifier::Identifier(std::string_view combined):
+		handle(internCombined(combined)) {}
 
 	Identifier::Identifier(const char *combined):
 		Identifier(std::string_view(combined)) {}
 
+	std::optional<Identifier> Identifier::find(std::string_view combined) {
+		if (std::optional<IdentifierHandle> handle = IdentifierTable::get().find(combined))
+			return Identifier(*handle);
+		return std::nullopt;
+	}
+
 	std::string Identifier::getPath() const {
+		const std::string &name = getName();
 		const size_t slash = name.find_last_of('/');
 		if (slash == std::string::npos)
 			return "";
@@ -23,6 +46,7 @@ namespace Game3 {
 	}
 
 	std::string Identifier::getPathStart() const {
+		const std::string &name = getName();
 		const size_t slash = name.find('/');
 		if (slash == std::string::npos)
 			return "";
@@ -30,42 +54,55 @@ namespace Game3 {
 	}
 
 	std::string Identifier::getPostPath() const {
+		const std::string &name = getName();
 		const size_t slash = name.find_last_of('/');
 		if (slash == std::string::npos)
 			return name;
 		return name.substr(slash + 1);
 	}
 
+	bool Identifier::hasPath(std::string_view path) const {
+		const std::string_view name = getName();
+		const size_t slash = name.find_last_of('/');
+		return name.substr(0, slash == std::string_view::npos? 0 : slash) == path;
+	}
+
+	bool Identifier::hasPathStart(std::string_view start) const {
+		const std::string_view name = getName();
+		const size_t slash = name.find('/');
+		return name.substr(0, slash == std::string_view::npos? 0 : slash) == start;
+	}
+
 	bool Identifier::operator==(const char *combined) const {
 		return *this == std::string_view(combined);
 	}
 
 	bool Identifier::operator==(std::string_view combined) const {
+		const IdentifierTable::Entry &entry = getEntry();
 		const size_t colon = combined.find(':');
 		if (colon == std::string_view::npos)
 			return false;
-		return space == combined.substr(0, colon) && name == combined.substr(colon + 1);
-	}
-
-	bool Identifier::operator==(const Identifier &other) const {
-		return this == &other || (space == other.space && name == other.name);
+		return entry.space == combined.substr(0, colon) && entry.name == combined.substr(colon + 1);
 	}
 
 	bool Identifier::operator<(const Identifier &other) const {
-		if (this == &other)
+		if (handle == other.handle)
 			return false;
 
-		if (space < other.space)
+		const IdentifierTable::Entry &entry = getEntry();
+		const IdentifierTable::Entry &other_entry = other.getEntry();
+
+		if (entry.space < other_entry.space)
 			return true;
 
-		if (space > other.space)
+		if (entry.space > other_entry.space)
 			return false;
 
-		return name < other.name;
+		return entry.name < other_entry.name;
 	}
 
 	std::ostream & operator<<(std::ostream &os, const Identifier &identifier) {
-		return os << identifier.space << ':' << identifier.name;
+		return os << identifier.view();
 	}
 
 	void from_json(const nlohmann::json &json, Identifier &identifier) {
@@ -82,7 +119,7 @@ namespace Game3 {
 
 	template <>
 	Identifier popBuffer<Identifier>(Buffer &buffer) {
-		return {popBuffer<std::string>(buffer)};
+		return decodeIdentifier(buffer, popBuffer<std::string>(buffer));
 	}
 
 	template <>
@@ -93,17 +130,17 @@ namespace Game3 {
 	}
 
 	Buffer & operator+=(Buffer &buffer, const Identifier &identifier) {
-		return buffer += identifier.str();
+		return buffer += identifier.view();
 	}
 
 	Buffer & operator<<(Buffer &buffer, const Identifier &identifier) {
-		return buffer << identifier.str();
+		return buffer << identifier.view();
 	}
 
 	Buffer & operator>>(Buffer &buffer, Identifier &identifier) {
 		std::string str;
 		buffer >> str;
-		identifier = std::string_view(str);
+		identifier = decodeIdentifier(buffer, str);
 		return buffer;
 	}
 }
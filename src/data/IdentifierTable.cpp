@@ -0,0 +1,65 @@
+#include "data/IdentifierTable.h"
+
+#include <mutex>
+#include <stdexcept>
+
+namespace Game3 {
+	IdentifierTable::IdentifierTable() {
+		// Index 0 is the empty identifier, so that default handles need no lookup.
+		intern({}, {});
+	}
+
+	IdentifierTable & IdentifierTable::get() {
+		static IdentifierTable *table = new IdentifierTable;
+		return *table;
+	}
+
+	IdentifierHandle IdentifierTable::intern(std::string_view space, std::string_view name) {
+		// Most identifiers are already interned, so the combined string is assembled without allocating when it fits.
+		thread_local std::string combined;
+		combined.clear();
+		combined.reserve(space.size() + 1 + name.size());
+		combined.append(space).append(1, ':').append(name);
+
+		{
+			std::shared_lock lock(mutex);
+			if (auto iter = indices.find(std::string_view(combined)); iter != indices.end())
+				return {iter->second};
+		}
+
+		std::unique_lock lock(mutex);
+		if (auto iter = indices.find(std::string_view(combined)); iter != indices.end())
+			return {iter->second};
+
+		if (MAX_SIZE <= count)
+			throw std::length_error("Identifier table is full");
+
+		const uint32_t index = count;
+		Entry *block = blocks[index / BLOCK_SIZE].load(std::memory_order_relaxed);
+		if (block == nullptr) {
+			block = new Entry[BLOCK_SIZE];
+			blocks[index / BLOCK_SIZE].store(block, std::memory_order_release);
+		}
+
+		Entry &entry = block[index % BLOCK_SIZE];
+		entry.space = space;
+		entry.name = name;
+		entry.combined = combined;
+		entry.hash = std::hash<std::string>()(entry.combined);
+		indices.emplace(std::string_view(entry.combined), index);
+		++count;
+		return {index};
+	}
+
+	std::optional<IdentifierHandle> IdentifierTable::find(std::string_view combined) const {
+		std::shared_lock lock(mutex);
+		if (auto iter = indices.find(combined); iter != indices.end())
+			return IdentifierHandle{iter->second};
+		return std::nullopt;
+	}
+
+	size_t IdentifierTable::size() const {
+		std::shared_lock lock(mutex);
+		return count;
+	}
+}
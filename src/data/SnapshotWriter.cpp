@@ -0,0 +1,211 @@
+#include "Log.h"
+#include "data/ChunkCodec.h"
+#include "data/SnapshotWriter.h"
+#include "util/Timer.h"
+
+#include <optional>
+
+namespace Game3 {
+	SnapshotWriter::SnapshotWriter(const std::filesystem::path &path, const ChunkCodec &codec_):
+		codec(codec_),
+		database(path, SQLite::OPEN_READWRITE),
+		insertRealm(database, "INSERT OR REPLACE INTO realms VALUES (?, ?, ?)"),
+		insertTileset(database, "INSERT OR REPLACE INTO tilesets VALUES (?, ?)"),
+		insertChunk(database, "INSERT OR REPLACE INTO chunks VALUES (?, ?, ?, ?, ?, ?, ?, ?)"),
+		insertTileEntity(database, "INSERT OR REPLACE INTO tileEntities VALUES (?, ?, ?, ?, ?, ?, ?)"),
+		insertEntity(database, "INSERT OR REPLACE INTO entities VALUES (?, ?, ?, ?, ?, ?, ?)"),
+		insertRule(database, "INSERT OR REPLACE INTO rules VALUES (?, ?)"),
+		insertUser(database, "INSERT OR REPLACE INTO users VALUES (?, ?, ?, ?, ?)"),
+		insertVillage(database, "INSERT OR REPLACE INTO villages VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"),
+		removeTileEntity(database, "DELETE FROM tileEntities WHERE globalID = ?"),
+		removeEntity(database, "DELETE FROM entities WHERE globalID = ?") {
+			database.setBusyTimeout(10'000);
+			// WAL makes this safe against corruption; at worst the last snapshot is lost if the machine goes down.
+			database.exec("PRAGMA synchronous = NORMAL");
+			thread = std::thread(&SnapshotWriter::run, this);
+		}
+
+	SnapshotWriter::~SnapshotWriter() {
+		{
+			std::unique_lock lock(mutex);
+			stopping = true;
+		}
+		jobReady.notify_all();
+		thread.join();
+	}
+
+	void SnapshotWriter::submit(WorldSnapshot snapshot) {
+		push(std::move(snapshot));
+	}
+
+	void SnapshotWriter::deleteTileEntity(GlobalID global_id) {
+		push(Deletion{Deletion::Kind::TileEntity, global_id});
+	}
+
+	void SnapshotWriter::deleteEntity(GlobalID global_id) {
+		push(Deletion{Deletion::Kind::Entity, global_id});
+	}
+
+	void SnapshotWriter::flush() {
+		std::unique_lock lock(mutex);
+		const size_t target = submitted;
+		jobDone.wait(lock, [&] { return target <= completed; });
+	}
+
+	void SnapshotWriter::push(Job job) {
+		{
+			std::unique_lock lock(mutex);
+			jobs.push_back(std::move(job));
+			++submitted;
+		}
+		jobReady.notify_one();
+	}
+
+	void SnapshotWriter::run() {
+		for (;;) {
+			std::optional<Job> job;
+
+			{
+				std::unique_lock lock(mutex);
+				jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+				if (jobs.empty())
+					return;
+				job.emplace(std::move(jobs.front()));
+				jobs.pop_front();
+			}
+
+			try {
+				std::visit([this](auto &contents) { write(contents); }, *job);
+			} catch (const std::exception &err) {
+				// Nothing was marked as saved, so the next autosave will try again.
+				ERROR("Snapshot writer failed: {}", err.what());
+				for (SQLite::Statement *statement: {&insertRealm, &insertTileset, &insertChunk, &insertTileEntity, &insertEntity, &insertRule, &insertUser, &insertVillage, &removeTileEntity, &removeEntity})
+					statement->tryReset();
+			}
+
+			{
+				std::unique_lock lock(mutex);
+				++completed;
+			}
+			jobDone.notify_all();
+		}
+	}
+
+	void SnapshotWriter::write(WorldSnapshot &snapshot) {
+		Timer timer{"SnapshotWrite"};
+		const auto start = std::chrono::steady_clock::now();
+
+		SaveStats stats;
+		stats.captureDuration = snapshot.captureDuration;
+
+		SQLite::Transaction transaction{database};
+
+		auto exec = [](SQLite::Statement &statement) {
+			statement.exec();
+			statement.reset();
+		};
+
+		for (const WorldSnapshot::RealmRow &row: snapshot.realms) {
+			insertRealm.bind(1, row.realmID);
+			insertRealm.bind(2, row.json);
+			insertRealm.bind(3, row.tilesetHash);
+			exec(insertRealm);
+		}
+
+		for (const WorldSnapshot::TilesetRow &row: snapshot.tilesets) {
+			insertTileset.bind(1, row.hash);
+			insertTileset.bind(2, row.json);
+			exec(insertTileset);
+		}
+
+		for (const WorldSnapshot::ChunkRow &row: snapshot.chunks) {
+			const EncodedChunk encoded = codec.encode(row.chunkSet);
+			insertChunk.bind(1, row.realmID);
+			insertChunk.bind(2, row.position.x);
+			insertChunk.bind(3, row.position.y);
+			insertChunk.bind(4, encoded.terrain.data(), encoded.terrain.size());
+			insertChunk.bind(5, encoded.biomes.data(), encoded.biomes.size());
+			insertChunk.bind(6, encoded.fluids.data(), encoded.fluids.size());
+			insertChunk.bind(7);
+			insertChunk.bind(8, static_cast<int>(ChunkFormat::Compressed));
+			exec(insertChunk);
+			++stats.chunks;
+			stats.bytes += encoded.terrain.size() + encoded.biomes.size() + encoded.fluids.size();
+		}
+
+		for (const WorldSnapshot::TileEntityRow &row: snapshot.tileEntities) {
+			insertTileEntity.bind(1, std::make_signed_t<GlobalID>(row.globalID));
+			insertTileEntity.bind(2, row.realmID);
+			insertTileEntity.bind(3, row.position.row);
+			insertTileEntity.bind(4, row.position.column);
+			insertTileEntity.bind(5, row.tileID);
+			insertTileEntity.bind(6, row.tileEntityID);
+			insertTileEntity.bind(7, row.encoded.data(), row.encoded.size());
+			exec(insertTileEntity);
+			++stats.tileEntities;
+			stats.bytes += row.encoded.size();
+		}
+
+		for (const WorldSnapshot::EntityRow &row: snapshot.entities) {
+			insertEntity.bind(1, std::make_signed_t<GlobalID>(row.globalID));
+			insertEntity.bind(2, row.realmID);
+			insertEntity.bind(3, row.position.row);
+			insertEntity.bind(4, row.position.column);
+			insertEntity.bind(5, row.type);
+			insertEntity.bind(6, row.direction);
+			insertEntity.bind(7, row.encoded.data(), row.encoded.size());
+			exec(insertEntity);
+			++stats.entities;
+			stats.bytes += row.encoded.size();
+		}
+
+		for (const WorldSnapshot::RuleRow &row: snapshot.rules) {
+			insertRule.bind(1, row.key);
+			insertRule.bind(2, row.value);
+			exec(insertRule);
+		}
+
+		for (const WorldSnapshot::UserRow &row: snapshot.users) {
+			insertUser.bind(1, row.username);
+			insertUser.bind(2, row.displayName);
+			insertUser.bind(3, row.json);
+			insertUser.bind(4);
+			insertUser.bind(5);
+			exec(insertUser);
+		}
+
+		for (const WorldSnapshot::VillageRow &row: snapshot.villages) {
+			insertVillage.bind(1, row.villageID);
+			insertVillage.bind(2, row.realmID);
+			insertVillage.bind(3, row.chunkPosition);
+			insertVillage.bind(4, row.position);
+			insertVillage.bind(5, row.options);
+			insertVillage.bind(6, row.richness);
+			insertVillage.bind(7, row.resources);
+			insertVillage.bind(8, row.name);
+			insertVillage.bind(9, row.labor);
+			insertVillage.bind(10, row.randomValue);
+			insertVillage.bind(11, row.greed);
+			exec(insertVillage);
+		}
+
+		transaction.commit();
+
+		stats.duration = std::chrono::steady_clock::now() - start;
+		Timer::count("SavedChunks", stats.chunks);
+		Timer::count("SavedBytes", stats.bytes);
+		INFO("Wrote snapshot of {} chunks, {} tile entities and {} entities ({} bytes): captured in {:.3f} seconds, written in {:.3f} seconds.",
+			stats.chunks, stats.tileEntities, stats.entities, stats.bytes,
+			std::chrono::duration<double>(stats.captureDuration).count(), std::chrono::duration<double>(stats.duration).count());
+
+		if (snapshot.onCommit)
+			snapshot.onCommit(stats);
+	}
+
+	void SnapshotWriter::write(const Deletion &deletion) {
+		SQLite::Statement &statement = deletion.kind == Deletion::Kind::TileEntity? removeTileEntity : removeEntity;
+		statement.bind(1, std::make_signed_t<GlobalID>(deletion.globalID));
+		statement.exec();
+		statement.reset();
+	}
+}
@@ -7,10 +7,9 @@
 #include "tileentity/Building.h"
 #include "tileentity/Chest.h"
 #include "tileentity/Teleporter.h"
+#include "util/Defer.h"
 
 namespace Game3 {
-	ThreadPool Animal::threadPool{2};
-
 	namespace {
 		constexpr HitPoints MAX_HEALTH   = 40;
 		constexpr size_t    PATHFIND_MAX = 256;
@@ -77,11 +76,6 @@ namespace Game3 {
 		return true;
 	}
 
-	void Animal::init(const GamePtr &game) {
-		Entity::init(game);
-		threadPool.start();
-	}
-
 	void Animal::tick(const TickArgs &args) {
 		if (getSide() == Side::Server) {
 			if (firstWander) {
@@ -101,20 +95,23 @@ namespace Game3 {
 	}
 
 	bool Animal::wander() {
-		if (!attemptingWander.exchange(true)) {
-			increaseUpdateCounter();
-			const auto [row, column] = position.copyBase();
-			return threadPool.add([this, row = row, column = column](ThreadPool &, size_t) {
-				pathfind({
-					threadContext.random(int64_t(row    - wanderRadius), int64_t(row    + wanderRadius)),
-					threadContext.random(int64_t(column - wanderRadius), int64_t(column + wanderRadius))
-				}, PATHFIND_MAX);
-
-				attemptingWander = false;
-			});
-		}
+		if (attemptingWander.exchange(true))
+			return false;
+
+		// The flag is tied to the queued job rather than to its callback, which won't run if the job is dropped
+		// (say, with the queue of a realm the animal has left) or if queueing it throws.
+		auto guard = std::make_shared<Defer>([weak = std::weak_ptr<Entity>(getSelf())] {
+			if (EntityPtr self = weak.lock())
+				std::static_pointer_cast<Animal>(self)->attemptingWander = false;
+		});
 
-		return false;
+		increaseUpdateCounter();
+		const auto [row, column] = position.copyBase();
+		queuePathfind({
+			threadContext.random(int64_t(row    - wanderRadius), int64_t(row    + wanderRadius)),
+			threadContext.random(int64_t(column - wanderRadius), int64_t(column + wanderRadius))
+		}, PATHFIND_MAX, [guard = std::move(guard)](bool) {});
+		return true;
 	}
 
 	void Animal::encode(Buffer &buffer) {
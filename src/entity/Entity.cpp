@@ -23,7 +23,6 @@
 #include "realm/Realm.h"
 #include "registry/Registries.h"
 #include "ui/Canvas.h"
-#include "algorithm/AStar.h"
 #include "util/Cast.h"
 #include "util/Util.h"
 
@@ -718,10 +717,19 @@ namespace Game3 {
 		RealmID limbo_id = inLimboFor.load();
 
 		if ((old_realm != new_realm) || (limbo_id != 0 && limbo_id != new_realm->id)) {
-			nextRealm = new_realm->id;
+			GamePtr game = getGame();
 			auto shared = getSelf();
 
-			GamePtr game = getGame();
+			// Moving between realms while realms are ticking on separate threads has to wait until they're all done.
+			if (game->getSide() == Side::Server && game->toServer().isTickingRealmsInParallel()) {
+				game->toServer().queueCrossRealmAction([shared, new_position, new_realm, context] {
+					shared->teleport(new_position, new_realm, context);
+				});
+				return;
+			}
+
+			nextRealm = new_realm->id;
+
 			if (game->getSide() == Side::Server && old_realm != new_realm && !context.suppressPackets)
 				game->toServer().entityChangingRealms(*this, new_realm, new_position);
 
@@ -769,9 +777,40 @@ namespace Game3 {
 		if (start == goal)
 			return PathResult::Trivial;
 
-		if (!simpleAStar(getRealm(), start, goal, positions, loop_max))
+		if (!getRealm()->pathGraph.findPath(start, goal, positions, loop_max))
 			return PathResult::Unpathable;
 
+		return followPath(goal, positions, out);
+	}
+
+	bool Entity::pathfind(const Position &goal, size_t loop_max) {
+		PathResult out = PathResult::Invalid;
+		{
+			auto lock = path.uniqueLock();
+			out = pathfind(position, goal, path, loop_max);
+		}
+
+		return finishPathfind(out);
+	}
+
+	void Entity::queuePathfind(const Position &goal, size_t loop_max, std::function<void(bool)> on_done) {
+		getRealm()->queuePathfind(getSelf(), goal, loop_max, std::move(on_done));
+	}
+
+	bool Entity::usePath(const PathRequest &request) {
+		PathResult out = PathResult::Unpathable;
+
+		if (request.start == request.goal) {
+			out = PathResult::Trivial;
+		} else if (request.found) {
+			auto lock = path.uniqueLock();
+			out = followPath(request.goal, request.path, path);
+		}
+
+		return finishPathfind(out);
+	}
+
+	PathResult Entity::followPath(const Position &goal, const std::vector<Position> &positions, std::list<Direction> &out) {
 		out.clear();
 		pathSeers.clear();
 
@@ -797,13 +836,7 @@ namespace Game3 {
 		return PathResult::Success;
 	}
 
-	bool Entity::pathfind(const Position &goal, size_t loop_max) {
-		PathResult out = PathResult::Invalid;
-		{
-			auto lock = path.uniqueLock();
-			out = pathfind(position, goal, path, loop_max);
-		}
-
+	bool Entity::finishPathfind(PathResult out) {
 		if (out == PathResult::Success && getSide() == Side::Server) {
 			increaseUpdateCounter();
 			auto shared = getSelf();
@@ -113,6 +113,10 @@ namespace Game3 {
 		const bool changed = new_health != health;
 		health = new_health;
 
+		// Health is saved with the entity, so a change has to make it count as unsaved.
+		if (changed)
+			increaseUpdateCounter();
+
 		if (getSide() == Side::Server) {
 			if (health <= 0) {
 				kill();
@@ -155,6 +159,8 @@ namespace Game3 {
 		if (damage == 0)
 			return false;
 
+		increaseUpdateCounter();
+
 		if (health.fetch_sub(damage) <= damage) {
 			health = 0;
 			kill();
@@ -0,0 +1,44 @@
+#include "game/ChunkPager.h"
+
+#include <algorithm>
+
+namespace Game3 {
+	ChunkPager::ChunkPager(const TileProvider &provider_):
+		provider(provider_) {}
+
+	std::vector<ChunkPosition> ChunkPager::collect(const std::unordered_set<ChunkPosition> &pinned, const Settings &settings, Clock::time_point now) {
+		std::unordered_map<ChunkPosition, Clock::time_point> next_pinned;
+		std::vector<std::pair<Clock::time_point, ChunkPosition>> unpinned;
+
+		provider.forEachChunk([&](ChunkPosition chunk_position, const ChunkRecord &) {
+			Clock::time_point time = now;
+
+			if (!pinned.contains(chunk_position)) {
+				if (auto iter = lastPinned.find(chunk_position); iter != lastPinned.end())
+					time = iter->second;
+				unpinned.emplace_back(time, chunk_position);
+			}
+
+			next_pinned.emplace(chunk_position, time);
+		});
+
+		// Forgetting chunks that are no longer resident keeps this from growing with the size of the world.
+		const size_t resident = next_pinned.size();
+		lastPinned = std::move(next_pinned);
+
+		std::ranges::sort(unpinned, {}, &std::pair<Clock::time_point, ChunkPosition>::first);
+
+		const size_t over_budget = settings.budget != 0 && settings.budget < resident? resident - settings.budget : 0;
+		std::vector<ChunkPosition> out;
+
+		for (size_t i = 0; i < unpinned.size(); ++i) {
+			const auto [time, chunk_position] = unpinned[i];
+			if (i < over_budget || settings.idleTime <= now - time)
+				out.push_back(chunk_position);
+			else
+				break;
+		}
+
+		return out;
+	}
+}
@@ -1,4 +1,5 @@
 #include "Log.h"
+#include "client/ChunkCache.h"
 #include "command/local/LocalCommandFactory.h"
 #include "entity/ClientPlayer.h"
 #include "entity/EntityFactory.h"
@@ -9,6 +10,7 @@
 #include "graphics/Tileset.h"
 #include "net/DisconnectedError.h"
 #include "net/LocalClient.h"
+#include "packet/CachedChunkRequestPacket.h"
 #include "packet/CommandPacket.h"
 #include "packet/ChunkRequestPacket.h"
 #include "packet/ClickPacket.h"
@@ -26,10 +28,24 @@
 namespace Game3 {
 	namespace {
 		constexpr float GARBAGE_COLLECTION_TIME = 60;
+		/** How often chunks changed by tile updates are written back to the chunk cache, in seconds. */
+		constexpr float CACHE_REFRESH_TIME = 10;
 	}
 
+	ClientGame::ClientGame(Canvas &canvas_): Game(), canvas(canvas_) {}
+
 	ClientGame::~ClientGame() {
 		INFOX(3, "\e[31m~ClientGame\e[39m({})", reinterpret_cast<void *>(this));
+
+		if (chunkCache) {
+			try {
+				refreshCachedChunks();
+			} catch (const std::exception &err) {
+				WARN("Couldn't refresh the chunk cache: {}", err.what());
+			}
+			// Finishes the cache's jobs while the rest of the game is still intact for their callbacks.
+			chunkCache.reset();
+		}
 	}
 
 	double ClientGame::getFrequency() const {
@@ -175,6 +191,12 @@ namespace Game3 {
 			garbageCollect();
 		}
 
+		lastCacheRefresh += delta;
+		if (lastCacheRefresh >= CACHE_REFRESH_TIME) {
+			lastCacheRefresh = 0;
+			refreshCachedChunks();
+		}
+
 		getClient()->read();
 
 		for (const auto &packet: packetQueue.steal()) {
@@ -189,6 +211,8 @@ namespace Game3 {
 			}
 		}
 
+		applyCachedChunks();
+
 		if (!getPlayer())
 			return true;
 
@@ -203,7 +227,7 @@ namespace Game3 {
 				missingChunks = std::move(new_missing_chunks);
 				missing_chunks_lock.lock();
 				if (!missingChunks.empty())
-					getClient()->send(ChunkRequestPacket(*realm, missingChunks, true));
+					requestChunks(*realm, missingChunks);
 			}
 		} else {
 			WARN_("No realm");
@@ -221,6 +245,128 @@ namespace Game3 {
 		missingChunks.erase(chunk_position);
 	}
 
+	void ClientGame::openChunkCache(const std::filesystem::path &path, std::string server_key, size_t capacity) {
+		try {
+			chunkCache = std::make_unique<ChunkCache>(path, std::move(server_key), capacity);
+		} catch (const std::exception &err) {
+			// Without a cache, every chunk is sent in full as before.
+			WARN("Couldn't open chunk cache at {}: {}", path.string(), err.what());
+			chunkCache.reset();
+		}
+	}
+
+	void ClientGame::cacheChunk(Realm &realm, ChunkPosition chunk_position) {
+		if (!chunkCache)
+			return;
+
+		ChunkSet chunk_set = realm.tileProvider.copyTilesAndFluids(chunk_position);
+		// The client never learns the biomes, but the storage format expects them.
+		chunk_set.biomes.assign(CHUNK_SIZE * CHUNK_SIZE, 0);
+		chunkCache->store(realm.id, chunk_position, realm.tileProvider.getUpdateCounter(chunk_position), realm.getTileset().getHash(), std::move(chunk_set));
+	}
+
+	void ClientGame::chunkChanged(RealmID realm_id, ChunkPosition chunk_position) {
+		if (!chunkCache)
+			return;
+
+		const std::pair key{realm_id, chunk_position};
+		if (auto iter = loadingCachedChunks.find(key); iter != loadingCachedChunks.end())
+			iter->second = true;
+		staleCachedChunks.insert(key);
+	}
+
+	void ClientGame::loadCachedChunk(RealmID realm_id, ChunkPosition chunk_position, uint64_t update_counter, uint64_t digest) {
+		if (!chunkCache) {
+			getClient()->send(ChunkRequestPacket(realm_id, {ChunkRequest(chunk_position)}));
+			return;
+		}
+
+		loadingCachedChunks[{realm_id, chunk_position}] = false;
+		// The cache is destroyed before the queue, so capturing this is safe.
+		chunkCache->load(realm_id, chunk_position, digest, [this, realm_id, chunk_position, update_counter](std::optional<ChunkSet> chunk_set) {
+			loadedCachedChunks.push(CachedChunk{realm_id, chunk_position, update_counter, std::move(chunk_set)});
+		});
+	}
+
+	void ClientGame::requestChunks(Realm &realm, const std::set<ChunkPosition> &chunk_positions) {
+		if (!chunkCache) {
+			getClient()->send(ChunkRequestPacket(realm, chunk_positions, true));
+			return;
+		}
+
+		chunkCache->find(realm.id, chunk_positions, [this, realm_id = realm.id](std::map<ChunkPosition, uint64_t> digests, std::set<ChunkPosition> missing) {
+			std::shared_ptr<LocalClient> client = getClient();
+			if (!client)
+				return;
+
+			if (!missing.empty())
+				client->send(ChunkRequestPacket(realm_id, std::set<ChunkRequest>(missing.begin(), missing.end())));
+
+			if (!digests.empty())
+				client->send(CachedChunkRequestPacket(realm_id, std::move(digests)));
+		});
+	}
+
+	void ClientGame::applyCachedChunks() {
+		for (CachedChunk &loaded: loadedCachedChunks.steal()) {
+			bool changed_while_loading = false;
+			if (auto iter = loadingCachedChunks.find({loaded.realmID, loaded.position}); iter != loadingCachedChunks.end()) {
+				changed_while_loading = iter->second;
+				loadingCachedChunks.erase(iter);
+			}
+
+			RealmPtr realm = tryRealm(loaded.realmID);
+			if (!realm)
+				continue;
+
+			if (!loaded.chunkSet) {
+				// The cached copy was evicted or overwritten since it was offered to the server.
+				getClient()->send(ChunkRequestPacket(*realm, {loaded.position}, true));
+				continue;
+			}
+
+			TileProvider &provider = realm->tileProvider;
+
+			// A full copy that arrived while the cache was being read is at least as new as the cached one.
+			if (!provider.contains(loaded.position) || provider.getUpdateCounter(loaded.position) < loaded.updateCounter) {
+				for (const Layer layer: allLayers)
+					provider.getTileChunk(layer, loaded.position) = std::vector<TileID>(std::move(loaded.chunkSet->terrain[getIndex(layer)]));
+
+				provider.getFluidChunk(loaded.position) = std::vector<FluidTile>(std::move(loaded.chunkSet->fluids));
+				provider.setUpdateCounter(loaded.position, loaded.updateCounter);
+
+				// Updates that arrived while the cache was being read were just overwritten, so ask for them again.
+				if (changed_while_loading)
+					getClient()->send(ChunkRequestPacket(*realm, {loaded.position}));
+
+				realm->queueReupload();
+				realm->queueStaticLightingTexture();
+			}
+
+			chunkReceived(loaded.position);
+		}
+	}
+
+	void ClientGame::refreshCachedChunks() {
+		if (!chunkCache)
+			return;
+
+		for (auto iter = staleCachedChunks.begin(); iter != staleCachedChunks.end();) {
+			const auto &[realm_id, chunk_position] = *iter;
+
+			// Caching a chunk that's still being loaded would store whatever partial copy the updates created.
+			if (loadingCachedChunks.contains(*iter)) {
+				++iter;
+				continue;
+			}
+
+			if (RealmPtr realm = tryRealm(realm_id); realm && realm->tileProvider.contains(chunk_position))
+				cacheChunk(*realm, chunk_position);
+
+			iter = staleCachedChunks.erase(iter);
+		}
+	}
+
 	void ClientGame::interactOn(Modifiers modifiers, Hand hand) {
 		auto client = getClient();
 		assert(client);
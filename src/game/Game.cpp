@@ -104,11 +104,20 @@ namespace Game3 {
 	}
 
 	RealmID Game::newRealmID() const {
-		// TODO: a less stupid way of doing this.
 		RealmID max = 1;
-		for (const auto &[id, realm]: realms)
-			max = std::max(max, id);
-		return max + 1;
+		{
+			auto lock = realms.sharedLock();
+			for (const auto &[id, realm]: realms)
+				max = std::max(max, id);
+		}
+
+		// Realms generated on other threads may not have been added yet, so the IDs they got have to be remembered.
+		RealmID last = lastRealmID.load();
+		RealmID next{};
+		do
+			next = std::max(max, last) + 1;
+		while (!lastRealmID.compare_exchange_weak(last, next));
+		return next;
 	}
 
 	double Game::getTotalSeconds() const {
@@ -129,12 +138,16 @@ namespace Game3 {
 	}
 
 	std::optional<TileID> Game::getFluidTileID(FluidID fluid_id) {
-		if (auto iter = fluidCache.find(fluid_id); iter != fluidCache.end())
-			return iter->second;
+		{
+			auto lock = fluidCache.sharedLock();
+			if (auto iter = fluidCache.find(fluid_id); iter != fluidCache.end())
+				return iter->second;
+		}
 
 		if (auto fluid = registry<FluidRegistry>().maybe(static_cast<size_t>(fluid_id))) {
 			if (auto tileset = registry<TilesetRegistry>().maybe(fluid->tilesetName)) {
 				if (auto fluid_tileid = tileset->maybe(fluid->tilename)) {
+					auto lock = fluidCache.uniqueLock();
 					fluidCache.emplace(fluid_id, *fluid_tileid);
 					return *fluid_tileid;
 				}
@@ -236,6 +249,7 @@ namespace Game3 {
 
 	void Game::associateWithRealm(const VillagePtr &village, RealmID realm_id) {
 		RealmPtr realm = getRealm(realm_id);
+		auto lock = realm->villages.uniqueLock();
 		realm->villages.insert(village);
 	}
 
@@ -7,6 +7,10 @@
 #include "packet/CommandResultPacket.h"
 #include "packet/CommandPacket.h"
 #include "packet/SelfTeleportedPacket.h"
+#include "packet/CachedChunkRequestPacket.h"
+#include "packet/ChunkDeltaPacket.h"
+#include "packet/ChunkUnchangedPacket.h"
+#include "packet/TileBatchPacket.h"
 #include "packet/ChunkTilesPacket.h"
 #include "packet/RealmNoticePacket.h"
 #include "packet/LoginPacket.h"
@@ -132,5 +136,9 @@ namespace Game3 {
 		add(PacketFactory::create<EntityMoneyChangedPacket>());
 		add(PacketFactory::create<EntityRiddenPacket>());
 		add(PacketFactory::create<SetCopierConfigurationPacket>());
+		add(PacketFactory::create<ChunkDeltaPacket>());
+		add(PacketFactory::create<CachedChunkRequestPacket>());
+		add(PacketFactory::create<ChunkUnchangedPacket>());
+		add(PacketFactory::create<TileBatchPacket>());
 	}
 }
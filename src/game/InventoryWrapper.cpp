@@ -104,7 +104,7 @@ namespace Game3 {
 	}
 
 	ItemCount InventoryWrapper::count(const ItemID &id) const {
-		if (id.getPathStart() == "attribute")
+		if (id.hasPathStart("attribute"))
 			return countAttribute(id);
 
 		ItemCount out = 0;
@@ -1,3 +1,4 @@
+#include "data/SnapshotWriter.h"
 #include "game/OwnsVillages.h"
 #include "game/Game.h"
 #include "realm/Realm.h"
@@ -17,14 +18,26 @@ namespace Game3 {
 	}
 
 	VillagePtr OwnsVillages::addVillage(Game &game, ChunkPosition chunk_position, const Place &place, const VillageOptions &options) {
-		auto lock = villageMap.uniqueLock();
-		const auto new_id = getNewVillageID();
-		VillagePtr new_village = std::make_shared<Village>(game, new_id, place.realm->getID(), chunk_position, place.position, options);
-		villageMap[new_id] = new_village;
-		associateWithRealm(new_village, place.realm->getID());
+		VillagePtr new_village = std::make_shared<Village>(game, getNewVillageID(), place.realm->getID(), chunk_position, place.position, options);
+
+		if (place.realm->isStaging()) {
+			auto lock = place.realm->stagedVillages.uniqueLock();
+			place.realm->stagedVillages.push_back(new_village);
+			return new_village;
+		}
+
+		addVillage(new_village);
 		return new_village;
 	}
 
+	void OwnsVillages::addVillage(const VillagePtr &village) {
+		{
+			auto lock = villageMap.uniqueLock();
+			villageMap[village->getID()] = village;
+		}
+		associateWithRealm(village, village->getRealmID());
+	}
+
 	VillagePtr OwnsVillages::addVillage(Game &game, VillageID village_id, std::string name, RealmID realm_id, ChunkPosition chunk_position, const Position &position, Resources resources) {
 		VillagePtr new_village = std::make_shared<Village>(village_id, realm_id, std::move(name), chunk_position, position, VillageOptions{}, Richness{}, std::move(resources), LaborAmount{}, double{}, double{});
 
@@ -65,6 +78,26 @@ namespace Game3 {
 			transaction->commit();
 	}
 
+	void OwnsVillages::snapshotVillages(WorldSnapshot &snapshot) const {
+		auto lock = villageMap.sharedLock();
+		snapshot.villages.reserve(snapshot.villages.size() + villageMap.size());
+		for (const auto &[id, village]: villageMap) {
+			snapshot.villages.push_back({
+				int64_t(village->getID()),
+				village->getRealmID(),
+				std::string(village->getChunkPosition()),
+				std::string(village->getPosition()),
+				nlohmann::json(village->options).dump(),
+				nlohmann::json(village->getRichness()).dump(),
+				nlohmann::json(village->getResources()).dump(),
+				village->getName(),
+				int64_t(village->getLabor()),
+				village->getRandomValue(),
+				village->getGreed(),
+			});
+		}
+	}
+
 	void OwnsVillages::loadVillages(const std::shared_ptr<Game> &game, SQLite::Database &database) {
 		SQLite::Statement query{database, "SELECT * FROM villages"};
 
@@ -6,6 +6,7 @@
 #include "entity/ServerPlayer.h"
 #include "game/ServerGame.h"
 #include "graphics/Tileset.h"
+#include "net/Frame.h"
 #include "net/Server.h"
 #include "net/RemoteClient.h"
 #include "packet/ChatMessageSentPacket.h"
@@ -31,6 +32,7 @@ namespace Game3 {
 	ServerGame::ServerGame(const std::shared_ptr<Server> &server_, size_t pool_size):
 	weakServer(server_), pool(pool_size) {
 		pool.start();
+		pagingPool.start();
 	}
 
 	ServerGame::~ServerGame() {
@@ -43,6 +45,7 @@ namespace Game3 {
 
 	void ServerGame::stop() {
 		pool.join();
+		pagingPool.join();
 		INFO_("Saving realms and users...");
 		assert(database);
 		database->writeAllRealms();
@@ -76,15 +79,13 @@ namespace Game3 {
 			if (auto client = weak_client.lock())
 				handlePacket(*client, *packet);
 
-		const size_t max_jobs = realms.size() * 2;
+		tickRealms();
 
-		for (auto &[id, realm]: realms) {
-			if (max_jobs <= pool.jobCount())
-				break;
-			// pool.add([weak_realm = std::weak_ptr(realm), delta = delta](ThreadPool &, size_t) {
-			// 	if (RealmPtr realm = weak_realm.lock())
-					realm->tick(delta);
-			// });
+		{
+			// Tile changes from this tick, including those made while handling packets, go out as one packet per chunk.
+			auto lock = realms.sharedLock();
+			for (const auto &[id, realm]: realms)
+				realm->flushTileUpdates();
 		}
 
 		std::optional<TimePacket> time_packet;
@@ -131,6 +132,57 @@ namespace Game3 {
 		return true;
 	}
 
+	void ServerGame::tickRealms() {
+		Timer timer{"TickRealms"};
+
+		std::vector<RealmPtr> realms_copy;
+		{
+			auto lock = realms.sharedLock();
+			realms_copy.reserve(realms.size());
+			for (const auto &[id, realm]: realms)
+				realms_copy.push_back(realm);
+		}
+
+		auto tick_realm = [delta = delta](const RealmPtr &realm) {
+			Timer realm_timer{"TickRealm(" + std::to_string(realm->getID()) + ')'};
+			realm->tick(delta);
+		};
+
+		if (pool.getSize() == 0 || realms_copy.size() < 2) {
+			for (const RealmPtr &realm: realms_copy)
+				tick_realm(realm);
+		} else {
+			tickingRealmsInParallel = true;
+			for (const RealmPtr &realm: realms_copy)
+				realm->tickingInParallel = true;
+
+			pool.parallelFor(0, realms_copy.size(), [&](size_t index) {
+				const RealmPtr &realm = realms_copy[index];
+				threadContext.tickingRealm = realm.get();
+				try {
+					tick_realm(realm);
+				} catch (const std::exception &err) {
+					ERROR("Couldn't tick realm {}: {}", realm->getID(), err.what());
+				}
+				threadContext.tickingRealm = nullptr;
+			});
+
+			for (const RealmPtr &realm: realms_copy)
+				realm->tickingInParallel = false;
+			tickingRealmsInParallel = false;
+		}
+
+		for (const auto &action: crossRealmQueue.steal())
+			action();
+	}
+
+	void ServerGame::queueCrossRealmAction(std::function<void()> action) {
+		if (tickingRealmsInParallel)
+			crossRealmQueue.push(std::move(action));
+		else
+			action();
+	}
+
 	void ServerGame::garbageCollect() {
 		auto lock = players.sharedLock();
 
@@ -152,17 +204,26 @@ namespace Game3 {
 	}
 
 	void ServerGame::broadcastTileUpdate(RealmID realm_id, Layer layer, const Position &position, TileID tile_id) {
-		broadcast({position, realms.at(realm_id), nullptr}, TileUpdatePacket(realm_id, layer, position, tile_id));
+		broadcast({position, getRealm(realm_id), nullptr}, TileUpdatePacket(realm_id, layer, position, tile_id));
 	}
 
 	void ServerGame::broadcastFluidUpdate(RealmID realm_id, const Position &position, FluidTile tile) {
-		broadcast({position, realms.at(realm_id), nullptr}, FluidUpdatePacket(realm_id, position, tile));
+		broadcast({position, getRealm(realm_id), nullptr}, FluidUpdatePacket(realm_id, position, tile));
 	}
 
 	void ServerGame::queuePacket(std::shared_ptr<RemoteClient> client, std::shared_ptr<Packet> packet) {
 		packetQueue.emplace(std::move(client), std::move(packet));
 	}
 
+	void ServerGame::queuePackets(const std::shared_ptr<RemoteClient> &client, std::vector<std::shared_ptr<Packet>> &&packets) {
+		std::vector<std::pair<std::weak_ptr<RemoteClient>, std::shared_ptr<Packet>>> batch;
+		batch.reserve(packets.size());
+		for (std::shared_ptr<Packet> &packet: packets)
+			batch.emplace_back(client, std::move(packet));
+		packets.clear();
+		packetQueue.pushAll(std::move(batch));
+	}
+
 	void ServerGame::runCommand(RemoteClient &client, const std::string &command, GlobalID command_id) {
 		auto [success, message] = commandHelper(client, command);
 		client.send(CommandResultPacket(command_id, success, std::move(message)));
@@ -227,6 +288,8 @@ namespace Game3 {
 		auto realm = tile_entity->getRealm();
 		realm->updateNeighbors(tile_entity->getPosition(), Layer::Submerged);
 		realm->updateNeighbors(tile_entity->getPosition(), Layer::Objects);
+		// The client expects the tiles under a tile entity to be in place by the time it hears about it.
+		realm->flushTileUpdates();
 		ChunkRange(tile_entity->getChunk()).iterate([&](ChunkPosition chunk_position) {
 			if (auto entities = realm->getEntities(chunk_position)) {
 				auto lock = entities->sharedLock();
@@ -239,6 +302,7 @@ namespace Game3 {
 
 	void ServerGame::tileEntityDestroyed(const TileEntity &tile_entity) {
 		const DestroyTileEntityPacket packet(tile_entity);
+		tile_entity.getRealm()->flushTileUpdates();
 		auto server = weakServer.lock();
 		assert(server);
 		auto &clients = server->getClients();
@@ -318,6 +382,15 @@ namespace Game3 {
 
 	void ServerGame::removeRealm(RealmPtr realm) {
 		assert(database);
+
+		// Removing a realm moves its players into another one.
+		if (tickingRealmsInParallel) {
+			queueCrossRealmAction([self = getSelf(), realm = std::move(realm)] {
+				self->removeRealm(realm);
+			});
+			return;
+		}
+
 		Game::removeRealm(realm);
 
 		{
@@ -478,6 +551,26 @@ namespace Game3 {
 				return {true, "Counter for chunk " + static_cast<std::string>(chunk) + ": " + std::to_string(counter)};
 			}
 
+			if (first == "genstats") {
+				RealmPtr realm = player->getRealm();
+				const Realm::GenerationStats &stats = realm->generationStats;
+				const size_t generated = stats.generated;
+				const double average_ms = generated == 0? 0. : stats.totalLatencyNanos / 1e6 / generated;
+				return {true, std::format("Realm {}: {} queued, {} in flight, {} generated in {} batches, latency avg {:.2f} ms, max {:.2f} ms",
+					realm->id, stats.queued.load(), stats.inFlight.load(), generated, stats.batches.load(), average_ms, stats.maxLatencyNanos / 1e6)};
+			}
+
+			if (first == "pagestats") {
+				RealmPtr realm = player->getRealm();
+				const TileProvider &provider = realm->tileProvider;
+				const size_t resident = provider.getResidentCount();
+				return {true, std::format("Realm {}: {} chunks resident (~{} MiB), {} paged out, {} page faults",
+					realm->id, resident, resident * ChunkPager::CHUNK_BYTES / (1024 * 1024), provider.getPagedOutCount(), provider.getPageFaultCount())};
+			}
+
+			if (first == "netstats")
+				return {true, FramePool::get().summarize()};
+
 			if (first == "moving") {
 				std::stringstream ss;
 				if (player->isMoving()) {
@@ -532,6 +625,11 @@ namespace Game3 {
 				return {true, "Position = " + std::string(player->getPosition()) + ", chunk position = " + std::string(player->getChunk())};
 			}
 
+			if (first == "paths") {
+				const PathGraph &graph = player->getRealm()->pathGraph;
+				return {true, std::format("Path cache: {} hits, {} misses ({:.1f}% hit rate)", graph.getCacheHits(), graph.getCacheMisses(), graph.getCacheHitRate() * 100)};
+			}
+
 			if (first == "pm") {
 				if (1 < words.size())
 					player->getRealm()->remakePathMap(player->getChunk());
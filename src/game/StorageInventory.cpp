@@ -183,7 +183,7 @@ namespace Game3 {
 	}
 
 	ItemCount StorageInventory::count(const ItemID &id) const {
-		if (id.getPath() == "attribute")
+		if (id.hasPath("attribute"))
 			return countAttribute(id);
 
 		ItemCount out = 0;
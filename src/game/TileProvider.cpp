@@ -1,76 +1,327 @@
 #include "graphics/Tileset.h"
 #include "game/Game.h"
 #include "game/TileProvider.h"
+#include "game/TileView.h"
+#include "util/Crypto.h"
 #include "util/Util.h"
 #include "util/Zstd.h"
 
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
 namespace Game3 {
+	namespace {
+		std::atomic_uint64_t nextEpoch = 1;
+
+		struct LastChunk {
+			uint64_t epoch = 0;
+			ChunkPosition position;
+			ChunkRecord *record = nullptr;
+		};
+
+		/** The record most recently looked up by this thread. */
+		thread_local LastChunk lastChunk;
+
+		/** Replaces a part's contents, discarding its packed form if it has one. The caller has to hold the part's lock. */
+		template <typename T>
+		void replacePart(ChunkRecord &record, uint8_t bit, Chunk<T> &chunk, Chunk<T> &&contents) {
+			auto lock = chunk.uniqueLock();
+			chunk.unsafeSet(std::move(contents));
+			if (record.isPacked(bit)) {
+				record.packed.fetch_and(static_cast<uint8_t>(~bit), std::memory_order_release);
+				record.unpacked = true;
+			}
+		}
+
+		template <typename T>
+		void unpackPart(ChunkRecord &record, uint8_t bit, Chunk<T> &chunk, const PalettedChunk<T> &packed) {
+			auto lock = chunk.uniqueLock();
+			// Another thread may have unpacked it while this one was waiting for the lock.
+			if (!record.isPacked(bit))
+				return;
+			packed.unpack(chunk);
+			// The packed copy stays around until the next compaction pass, since other threads may still be reading it.
+			record.packed.fetch_and(static_cast<uint8_t>(~bit), std::memory_order_release);
+			record.unpacked = true;
+		}
+
+		template <typename T>
+		std::vector<T> copyPart(const ChunkRecord &record, uint8_t bit, const Chunk<T> &chunk, const PalettedChunk<T> &packed) {
+			auto lock = chunk.sharedLock();
+			std::vector<T> out;
+			if (record.isPacked(bit))
+				packed.unpack(out);
+			else
+				out = chunk;
+			return out;
+		}
+
+		template <typename T>
+		bool matches(const Chunk<T> &chunk, const PalettedChunk<T> &packed) {
+			for (size_t i = 0; i < chunk.size(); ++i)
+				if (chunk[i] != packed[i])
+					return false;
+			return true;
+		}
+
+		/** Frees everything a paged-out record holds while keeping the record itself, since other threads may still be
+		 *  pointing to it. The caller has to hold every part lock. */
+		void emptyRecord(ChunkRecord &record) {
+			for (size_t i = 0; i < LAYER_COUNT; ++i) {
+				std::vector<TileID>().swap(record.layers[i]);
+				record.packedLayers[i] = {};
+			}
+			std::vector<BiomeType>().swap(record.biomes);
+			std::vector<uint8_t>().swap(record.paths);
+			std::vector<FluidTile>().swap(record.fluids);
+			record.packedBiomes = {};
+			record.packedFluids = {};
+			record.present = 0;
+			record.packed = 0;
+			record.unpacked = false;
+			record.compactedCount = ChunkRecord::NEVER_SAVED;
+			std::unique_lock lock(record.journalMutex);
+			record.journal.reset();
+		}
+
+		/** get_parts(ChunkRecord &) returns pointers to the dense and packed forms of the part. */
+		template <typename T, typename F>
+		void packParts(std::shared_mutex &part_mutex, uint8_t bit, std::span<ChunkRecord * const> cold, std::span<ChunkRecord * const> unpacked, F get_parts,
+		               std::vector<std::vector<T>> &retired, TileProvider::CompactionStats &stats) {
+			std::vector<std::pair<ChunkRecord *, PalettedChunk<T>>> packed;
+
+			// Packing is the slow part, so it's done while other threads can still read.
+			{
+				std::shared_lock lock(part_mutex);
+				for (ChunkRecord *record: cold) {
+					if (!record->has(bit) || record->isPacked(bit))
+						continue;
+					const Chunk<T> &chunk = *get_parts(*record).first;
+					auto chunk_lock = chunk.sharedLock();
+					if (std::optional<PalettedChunk<T>> result = PalettedChunk<T>::pack(std::span<const T>(chunk.data(), chunk.size())))
+						packed.emplace_back(record, std::move(*result));
+				}
+			}
+
+			std::unique_lock lock(part_mutex);
+
+			for (auto &[record, result]: packed) {
+				// Changes are tracked the same way as for saving; a chunk that changed since it was collected is left alone.
+				if (!record->has(bit) || record->updateCount.load() != record->compactedCount)
+					continue;
+				auto [chunk, destination] = get_parts(*record);
+				auto chunk_lock = chunk->uniqueLock();
+				// A write can land between the two phases before its update counter is bumped.
+				if (!matches(*chunk, result))
+					continue;
+				stats.bytesBefore += chunk->capacity() * sizeof(T);
+				stats.bytesAfter += result.getMemoryUsage();
+				++stats.packed;
+				*destination = std::move(result);
+				record->packed.fetch_or(bit, std::memory_order_release);
+				// Swapped out rather than freed, in case anything is still holding a reference into it.
+				retired.emplace_back().swap(*chunk);
+			}
+
+			for (ChunkRecord *record: unpacked) {
+				auto [chunk, destination] = get_parts(*record);
+				if (record->isPacked(bit) || destination->empty())
+					continue;
+				auto chunk_lock = chunk->uniqueLock();
+				if (!record->isPacked(bit))
+					destination->clear();
+			}
+		}
+	}
+
+	TileProvider::TileProvider():
+		epoch(nextEpoch++) {}
+
 	TileProvider::TileProvider(Identifier tileset_id):
-		tilesetID(std::move(tileset_id)) {}
+		tilesetID(std::move(tileset_id)),
+		epoch(nextEpoch++) {}
 
 	void TileProvider::clear() {
-		for (auto &map: chunkMaps)
-			map.clear();
-		biomeMap.clear();
+		std::unique_lock lock(indexMutex);
+		chunks.clear();
+		pagedOut.clear();
+		retiredTiles.clear();
+		retiredBiomes.clear();
+		retiredFluids.clear();
+		epoch = nextEpoch++;
 	}
 
 	bool TileProvider::contains(ChunkPosition chunk_position) const {
-		if (!pathMap.contains(chunk_position) || !biomeMap.contains(chunk_position))
-			return false;
-		for (const auto &map: chunkMaps)
-			if (!map.contains(chunk_position))
-				return false;
-		return true;
+		// Fluids have never been required here.
+		constexpr uint8_t required = ChunkRecord::ALL_PRESENT & ~ChunkRecord::FLUIDS_PRESENT;
+		ChunkRecord *record = findRecord(chunk_position);
+		return record != nullptr && record->has(required);
 	}
 
 	uint64_t TileProvider::updateChunk(ChunkPosition chunk_position) {
-		std::unique_lock meta_lock(metaMutex);
-		return ++metaMap[chunk_position].updateCount;
+		return bumpUnjournaled(ensureRecord(chunk_position));
+	}
+
+	uint64_t TileProvider::updateChunk(ChunkPosition chunk_position, const ChunkChange &change) {
+		ChunkRecord &record = ensureRecord(chunk_position);
+		std::unique_lock lock(record.journalMutex);
+
+		if (!record.journal) {
+			record.journal = std::make_unique<ChunkJournal>();
+			record.journal->start = record.updateCount;
+		}
+
+		const uint64_t update_counter = ++record.updateCount;
+		ChunkJournal &journal = *record.journal;
+		journal.entries.emplace_back(update_counter, change);
+
+		// Each entry accounts for exactly one increment, so dropping one means clients have to be past its counter.
+		if (JOURNAL_SIZE < journal.entries.size()) {
+			journal.start = journal.entries.front().first;
+			journal.entries.pop_front();
+		}
+
+		return update_counter;
+	}
+
+	std::optional<std::pair<uint64_t, std::vector<ChunkChange>>> TileProvider::getChangesSince(ChunkPosition chunk_position, uint64_t update_counter) const {
+		ChunkRecord *record = findRecord(chunk_position);
+		if (record == nullptr)
+			return std::nullopt;
+
+		std::unique_lock lock(record->journalMutex);
+		const uint64_t current = record->updateCount;
+
+		if (!record->journal || update_counter < record->journal->start || current < update_counter)
+			return std::nullopt;
+
+		std::vector<ChunkChange> changes;
+		for (const auto &[counter, change]: record->journal->entries)
+			if (update_counter < counter)
+				changes.push_back(change);
+
+		// Only the latest change to each tile matters. The sort is stable, so that's the last of each group.
+		std::stable_sort(changes.begin(), changes.end(), [](const ChunkChange &left, const ChunkChange &right) {
+			return std::tie(left.part, left.index) < std::tie(right.part, right.index);
+		});
+
+		auto out = changes.begin();
+		for (auto iter = changes.begin(); iter != changes.end(); ++iter) {
+			auto next = std::next(iter);
+			if (next == changes.end() || next->part != iter->part || next->index != iter->index)
+				*out++ = *iter;
+		}
+		changes.erase(out, changes.end());
+
+		return std::make_pair(current, std::move(changes));
 	}
 
 	uint64_t TileProvider::getUpdateCounter(ChunkPosition chunk_position) {
-		std::shared_lock shared_lock(metaMutex);
-		if (auto iter = metaMap.find(chunk_position); iter != metaMap.end())
-			return iter->second.updateCount;
+		if (ChunkRecord *record = findRecord(chunk_position))
+			return record->updateCount;
 		return 0;
 	}
 
 	void TileProvider::setUpdateCounter(ChunkPosition chunk_position, uint64_t counter) {
-		std::unique_lock meta_lock(metaMutex);
-		metaMap[chunk_position].updateCount = counter;
+		ChunkRecord &record = ensureRecord(chunk_position);
+		std::unique_lock lock(record.journalMutex);
+		record.journal.reset();
+		record.updateCount = counter;
 	}
 
 	void TileProvider::absorb(ChunkPosition chunk_position, ChunkSet chunk_set) {
-		if (chunk_set.terrain.size() != LAYER_COUNT)
-			throw std::invalid_argument("ChunkSet has invalid number of terrain layers in TileProvider::absorb: " + std::to_string(chunk_set.terrain.size()));
+		validateChunkSet(chunk_set);
 
-		if (chunk_set.biomes.size() != CHUNK_SIZE * CHUNK_SIZE)
-			throw std::invalid_argument("Invalid number of biome tiles in TileProvider::absorb: " + std::to_string(chunk_set.biomes.size()));
+		ChunkRecord &record = ensureRecord(chunk_position);
 
-		if (chunk_set.fluids.size() != CHUNK_SIZE * CHUNK_SIZE)
-			throw std::invalid_argument("Invalid number of fluid tiles in TileProvider::absorb: " + std::to_string(chunk_set.fluids.size()));
+		for (size_t i = 0; i < LAYER_COUNT; ++i) {
+			const uint8_t bit = ChunkRecord::layerBit(getLayer(i + 1));
+			std::unique_lock lock(chunkMutexes[i]);
+			replacePart(record, bit, record.layers[i], std::move(chunk_set.terrain[i]));
+			record.mark(bit);
+		}
+
+		{
+			std::unique_lock lock(biomeMutex);
+			replacePart(record, ChunkRecord::BIOMES_PRESENT, record.biomes, std::move(chunk_set.biomes));
+			record.mark(ChunkRecord::BIOMES_PRESENT);
+		}
+
+		{
+			std::unique_lock lock(fluidMutex);
+			replacePart(record, ChunkRecord::FLUIDS_PRESENT, record.fluids, std::move(chunk_set.fluids));
+			record.mark(ChunkRecord::FLUIDS_PRESENT);
+		}
+
+		{
+			std::unique_lock lock(pathMutex);
+			record.paths = std::move(chunk_set.pathmap);
+			record.mark(ChunkRecord::PATHS_PRESENT);
+		}
+
+		bumpUnjournaled(record);
+	}
+
+	void TileProvider::absorb(std::vector<std::pair<ChunkPosition, ChunkSet>> batch) {
+		for (const auto &[chunk_position, chunk_set]: batch)
+			validateChunkSet(chunk_set);
+
+		std::vector<ChunkRecord *> records;
+		records.reserve(batch.size());
+
+		{
+			std::unique_lock lock(indexMutex);
+			for (const auto &[chunk_position, chunk_set]: batch)
+				records.push_back(chunks.tryEmplace(chunk_position).first);
+		}
 
 		for (size_t i = 0; i < LAYER_COUNT; ++i) {
+			const uint8_t bit = ChunkRecord::layerBit(getLayer(i + 1));
 			std::unique_lock lock(chunkMutexes[i]);
-			chunkMaps[i][chunk_position] = std::move(chunk_set.terrain[i]);
+			for (size_t j = 0; j < batch.size(); ++j) {
+				replacePart(*records[j], bit, records[j]->layers[i], std::move(batch[j].second.terrain[i]));
+				records[j]->mark(bit);
+			}
 		}
 
 		{
 			std::unique_lock lock(biomeMutex);
-			biomeMap[chunk_position] = std::move(chunk_set.biomes);
+			for (size_t j = 0; j < batch.size(); ++j) {
+				replacePart(*records[j], ChunkRecord::BIOMES_PRESENT, records[j]->biomes, std::move(batch[j].second.biomes));
+				records[j]->mark(ChunkRecord::BIOMES_PRESENT);
+			}
 		}
 
 		{
 			std::unique_lock lock(fluidMutex);
-			fluidMap[chunk_position] = std::move(chunk_set.fluids);
+			for (size_t j = 0; j < batch.size(); ++j) {
+				replacePart(*records[j], ChunkRecord::FLUIDS_PRESENT, records[j]->fluids, std::move(batch[j].second.fluids));
+				records[j]->mark(ChunkRecord::FLUIDS_PRESENT);
+			}
 		}
 
 		{
 			std::unique_lock lock(pathMutex);
-			pathMap[chunk_position] = std::move(chunk_set.pathmap);
+			for (size_t j = 0; j < batch.size(); ++j) {
+				records[j]->paths = std::move(batch[j].second.pathmap);
+				records[j]->mark(ChunkRecord::PATHS_PRESENT);
+			}
 		}
 
-		updateChunk(chunk_position);
+		for (ChunkRecord *record: records)
+			bumpUnjournaled(*record);
+	}
+
+	void TileProvider::validateChunkSet(const ChunkSet &chunk_set) {
+		if (chunk_set.terrain.size() != LAYER_COUNT)
+			throw std::invalid_argument("ChunkSet has invalid number of terrain layers in TileProvider::absorb: " + std::to_string(chunk_set.terrain.size()));
+
+		if (chunk_set.biomes.size() != CHUNK_SIZE * CHUNK_SIZE)
+			throw std::invalid_argument("Invalid number of biome tiles in TileProvider::absorb: " + std::to_string(chunk_set.biomes.size()));
+
+		if (chunk_set.fluids.size() != CHUNK_SIZE * CHUNK_SIZE)
+			throw std::invalid_argument("Invalid number of fluid tiles in TileProvider::absorb: " + std::to_string(chunk_set.fluids.size()));
 	}
 
 	std::shared_ptr<Tileset> TileProvider::getTileset(const Game &game) const {
@@ -88,16 +339,21 @@ namespace Game3 {
 		std::vector<Position> land_tiles;
 		land_tiles.resize((range.tileWidth() - right_pad) * (range.tileHeight() - bottom_pad));
 
-		std::shared_lock lock(chunkMutexes[0]);
+		TileView view(*this, range, TileView::TILES | TileView::FLUIDS);
 
 		size_t i = 0;
-		bool was_empty = false;
 
-		for (Index row = range.rowMin(); row <= range.rowMax() - bottom_pad; ++row)
-			for (Index column = range.columnMin(); column < range.columnMax() - right_pad; ++column)
-				if (tileset->isLand(copyTileUnsafe(Layer::Terrain, Position(row, column), was_empty, TileMode::Throw)))
-					if (auto fluid_tile = copyFluidTile(Position(row, column)); !fluid_tile || fluid_tile->level == 0)
-						land_tiles[i++] = {row, column};
+		for (Index row = range.rowMin(); row <= range.rowMax() - bottom_pad; ++row) {
+			for (Index column = range.columnMin(); column < range.columnMax() - right_pad; ++column) {
+				const Position position(row, column);
+				const std::optional<TileID> tile = view.tryTile(Layer::Terrain, position);
+				if (!tile)
+					throw std::out_of_range("Couldn't copy tile at " + std::string(position));
+				if (tileset->isLand(*tile) && !view.hasFluid(position))
+					land_tiles[i++] = position;
+			}
+		}
+
 		return land_tiles;
 	}
 
@@ -110,12 +366,8 @@ namespace Game3 {
 		was_empty = false;
 		validateLayer(layer);
 
-		const ChunkPosition chunk_position = position.getChunk();
-
-		const ChunkMap &map = chunkMaps[getIndex(layer)];
-
-		if (auto iter = map.find(chunk_position); iter != map.end())
-			return access(iter->second, remainder(position.row), remainder(position.column));
+		if (const ChunkRecord *record = findRecord(position.getChunk()); record != nullptr && record->has(ChunkRecord::layerBit(layer)))
+			return record->getTile(getIndex(layer), remainder(position.row) * CHUNK_SIZE + remainder(position.column));
 
 		if (mode == TileMode::ReturnEmpty) {
 			was_empty = true;
@@ -136,10 +388,9 @@ namespace Game3 {
 		const ChunkPosition chunk_position{divide(position.column), divide(position.row)};
 
 		std::shared_lock lock(chunkMutexes[getIndex(layer)]);
-		const auto &map = chunkMaps[getIndex(layer)];
 
-		if (auto iter = map.find(chunk_position); iter != map.end())
-			return access(iter->second, remainder(position.row), remainder(position.column));
+		if (const ChunkRecord *record = findRecord(chunk_position); record != nullptr && record->has(ChunkRecord::layerBit(layer)))
+			return record->getTile(getIndex(layer), remainder(position.row) * CHUNK_SIZE + remainder(position.column));
 
 		return std::nullopt;
 	}
@@ -149,8 +400,8 @@ namespace Game3 {
 
 		std::shared_lock lock(biomeMutex);
 
-		if (auto iter = biomeMap.find(chunk_position); iter != biomeMap.end())
-			return access(iter->second, remainder(position.row), remainder(position.column));
+		if (const ChunkRecord *record = findRecord(chunk_position); record != nullptr && record->has(ChunkRecord::BIOMES_PRESENT))
+			return record->getBiome(remainder(position.row) * CHUNK_SIZE + remainder(position.column));
 
 		return std::nullopt;
 	}
@@ -160,8 +411,8 @@ namespace Game3 {
 
 		std::shared_lock lock(pathMutex);
 
-		if (auto iter = pathMap.find(chunk_position); iter != pathMap.end())
-			return access(iter->second, remainder(position.row), remainder(position.column));
+		if (const PathChunk *chunk = findPart(chunk_position, ChunkRecord::PATHS_PRESENT, &ChunkRecord::paths))
+			return access(*chunk, remainder(position.row), remainder(position.column));
 
 		return std::nullopt;
 	}
@@ -171,57 +422,112 @@ namespace Game3 {
 
 		std::shared_lock lock(fluidMutex);
 
-		if (auto iter = fluidMap.find(chunk_position); iter != fluidMap.end())
-			return access(iter->second, remainder(position.row), remainder(position.column));
+		if (const ChunkRecord *record = findRecord(chunk_position); record != nullptr && record->has(ChunkRecord::FLUIDS_PRESENT))
+			return record->getFluid(remainder(position.row) * CHUNK_SIZE + remainder(position.column));
 
 		return std::nullopt;
 	}
 
+	ChunkSet TileProvider::copyTilesAndFluids(ChunkPosition chunk_position) const {
+		ChunkSet out;
+		for (const Layer layer: allLayers)
+			out.terrain[getIndex(layer)] = copyTileChunk(layer, chunk_position);
+		out.fluids = copyFluidChunk(chunk_position);
+		return out;
+	}
+
+	uint64_t TileProvider::computeDigest(const ChunkSet &chunk_set, std::string_view salt) {
+		Hasher hasher(Hasher::Algorithm::SHA3_256);
+		hasher += salt;
+
+		for (const TileChunk &chunk: chunk_set.terrain) {
+			auto lock = chunk.sharedLock();
+			hasher += std::span<const TileID>(chunk);
+		}
+
+		std::vector<FluidInt> fluids;
+		{
+			auto lock = chunk_set.fluids.sharedLock();
+			fluids.reserve(chunk_set.fluids.size());
+			for (const FluidTile &tile: chunk_set.fluids)
+				fluids.push_back(toLittle(static_cast<FluidInt>(tile)));
+		}
+		hasher += std::span<const FluidInt>(fluids);
+
+		const std::vector<uint8_t> digest = hasher.value<std::vector<uint8_t>>();
+		uint64_t out{};
+		std::memcpy(&out, digest.data(), sizeof(out));
+		return out;
+	}
+
 	ChunkSet TileProvider::getChunkSet(ChunkPosition chunk_position) const {
 		std::vector<TileChunk> terrain;
 
-		for (size_t i = 0; i < LAYER_COUNT; ++i) {
-			std::shared_lock lock(chunkMutexes[i]);
-			terrain.push_back(chunkMaps[i].at(chunk_position));
+		for (const Layer layer: allLayers) {
+			std::shared_lock lock(chunkMutexes[getIndex(layer)]);
+			terrain.emplace_back(copyTileChunk(layer, chunk_position));
 		}
 
 		BiomeChunk biomes;
 
 		{
 			std::shared_lock lock(biomeMutex);
-			biomes = biomeMap.at(chunk_position);
+			biomes = copyBiomeChunk(chunk_position);
 		}
 
 		FluidChunk fluids;
 
 		{
 			std::shared_lock lock(fluidMutex);
-			fluids = fluidMap.at(chunk_position);
+			fluids = copyFluidChunk(chunk_position);
 		}
 
 		PathChunk pathmap;
 
 		{
 			std::shared_lock lock(pathMutex);
-			pathmap = pathMap.at(chunk_position);
+			pathmap = getPathChunk(chunk_position);
 		}
 
 		return {std::move(terrain), std::move(biomes), std::move(fluids), std::move(pathmap)};
 	}
 
+	std::vector<TileID> TileProvider::copyTileChunk(Layer layer, ChunkPosition chunk_position) const {
+		validateLayer(layer);
+		const uint8_t bit = ChunkRecord::layerBit(layer);
+
+		if (const ChunkRecord *record = findRecord(chunk_position); record != nullptr && record->has(bit))
+			return copyPart(*record, bit, record->layers[getIndex(layer)], record->packedLayers[getIndex(layer)]);
+
+		throw std::out_of_range("Couldn't find tile chunk at position " + static_cast<std::string>(chunk_position));
+	}
+
+	std::vector<BiomeType> TileProvider::copyBiomeChunk(ChunkPosition chunk_position) const {
+		if (const ChunkRecord *record = findRecord(chunk_position); record != nullptr && record->has(ChunkRecord::BIOMES_PRESENT))
+			return copyPart(*record, ChunkRecord::BIOMES_PRESENT, record->biomes, record->packedBiomes);
+
+		throw std::out_of_range("Couldn't find biome chunk at position " + static_cast<std::string>(chunk_position));
+	}
+
+	std::vector<FluidTile> TileProvider::copyFluidChunk(ChunkPosition chunk_position) const {
+		if (const ChunkRecord *record = findRecord(chunk_position); record != nullptr && record->has(ChunkRecord::FLUIDS_PRESENT))
+			return copyPart(*record, ChunkRecord::FLUIDS_PRESENT, record->fluids, record->packedFluids);
+
+		throw std::out_of_range("Couldn't find fluid chunk at position " + static_cast<std::string>(chunk_position));
+	}
+
 	std::string TileProvider::getRawChunks(ChunkPosition chunk_position) const {
 		std::string raw;
 		raw.reserve(LAYER_COUNT * CHUNK_SIZE * CHUNK_SIZE * sizeof(TileID));
 
 		for (Layer layer: allLayers) {
 			std::shared_lock lock(chunkMutexes[getIndex(layer)]);
-			const TileChunk &chunk = chunkMaps[getIndex(layer)].at(chunk_position);
-			appendSpan(raw, std::span(chunk));
+			appendSpan(raw, std::span(copyTileChunk(layer, chunk_position)));
 		}
 
 		{
 			std::shared_lock lock(biomeMutex);
-			appendSpan(raw, std::span(biomeMap.at(chunk_position)));
+			appendSpan(raw, std::span(copyBiomeChunk(chunk_position)));
 		}
 
 		{
@@ -229,7 +535,7 @@ namespace Game3 {
 			std::vector<FluidInt> raw_fluids;
 			raw_fluids.reserve(CHUNK_SIZE * CHUNK_SIZE);
 
-			for (const FluidTile &tile: fluidMap.at(chunk_position))
+			for (const FluidTile &tile: copyFluidChunk(chunk_position))
 				raw_fluids.emplace_back(tile);
 
 			appendSpan(raw, std::span(raw_fluids));
@@ -244,8 +550,7 @@ namespace Game3 {
 
 		for (Layer layer: allLayers) {
 			std::shared_lock lock(chunkMutexes[getIndex(layer)]);
-			const TileChunk &chunk = chunkMaps[getIndex(layer)].at(chunk_position);
-			appendSpan(raw, std::span(chunk));
+			appendSpan(raw, std::span(copyTileChunk(layer, chunk_position)));
 		}
 
 		return raw;
@@ -256,9 +561,7 @@ namespace Game3 {
 		raw.reserve(sizeof(BiomeType) * CHUNK_SIZE * CHUNK_SIZE);
 		{
 			std::shared_lock lock(biomeMutex);
-			const BiomeChunk &biome_data = biomeMap.at(chunk_position);
-			auto biome_lock = biome_data.sharedLock();
-			appendSpan(raw, std::span(biome_data));
+			appendSpan(raw, std::span(copyBiomeChunk(chunk_position)));
 		}
 		return raw;
 	}
@@ -268,7 +571,7 @@ namespace Game3 {
 		raw.reserve(sizeof(uint8_t) * CHUNK_SIZE * CHUNK_SIZE);
 		{
 			std::shared_lock lock(pathMutex);
-			const PathChunk &pathmap_data = pathMap.at(chunk_position);
+			const PathChunk &pathmap_data = getPathChunk(chunk_position);
 			auto pathmap_lock = pathmap_data.sharedLock();
 			appendSpan(raw, std::span(pathmap_data));
 		}
@@ -282,9 +585,7 @@ namespace Game3 {
 		raw.reserve(CHUNK_SIZE * CHUNK_SIZE * sizeof(FluidInt));
 		{
 			std::shared_lock lock(fluidMutex);
-			const FluidChunk &fluid_data = fluidMap.at(chunk_position);
-			auto fluid_lock = fluid_data.sharedLock();
-			for (const FluidTile &tile: fluidMap.at(chunk_position))
+			for (const FluidTile &tile: copyFluidChunk(chunk_position))
 				raw_fluids.emplace_back(tile);
 		}
 		assert(raw_fluids.size() == CHUNK_SIZE * CHUNK_SIZE);
@@ -298,35 +599,31 @@ namespace Game3 {
 		validateLayer(layer);
 
 		const ChunkPosition chunk_position {divide(position.column), divide(position.row)};
-
-		std::shared_mutex &mutex = chunkMutexes[getIndex(layer)];
-		std::shared_lock shared_lock(mutex);
-		ChunkMap &map = chunkMaps[getIndex(layer)];
-
-		if (auto iter = map.find(chunk_position); iter != map.end()) {
-			if (lock_out != nullptr)
-				*lock_out = std::move(shared_lock);
-			return access(iter->second, remainder(position.row), remainder(position.column));
-		}
-
-		if (mode == TileMode::Create) {
-			created = true;
-			shared_lock.unlock();
-			std::unique_lock unique_lock(mutex);
-			TileChunk &chunk = map[chunk_position];
-			initTileChunk(layer, chunk, chunk_position);
-			TileID &accessed = access(chunk, remainder(position.row), remainder(position.column)) = 0;
-
-			if (lock_out != nullptr) {
-				unique_lock.unlock();
-				shared_lock.lock();
-				*lock_out = std::move(shared_lock);
+		const uint8_t bit = ChunkRecord::layerBit(layer);
+		ChunkRecord *record = nullptr;
+		std::shared_lock<std::shared_mutex> shared_lock;
+
+		// The chunk can be paged out between finding its record and locking the layer.
+		while (!shared_lock.owns_lock()) {
+			record = findRecord(chunk_position);
+			if (record == nullptr || !record->has(bit)) {
+				if (mode != TileMode::Create)
+					throw std::out_of_range("Couldn't find tile at " + std::string(position));
+				record = &ensureRecord(chunk_position);
+				ensureParts(chunk_position, *record, bit);
+				created = true;
 			}
-
-			return accessed;
+			shared_lock = std::shared_lock(chunkMutexes[getIndex(layer)]);
+			if (!record->has(bit))
+				shared_lock.unlock();
 		}
 
-		throw std::out_of_range("Couldn't find tile at " + std::string(position));
+		// Unpacked only once the lock is held, so that compaction can't pack the layer again in between.
+		unpackLocked(*record, bit);
+		TileID &accessed = access(record->layers[getIndex(layer)], remainder(position.row), remainder(position.column));
+		if (lock_out != nullptr)
+			*lock_out = std::move(shared_lock);
+		return accessed;
 	}
 
 	TileID & TileProvider::findTile(Layer layer, Position position, bool &created, std::unique_lock<std::shared_mutex> *lock_out, TileMode mode) {
@@ -334,189 +631,459 @@ namespace Game3 {
 		validateLayer(layer);
 
 		const ChunkPosition chunk_position {divide(position.column), divide(position.row)};
-
-		std::shared_mutex &mutex = chunkMutexes[getIndex(layer)];
-		std::shared_lock shared_lock(mutex);
-		ChunkMap &map = chunkMaps[getIndex(layer)];
-
-		if (auto iter = map.find(chunk_position); iter != map.end()) {
-			if (lock_out != nullptr) {
-				shared_lock.unlock();
-				*lock_out = std::unique_lock(mutex);
+		const uint8_t bit = ChunkRecord::layerBit(layer);
+		ChunkRecord *record = nullptr;
+		std::unique_lock<std::shared_mutex> unique_lock;
+
+		// The chunk can be paged out between finding its record and locking the layer.
+		while (!unique_lock.owns_lock()) {
+			record = findRecord(chunk_position);
+			if (record == nullptr || !record->has(bit)) {
+				if (mode != TileMode::Create)
+					throw std::out_of_range("Couldn't find tile at " + std::string(position));
+				record = &ensureRecord(chunk_position);
+				ensureParts(chunk_position, *record, bit);
+				created = true;
 			}
-			return access(iter->second, remainder(position.row), remainder(position.column));
-		}
-
-		if (mode == TileMode::Create) {
-			created = true;
-			shared_lock.unlock();
-			std::unique_lock unique_lock(mutex);
-			TileChunk &chunk = map[chunk_position];
-			initTileChunk(layer, chunk, chunk_position);
-			TileID &accessed = access(chunk, remainder(position.row), remainder(position.column)) = 0;
-			if (lock_out != nullptr)
-				*lock_out = std::move(unique_lock);
-			return accessed;
+			unique_lock = std::unique_lock(chunkMutexes[getIndex(layer)]);
+			if (!record->has(bit))
+				unique_lock.unlock();
 		}
 
-		throw std::out_of_range("Couldn't find tile at " + std::string(position));
+		// Unpacked only once the lock is held, so that compaction can't pack the layer again in between.
+		unpackLocked(*record, bit);
+		TileID &accessed = access(record->layers[getIndex(layer)], remainder(position.row), remainder(position.column));
+		if (lock_out != nullptr)
+			*lock_out = std::move(unique_lock);
+		return accessed;
 	}
 
 	BiomeType & TileProvider::findBiomeType(Position position, bool &created, std::shared_lock<std::shared_mutex> *lock_out, BiomeMode mode) {
-		return findItem(position, created, lock_out, mode, biomeMutex, biomeMap, [this](auto &chunk, ChunkPosition chunk_position) {
-			initBiomeChunk(chunk, chunk_position);
-		});
+		return findItem(position, created, lock_out, mode, biomeMutex, ChunkRecord::BIOMES_PRESENT, &ChunkRecord::biomes);
 	}
 
 	BiomeType & TileProvider::findBiomeType(Position position, bool &created, std::unique_lock<std::shared_mutex> *lock_out, BiomeMode mode) {
-		return findItem(position, created, lock_out, mode, biomeMutex, biomeMap, [this](auto &chunk, ChunkPosition chunk_position) {
-			initBiomeChunk(chunk, chunk_position);
-		});
+		return findItem(position, created, lock_out, mode, biomeMutex, ChunkRecord::BIOMES_PRESENT, &ChunkRecord::biomes);
 	}
 
 	uint8_t & TileProvider::findPathState(Position position, bool &created, std::shared_lock<std::shared_mutex> *lock_out, PathMode mode) {
-		return findItem(position, created, lock_out, mode, pathMutex, pathMap, [this](auto &chunk, ChunkPosition chunk_position) {
-			initPathChunk(chunk, chunk_position);
-		});
+		return findItem(position, created, lock_out, mode, pathMutex, ChunkRecord::PATHS_PRESENT, &ChunkRecord::paths);
 	}
 
 	uint8_t & TileProvider::findPathState(Position position, bool &created, std::unique_lock<std::shared_mutex> *lock_out, PathMode mode) {
-		return findItem(position, created, lock_out, mode, pathMutex, pathMap, [this](auto &chunk, ChunkPosition chunk_position) {
-			initPathChunk(chunk, chunk_position);
-		});
+		return findItem(position, created, lock_out, mode, pathMutex, ChunkRecord::PATHS_PRESENT, &ChunkRecord::paths);
 	}
 
 	FluidTile & TileProvider::findFluid(Position position, std::shared_lock<std::shared_mutex> *lock_out, FluidMode mode) {
 		bool created{};
-		return findItem(position, created, lock_out, mode, fluidMutex, fluidMap, [this](auto &chunk, ChunkPosition chunk_position) {
-			initFluidChunk(chunk, chunk_position);
-		});
+		return findItem(position, created, lock_out, mode, fluidMutex, ChunkRecord::FLUIDS_PRESENT, &ChunkRecord::fluids);
 	}
 
 	FluidTile & TileProvider::findFluid(Position position, std::unique_lock<std::shared_mutex> *lock_out, FluidMode mode) {
 		bool created{};
-		return findItem(position, created, lock_out, mode, fluidMutex, fluidMap, [this](auto &chunk, ChunkPosition chunk_position) {
-			initFluidChunk(chunk, chunk_position);
-		});
+		return findItem(position, created, lock_out, mode, fluidMutex, ChunkRecord::FLUIDS_PRESENT, &ChunkRecord::fluids);
 	}
 
 	const TileChunk & TileProvider::getTileChunk(Layer layer, ChunkPosition chunk_position) const {
 		validateLayer(layer);
 
-		std::shared_lock lock(chunkMutexes[getIndex(layer)]);
-		if (auto iter = chunkMaps[getIndex(layer)].find(chunk_position); iter != chunkMaps[getIndex(layer)].end())
-			return iter->second;
+		if (const TileChunk *chunk = findTileChunk(chunk_position, layer))
+			return *chunk;
 
 		throw std::out_of_range("Couldn't find tile chunk at position " + static_cast<std::string>(chunk_position));
 	}
 
 	TileChunk & TileProvider::getTileChunk(Layer layer, ChunkPosition chunk_position) {
 		validateLayer(layer);
-		ensureTileChunk(chunk_position, layer);
-		std::unique_lock lock(chunkMutexes[getIndex(layer)]);
-		return chunkMaps[getIndex(layer)][chunk_position];
+		ChunkRecord &record = ensureRecord(chunk_position);
+		ensureParts(chunk_position, record, ChunkRecord::layerBit(layer));
+		unpack(record, ChunkRecord::layerBit(layer));
+		return record.layers[getIndex(layer)];
 	}
 
 	std::optional<std::reference_wrapper<const TileChunk>> TileProvider::tryTileChunk(Layer layer, ChunkPosition chunk_position) const {
-		std::shared_lock lock(chunkMutexes[getIndex(layer)]);
-		if (auto iter = chunkMaps[getIndex(layer)].find(chunk_position); iter != chunkMaps[getIndex(layer)].end())
-			return std::ref(iter->second);
+		if (const TileChunk *chunk = findTileChunk(chunk_position, layer))
+			return std::cref(*chunk);
 		return std::nullopt;
 	}
 
 	std::optional<std::reference_wrapper<TileChunk>> TileProvider::tryTileChunk(Layer layer, ChunkPosition chunk_position) {
-		std::shared_lock lock(chunkMutexes[getIndex(layer)]);
-		if (auto iter = chunkMaps[getIndex(layer)].find(chunk_position); iter != chunkMaps[getIndex(layer)].end())
-			return std::ref(iter->second);
+		if (TileChunk *chunk = findTileChunk(chunk_position, layer))
+			return std::ref(*chunk);
 		return std::nullopt;
 	}
 
 	const Chunk<BiomeType> & TileProvider::getBiomeChunk(ChunkPosition chunk_position) const {
-		std::shared_lock lock(biomeMutex);
-		if (auto iter = biomeMap.find(chunk_position); iter != biomeMap.end())
-			return iter->second;
-
-		throw std::out_of_range("Couldn't find biome chunk at position " + static_cast<std::string>(chunk_position));
+		return getPart(chunk_position, ChunkRecord::BIOMES_PRESENT, &ChunkRecord::biomes, "biome");
 	}
 
 	Chunk<BiomeType> & TileProvider::getBiomeChunk(ChunkPosition chunk_position) {
-		ensureBiomeChunk(chunk_position);
-		std::unique_lock lock(biomeMutex);
-		return biomeMap[chunk_position];
+		ChunkRecord &record = ensureRecord(chunk_position);
+		ensureParts(chunk_position, record, ChunkRecord::BIOMES_PRESENT);
+		unpack(record, ChunkRecord::BIOMES_PRESENT);
+		return record.biomes;
 	}
 
 	const Chunk<uint8_t> & TileProvider::getPathChunk(ChunkPosition chunk_position) const {
-		std::shared_lock lock(pathMutex);
-		if (auto iter = pathMap.find(chunk_position); iter != pathMap.end())
-			return iter->second;
-
-		throw std::out_of_range("Couldn't find path chunk at position " + static_cast<std::string>(chunk_position));
+		return getPart(chunk_position, ChunkRecord::PATHS_PRESENT, &ChunkRecord::paths, "path");
 	}
 
 	Chunk<uint8_t> & TileProvider::getPathChunk(ChunkPosition chunk_position) {
-		ensurePathChunk(chunk_position);
-		std::unique_lock lock(pathMutex);
-		return pathMap[chunk_position];
+		ChunkRecord &record = ensureRecord(chunk_position);
+		ensureParts(chunk_position, record, ChunkRecord::PATHS_PRESENT);
+		return record.paths;
 	}
 
 	const Chunk<FluidTile> & TileProvider::getFluidChunk(ChunkPosition chunk_position) const {
-		std::shared_lock lock(fluidMutex);
-		if (auto iter = fluidMap.find(chunk_position); iter != fluidMap.end())
-			return iter->second;
-
-		throw std::out_of_range("Couldn't find fluid chunk at position " + static_cast<std::string>(chunk_position));
+		return getPart(chunk_position, ChunkRecord::FLUIDS_PRESENT, &ChunkRecord::fluids, "fluid");
 	}
 
 	Chunk<FluidTile> & TileProvider::getFluidChunk(ChunkPosition chunk_position) {
-		ensureFluidChunk(chunk_position);
-		std::unique_lock lock(fluidMutex);
-		return fluidMap[chunk_position];
+		ChunkRecord &record = ensureRecord(chunk_position);
+		ensureParts(chunk_position, record, ChunkRecord::FLUIDS_PRESENT);
+		unpack(record, ChunkRecord::FLUIDS_PRESENT);
+		return record.fluids;
 	}
 
 	void TileProvider::ensureTileChunk(ChunkPosition chunk_position) {
-		for (const auto layer: allLayers) {
-			std::unique_lock lock(chunkMutexes[getIndex(layer)]);
-			if (auto [iter, inserted] = chunkMaps[getIndex(layer)].try_emplace(chunk_position); inserted)
-				initTileChunk(layer, iter->second, chunk_position);
-		}
+		uint8_t bits = 0;
+		for (const Layer layer: allLayers)
+			bits |= ChunkRecord::layerBit(layer);
+		ensureParts(chunk_position, ensureRecord(chunk_position), bits);
 	}
 
 	void TileProvider::ensureTileChunk(ChunkPosition chunk_position, Layer layer) {
 		validateLayer(layer);
-		std::unique_lock lock(chunkMutexes[getIndex(layer)]);
-		if (auto [iter, inserted] = chunkMaps[getIndex(layer)].try_emplace(chunk_position); inserted)
-			initTileChunk(layer, iter->second, chunk_position);
+		ensureParts(chunk_position, ensureRecord(chunk_position), ChunkRecord::layerBit(layer));
 	}
 
 	void TileProvider::ensureBiomeChunk(ChunkPosition chunk_position) {
-		std::unique_lock lock(biomeMutex);
-		if (auto [iter, inserted] = biomeMap.try_emplace(chunk_position); inserted)
-			initBiomeChunk(iter->second, chunk_position);
+		ensureParts(chunk_position, ensureRecord(chunk_position), ChunkRecord::BIOMES_PRESENT);
 	}
 
 	void TileProvider::ensurePathChunk(ChunkPosition chunk_position) {
-		std::unique_lock lock(pathMutex);
-		if (auto [iter, inserted] = pathMap.try_emplace(chunk_position); inserted)
-			initPathChunk(iter->second, chunk_position);
+		ensureParts(chunk_position, ensureRecord(chunk_position), ChunkRecord::PATHS_PRESENT);
 	}
 
 	void TileProvider::ensureFluidChunk(ChunkPosition chunk_position) {
-		std::unique_lock lock(fluidMutex);
-		if (auto [iter, inserted] = fluidMap.try_emplace(chunk_position); inserted)
-			initFluidChunk(iter->second, chunk_position);
+		ensureParts(chunk_position, ensureRecord(chunk_position), ChunkRecord::FLUIDS_PRESENT);
 	}
 
 	void TileProvider::ensureAllChunks(ChunkPosition chunk_position) {
-		ensurePathChunk(chunk_position);
-		ensureBiomeChunk(chunk_position);
-		ensureTileChunk(chunk_position);
-		ensureFluidChunk(chunk_position);
+		ensureParts(chunk_position, ensureRecord(chunk_position), ChunkRecord::ALL_PRESENT);
 	}
 
 	void TileProvider::ensureAllChunks(Position position) {
 		ensureAllChunks(position.getChunk());
 	}
 
+	std::vector<ChunkPosition> TileProvider::getChunkPositions() const {
+		std::vector<ChunkPosition> out;
+		std::shared_lock lock(indexMutex);
+		out.reserve(chunks.size());
+		chunks.forEach([&](ChunkPosition chunk_position, const ChunkRecord &record) {
+			if (record.has(ChunkRecord::layerBit(Layer::Terrain)))
+				out.push_back(chunk_position);
+		});
+		return out;
+	}
+
+	std::vector<std::pair<ChunkPosition, uint64_t>> TileProvider::getUnsavedChunks(bool all) const {
+		std::vector<std::pair<ChunkPosition, uint64_t>> out;
+		std::shared_lock lock(indexMutex);
+		chunks.forEach([&](ChunkPosition chunk_position, const ChunkRecord &record) {
+			if (!record.has(ChunkRecord::layerBit(Layer::Terrain)))
+				return;
+			const uint64_t update_counter = record.updateCount.load();
+			if (all || record.savedCount.load() != update_counter)
+				out.emplace_back(chunk_position, update_counter);
+		});
+		return out;
+	}
+
+	void TileProvider::markSaved(ChunkPosition chunk_position, uint64_t update_counter) {
+		if (ChunkRecord *record = findRecord(chunk_position))
+			record->savedCount = update_counter;
+	}
+
+	bool TileProvider::pageOut(ChunkPosition chunk_position) {
+		return pageOut(std::span(&chunk_position, 1)).empty() && isPagedOut(chunk_position);
+	}
+
+	std::vector<ChunkPosition> TileProvider::pageOut(std::span<const ChunkPosition> chunk_positions) {
+		std::vector<ChunkPosition> unsaved;
+		bool any_paged_out = false;
+
+		// Nothing can be holding a reference into the records' parts while every part lock is held.
+		auto part_locks = lockAllParts();
+		std::unique_lock lock(indexMutex);
+
+		for (const ChunkPosition chunk_position: chunk_positions) {
+			ChunkRecord *record = chunks.find(chunk_position);
+			if (record == nullptr)
+				continue;
+
+			const uint64_t update_count = record->updateCount.load();
+			if (record->savedCount.load() != update_count) {
+				unsaved.push_back(chunk_position);
+				continue;
+			}
+
+			std::unique_ptr<ChunkRecord> emptied = chunks.erase(chunk_position);
+			emptyRecord(*emptied);
+			pagedOut.try_emplace(chunk_position, update_count, std::move(emptied));
+			any_paged_out = true;
+		}
+
+		if (any_paged_out)
+			epoch = nextEpoch++;
+
+		return unsaved;
+	}
+
+	bool TileProvider::pageIn(ChunkPosition chunk_position, ChunkSet chunk_set) {
+		validateChunkSet(chunk_set);
+
+		{
+			// Threads that found the record before it was paged out may be waiting on its part locks.
+			auto part_locks = lockAllParts();
+			std::unique_lock lock(indexMutex);
+			auto iter = pagedOut.find(chunk_position);
+			if (iter == pagedOut.end())
+				return false;
+
+			const uint64_t update_count = iter->second.updateCount;
+			std::unique_ptr<ChunkRecord> emptied = std::move(iter->second.record);
+			pagedOut.erase(iter);
+
+			ChunkRecord &record = *chunks.tryInsert(chunk_position, std::move(emptied)).first;
+			for (size_t i = 0; i < LAYER_COUNT; ++i)
+				record.layers[i] = std::move(chunk_set.terrain[i]);
+			record.biomes = std::move(chunk_set.biomes);
+			record.paths = std::move(chunk_set.pathmap);
+			record.fluids = std::move(chunk_set.fluids);
+			record.updateCount = update_count;
+			record.savedCount = update_count;
+			record.mark(ChunkRecord::ALL_PRESENT);
+		}
+
+		pagedInQueue.push(chunk_position);
+		return true;
+	}
+
+	bool TileProvider::isPagedOut(ChunkPosition chunk_position) const {
+		std::shared_lock lock(indexMutex);
+		return pagedOut.contains(chunk_position);
+	}
+
+	bool TileProvider::requestPageIn(ChunkPosition chunk_position) const {
+		bool faulted = false;
+		{
+			std::shared_lock lock(indexMutex);
+			auto iter = pagedOut.find(chunk_position);
+			if (iter == pagedOut.end())
+				return false;
+			faulted = !iter->second.faulted.exchange(true);
+		}
+
+		if (faulted) {
+			++pageFaultCount;
+			pageFaultQueue.push(chunk_position);
+		}
+
+		return true;
+	}
+
+	void TileProvider::clearFault(ChunkPosition chunk_position) {
+		std::shared_lock lock(indexMutex);
+		if (auto iter = pagedOut.find(chunk_position); iter != pagedOut.end())
+			iter->second.faulted = false;
+	}
+
+	TileProvider::CompactionStats TileProvider::compact(size_t max_records) {
+		CompactionStats stats;
+		std::vector<ChunkRecord *> cold;
+		std::vector<ChunkRecord *> unpacked;
+
+		{
+			std::shared_lock lock(indexMutex);
+			chunks.forEach([&](ChunkPosition, ChunkRecord &record) {
+				const uint64_t update_count = record.updateCount.load();
+				if (record.unpacked.exchange(false))
+					unpacked.push_back(&record);
+				else if (update_count == record.compactedCount && cold.size() < max_records && (record.present.load() & ~record.packed.load() & ChunkRecord::PACKABLE) != 0)
+					cold.push_back(&record);
+				record.compactedCount = update_count;
+			});
+		}
+
+		// Anything that was holding a reference into these has had a whole pass to let go of it.
+		retiredTiles.clear();
+		retiredBiomes.clear();
+		retiredFluids.clear();
+
+		for (size_t i = 0; i < LAYER_COUNT; ++i) {
+			packParts(chunkMutexes[i], static_cast<uint8_t>(1 << i), cold, unpacked, [i](ChunkRecord &record) {
+				return std::make_pair(&record.layers[i], &record.packedLayers[i]);
+			}, retiredTiles, stats);
+		}
+
+		packParts(biomeMutex, ChunkRecord::BIOMES_PRESENT, cold, unpacked, [](ChunkRecord &record) {
+			return std::make_pair(&record.biomes, &record.packedBiomes);
+		}, retiredBiomes, stats);
+
+		packParts(fluidMutex, ChunkRecord::FLUIDS_PRESENT, cold, unpacked, [](ChunkRecord &record) {
+			return std::make_pair(&record.fluids, &record.packedFluids);
+		}, retiredFluids, stats);
+
+		return stats;
+	}
+
+	size_t TileProvider::getResidentCount() const {
+		std::shared_lock lock(indexMutex);
+		return chunks.size();
+	}
+
+	size_t TileProvider::getPagedOutCount() const {
+		std::shared_lock lock(indexMutex);
+		return pagedOut.size();
+	}
+
+	ChunkRecord * TileProvider::findRecord(ChunkPosition chunk_position) const {
+		const uint64_t current_epoch = epoch.load(std::memory_order_acquire);
+
+		if (lastChunk.epoch == current_epoch && lastChunk.position == chunk_position)
+			return lastChunk.record;
+
+		ChunkRecord *record = nullptr;
+		bool faulted = false;
+		{
+			std::shared_lock lock(indexMutex);
+			record = chunks.find(chunk_position);
+			if (record == nullptr && !pagedOut.empty())
+				if (auto iter = pagedOut.find(chunk_position); iter != pagedOut.end())
+					faulted = !iter->second.faulted.exchange(true);
+		}
+
+		if (record != nullptr)
+			lastChunk = {current_epoch, chunk_position, record};
+
+		if (faulted) {
+			++pageFaultCount;
+			pageFaultQueue.push(chunk_position);
+		}
+
+		return record;
+	}
+
+	ChunkRecord & TileProvider::ensureRecord(ChunkPosition chunk_position) {
+		if (ChunkRecord *record = findRecord(chunk_position))
+			return *record;
+
+		// A fresh record in place of a paged-out chunk would replace it in storage at the next save.
+		if (isPagedOut(chunk_position)) {
+			std::optional<ChunkSet> chunk_set;
+			if (pageLoader)
+				chunk_set = pageLoader(chunk_position);
+			if (!chunk_set)
+				throw std::runtime_error("Couldn't page in chunk at position " + static_cast<std::string>(chunk_position));
+			pageIn(chunk_position, std::move(*chunk_set));
+			if (ChunkRecord *record = findRecord(chunk_position))
+				return *record;
+		}
+
+		std::unique_lock lock(indexMutex);
+		return *chunks.tryEmplace(chunk_position).first;
+	}
+
+	std::vector<std::unique_lock<std::shared_mutex>> TileProvider::lockAllParts() const {
+		std::vector<std::unique_lock<std::shared_mutex>> locks;
+		locks.reserve(LAYER_COUNT + 3);
+		for (std::shared_mutex &mutex: chunkMutexes)
+			locks.emplace_back(mutex);
+		locks.emplace_back(biomeMutex);
+		locks.emplace_back(pathMutex);
+		locks.emplace_back(fluidMutex);
+		return locks;
+	}
+
+	uint64_t TileProvider::bumpUnjournaled(ChunkRecord &record) {
+		std::unique_lock lock(record.journalMutex);
+		record.journal.reset();
+		return ++record.updateCount;
+	}
+
+	void TileProvider::ensureParts(ChunkPosition chunk_position, ChunkRecord &record, uint8_t bits) {
+		if (record.has(bits))
+			return;
+
+		// Initialization is rare, so it's serialized on the index lock rather than given a lock of its own.
+		std::unique_lock lock(indexMutex);
+		const uint8_t missing = bits & ~record.present.load(std::memory_order_acquire);
+
+		for (const Layer layer: allLayers)
+			if (missing & ChunkRecord::layerBit(layer))
+				initTileChunk(layer, record.layers[getIndex(layer)], chunk_position);
+
+		if (missing & ChunkRecord::BIOMES_PRESENT)
+			initBiomeChunk(record.biomes, chunk_position);
+
+		if (missing & ChunkRecord::PATHS_PRESENT)
+			initPathChunk(record.paths, chunk_position);
+
+		if (missing & ChunkRecord::FLUIDS_PRESENT)
+			initFluidChunk(record.fluids, chunk_position);
+
+		record.mark(missing);
+	}
+
+	void TileProvider::unpack(ChunkRecord &record, uint8_t bits) const {
+		const uint8_t packed = bits & record.packed.load(std::memory_order_acquire);
+		if (packed == 0)
+			return;
+
+		for (size_t i = 0; i < LAYER_COUNT; ++i) {
+			if (const uint8_t bit = static_cast<uint8_t>(1 << i); packed & bit) {
+				std::shared_lock lock(chunkMutexes[i]);
+				unpackPart(record, bit, record.layers[i], record.packedLayers[i]);
+			}
+		}
+
+		if (packed & ChunkRecord::BIOMES_PRESENT) {
+			std::shared_lock lock(biomeMutex);
+			unpackPart(record, ChunkRecord::BIOMES_PRESENT, record.biomes, record.packedBiomes);
+		}
+
+		if (packed & ChunkRecord::FLUIDS_PRESENT) {
+			std::shared_lock lock(fluidMutex);
+			unpackPart(record, ChunkRecord::FLUIDS_PRESENT, record.fluids, record.packedFluids);
+		}
+	}
+
+	void TileProvider::unpackLocked(ChunkRecord &record, uint8_t bits) {
+		const uint8_t packed = bits & record.packed.load(std::memory_order_acquire);
+		if (packed == 0)
+			return;
+
+		for (size_t i = 0; i < LAYER_COUNT; ++i)
+			if (const uint8_t bit = static_cast<uint8_t>(1 << i); packed & bit)
+				unpackPart(record, bit, record.layers[i], record.packedLayers[i]);
+
+		if (packed & ChunkRecord::BIOMES_PRESENT)
+			unpackPart(record, ChunkRecord::BIOMES_PRESENT, record.biomes, record.packedBiomes);
+
+		if (packed & ChunkRecord::FLUIDS_PRESENT)
+			unpackPart(record, ChunkRecord::FLUIDS_PRESENT, record.fluids, record.packedFluids);
+	}
+
+	TileChunk * TileProvider::findTileChunk(ChunkPosition chunk_position, Layer layer) const {
+		if (ChunkRecord *record = findRecord(chunk_position); record != nullptr && record->has(ChunkRecord::layerBit(layer))) {
+			unpack(*record, ChunkRecord::layerBit(layer));
+			return &record->layers[getIndex(layer)];
+		}
+		return nullptr;
+	}
+
 	void TileProvider::validateLayer(Layer layer) const {
 		if (static_cast<uint8_t>(layer) < static_cast<uint8_t>(Layer::Terrain) || LAYER_COUNT < static_cast<uint8_t>(layer))
 			throw std::out_of_range("Invalid layer: " + std::to_string(static_cast<uint8_t>(layer)));
@@ -547,31 +1114,37 @@ namespace Game3 {
 
 			nlohmann::json tile_array;
 			for (const auto layer: allLayers) {
-				std::shared_lock biome_lock(chunkMutexes[getIndex(layer)]);
-				for (auto &[position, chunk]: chunkMaps[getIndex(layer)]) {
-					auto chunk_lock = chunk.sharedLock();
-					tile_array.push_back(std::make_pair(std::make_tuple(getIndex(layer), position.x, position.y), compress(std::span(chunk.data(), chunk.size()))));
-				}
+				std::shared_lock layer_lock(chunkMutexes[getIndex(layer)]);
+				forEachChunk([&](ChunkPosition position, const ChunkRecord &record) {
+					if (!record.has(ChunkRecord::layerBit(layer)))
+						return;
+					const std::vector<TileID> tiles = copyPart(record, ChunkRecord::layerBit(layer), record.layers[getIndex(layer)], record.packedLayers[getIndex(layer)]);
+					tile_array.push_back(std::make_pair(std::make_tuple(getIndex(layer), position.x, position.y), compress(std::span(tiles.data(), tiles.size()))));
+				});
 			}
 			data.push_back(std::move(tile_array));
 
 			nlohmann::json biome_array;
 			{
 				std::shared_lock biome_lock(biomeMutex);
-				for (auto &[position, chunk]: biomeMap) {
-					auto chunk_lock = chunk.sharedLock();
-					biome_array.push_back(std::make_pair(std::make_pair(position.x, position.y), compress(std::span(chunk.data(), chunk.size()))));
-				}
+				forEachChunk([&](ChunkPosition position, const ChunkRecord &record) {
+					if (!record.has(ChunkRecord::BIOMES_PRESENT))
+						return;
+					const std::vector<BiomeType> biomes = copyPart(record, ChunkRecord::BIOMES_PRESENT, record.biomes, record.packedBiomes);
+					biome_array.push_back(std::make_pair(std::make_pair(position.x, position.y), compress(std::span(biomes.data(), biomes.size()))));
+				});
 			}
 			data.push_back(std::move(biome_array));
 
 			nlohmann::json path_array;
 			{
 				std::shared_lock path_lock(pathMutex);
-				for (auto &[position, chunk]: pathMap) {
-					auto chunk_lock = chunk.sharedLock();
-					path_array.push_back(std::make_pair(std::make_pair(position.x, position.y), compress(std::span(chunk.data(), chunk.size()))));
-				}
+				forEachChunk([&](ChunkPosition position, const ChunkRecord &record) {
+					if (!record.has(ChunkRecord::PATHS_PRESENT))
+						return;
+					auto chunk_lock = record.paths.sharedLock();
+					path_array.push_back(std::make_pair(std::make_pair(position.x, position.y), compress(std::span(record.paths.data(), record.paths.size()))));
+				});
 			}
 			data.push_back(std::move(path_array));
 
@@ -579,16 +1152,15 @@ namespace Game3 {
 			{
 				static_assert(sizeof(FluidLevel) == 2);
 				std::shared_lock fluid_lock(fluidMutex);
-				for (auto &[position, chunk]: fluidMap) {
+				forEachChunk([&](ChunkPosition position, const ChunkRecord &record) {
+					if (!record.has(ChunkRecord::FLUIDS_PRESENT))
+						return;
 					std::vector<FluidInt> packed;
-					{
-						auto chunk_lock = chunk.sharedLock();
-						packed.reserve(chunk.size());
-						for (const FluidTile &fluid_tile: chunk)
-							packed.emplace_back(fluid_tile);
-					}
+					packed.reserve(CHUNK_SIZE * CHUNK_SIZE);
+					for (const FluidTile &fluid_tile: copyPart(record, ChunkRecord::FLUIDS_PRESENT, record.fluids, record.packedFluids))
+						packed.emplace_back(fluid_tile);
 					fluid_array.push_back(std::make_pair(std::make_pair(position.x, position.y), compress(std::span(packed.data(), packed.size()))));
-				}
+				});
 			}
 			data.push_back(std::move(fluid_array));
 		}
@@ -604,21 +1176,27 @@ namespace Game3 {
 				const auto [layer, x, y] = item.at(0).get<std::tuple<size_t, int32_t, int32_t>>();
 				static_assert(sizeof(TileID) == 2);
 				const auto compressed = item.at(1).get<std::vector<uint8_t>>();
-				chunkMaps[layer][ChunkPosition{x, y}] = decompress16(std::span(compressed.data(), compressed.size()));
+				ChunkRecord &record = ensureRecord(ChunkPosition{x, y});
+				record.layers.at(layer) = decompress16(std::span(compressed.data(), compressed.size()));
+				record.mark(ChunkRecord::layerBit(getLayer(layer + 1)));
 			}
 
 			for (const auto &item: data.at(1)) {
 				const auto [x, y] = item.at(0).get<std::pair<int32_t, int32_t>>();
 				static_assert(sizeof(BiomeType) == 2);
 				const auto compressed = item.at(1).get<std::vector<uint8_t>>();
-				biomeMap[ChunkPosition{x, y}] = decompress16(std::span(compressed.data(), compressed.size()));
+				ChunkRecord &record = ensureRecord(ChunkPosition{x, y});
+				record.biomes = decompress16(std::span(compressed.data(), compressed.size()));
+				record.mark(ChunkRecord::BIOMES_PRESENT);
 			}
 
 			for (const auto &item: data.at(2)) {
 				const auto [x, y] = item.at(0).get<std::pair<int32_t, int32_t>>();
 				static_assert(sizeof(PathChunk::value_type) == 1);
 				const auto compressed = item.at(1).get<std::vector<uint8_t>>();
-				pathMap[ChunkPosition{x, y}] = decompress8(std::span(compressed.data(), compressed.size()));
+				ChunkRecord &record = ensureRecord(ChunkPosition{x, y});
+				record.paths = decompress8(std::span(compressed.data(), compressed.size()));
+				record.mark(ChunkRecord::PATHS_PRESENT);
 			}
 
 			for (const auto &item: data.at(3)) {
@@ -626,7 +1204,8 @@ namespace Game3 {
 				static_assert(sizeof(FluidTile) == 6);
 				const auto compressed = item.at(1).get<std::vector<uint8_t>>();
 				const auto decompressed = decompress64(std::span(compressed.data(), compressed.size()));
-				auto &chunk = fluidMap[ChunkPosition{x, y}];
+				ChunkRecord &record = ensureRecord(ChunkPosition{x, y});
+				auto &chunk = record.fluids;
 				chunk.clear();
 				chunk.reserve(decompressed.size());
 				for (const auto tile: decompressed) {
@@ -634,6 +1213,7 @@ namespace Game3 {
 						(tile & 0xff) | ((tile >> 8) & 0xff), ((tile >> 16) & 0xff) | ((tile >> 24) & 0xff) | ((tile >> 32) & 0xff) | ((tile >> 40) & 0xff)
 					);
 				}
+				record.mark(ChunkRecord::FLUIDS_PRESENT);
 			}
 		}
 	}
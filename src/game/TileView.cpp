@@ -0,0 +1,102 @@
+#include "game/TileProvider.h"
+#include "game/TileView.h"
+
+namespace Game3 {
+	TileView::TileView(const TileProvider &provider_, const ChunkRange &range_, uint8_t parts_):
+		provider(provider_),
+		range(range_),
+		parts(parts_),
+		slots((range.bottomRight.x - range.topLeft.x + 1) * (range.bottomRight.y - range.topLeft.y + 1)) {
+		if (parts & TILES)
+			for (size_t i = 0; i < LAYER_COUNT; ++i)
+				layerLocks[i] = std::shared_lock(provider.chunkMutexes[i]);
+
+		if (parts & BIOMES)
+			biomeLock = std::shared_lock(provider.biomeMutex);
+
+		if (parts & PATHS)
+			pathLock = std::shared_lock(provider.pathMutex);
+
+		if (parts & FLUIDS)
+			fluidLock = std::shared_lock(provider.fluidMutex);
+	}
+
+	std::optional<TileID> TileView::tryTile(Layer layer, Position position) const {
+		assert(parts & TILES);
+		assert(layer != Layer::Invalid);
+		if (const ChunkRecord *record = getRecord(position.getChunk()); record != nullptr && record->has(ChunkRecord::layerBit(layer)))
+			return record->getTile(getIndex(layer), offset(position));
+		return std::nullopt;
+	}
+
+	std::optional<BiomeType> TileView::copyBiomeType(Position position) const {
+		assert(parts & BIOMES);
+		if (const ChunkRecord *record = getRecord(position.getChunk()); record != nullptr && record->has(ChunkRecord::BIOMES_PRESENT))
+			return record->getBiome(offset(position));
+		return std::nullopt;
+	}
+
+	std::optional<uint8_t> TileView::copyPathState(Position position) const {
+		assert(parts & PATHS);
+		if (const ChunkRecord *record = getRecord(position.getChunk()); record != nullptr && record->has(ChunkRecord::PATHS_PRESENT))
+			return record->paths[offset(position)];
+		return std::nullopt;
+	}
+
+	std::optional<FluidTile> TileView::copyFluidTile(Position position) const {
+		assert(parts & FLUIDS);
+		if (const ChunkRecord *record = getRecord(position.getChunk()); record != nullptr && record->has(ChunkRecord::FLUIDS_PRESENT))
+			return record->getFluid(offset(position));
+		return std::nullopt;
+	}
+
+	bool TileView::hasFluid(Position position, FluidLevel minimum) const {
+		if (auto fluid = copyFluidTile(position))
+			return minimum <= fluid->level;
+		return false;
+	}
+
+	const ChunkRecord * TileView::getRecord(ChunkPosition chunk_position) const {
+		if (lastRecord != nullptr && chunk_position == lastPosition)
+			return lastRecord;
+
+		if (!range.contains(chunk_position))
+			return nullptr;
+
+		const size_t width = range.bottomRight.x - range.topLeft.x + 1;
+		Slot &slot = slots[(chunk_position.y - range.topLeft.y) * width + (chunk_position.x - range.topLeft.x)];
+
+		if (!slot.resolved) {
+			slot.record = pin(chunk_position);
+			slot.resolved = true;
+		}
+
+		if (slot.record != nullptr) {
+			lastPosition = chunk_position;
+			lastRecord = slot.record;
+		}
+
+		return slot.record;
+	}
+
+	const ChunkRecord * TileView::pin(ChunkPosition chunk_position) const {
+		const ChunkRecord *record = provider.findRecord(chunk_position);
+		if (record == nullptr)
+			return nullptr;
+
+		if (parts & TILES)
+			for (const TileChunk &chunk: record->layers)
+				chunkLocks.emplace_back(chunk.sharedLock());
+
+		if (parts & BIOMES)
+			chunkLocks.emplace_back(record->biomes.sharedLock());
+
+		if (parts & PATHS)
+			chunkLocks.emplace_back(record->paths.sharedLock());
+
+		if (parts & FLUIDS)
+			chunkLocks.emplace_back(record->fluids.sharedLock());
+
+		return record;
+	}
+}
@@ -2,8 +2,12 @@
 #include "game/Game.h"
 #include "item/Item.h"
 #include "realm/Realm.h"
+#include "tile/Tile.h"
 #include "util/Crypto.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace Game3 {
 	Tileset::Tileset(Identifier identifier_):
 		NamedRegisterable(std::move(identifier_)) {}
@@ -13,7 +17,7 @@ namespace Game3 {
 	}
 
 	bool Tileset::isLand(TileID id) const {
-		return isLand(names.at(id));
+		return (getFlags(id) & LandFlag) != 0;
 	}
 
 	bool Tileset::isWalkable(const Identifier &id) const {
@@ -21,7 +25,7 @@ namespace Game3 {
 	}
 
 	bool Tileset::isWalkable(TileID id) const {
-		return isWalkable(names.at(id));
+		return (getFlags(id) & WalkableFlag) != 0;
 	}
 
 	bool Tileset::isSolid(const Identifier &id) const {
@@ -29,9 +33,10 @@ namespace Game3 {
 	}
 
 	bool Tileset::isSolid(TileID id) const {
-		return isSolid(names.at(id));
+		return (getFlags(id) & SolidFlag) != 0;
 	}
 
+
 	const Identifier & Tileset::getEmpty() const {
 		return empty;
 	}
@@ -50,18 +55,6 @@ namespace Game3 {
 		return bright;
 	}
 
-	std::vector<TileID> Tileset::getBrightIDs() {
-		if (brightCache)
-			return *brightCache;
-
-		std::vector<TileID> out;
-		out.reserve(bright.size());
-		for (const auto &tilename: bright)
-			out.push_back(ids.at(tilename));
-		brightCache = out;
-		return out;
-	}
-
 	std::string Tileset::getName() const {
 		return name;
 	}
@@ -91,29 +84,8 @@ namespace Game3 {
 		return false;
 	}
 
-	bool Tileset::isMarchable(TileID id) {
-		if (marchableCache.contains(id))
-			return true;
-
-		if (unmarchableCache.contains(id))
-			return false;
-
-		const auto &tilename = names.at(id);
-
-		if (marchable.contains(tilename)) {
-			marchableCache.insert(id);
-			return true;
-		}
-
-		for (const auto &category: inverseCategories.at(tilename)) {
-			if (marchable.contains(category)) {
-				marchableCache.insert(id);
-				return true;
-			}
-		}
-
-		unmarchableCache.insert(id);
-		return false;
+	bool Tileset::isMarchable(TileID id) const {
+		return (getFlags(id) & MarchableFlag) != 0;
 	}
 
 	bool Tileset::isCategoryMarchable(const Identifier &category) const {
@@ -127,20 +99,15 @@ namespace Game3 {
 	}
 
 	void Tileset::clearCache() {
-		marchableCache.clear();
-		unmarchableCache.clear();
-		brightCache.reset();
+		buildTables();
 	}
 
 	const std::unordered_set<Identifier> & Tileset::getCategories(const Identifier &tilename) const {
 		return inverseCategories.at(tilename);
 	}
 
-	const std::unordered_set<TileID> Tileset::getCategoryIDs(const Identifier &category) const {
-		std::unordered_set<TileID> out;
-		for (const auto &tilename: categories.at(category))
-			out.insert((*this)[tilename]);
-		return out;
+	const std::unordered_set<TileID> & Tileset::getCategoryIDs(const Identifier &category) const {
+		return categoryIDs.at(category);
 	}
 
 	const std::unordered_set<Identifier> & Tileset::getTilesByCategory(const Identifier &category) const {
@@ -154,7 +121,16 @@ namespace Game3 {
 	}
 
 	bool Tileset::isInCategory(TileID tile_id, const Identifier &category) const {
-		return isInCategory((*this)[tile_id], category);
+		getFlags(tile_id);
+
+		if (auto iter = categoryBits.find(category); iter != categoryBits.end())
+			return tile_id < iter->second.size() && iter->second[tile_id];
+
+		// Categories without any tiles have no bits, but a name that isn't a category at all is probably a typo.
+		if (!categories.contains(category))
+			throw std::out_of_range("Unknown tile category: " + category.str());
+
+		return false;
 	}
 
 	bool Tileset::hasName(const Identifier &tilename) const {
@@ -196,6 +172,89 @@ namespace Game3 {
 		return uppers.contains(id);
 	}
 
+	void Tileset::buildTables() {
+		TileID max_id = 0;
+		for (const auto &[id, tilename]: names)
+			max_id = std::max(max_id, id);
+
+		tileFlags.assign(size_t(max_id) + 1, 0);
+		tileTable = nullptr;
+		categoryBits.clear();
+		categoryIDs.clear();
+
+		for (const auto &[id, tilename]: names) {
+			uint8_t flags = KnownFlag;
+
+			if (isLand(tilename))
+				flags |= LandFlag;
+
+			if (isWalkable(tilename))
+				flags |= WalkableFlag;
+
+			if (isSolid(tilename))
+				flags |= SolidFlag;
+
+			if (marchable.contains(tilename))
+				flags |= MarchableFlag;
+
+			if (auto iter = inverseCategories.find(tilename); iter != inverseCategories.end()) {
+				for (const Identifier &category: iter->second) {
+					if (marchable.contains(category))
+						flags |= MarchableFlag;
+
+					std::vector<bool> &bits = categoryBits[category];
+					bits.resize(tileFlags.size());
+					bits[id] = true;
+				}
+			}
+
+			tileFlags[id] = flags;
+		}
+
+		// Every ID of a tile with several variants (autotiles and tall tiles) maps to the same name, but categories only
+		// ever held the primary ID.
+		for (const auto &[category, tilenames]: categories) {
+			std::unordered_set<TileID> &category_ids = categoryIDs[category];
+			for (const Identifier &tilename: tilenames)
+				if (auto iter = ids.find(tilename); iter != ids.end())
+					category_ids.insert(iter->second);
+		}
+	}
+
+	std::shared_ptr<const TileTable> Tileset::getTileTable(Game &game) const {
+		const size_t registry_size = game.registry<TileRegistry>().size();
+
+		{
+			auto lock = tileTable.sharedLock();
+			if (tileTable && tileTable->registrySize == registry_size)
+				return tileTable;
+		}
+
+		auto lock = tileTable.uniqueLock();
+		if (tileTable && tileTable->registrySize == registry_size)
+			return tileTable;
+
+		auto table = std::make_shared<TileTable>();
+		table->registrySize = registry_size;
+		table->tiles.resize(tileFlags.size());
+		table->randomTicks.resize(tileFlags.size());
+
+		for (const auto &[id, tilename]: names) {
+			TilePtr tile = game.getTile(tilename);
+			table->randomTicks[id] = tile->hasRandomTick();
+			table->tiles[id] = std::move(tile);
+		}
+
+		tileTable.unsafeSet(table);
+		return table;
+	}
+
+	uint8_t Tileset::getFlags(TileID id) const {
+		if (tileFlags.size() <= id || (tileFlags[id] & KnownFlag) == 0)
+			throw std::out_of_range("Unknown tile ID: " + std::to_string(id));
+		return tileFlags[id];
+	}
+
 	const TileID & Tileset::operator[](const Identifier &tilename) const {
 		return ids.at(tilename);
 	}
@@ -21,7 +21,7 @@ namespace Game3 {
 		const auto &tileset = realm.getTileset();
 
 		if (realm.isPathable(position) && realm.middleEmpty(position))
-			if (!validGround || tileset.isInCategory(tileset[realm.getTile(Layer::Terrain, position)], validGround))
+			if (!validGround || tileset.isInCategory(realm.getTile(Layer::Terrain, position), validGround))
 				return plant(place.player->getInventory(0), slot, stack, place);
 
 		return false;
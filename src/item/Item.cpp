@@ -151,7 +151,10 @@ namespace Game3 {
 	bool ItemStack::canMerge(const ItemStack &other) const {
 		if (!item || !other.item)
 			return false;
-		return *item == *other.item && data == other.data;
+		// Items are shared from the registry, so the pointers usually settle it before the handles are compared.
+		if (item != other.item && item->identifier.getHandle() != other.item->identifier.getHandle())
+			return false;
+		return data == other.data;
 	}
 
 	Glib::RefPtr<Gdk::Pixbuf> ItemStack::getImage() const {
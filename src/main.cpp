@@ -40,6 +40,19 @@ namespace Game3 {
 	void damageTest(HitPoints weapon_damage, int defense, int variability, double attacker_luck, double defender_luck);
 	void voronoiTest();
 	void scriptEngineTest();
+	void queueBenchmark();
+	void threadPoolBenchmark();
+	void tileProviderBenchmark();
+	void pathfindingBenchmark();
+	void loadBenchmark(const std::filesystem::path &);
+	bool pagingTest();
+	bool tickWheelTest();
+	void framingBenchmark();
+	bool receiveBenchmark(const std::filesystem::path &);
+	bool receiveFuzz(const std::filesystem::path &, size_t iterations);
+	void interestBenchmark(size_t player_count, size_t updates_per_tick);
+	void tilesetBenchmark();
+	void identifierBenchmark();
 }
 
 int main(int argc, char **argv) {
@@ -220,6 +233,70 @@ int main(int argc, char **argv) {
 			return 0;
 		}
 
+		if (arg1 == "--queue-bench") {
+			Game3::queueBenchmark();
+			return 0;
+		}
+
+		if (arg1 == "--pool-bench") {
+			Game3::threadPoolBenchmark();
+			return 0;
+		}
+
+		if (arg1 == "--tile-bench") {
+			Game3::tileProviderBenchmark();
+			return 0;
+		}
+
+		if (arg1 == "--path-bench") {
+			Game3::pathfindingBenchmark();
+			return 0;
+		}
+
+		if (arg1 == "--load-benchmark" && argc == 3) {
+			Game3::loadBenchmark(argv[2]);
+			return 0;
+		}
+
+		if (arg1 == "--paging-test") {
+			return Game3::pagingTest()? 0 : 1;
+		}
+
+		if (arg1 == "--tick-wheel-test") {
+			return Game3::tickWheelTest()? 0 : 1;
+		}
+
+		if (arg1 == "--frame-bench") {
+			Game3::framingBenchmark();
+			return 0;
+		}
+
+		if (arg1 == "--receive-bench") {
+			return Game3::receiveBenchmark(argc < 3? std::filesystem::path{} : std::filesystem::path(argv[2]))? 0 : 1;
+		}
+
+		if (arg1 == "--tileset-bench") {
+			Game3::tilesetBenchmark();
+			return 0;
+		}
+
+		if (arg1 == "--identifier-bench") {
+			Game3::identifierBenchmark();
+			return 0;
+		}
+
+		if (arg1 == "--interest-bench") {
+			const size_t player_count = argc < 3? 100 : Game3::parseNumber<size_t>(argv[2]);
+			const size_t updates_per_tick = argc < 4? 1'000 : Game3::parseNumber<size_t>(argv[3]);
+			Game3::interestBenchmark(player_count, updates_per_tick);
+			return 0;
+		}
+
+		if (arg1 == "--receive-fuzz") {
+			const size_t iterations = argc < 4? 10'000 : Game3::parseNumber<size_t>(argv[3]);
+			return Game3::receiveFuzz(argc < 3? std::filesystem::path{} : std::filesystem::path(argv[2]), iterations)? 0 : 1;
+		}
+
 		if (arg1 == "--ore-tile" && argc == 5) {
 			std::cout << Game3::generateFlask(Game3::dataRoot / "resources" / "orebase.png", Game3::dataRoot / "resources" / "oremask.png", argv[2], argv[3], argv[4]);
 			return 0;
@@ -16,7 +16,7 @@
 
 namespace Game3 {
 	Buffer::Buffer(Buffer &&other):
-	bytes(std::move(other.bytes)), skip(other.skip), context(std::move(other.context)) {
+	bytes(std::move(other.bytes)), skip(other.skip), context(std::move(other.context)), untrusted(other.untrusted) {
 		other.skip = 0;
 	}
 
@@ -24,6 +24,7 @@ namespace Game3 {
 		bytes = std::move(other.bytes);
 		skip = other.skip;
 		context = std::move(other.context);
+		untrusted = other.untrusted;
 		other.skip = 0;
 		return *this;
 	}
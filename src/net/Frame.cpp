@@ -0,0 +1,115 @@
+#include "net/Buffer.h"
+#include "net/Frame.h"
+#include "packet/Packet.h"
+#include "util/Math.h"
+
+#include <cassert>
+#include <cstring>
+#include <format>
+
+namespace Game3 {
+	FramePool & FramePool::get() {
+		static FramePool *pool = new FramePool;
+		return *pool;
+	}
+
+	SharedFrame FramePool::frame(Game &game, const Packet &packet) {
+		auto [storage, pooled] = acquire();
+		const size_t capacity = storage->capacity();
+
+		Buffer buffer;
+		buffer.bytes = std::move(*storage);
+		buffer.bytes.resize(FRAME_HEADER_SIZE);
+		// The header is skipped so that the packet sees an empty buffer and size() is the payload size.
+		buffer.skip = FRAME_HEADER_SIZE;
+		packet.encode(game, buffer);
+		assert(buffer.size() < UINT32_MAX);
+		const auto size = toLittle(static_cast<uint32_t>(buffer.size()));
+		*storage = std::move(buffer.bytes);
+
+		const PacketID packet_id = toLittle(packet.getID());
+		std::memcpy(storage->data(), &packet_id, sizeof(packet_id));
+		std::memcpy(storage->data() + sizeof(packet_id), &size, sizeof(size));
+
+		Counters &packet_counters = countersFor(packet.getID());
+		++packet_counters.frames;
+		packet_counters.bytes += storage->size();
+		if (!pooled)
+			++packet_counters.allocations;
+		else if (storage->capacity() != capacity)
+			++packet_counters.reallocations;
+
+		return share(std::move(storage));
+	}
+
+	SharedFrame FramePool::copy(std::string_view bytes) {
+		auto [storage, pooled] = acquire();
+		storage->assign(bytes.begin(), bytes.end());
+
+		++rawCounters.frames;
+		rawCounters.bytes += bytes.size();
+		rawCounters.copiedBytes += bytes.size();
+		if (!pooled)
+			++rawCounters.allocations;
+
+		return share(std::move(storage));
+	}
+
+	const FramePool::Counters & FramePool::getCounters(PacketID packet_id) const {
+		return counters[std::min<size_t>(packet_id, MAX_COUNTED_ID)];
+	}
+
+	FramePool::Counters & FramePool::countersFor(PacketID packet_id) {
+		return counters[std::min<size_t>(packet_id, MAX_COUNTED_ID)];
+	}
+
+	std::string FramePool::summarize() const {
+		std::string out;
+
+		auto append = [&](std::string_view name, const Counters &packet_counters) {
+			if (packet_counters.frames == 0)
+				return;
+			out += std::format("{}: {} frames, {} bytes, {} allocations, {} reallocations, {} bytes copied\n", name,
+				packet_counters.frames.load(), packet_counters.bytes.load(), packet_counters.allocations.load(),
+				packet_counters.reallocations.load(), packet_counters.copiedBytes.load());
+		};
+
+		for (size_t packet_id = 0; packet_id <= MAX_COUNTED_ID; ++packet_id)
+			append(std::format("Packet {}", packet_id), counters[packet_id]);
+		append("Raw", rawCounters);
+
+		return out;
+	}
+
+	std::pair<std::unique_ptr<FrameBytes>, bool> FramePool::acquire() {
+		{
+			std::unique_lock lock(mutex);
+			if (!free.empty()) {
+				std::unique_ptr<FrameBytes> storage = std::move(free.back());
+				free.pop_back();
+				return {std::move(storage), true};
+			}
+		}
+
+		return {std::make_unique<FrameBytes>(), false};
+	}
+
+	SharedFrame FramePool::share(std::unique_ptr<FrameBytes> storage) {
+		return SharedFrame(storage.release(), [](FrameBytes *bytes) {
+			FramePool::get().release(bytes);
+		});
+	}
+
+	void FramePool::release(FrameBytes *bytes) {
+		if (bytes->capacity() <= MAX_POOLED_CAPACITY) {
+			bytes->clear();
+			std::unique_lock lock(mutex);
+			if (free.size() < MAX_FREE) {
+				free.emplace_back(bytes);
+				return;
+			}
+		}
+
+		delete bytes;
+	}
+}
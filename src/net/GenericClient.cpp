@@ -2,6 +2,8 @@
 #include "net/GenericClient.h"
 #include "net/Server.h"
 
+#include <algorithm>
+
 namespace Game3 {
 	GenericClient::GenericClient(Server &server_, std::string_view ip_, int id_, asio::ip::tcp::socket &&socket_):
 		server(server_),
@@ -25,10 +27,10 @@ namespace Game3 {
 		doHandshake();
 	}
 
-	void GenericClient::queue(std::string message) {
+	void GenericClient::queue(SharedFrame frame) {
 		{
 			auto lock = outbox.uniqueLock();
-			outbox.push_back(std::move(message));
+			outbox.push_back(std::move(frame));
 			if (1 < outbox.size())
 				return;
 		}
@@ -36,10 +38,29 @@ namespace Game3 {
 		write();
 	}
 
+	void GenericClient::queue(std::vector<SharedFrame> frames) {
+		if (frames.empty())
+			return;
+
+		{
+			auto lock = outbox.uniqueLock();
+			const bool idle = outbox.empty();
+			outbox.insert(outbox.end(), std::make_move_iterator(frames.begin()), std::make_move_iterator(frames.end()));
+			if (!idle)
+				return;
+		}
+
+		write();
+	}
+
 	void GenericClient::write() {
 		auto lock = outbox.uniqueLock();
-		const std::string &message = outbox.front();
-		asio::async_write(socket, asio::buffer(message), strand.wrap([shared = shared_from_this()](const asio::error_code &errc, size_t size) {
+		// Everything queued so far goes out in one write; the frames stay in the outbox until it completes.
+		inFlight = std::min(outbox.size(), MAX_GATHER);
+		gathered.clear();
+		for (size_t i = 0; i < inFlight; ++i)
+			gathered.emplace_back(asio::buffer(*outbox[i]));
+		asio::async_write(socket, gathered, strand.wrap([shared = shared_from_this()](const asio::error_code &errc, size_t size) {
 			shared->writeHandler(errc, size);
 		}));
 	}
@@ -48,7 +69,8 @@ namespace Game3 {
 		bool empty{};
 		{
 			auto lock = outbox.uniqueLock();
-			outbox.pop_front();
+			outbox.erase(outbox.begin(), outbox.begin() + inFlight);
+			inFlight = 0;
 			empty = outbox.empty();
 		}
 
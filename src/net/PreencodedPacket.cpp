@@ -0,0 +1,10 @@
+#include "net/PreencodedPacket.h"
+#include "packet/Packet.h"
+
+namespace Game3 {
+	PreencodedPacket::PreencodedPacket(Game &game, const Packet &packet):
+	packetID(packet.getID()) {
+		if (packet.valid)
+			frame = FramePool::get().frame(game, packet);
+	}
+}
@@ -19,76 +19,51 @@ namespace Game3 {
 		if (string.empty())
 			return;
 
-		std::stringstream ss;
-		for (const uint8_t byte: string)
-			ss << ' ' << std::hex << std::setfill('0') << std::setw(2) << std::right << static_cast<uint16_t>(byte) << std::dec;
-		auto str = std::string(string);
-		while (!str.empty() && (str.back() == '\r' || str.back() == '\n'))
-			str.pop_back();
-
-		headerBytes.insert(headerBytes.end(), string.begin(), string.end());
-
-		if (state == State::Begin) {
-			receiveBuffer.clear();
-			packetType = 0;
-			payloadSize = 0;
-
-			if (6 <= headerBytes.size()) {
-				packetType = headerBytes[0] | (static_cast<uint16_t>(headerBytes[1]) << 8);
-				payloadSize = headerBytes[2] | (static_cast<uint32_t>(headerBytes[3]) << 8) | (static_cast<uint32_t>(headerBytes[4]) << 16) | (static_cast<uint32_t>(headerBytes[5]) << 24);
-
-				if (payloadSize > 32768) {
-					WARN("Payload size of {} bytes for packet type {} is too large ({})", payloadSize, packetType, ip);
-					mock();
-					return;
-				}
-
-				headerBytes.erase(headerBytes.begin(), headerBytes.begin() + 6);
-				state = State::Data;
-			}
+		auto self = std::static_pointer_cast<RemoteClient>(shared_from_this());
+
+		try {
+			reader.feed(std::span(reinterpret_cast<const uint8_t *>(string.data()), string.size()), [&](PacketID packet_type, const PacketReader::Payload &payload) {
+				receivedPackets.push_back(decode(packet_type, payload));
+			});
+		} catch (const PacketError &err) {
+			WARN("{} ({})", err.what(), ip);
+			receivedPackets.clear();
+			reader.reset();
+			mock();
+			return;
 		}
 
-		if (state == State::Data) {
-			if (MAX_PACKET_SIZE < receiveBuffer.size() + headerBytes.size())
-				throw PacketError("Packet too large");
+		if (!receivedPackets.empty()) {
+			server.game->queuePackets(self, std::move(receivedPackets));
+			// Don't rely on the moved-from vector being empty.
+			receivedPackets.clear();
+		}
+	}
 
-			const size_t to_append = std::min(payloadSize - receiveBuffer.size(), headerBytes.size());
+	std::shared_ptr<Packet> RemoteClient::decode(PacketID packet_type, const PacketReader::Payload &payload) {
+		if (receiveBuffer.context.expired())
+			receiveBuffer.context = server.game;
 
-			receiveBuffer.append(headerBytes.begin(), headerBytes.begin() + to_append);
-			if (to_append == headerBytes.size())
-				headerBytes.clear();
-			else
-				headerBytes.erase(headerBytes.begin(), headerBytes.begin() + to_append);
-
-			if (payloadSize < receiveBuffer.size()) {
-				mock();
-				throw std::logic_error("Buffer grew too large");
-			}
-
-			if (payloadSize == receiveBuffer.size()) {
-				if (receiveBuffer.context.expired())
-					receiveBuffer.context = server.game;
-
-				auto packet = (*server.game->registry<PacketFactoryRegistry>()[packetType])();
-
-				try {
-					packet->decode(*server.game, receiveBuffer);
-				} catch (const std::exception &err) {
-					ERROR("Couldn't decode packet of type {}, size {}: {}", packetType, payloadSize, err.what());
-					mock();
-					return;
-				} catch (...) {
-					ERROR("Couldn't decode packet of type {}, size {}", packetType, payloadSize);
-					mock();
-					return;
-				}
-
-				assert(receiveBuffer.empty());
-				receiveBuffer.clear();
-				server.game->queuePacket(std::static_pointer_cast<RemoteClient>(shared_from_this()), packet);
-				state = State::Begin;
-			}
+		receiveBuffer.untrusted = true;
+
+		payload.copyTo(receiveBuffer.bytes);
+		receiveBuffer.skip = 0;
+
+		std::shared_ptr<Packet> packet;
+
+		try {
+			packet = (*server.game->registry<PacketFactoryRegistry>()[packet_type])();
+			packet->decode(*server.game, receiveBuffer);
+		} catch (const std::exception &err) {
+			throw PacketError(std::format("Couldn't decode packet of type {}, size {}: {}", packet_type, payload.size(), err.what()));
+		} catch (...) {
+			throw PacketError(std::format("Couldn't decode packet of type {}, size {}", packet_type, payload.size()));
 		}
+
+		if (!receiveBuffer.empty())
+			throw PacketError(std::format("Packet of type {} left {} of {} bytes undecoded", packet_type, receiveBuffer.size(), payload.size()));
+
+		return packet;
 	}
 
 	bool RemoteClient::send(const Packet &packet) {
@@ -102,19 +77,17 @@ namespace Game3 {
 			return false;
 		}
 
-		Buffer send_buffer;
-		packet.encode(*server.game, send_buffer);
-		assert(send_buffer.size() < UINT32_MAX);
-		const auto size = toLittle(static_cast<uint32_t>(send_buffer.size()));
-		const auto packet_id = toLittle(packet.getID());
-
-		std::span span = send_buffer.getSpan();
-		std::string to_send;
-		to_send.reserve(span.size_bytes() + sizeof(packet_id) + sizeof(size));
-		to_send.append(reinterpret_cast<const char *>(&packet_id), sizeof(packet_id));
-		to_send.append(reinterpret_cast<const char *>(&size), sizeof(size));
-		to_send.append(span.begin(), span.end());
-		send(to_send);
+		// Both kinds of packet go out the same way, so that neither can skip the send buffer.
+		return send(PreencodedPacket(*server.game, packet));
+	}
+
+	bool RemoteClient::send(const PreencodedPacket &packet) {
+		if (!packet) {
+			WARN("Dropping invalid preencoded packet with ID {}", packet.getID());
+			return false;
+		}
+
+		server.send(*this, packet.getFrame());
 		return true;
 	}
 
@@ -125,7 +98,10 @@ namespace Game3 {
 			return;
 
 		try {
-			realm.sendToOne(*this, chunk_position);
+			if (counter_threshold != 0)
+				realm.sendToOne(*this, chunk_position, counter_threshold - 1);
+			else
+				realm.sendToOne(*this, chunk_position);
 		} catch (const std::out_of_range &) {
 			if (!can_request)
 				throw;
@@ -133,6 +109,16 @@ namespace Game3 {
 		}
 	}
 
+	void RemoteClient::sendCachedChunk(Realm &realm, ChunkPosition chunk_position, uint64_t cached_digest) {
+		assert(server.game);
+
+		try {
+			realm.sendCachedToOne(*this, chunk_position, cached_digest);
+		} catch (const std::out_of_range &) {
+			realm.requestChunk(chunk_position, std::static_pointer_cast<RemoteClient>(shared_from_this()));
+		}
+	}
+
 	template <typename T>
 	requires (!std::derived_from<T, Packet>)
 	void RemoteClient::send(const T &value) {
@@ -146,15 +132,16 @@ namespace Game3 {
 	void RemoteClient::flushBuffer(bool force) {
 		if (!force && !sendBuffer.active())
 			return;
-		std::string moved_buffer;
+		std::vector<SharedFrame> frames;
 		{
 			auto buffer_lock = sendBuffer.uniqueLock();
-			if (sendBuffer.bytes.empty())
+			if (sendBuffer.frames.empty())
 				return;
-			moved_buffer = std::move(sendBuffer.bytes);
+			frames = std::move(sendBuffer.frames);
+			sendBuffer.frames.clear();
 		}
 		std::unique_lock network_lock(networkMutex);
-		server.send(*this, std::move(moved_buffer), true);
+		server.send(*this, std::move(frames));
 	}
 
 	void RemoteClient::stopBuffering() {
@@ -54,22 +54,41 @@ namespace Game3 {
 			onMessage(client, message);
 	}
 
-	void Server::send(RemoteClient &client, std::string message, bool force) {
+	void Server::send(RemoteClient &client, std::string_view message, bool force) {
 		if (message.empty())
 			return;
 
+		send(client, FramePool::get().copy(message), force);
+	}
+
+	void Server::send(RemoteClient &client, SharedFrame frame, bool force) {
+		if (!frame || frame->empty())
+			return;
+
 		if (!force && client.isBuffering()) {
 			SendBuffer &buffer = client.sendBuffer;
 			auto lock = buffer.uniqueLock();
-			buffer.bytes.insert(buffer.bytes.end(), message.begin(), message.end());
+			buffer.frames.push_back(std::move(frame));
 			return;
 		}
 
 		std::weak_ptr weak_client(std::static_pointer_cast<RemoteClient>(client.shared_from_this()));
 
-		client.strand.post([this, weak_client, message = std::move(message)]() mutable {
+		client.strand.post([weak_client, frame = std::move(frame)]() mutable {
+			if (std::shared_ptr<RemoteClient> client = weak_client.lock())
+				client->queue(std::move(frame));
+		});
+	}
+
+	void Server::send(RemoteClient &client, std::vector<SharedFrame> frames) {
+		if (frames.empty())
+			return;
+
+		std::weak_ptr weak_client(std::static_pointer_cast<RemoteClient>(client.shared_from_this()));
+
+		client.strand.post([weak_client, frames = std::move(frames)]() mutable {
 			if (std::shared_ptr<RemoteClient> client = weak_client.lock())
-				client->queue(std::move(message));
+				client->queue(std::move(frames));
 		});
 	}
 
@@ -269,7 +288,15 @@ namespace Game3 {
 		if (signal(SIGINT, +[](int) { running = false; stopCV.notify_all(); saveCV.notify_all(); }) == SIG_ERR)
 			throw std::runtime_error("Couldn't register SIGINT handler");
 
-		auto game = std::dynamic_pointer_cast<ServerGame>(Game::create(Side::Server, std::make_pair(global_server, size_t(8))));
+		// Realms are ticked in parallel on this many threads. Zero means they're ticked serially on the tick thread, which
+		// is the default until a server opts in with a .tick_threads file.
+		size_t tick_threads = 0;
+		if (std::filesystem::exists(".tick_threads")) {
+			tick_threads = parseNumber<size_t>(trim(readFile(".tick_threads")));
+			INFO("Ticking realms on \e[1m{}\e[22m thread(s)", tick_threads);
+		}
+
+		auto game = std::dynamic_pointer_cast<ServerGame>(Game::create(Side::Server, std::make_pair(global_server, tick_threads)));
 
 		global_server->onStop = [] {
 			running = false;
@@ -337,10 +364,10 @@ namespace Game3 {
 
 				if (running && save_period <= std::chrono::system_clock::now() - last_save) {
 					INFO_("Autosaving...");
-					game->tickingPaused = true;
-					game->getDatabase().writeAll();
-					game->tickingPaused = false;
-					INFO_("Autosaved.");
+					// The snapshot is captured between ticks and written in the background, which logs its statistics.
+					game->enqueue([](const TickArgs &args) {
+						args.game->toServer().getDatabase().snapshotAll();
+					});
 					last_save = std::chrono::system_clock::now();
 				}
 			}
@@ -0,0 +1,50 @@
+#include "game/ServerGame.h"
+#include "net/Buffer.h"
+#include "net/RemoteClient.h"
+#include "packet/CachedChunkRequestPacket.h"
+#include "packet/PacketError.h"
+
+namespace Game3 {
+	void CachedChunkRequestPacket::encode(Game &, Buffer &buffer) const {
+		std::vector<uint32_t> data;
+		data.reserve(4 * digests.size());
+
+		for (const auto &[chunk_position, digest]: digests) {
+			data.push_back(chunk_position.x);
+			data.push_back(chunk_position.y);
+			data.push_back(digest & 0xffffffff);
+			data.push_back((digest >> 32) & 0xffffffff);
+		}
+
+		buffer << realmID << data;
+	}
+
+	void CachedChunkRequestPacket::decode(Game &, Buffer &buffer) {
+		std::vector<uint32_t> data;
+
+		buffer >> realmID >> data;
+
+		if (data.empty())
+			throw PacketError("Empty CachedChunkRequestPacket");
+
+		if (data.size() % 4 != 0)
+			throw PacketError("Misshapen CachedChunkRequestPacket");
+
+		if (data.size() > 128)
+			throw PacketError("Excessively greedy CachedChunkRequestPacket");
+
+		digests.clear();
+		for (size_t i = 0; i < data.size(); i += 4) {
+			digests.emplace(
+				ChunkPosition{static_cast<int32_t>(data[i]), static_cast<int32_t>(data[i + 1])},
+				data[i + 2] | (static_cast<uint64_t>(data[i + 3]) << 32)
+			);
+		}
+	}
+
+	void CachedChunkRequestPacket::handle(const std::shared_ptr<ServerGame> &game, RemoteClient &client) {
+		RealmPtr realm = game->getRealm(realmID);
+		for (const auto &[chunk_position, digest]: digests)
+			client.sendCachedChunk(*realm, chunk_position, digest);
+	}
+}
@@ -0,0 +1,59 @@
+#include "game/ClientGame.h"
+#include "game/TileProvider.h"
+#include "net/LocalClient.h"
+#include "packet/ChunkDeltaPacket.h"
+#include "packet/ChunkRequestPacket.h"
+#include "packet/ChunkRuns.h"
+#include "realm/Realm.h"
+
+#include <algorithm>
+
+namespace Game3 {
+	ChunkDeltaPacket::ChunkDeltaPacket(RealmID realm_id, ChunkPosition chunk_position, uint64_t from_counter, uint64_t to_counter, std::span<const ChunkChange> changes):
+	realmID(realm_id), chunkPosition(chunk_position), fromCounter(from_counter), toCounter(to_counter) {
+		packChunkRuns(changes, tileRuns, fluidRuns);
+	}
+
+	void ChunkDeltaPacket::handle(const ClientGamePtr &game) {
+		RealmPtr realm = game->getRealm(realmID);
+		TileProvider &provider = realm->tileProvider;
+
+		if (!provider.contains(chunkPosition) || provider.getUpdateCounter(chunkPosition) != fromCounter) {
+			// Our copy has moved on since the request was sent, or it isn't the one the delta was made against.
+			if (provider.contains(chunkPosition) && toCounter <= provider.getUpdateCounter(chunkPosition))
+				return;
+			game->getClient()->send(ChunkRequestPacket(*realm, {chunkPosition}, true));
+			return;
+		}
+
+		// Validate everything before applying anything so that a bad packet can't leave the chunk half-updated.
+		validateChunkRuns(tileRuns, fluidRuns, "ChunkDeltaPacket");
+
+		for (size_t i = 0; i < tileRuns.size();) {
+			const uint16_t start = tileRuns[i + 1], count = tileRuns[i + 2];
+			TileChunk &chunk = provider.getTileChunk(static_cast<Layer>(tileRuns[i]), chunkPosition);
+			{
+				auto lock = chunk.uniqueLock();
+				std::copy_n(tileRuns.begin() + i + 3, count, chunk.begin() + start);
+			}
+			i += 3 + count;
+		}
+
+		if (!fluidRuns.empty()) {
+			FluidChunk &chunk = provider.getFluidChunk(chunkPosition);
+			auto lock = chunk.uniqueLock();
+			for (size_t i = 0; i < fluidRuns.size();) {
+				const uint64_t start = fluidRuns[i], count = fluidRuns[i + 1];
+				for (uint64_t j = 0; j < count; ++j)
+					chunk[start + j] = FluidTile(static_cast<FluidInt>(fluidRuns[i + 2 + j]));
+				i += 2 + count;
+			}
+		}
+
+		provider.setUpdateCounter(chunkPosition, toCounter);
+		game->cacheChunk(*realm, chunkPosition);
+
+		realm->queueReupload();
+		realm->queueStaticLightingTexture();
+	}
+}
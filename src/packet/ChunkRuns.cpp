@@ -0,0 +1,53 @@
+#include "packet/ChunkRuns.h"
+#include "packet/PacketError.h"
+
+#include <format>
+
+namespace Game3 {
+	void packChunkRuns(std::span<const ChunkChange> changes, std::vector<uint16_t> &tile_runs, std::vector<uint64_t> &fluid_runs) {
+		size_t i = 0;
+		while (i < changes.size()) {
+			// Extend the run for as long as the offsets stay consecutive within the same part.
+			size_t end = i + 1;
+			while (end < changes.size() && changes[end].part == changes[i].part && changes[end].index == changes[end - 1].index + 1)
+				++end;
+
+			if (changes[i].part == 0) {
+				fluid_runs.push_back(changes[i].index);
+				fluid_runs.push_back(end - i);
+				for (size_t j = i; j < end; ++j)
+					fluid_runs.push_back(changes[j].value);
+			} else {
+				tile_runs.push_back(changes[i].part);
+				tile_runs.push_back(changes[i].index);
+				tile_runs.push_back(static_cast<uint16_t>(end - i));
+				for (size_t j = i; j < end; ++j)
+					tile_runs.push_back(static_cast<TileID>(changes[j].value));
+			}
+
+			i = end;
+		}
+	}
+
+	void validateChunkRuns(const std::vector<uint16_t> &tile_runs, const std::vector<uint64_t> &fluid_runs, std::string_view packet_name) {
+		constexpr size_t TILE_COUNT = CHUNK_SIZE * CHUNK_SIZE;
+
+		for (size_t i = 0; i < tile_runs.size();) {
+			if (tile_runs.size() < i + 3)
+				throw PacketError(std::format("Truncated tile run in {}", packet_name));
+			const uint16_t layer = tile_runs[i], start = tile_runs[i + 1], count = tile_runs[i + 2];
+			if (layer < 1 || LAYER_COUNT < layer || TILE_COUNT < size_t(start) + count || tile_runs.size() < i + 3 + count)
+				throw PacketError(std::format("Invalid tile run in {}", packet_name));
+			i += 3 + count;
+		}
+
+		for (size_t i = 0; i < fluid_runs.size();) {
+			if (fluid_runs.size() < i + 2)
+				throw PacketError(std::format("Truncated fluid run in {}", packet_name));
+			const uint64_t start = fluid_runs[i], count = fluid_runs[i + 1];
+			if (TILE_COUNT < start || TILE_COUNT - start < count || fluid_runs.size() - i - 2 < count)
+				throw PacketError(std::format("Invalid fluid run in {}", packet_name));
+			i += 2 + count;
+		}
+	}
+}
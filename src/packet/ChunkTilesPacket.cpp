@@ -15,14 +15,11 @@ namespace Game3 {
 	realmID(realm.id), chunkPosition(chunk_position), updateCounter(update_counter) {
 		tiles.reserve(CHUNK_SIZE * CHUNK_SIZE * LAYER_COUNT);
 		for (const Layer layer: allLayers) {
-			const TileChunk &layer_tiles = realm.tileProvider.getTileChunk(layer, chunk_position);
-			auto lock = layer_tiles.sharedLock();
+			const std::vector<TileID> layer_tiles = realm.tileProvider.copyTileChunk(layer, chunk_position);
 			tiles.insert(tiles.end(), layer_tiles.begin(), layer_tiles.end());
 		}
 
-		const FluidChunk &fluid_chunk = realm.tileProvider.getFluidChunk(chunk_position);
-		auto lock = fluid_chunk.sharedLock();
-		fluids = fluid_chunk;
+		fluids = realm.tileProvider.copyFluidChunk(chunk_position);
 	}
 
 	ChunkTilesPacket::ChunkTilesPacket(Realm &realm, ChunkPosition chunk_position): ChunkTilesPacket(realm, chunk_position, 0) {
@@ -67,6 +64,7 @@ namespace Game3 {
 		provider.setUpdateCounter(chunkPosition, updateCounter);
 
 		game->chunkReceived(chunkPosition);
+		game->cacheChunk(*realm, chunkPosition);
 		realm->queueReupload();
 		realm->queueStaticLightingTexture();
 	}
@@ -0,0 +1,10 @@
+#include "game/ClientGame.h"
+#include "packet/ChunkUnchangedPacket.h"
+
+namespace Game3 {
+	void ChunkUnchangedPacket::handle(const ClientGamePtr &game) {
+		// Makes sure the realm exists before the cache is read on its behalf.
+		game->getRealm(realmID);
+		game->loadCachedChunk(realmID, chunkPosition, updateCounter, digest);
+	}
+}
@@ -8,5 +8,6 @@ namespace Game3 {
 		auto realm = game->getRealm(realmID);
 		realm->setFluid(position, fluidTile);
 		realm->queueReupload();
+		game->chunkChanged(realmID, position.getChunk());
 	}
 }
@@ -0,0 +1,75 @@
+#include "game/ClientGame.h"
+#include "packet/ChunkRuns.h"
+#include "packet/TileBatchPacket.h"
+#include "realm/Realm.h"
+#include "util/Zstd.h"
+
+namespace Game3 {
+	namespace {
+		/** Batches are compressed on the tick thread, so this is zstd's default level rather than its slow maximum. */
+		constexpr int COMPRESSION_LEVEL = 3;
+		/** No valid batch is bigger than every tile in a run of its own plus every fluid in one. */
+		constexpr size_t MAX_RUNS_SIZE = CHUNK_SIZE * CHUNK_SIZE * (LAYER_COUNT * 4 * sizeof(uint16_t) + 3 * sizeof(uint64_t)) + 64;
+	}
+
+	TileBatchPacket::TileBatchPacket(RealmID realm_id, ChunkPosition chunk_position, std::span<const ChunkChange> changes):
+	realmID(realm_id), chunkPosition(chunk_position) {
+		packChunkRuns(changes, tileRuns, fluidRuns);
+	}
+
+	void TileBatchPacket::encode(Game &, Buffer &buffer) const {
+		Buffer runs;
+		runs << tileRuns << fluidRuns;
+		const bool compressed = COMPRESSION_THRESHOLD < runs.bytes.size();
+		buffer << realmID << chunkPosition << compressed;
+		if (compressed)
+			buffer << compress(runs.getSpan(), COMPRESSION_LEVEL);
+		else
+			buffer << runs.bytes;
+	}
+
+	void TileBatchPacket::decode(Game &, Buffer &buffer) {
+		bool compressed{};
+		Buffer runs;
+		buffer >> realmID >> chunkPosition >> compressed >> runs.bytes;
+		if (compressed)
+			runs.bytes = decompress8(runs.getSpan(), MAX_RUNS_SIZE);
+		runs >> tileRuns >> fluidRuns;
+	}
+
+	void TileBatchPacket::handle(const ClientGamePtr &game) {
+		RealmPtr realm = game->getRealm(realmID);
+
+		validateChunkRuns(tileRuns, fluidRuns, "TileBatchPacket");
+
+		// The chunk cache has to hear about this even if the chunk is still being loaded from it.
+		game->chunkChanged(realmID, chunkPosition);
+
+		// A chunk we don't have yet will arrive whole, with these changes already in it.
+		if (!realm->tileProvider.contains(chunkPosition))
+			return;
+
+		const Position origin = chunkPosition.topLeft();
+		auto position = [&](uint64_t offset) {
+			return Position(origin.row + static_cast<Index>(offset / CHUNK_SIZE), origin.column + static_cast<Index>(offset % CHUNK_SIZE));
+		};
+
+		// Setting tiles one by one keeps the lighting and pathfinding side effects of individual updates.
+		for (size_t i = 0; i < tileRuns.size();) {
+			const Layer layer = static_cast<Layer>(tileRuns[i]);
+			const uint16_t start = tileRuns[i + 1], count = tileRuns[i + 2];
+			for (uint16_t j = 0; j < count; ++j)
+				realm->setTile(layer, position(start + j), tileRuns[i + 3 + j], true);
+			i += 3 + count;
+		}
+
+		for (size_t i = 0; i < fluidRuns.size();) {
+			const uint64_t start = fluidRuns[i], count = fluidRuns[i + 1];
+			for (uint64_t j = 0; j < count; ++j)
+				realm->setFluid(position(start + j), FluidTile(static_cast<FluidInt>(fluidRuns[i + 2 + j])));
+			i += 2 + count;
+		}
+
+		realm->queueReupload();
+	}
+}
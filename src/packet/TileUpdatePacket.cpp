@@ -8,5 +8,6 @@ namespace Game3 {
 		auto realm = game->getRealm(realmID);
 		realm->setTile(layer, position, tileID, true);
 		realm->queueReupload();
+		game->chunkChanged(realmID, position.getChunk());
 	}
 }
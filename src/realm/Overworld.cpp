@@ -9,6 +9,10 @@ namespace Game3 {
 		tileProvider.updateChunk(chunk_position);
 	}
 
+	void Overworld::generateChunks(const std::vector<ChunkPosition> &chunk_positions) {
+		WorldGen::generateOverworld(shared_from_this(), seed, worldgenParams, chunk_positions, false);
+	}
+
 	void Overworld::absorbJSON(const nlohmann::json &json, bool full_data) {
 		Realm::absorbJSON(json, full_data);
 		worldgenParams = json.at("worldgenParams");
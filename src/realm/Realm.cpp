@@ -8,13 +8,17 @@
 #include "game/Game.h"
 #include "game/InteractionSet.h"
 #include "game/ServerGame.h"
+#include "game/TileView.h"
 #include "graphics/RendererContext.h"
 #include "graphics/SpriteRenderer.h"
 #include "graphics/TextRenderer.h"
 #include "graphics/Tileset.h"
 #include "net/RemoteClient.h"
+#include "packet/ChunkDeltaPacket.h"
+#include "packet/ChunkUnchangedPacket.h"
 #include "packet/ErrorPacket.h"
 #include "packet/InteractPacket.h"
+#include "packet/TileBatchPacket.h"
 #include "realm/Realm.h"
 #include "realm/RealmFactory.h"
 #include "threading/ThreadContext.h"
@@ -24,7 +28,10 @@
 #include "util/Cast.h"
 #include "util/Timer.h"
 #include "util/Util.h"
+#include "worldgen/WorldGen.h"
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <thread>
 #include <unordered_set>
@@ -36,6 +43,18 @@ namespace Game3 {
 		details.tilesetName = json.at("tileset");
 	}
 
+	Realm::GenerationGuard::~GenerationGuard() {
+		auto iter = threadContext.generations.find(realm.get());
+		if (iter == threadContext.generations.end() || --iter->second.depth != 0)
+			return;
+
+		std::unordered_set<ChunkPosition> dirty_chunks = std::move(iter->second.dirtyChunks);
+		threadContext.generations.erase(iter);
+		// Generated tiles aren't journaled, so clients that had these chunks get them whole.
+		for (const ChunkPosition chunk_position: dirty_chunks)
+			realm->tileProvider.updateChunk(chunk_position);
+	}
+
 	Realm::Realm(const GamePtr &game): weakGame(game) {
 		if (game->getSide() == Side::Client) {
 			game->toClient().getWindow().queue([this] {
@@ -120,7 +139,7 @@ namespace Game3 {
 		id = json.at("id");
 		type = json.at("type");
 		seed = json.at("seed");
-		generatedChunks = json.at("generatedChunks");
+		generatedChunks = json.at("generatedChunks").get<std::unordered_set<ChunkPosition>>();
 		outdoors = json.at("outdoors");
 		tileProvider.clear();
 
@@ -376,6 +395,7 @@ namespace Game3 {
 	}
 
 	EntityPtr Realm::add(const EntityPtr &entity, const Position &position) {
+		assertTickOwner();
 		if (auto found = getEntity(entity->getGID()))
 			return found;
 		auto shared = shared_from_this();
@@ -395,23 +415,27 @@ namespace Game3 {
 		entity->firstTeleport = false;
 		attach(entity);
 		if (entity->isPlayer()) {
+			PlayerPtr player = safeDynamicCast<Player>(entity);
 			{
 				auto lock = players.uniqueLock();
-				players.emplace(safeDynamicCast<Player>(entity));
+				players.emplace(player);
 			}
 			recalculateVisibleChunks();
+			removeIncomingPlayer(player);
 		}
 		return entity;
 	}
 
 	TileEntityPtr Realm::add(const TileEntityPtr &tile_entity) {
+		assertTickOwner();
 		{
 			auto lock = tileEntities.sharedLock();
 			if (tileEntities.contains(tile_entity->position))
 				return nullptr;
 		}
 		tile_entity->setRealm(shared_from_this());
-		if (!tile_entity->initialized) {
+		// A staging realm's tile entities are initialized and announced once they're committed to the live realm.
+		if (!tile_entity->initialized && !staging) {
 			GamePtr game = getGame();
 			tile_entity->init(*game);
 		}
@@ -425,10 +449,15 @@ namespace Game3 {
 		}
 		attach(tile_entity);
 		if (tile_entity->solid) {
-			std::unique_lock<std::shared_mutex> path_lock;
-			tileProvider.findPathState(tile_entity->position.copyBase(), &path_lock) = 0;
+			const Position position = tile_entity->position.copyBase();
+			{
+				std::unique_lock<std::shared_mutex> path_lock;
+				tileProvider.findPathState(position, &path_lock) = 0;
+			}
+			pathGraph.invalidate(position);
 		}
-		tile_entity->onSpawn();
+		if (!staging)
+			tile_entity->onSpawn();
 		return tile_entity;
 	}
 
@@ -527,7 +556,7 @@ namespace Game3 {
 					}
 
 					std::uniform_int_distribution<int64_t> distribution{0, CHUNK_SIZE - 1};
-					Tileset &tileset = getTileset();
+					const auto tile_table = getTileset().getTileTable(*game);
 					auto shared = shared_from_this();
 
 #ifdef PROFILE_TICKS
@@ -537,8 +566,8 @@ namespace Game3 {
 						const Position position(chunk.y * CHUNK_SIZE + distribution(threadContext.rng), chunk.x * CHUNK_SIZE + distribution(threadContext.rng));
 
 						for (const Layer layer: mainLayers)
-							if (auto tile_id = tileProvider.tryTile(layer, position); tile_id && *tile_id != 0)
-								game->getTile(tileset[*tile_id])->randomTick({position, shared, nullptr});
+							if (auto tile_id = tileProvider.tryTile(layer, position); tile_id && *tile_id != 0 && tile_table->hasRandomTick(*tile_id))
+								(*tile_table)[*tile_id].randomTick({position, shared, nullptr});
 					}
 				}
 			}
@@ -566,41 +595,9 @@ namespace Game3 {
 			for (const auto &stolen: generalQueue.steal())
 				stolen();
 
-			if (!tileProvider.generationQueue.empty()) {
-				const auto chunk_position = tileProvider.generationQueue.take();
-				if (!generatedChunks.contains(chunk_position)) {
-					tileProvider.ensureAllChunks(chunk_position);
-					generateChunk(chunk_position);
-					generatedChunks.insert(chunk_position);
-					remakePathMap(chunk_position);
-					auto lock = chunkRequests.uniqueLock();
-					if (auto iter = chunkRequests.find(chunk_position); iter != chunkRequests.end()) {
-						std::unordered_set<std::shared_ptr<RemoteClient>> strong;
-						for (const auto &weak: iter->second)
-							if (auto locked = weak.lock())
-								strong.insert(locked);
-						sendToMany(strong, chunk_position);
-						chunkRequests.erase(iter);
-					}
-				}
-			} else {
-				auto lock = chunkRequests.uniqueLock();
-
-				if (!chunkRequests.empty()) {
-					auto iter = chunkRequests.begin();
-					const auto &[chunk_position, client_set] = *iter;
-
-					if (!generatedChunks.contains(chunk_position)) {
-						generateChunk(chunk_position);
-						generatedChunks.insert(chunk_position);
-						remakePathMap(chunk_position);
-					}
-
-					sendToMany(filterWeak(client_set), chunk_position);
-					chunkRequests.erase(iter);
-				}
-			}
-
+			tickPathfinding();
+			tickGeneration();
+			tickPaging();
 		} else {
 
 			auto player = getGame()->toClient().getPlayer();
@@ -994,6 +991,10 @@ namespace Game3 {
 	}
 
 	void Realm::queueAddition(const EntityPtr &entity, const Position &new_position) {
+		if (isServer() && entity->isPlayer()) {
+			auto lock = incomingPlayers.uniqueLock();
+			incomingPlayers.push_back(safeDynamicCast<Player>(entity));
+		}
 		entityAdditionQueue.emplace(entity, new_position);
 	}
 
@@ -1005,6 +1006,10 @@ namespace Game3 {
 		generalQueue.push(std::move(fn));
 	}
 
+	void Realm::queuePathfind(const EntityPtr &entity, const Position &goal, size_t loop_max, std::function<void(bool)> on_done) {
+		pathfindQueue.emplace(entity, goal, loop_max, std::move(on_done));
+	}
+
 	void Realm::absorb(const EntityPtr &entity, const Position &position) {
 		if (auto realm = entity->weakRealm.lock())
 			realm->remove(entity);
@@ -1019,8 +1024,10 @@ namespace Game3 {
 	}
 
 	void Realm::setTile(Layer layer, const Position &position, TileID tile_id, bool run_helper, TileUpdateContext context) {
+		assertTickOwner();
 		bool affected_lighting = false;
 		GamePtr game = getGame();
+		const ChunkChange change{static_cast<uint8_t>(layer), TileProvider::getOffset(position), tile_id};
 
 		{
 			std::unique_lock<std::shared_mutex> tile_lock;
@@ -1033,13 +1040,15 @@ namespace Game3 {
 					affected_lighting = tile_object->hasStaticLighting();
 
 			tile = tile_id;
+
+			// Bumped before the lock is released so that the chunk can't be paged out with the change unsaved.
+			if (isServer())
+				updateChunk(position.getChunk(), change);
 		}
 
 		if (isServer()) {
-			if (!isGenerating()) {
-				tileProvider.updateChunk(position.getChunk());
-				game->toServer().broadcastTileUpdate(id, layer, position, tile_id);
-			}
+			if (!isGenerating())
+				queueTileUpdate(position.getChunk(), change);
 			if (run_helper)
 				setLayerHelper(position.row, position.column, layer, context);
 		} else if (run_helper) {
@@ -1055,18 +1064,27 @@ namespace Game3 {
 	}
 
 	void Realm::setFluid(const Position &position, FluidTile tile) {
+		assertTickOwner();
+		bool fluid_flipped = false;
+		const ChunkChange change{0, TileProvider::getOffset(position), static_cast<FluidInt>(tile)};
 		{
 			std::unique_lock<std::shared_mutex> fluid_lock;
 			FluidTile &fluid = tileProvider.findFluid(position, &fluid_lock);
 			if (fluid == tile)
 				return;
+			// Pathfinding treats any fluid as impassable.
+			fluid_flipped = (fluid.level == 0) != (tile.level == 0);
 			fluid = tile;
-		}
 
-		if (isServer() && !isGenerating()) {
-			tileProvider.updateChunk(position.getChunk());
-			getGame()->toServer().broadcastFluidUpdate(id, position, tile);
+			if (isServer())
+				updateChunk(position.getChunk(), change);
 		}
+
+		if (fluid_flipped)
+			pathGraph.invalidate(position);
+
+		if (isServer() && !isGenerating())
+			queueTileUpdate(position.getChunk(), change);
 	}
 
 	void Realm::setFluid(const Position &position, const Identifier &fluidname, FluidLevel level, bool infinite) {
@@ -1147,8 +1165,11 @@ namespace Game3 {
 	}
 
 	void Realm::setPathable(const Position &position, bool pathable) {
-		std::unique_lock<std::shared_mutex> lock;
-		tileProvider.findPathState(position, &lock) = pathable;
+		{
+			std::unique_lock<std::shared_mutex> lock;
+			tileProvider.findPathState(position, &lock) = pathable;
+		}
+		pathGraph.invalidate(position);
 	}
 
 	void Realm::updateNeighbors(const Position &position, Layer layer, TileUpdateContext context) {
@@ -1158,7 +1179,7 @@ namespace Game3 {
 		++threadContext.updateNeighborsDepth;
 
 		GamePtr game = getGame();
-		TilesetPtr tileset = tileProvider.getTileset(*game);
+		const auto tile_table = tileProvider.getTileset(*game)->getTileTable(*game);
 		RealmPtr self = shared_from_this();
 
 		Place place{{}, self, nullptr};
@@ -1172,7 +1193,7 @@ namespace Game3 {
 
 					if (auto tile_id = tryTile(layer, offset_position)) {
 						place.position = offset_position;
-						if (game->getTile((*tileset)[*tile_id])->update(place, layer))
+						if ((*tile_table)[*tile_id].update(place, layer))
 							continue;
 					}
 
@@ -1250,16 +1271,32 @@ namespace Game3 {
 		return true;
 	}
 
+	bool Realm::isWalkable(const TileView &view, Position position, const Tileset &tileset) const {
+		for (const Layer layer: collidingLayers)
+			if (std::optional<TileID> tile = view.tryTile(layer, position); !tile || !tileset.isWalkable(*tile) || tileset.isSolid(*tile))
+				return false;
+		if (auto iter = tileEntities.find(position); iter != tileEntities.end() && iter->second->solid)
+			return false;
+		return true;
+	}
+
 	void Realm::setLayerHelper(Index row, Index column, Layer layer, TileUpdateContext context) {
 		if (isServer()) {
 			const auto &tileset = getTileset();
 			const Position position(row, column);
 
+			bool flipped = false;
 			{
+				const uint8_t walkable = isWalkable(row, column, tileset);
 				std::unique_lock<std::shared_mutex> path_lock;
-				tileProvider.findPathState(position, &path_lock) = isWalkable(row, column, tileset);
+				uint8_t &state = tileProvider.findPathState(position, &path_lock);
+				flipped = state != walkable;
+				state = walkable;
 			}
 
+			if (flipped)
+				pathGraph.invalidate(position);
+
 			updateNeighbors(position, layer, context);
 		} else if (isActive()) {
 			// queueStaticLightingTexture();
@@ -1287,11 +1324,15 @@ namespace Game3 {
 	}
 
 	void Realm::remakePathMap() {
-		const auto &tileset = getTileset();
-		for (auto &[chunk_position, path_chunk]: tileProvider.pathMap)
-			for (int64_t row = 0; row < CHUNK_SIZE; ++row)
-				for (int64_t column = 0; column < CHUNK_SIZE; ++column)
-					path_chunk[row * CHUNK_SIZE + column] = isWalkable(row, column, tileset);
+		// Remaking a chunk takes part locks, which can't be taken while forEachChunk holds the index lock.
+		std::vector<ChunkPosition> chunk_positions;
+		tileProvider.forEachChunk([&](ChunkPosition chunk_position, const ChunkRecord &record) {
+			if (record.has(ChunkRecord::PATHS_PRESENT))
+				chunk_positions.push_back(chunk_position);
+		});
+		for (const ChunkPosition chunk_position: chunk_positions)
+			remakePathMap(chunk_position);
+		pathGraph.clear();
 	}
 
 	void Realm::remakePathMap(const ChunkRange &range) {
@@ -1303,30 +1344,71 @@ namespace Game3 {
 	void Realm::remakePathMap(ChunkPosition position) {
 		Timer timer{"RemakePathMap"};
 		const auto &tileset = getTileset();
-		auto &path_chunk = tileProvider.getPathChunk(position);
-		auto lock = path_chunk.uniqueLock();
-		for (int64_t row = 0; row < CHUNK_SIZE; ++row)
-			for (int64_t column = 0; column < CHUNK_SIZE; ++column)
-				path_chunk[row * CHUNK_SIZE + column] = isWalkable(position.y * CHUNK_SIZE + row, position.x * CHUNK_SIZE + column, tileset);
+		std::array<uint8_t, CHUNK_SIZE * CHUNK_SIZE> walkable;
+		{
+			TileView view(tileProvider, ChunkRange(position), TileView::TILES);
+			auto tile_entities_lock = tileEntities.sharedLock();
+			for (int64_t row = 0; row < CHUNK_SIZE; ++row)
+				for (int64_t column = 0; column < CHUNK_SIZE; ++column)
+					walkable[row * CHUNK_SIZE + column] = isWalkable(view, {position.y * CHUNK_SIZE + row, position.x * CHUNK_SIZE + column}, tileset);
+		}
+		{
+			// Taken after the view is gone, since the view's tile locks come before the path lock.
+			auto &path_chunk = tileProvider.getPathChunk(position);
+			std::unique_lock path_lock(tileProvider.pathMutex);
+			auto lock = path_chunk.uniqueLock();
+			std::copy(walkable.begin(), walkable.end(), path_chunk.begin());
+		}
+		pathGraph.invalidate(position);
 	}
 
 	void Realm::remakePathMap(Position position) {
 		const auto &tileset = getTileset();
+		const uint8_t walkable = isWalkable(position.row, position.column, tileset);
 		auto &path_chunk = tileProvider.getPathChunk(position.getChunk());
-		auto lock = path_chunk.uniqueLock();
-		path_chunk[position.row * CHUNK_SIZE + position.column] = isWalkable(position.row, position.column, tileset);
+		{
+			auto lock = path_chunk.uniqueLock();
+			uint8_t &state = TileProvider::access(path_chunk, TileProvider::remainder(position.row), TileProvider::remainder(position.column));
+			if (state == walkable)
+				return;
+			state = walkable;
+		}
+		pathGraph.invalidate(position);
+	}
+
+	void Realm::updateChunk(ChunkPosition chunk_position, const ChunkChange &change) {
+		if (auto iter = threadContext.generations.find(this); iter != threadContext.generations.end())
+			iter->second.dirtyChunks.insert(chunk_position);
+		else
+			tileProvider.updateChunk(chunk_position, change);
 	}
 
 	void Realm::markGenerated(const ChunkRange &range) {
+		auto lock = generatedChunks.uniqueLock();
 		for (auto y = range.topLeft.y; y <= range.bottomRight.y; ++y)
 			for (auto x = range.topLeft.x; x <= range.bottomRight.x; ++x)
 				generatedChunks.emplace(x, y);
 	}
 
 	void Realm::markGenerated(ChunkPosition chunk_position) {
+		auto lock = generatedChunks.uniqueLock();
 		generatedChunks.insert(chunk_position);
 	}
 
+	bool Realm::isGenerated(ChunkPosition chunk_position) const {
+		auto lock = generatedChunks.sharedLock();
+		return generatedChunks.contains(chunk_position);
+	}
+
+	void Realm::generateChunks(const std::vector<ChunkPosition> &chunk_positions) {
+		for (const ChunkPosition chunk_position: chunk_positions) {
+			tileProvider.ensureAllChunks(chunk_position);
+			generateChunk(chunk_position);
+			markGenerated(chunk_position);
+			remakePathMap(chunk_position);
+		}
+	}
+
 	bool Realm::isVisible(const Position &position) {
 		const auto chunk_pos = position.getChunk();
 		auto lock = players.sharedLock();
@@ -1402,17 +1484,34 @@ namespace Game3 {
 	}
 
 	void Realm::addPlayer(const PlayerPtr &player) {
-		auto players_lock = players.uniqueLock();
-		players.insert(player);
-		recalculateVisibleChunks();
+		assertTickOwner();
+		{
+			auto players_lock = players.uniqueLock();
+			players.insert(player);
+			recalculateVisibleChunks();
+		}
+		removeIncomingPlayer(player);
+	}
+
+	void Realm::removeIncomingPlayer(const PlayerPtr &player) {
+		auto lock = incomingPlayers.uniqueLock();
+		std::erase_if(incomingPlayers, [&](const std::weak_ptr<Player> &weak_player) {
+			PlayerPtr incoming = weak_player.lock();
+			return !incoming || incoming == player;
+		});
 	}
 
 	void Realm::removePlayer(const PlayerPtr &player) {
+		assertTickOwner();
 		auto players_lock = players.uniqueLock();
 		players.erase(player);
 		if (players.empty()) {
-			auto lock = visibleChunks.uniqueLock();
-			visibleChunks.clear();
+			{
+				auto lock = visibleChunks.uniqueLock();
+				visibleChunks.clear();
+			}
+			auto lock = chunkSubscribers.uniqueLock();
+			chunkSubscribers.clear();
 		} else
 			recalculateVisibleChunks();
 	}
@@ -1542,12 +1641,18 @@ namespace Game3 {
 		try {
 			const auto [chunk_tiles, entity_packets, tile_entity_packets] = getChunkPackets(chunk_position);
 
+			// Encode everything once up front so that the chunk costs the same to serialize for any number of clients.
+			GamePtr game = getGame();
+			const PreencodedPacket encoded_tiles(*game, chunk_tiles);
+			const auto encoded_entities = PreencodedPacket::encodeAll(*game, entity_packets);
+			const auto encoded_tile_entities = PreencodedPacket::encodeAll(*game, tile_entity_packets);
+
 			for (const auto &client: clients) {
 				client->getPlayer()->notifyOfRealm(*this);
-				client->send(chunk_tiles);
-				for (const auto &packet: entity_packets)
+				client->send(encoded_tiles);
+				for (const auto &packet: encoded_entities)
 					client->send(packet);
-				for (const auto &packet: tile_entity_packets)
+				for (const auto &packet: encoded_tile_entities)
 					client->send(packet);
 			}
 		} catch (const std::out_of_range &) {
@@ -1570,16 +1675,128 @@ namespace Game3 {
 		}
 	}
 
+	void Realm::sendToOne(RemoteClient &client, ChunkPosition chunk_position, uint64_t client_counter) {
+		auto changes = tileProvider.getChangesSince(chunk_position, client_counter);
+		if (!changes) {
+			sendToOne(client, chunk_position);
+			return;
+		}
+
+		if (ServerPlayerPtr player = client.getPlayer()) {
+			const auto &[update_counter, chunk_changes] = *changes;
+			player->notifyOfRealm(*this);
+			client.send(ChunkDeltaPacket(id, chunk_position, client_counter, update_counter, chunk_changes));
+			Timer::count("ChunkDeltas", 1);
+			sendEntitiesToOne(client, chunk_position);
+		}
+	}
+
+	void Realm::sendCachedToOne(RemoteClient &client, ChunkPosition chunk_position, uint64_t cached_digest) {
+		// The counter is read first so that a change made while the digest is computed is sent again later rather than lost.
+		const uint64_t update_counter = tileProvider.getUpdateCounter(chunk_position);
+		if (TileProvider::computeDigest(tileProvider.copyTilesAndFluids(chunk_position), getTileset().getHash()) != cached_digest) {
+			sendToOne(client, chunk_position);
+			return;
+		}
+
+		if (ServerPlayerPtr player = client.getPlayer()) {
+			player->notifyOfRealm(*this);
+			client.send(ChunkUnchangedPacket(id, chunk_position, update_counter, cached_digest));
+			Timer::count("ChunkCacheConfirmations", 1);
+			sendEntitiesToOne(client, chunk_position);
+		}
+	}
+
+	void Realm::queueTileUpdate(ChunkPosition chunk_position, const ChunkChange &change) {
+		auto lock = pendingTileUpdates.uniqueLock();
+		pendingTileUpdates[chunk_position][{change.part, change.index}] = change.value;
+	}
+
+	void Realm::flushTileUpdates() {
+		decltype(pendingTileUpdates)::Base updates;
+		{
+			auto lock = pendingTileUpdates.uniqueLock();
+			if (pendingTileUpdates.empty())
+				return;
+			updates.swap(pendingTileUpdates);
+		}
+
+		ServerGame &game = getGame()->toServer();
+		RealmPtr shared = shared_from_this();
+		std::vector<ChunkChange> changes;
+
+		for (const auto &[chunk_position, chunk_updates]: updates) {
+			if (chunk_updates.size() == 1) {
+				// A lone change is smaller as the packet it used to be sent as.
+				const auto &[key, value] = *chunk_updates.begin();
+				const Position origin = chunk_position.topLeft();
+				const Position position(origin.row + key.second / CHUNK_SIZE, origin.column + key.second % CHUNK_SIZE);
+				if (key.first == 0)
+					game.broadcastFluidUpdate(id, position, FluidTile(static_cast<FluidInt>(value)));
+				else
+					game.broadcastTileUpdate(id, static_cast<Layer>(key.first), position, static_cast<TileID>(value));
+				continue;
+			}
+
+			changes.clear();
+			changes.reserve(chunk_updates.size());
+			for (const auto &[key, value]: chunk_updates)
+				changes.push_back(ChunkChange{key.first, key.second, value});
+
+			game.broadcast(Place{chunk_position.topLeft(), shared}, TileBatchPacket(id, chunk_position, changes));
+			Timer::count("TileBatches", 1);
+			Timer::count("TileBatchChanges", changes.size());
+		}
+	}
+
+	void Realm::sendEntitiesToOne(RemoteClient &client, ChunkPosition chunk_position) {
+		if (auto entities_ptr = getEntities(chunk_position)) {
+			auto lock = entities_ptr->sharedLock();
+			for (const auto &entity: *entities_ptr)
+				client.send(EntityPacket(entity));
+		}
+
+		if (auto tile_entities_ptr = getTileEntities(chunk_position)) {
+			auto lock = tile_entities_ptr->sharedLock();
+			for (const auto &tile_entity: *tile_entities_ptr)
+				client.send(TileEntityPacket(tile_entity));
+		}
+	}
+
 	void Realm::recalculateVisibleChunks() {
+		const bool track_subscribers = getSide() == Side::Server;
 		decltype(visibleChunks)::Base new_visible_chunks;
+		decltype(chunkSubscribers)::Base new_subscribers;
 		for (const auto &weak_player: players) {
 			if (auto player = weak_player.lock()) {
 				ChunkRange(player->getChunk()).iterate([&](ChunkPosition chunk_position) {
 					new_visible_chunks.insert(chunk_position);
+					if (track_subscribers)
+						new_subscribers[chunk_position].push_back(weak_player);
 				});
 			}
 		}
 		visibleChunks = std::move(new_visible_chunks);
+		if (track_subscribers)
+			chunkSubscribers = std::move(new_subscribers);
+	}
+
+	std::vector<PlayerPtr> Realm::getSubscribers(ChunkPosition chunk_position) const {
+		std::vector<PlayerPtr> out;
+		auto lock = chunkSubscribers.sharedLock();
+		if (auto iter = chunkSubscribers.find(chunk_position); iter != chunkSubscribers.end()) {
+			out.reserve(iter->second.size());
+			for (const std::weak_ptr<Player> &weak_player: iter->second)
+				if (PlayerPtr player = weak_player.lock())
+					out.push_back(std::move(player));
+		}
+		lock.unlock();
+
+		auto incoming_lock = incomingPlayers.sharedLock();
+		for (const std::weak_ptr<Player> &weak_player: incomingPlayers)
+			if (PlayerPtr player = weak_player.lock(); player && std::find(out.begin(), out.end(), player) == out.end())
+				out.push_back(std::move(player));
+		return out;
 	}
 
 	void Realm::queueReupload() {
@@ -1742,6 +1959,419 @@ namespace Game3 {
 		return !(5. <= hour && hour < 21.);
 	}
 
+	void Realm::tickPathfinding() {
+		std::vector<QueuedPathfind> queued = pathfindQueue.steal();
+		if (queued.empty())
+			return;
+
+		std::vector<EntityPtr> entities_to_move;
+		std::vector<std::function<void(bool)>> callbacks;
+		std::vector<PathRequest> requests;
+		entities_to_move.reserve(queued.size());
+		callbacks.reserve(queued.size());
+		requests.reserve(queued.size());
+
+		for (QueuedPathfind &pathfind: queued) {
+			if (EntityPtr entity = pathfind.entity.lock()) {
+				requests.push_back(PathRequest{entity->getPosition(), pathfind.goal, pathfind.loopMax, {}, false});
+				entities_to_move.push_back(std::move(entity));
+				callbacks.push_back(std::move(pathfind.onDone));
+			}
+		}
+
+		pathGraph.findPaths(requests);
+
+		for (size_t i = 0; i < requests.size(); ++i) {
+			const bool result = entities_to_move[i]->usePath(requests[i]);
+			if (callbacks[i])
+				callbacks[i](result);
+		}
+	}
+
+	void Realm::tickGeneration() {
+		for (GeneratedBatch &generated: generatedBatches.steal()) {
+			const std::vector<ChunkPosition> &batch = generated.chunkPositions;
+
+			if (generated.staging) {
+				commitGenerated(*generated.staging, batch);
+			} else {
+				// Chunks that failed to generate aren't tried again.
+				for (const ChunkPosition chunk_position: batch)
+					markGenerated(chunk_position);
+			}
+
+			const auto now = std::chrono::system_clock::now();
+
+			for (const ChunkPosition chunk_position: batch) {
+				chunksInGeneration.erase(chunk_position);
+
+				if (auto iter = generationRequestTimes.find(chunk_position); iter != generationRequestTimes.end()) {
+					const uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - iter->second).count();
+					generationStats.totalLatencyNanos += latency;
+					uint64_t max_latency = generationStats.maxLatencyNanos;
+					while (max_latency < latency && !generationStats.maxLatencyNanos.compare_exchange_weak(max_latency, latency));
+					generationRequestTimes.erase(iter);
+				}
+			}
+
+			generationStats.generated += batch.size();
+			generationStats.inFlight -= batch.size();
+		}
+
+		{
+			auto lock = chunkRequests.uniqueLock();
+			for (auto iter = chunkRequests.begin(); iter != chunkRequests.end();) {
+				const auto &[chunk_position, client_set] = *iter;
+				// Paged-out chunks are answered once they've been read back in.
+				if (chunksInGeneration.contains(chunk_position) || !isGenerated(chunk_position) || tileProvider.requestPageIn(chunk_position)) {
+					++iter;
+					continue;
+				}
+
+				sendToMany(filterWeak(client_set), chunk_position);
+				iter = chunkRequests.erase(iter);
+			}
+		}
+
+		if (!generationBusy)
+			startGenerationBatch();
+	}
+
+	void Realm::startGenerationBatch() {
+		std::vector<std::pair<int64_t, ChunkPosition>> candidates;
+		std::unordered_set<ChunkPosition> seen;
+
+		std::vector<ChunkPosition> player_chunks;
+		{
+			auto lock = players.sharedLock();
+			for (const auto &weak_player: players)
+				if (PlayerPtr player = weak_player.lock())
+					player_chunks.push_back(player->getChunk());
+		}
+
+		auto consider = [&](ChunkPosition chunk_position) {
+			if (chunksInGeneration.contains(chunk_position) || isGenerated(chunk_position) || !seen.insert(chunk_position).second)
+				return;
+
+			int64_t distance = player_chunks.empty()? 0 : INT64_MAX;
+			for (const ChunkPosition player_chunk: player_chunks)
+				distance = std::min<int64_t>(distance, std::max(std::abs(int64_t(player_chunk.x) - chunk_position.x), std::abs(int64_t(player_chunk.y) - chunk_position.y)));
+
+			candidates.emplace_back(distance, chunk_position);
+		};
+
+		for (const ChunkPosition chunk_position: tileProvider.generationQueue.steal())
+			consider(chunk_position);
+
+		{
+			auto lock = chunkRequests.sharedLock();
+			for (const auto &[chunk_position, client_set]: chunkRequests)
+				consider(chunk_position);
+		}
+
+		if (candidates.empty()) {
+			generationStats.queued = 0;
+			return;
+		}
+
+		const auto now = std::chrono::system_clock::now();
+		for (const auto &[distance, chunk_position]: candidates)
+			generationRequestTimes.try_emplace(chunk_position, now);
+
+		// Closest chunks first.
+		std::ranges::stable_sort(candidates, {}, &std::pair<int64_t, ChunkPosition>::first);
+
+		const size_t batch_size = std::min(candidates.size(), GENERATION_BATCH_SIZE);
+		std::vector<ChunkPosition> batch;
+		batch.reserve(batch_size);
+
+		for (size_t i = 0; i < candidates.size(); ++i) {
+			const ChunkPosition chunk_position = candidates[i].second;
+			if (i < batch_size) {
+				batch.push_back(chunk_position);
+				chunksInGeneration.insert(chunk_position);
+			} else {
+				tileProvider.generationQueue.push(chunk_position);
+			}
+		}
+
+		generationStats.queued = candidates.size() - batch_size;
+		generationStats.inFlight += batch_size;
+		++generationStats.batches;
+		generationBusy = true;
+
+		// Chunks are generated into a realm of their own and only committed to this one on the ticking thread, so that
+		// nothing sees them half-generated.
+		auto job = [self = shared_from_this(), staging_realm = makeStagingRealm(), batch = std::move(batch)](ThreadPool &, size_t) mutable {
+			try {
+				Timer timer{"GenerateChunkBatch"};
+
+				// Generation looks at the chunks around the ones it generates, so whichever of those exist are copied in.
+				std::unordered_set<ChunkPosition> neighbors;
+				for (const ChunkPosition chunk_position: batch) {
+					ChunkRange(chunk_position).iterate([&](ChunkPosition neighbor) {
+						neighbors.insert(neighbor);
+					});
+				}
+				for (const ChunkPosition chunk_position: batch)
+					neighbors.erase(chunk_position);
+
+				for (const ChunkPosition neighbor: neighbors) {
+					if (!self->isGenerated(neighbor))
+						continue;
+					try {
+						staging_realm->tileProvider.absorb(neighbor, self->tileProvider.getChunkSet(neighbor));
+					} catch (const std::out_of_range &) {
+						// Not resident.
+					}
+				}
+
+				staging_realm->generateChunks(batch);
+			} catch (const std::exception &err) {
+				ERROR("Couldn't generate chunk batch in realm {}: {}", self->id, err.what());
+				staging_realm.reset();
+			}
+
+			self->generatedBatches.push(GeneratedBatch{std::move(batch), std::move(staging_realm)});
+			self->generationBusy = false;
+		};
+
+		WorldGen::batchPool.start();
+		if (!WorldGen::batchPool.add(job))
+			job(WorldGen::batchPool, 0);
+	}
+
+	std::shared_ptr<Realm> Realm::makeStagingRealm() {
+		// Made afresh for every batch: the settings can change between batches and subclasses add their own.
+		nlohmann::json json;
+		toJSON(json, false);
+		json["generatedChunks"] = nlohmann::json::array();
+
+		RealmPtr out = fromJSON(getGame(), json, false);
+		out->staging = true;
+		return out;
+	}
+
+	void Realm::addInteriorRealm(const RealmPtr &realm) {
+		if (staging) {
+			auto lock = stagedRealms.uniqueLock();
+			stagedRealms.push_back(realm);
+			return;
+		}
+
+		getGame()->addRealm(realm);
+	}
+
+	void Realm::commitGenerated(Realm &staging_realm, const std::vector<ChunkPosition> &chunk_positions) {
+		Timer timer{"CommitGeneratedChunks"};
+		const std::unordered_set<ChunkPosition> committed(chunk_positions.begin(), chunk_positions.end());
+
+		std::vector<std::pair<ChunkPosition, ChunkSet>> chunk_sets;
+		chunk_sets.reserve(chunk_positions.size());
+		for (const ChunkPosition chunk_position: chunk_positions)
+			chunk_sets.emplace_back(chunk_position, staging_realm.tileProvider.getChunkSet(chunk_position));
+		tileProvider.absorb(std::move(chunk_sets));
+
+		for (const ChunkPosition chunk_position: chunk_positions) {
+			markGenerated(chunk_position);
+			pathGraph.invalidate(chunk_position);
+		}
+
+		std::vector<TileEntityPtr> tile_entities;
+		for (const ChunkPosition chunk_position: chunk_positions) {
+			if (auto set = staging_realm.getTileEntities(chunk_position)) {
+				auto lock = set->sharedLock();
+				tile_entities.insert(tile_entities.end(), set->begin(), set->end());
+			}
+		}
+
+		for (const TileEntityPtr &tile_entity: tile_entities)
+			add(tile_entity);
+
+		for (const auto &[entity, position]: staging_realm.entityInitializationQueue.steal())
+			if (committed.contains(position.getChunk()))
+				spawn(entity, position);
+
+		{
+			ServerGame &game = getGame()->toServer();
+			auto lock = staging_realm.stagedVillages.uniqueLock();
+			for (const VillagePtr &village: staging_realm.stagedVillages)
+				game.addVillage(village);
+		}
+
+		{
+			GamePtr game = getGame();
+			auto lock = staging_realm.stagedRealms.uniqueLock();
+			for (const RealmPtr &realm: staging_realm.stagedRealms)
+				game->addRealm(realm);
+		}
+
+		// Generation autotiled the edges of the neighboring chunks in its copies of them. This does it for real.
+		auto retile = [&](const Position &position) {
+			const ChunkPosition neighbor = position.getChunk();
+			if (committed.contains(neighbor) || !isGenerated(neighbor) || !tileProvider.contains(neighbor))
+				return;
+			for (const Layer layer: allLayers)
+				autotile(position, layer);
+		};
+
+		for (const ChunkPosition chunk_position: chunk_positions) {
+			const Position top_left = chunk_position.topLeft();
+			for (Index offset = -1; offset <= CHUNK_SIZE; ++offset) {
+				retile({top_left.row - 1, top_left.column + offset});
+				retile({top_left.row + CHUNK_SIZE, top_left.column + offset});
+			}
+			for (Index offset = 0; offset < CHUNK_SIZE; ++offset) {
+				retile({top_left.row + offset, top_left.column - 1});
+				retile({top_left.row + offset, top_left.column + CHUNK_SIZE});
+			}
+		}
+	}
+
+	void Realm::tickPaging() {
+		for (const ChunkPosition chunk_position: tileProvider.pagedInQueue.steal())
+			remakePathMap(chunk_position);
+
+		ServerGame &game = getGame()->toServer();
+
+		if (std::vector<ChunkPosition> faulted = tileProvider.pageFaultQueue.steal(); !faulted.empty()) {
+			auto job = [self = shared_from_this(), faulted = std::move(faulted)](ThreadPool &, size_t) {
+				GameDB &database = self->getGame()->toServer().getDatabase();
+				for (const ChunkPosition chunk_position: faulted) {
+					if (!self->tileProvider.isPagedOut(chunk_position))
+						continue;
+					try {
+						if (std::optional<ChunkSet> chunk_set = database.getChunk(self->id, chunk_position)) {
+							self->tileProvider.pageIn(chunk_position, std::move(*chunk_set));
+							continue;
+						}
+						ERROR("Paged-out chunk {} of realm {} is missing from the database", chunk_position, self->id);
+					} catch (const std::exception &err) {
+						ERROR("Couldn't page in chunk {} of realm {}: {}", chunk_position, self->id, err.what());
+					}
+					// The next access tries again.
+					self->tileProvider.clearFault(chunk_position);
+				}
+			};
+
+			ThreadPool &pool = game.getPagingPool();
+			if (!pool.add(job))
+				job(pool, 0);
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		if (now < nextPagingPass)
+			return;
+		nextPagingPass = now + PAGING_INTERVAL;
+
+		// Chunks that haven't changed since the last pass are packed whether or not paging is enabled.
+		{
+			Timer timer{"ChunkCompaction"};
+			const TileProvider::CompactionStats stats = tileProvider.compact(COMPACTION_BATCH_SIZE);
+			Timer::count("PackedChunkParts", stats.packed);
+			Timer::count("PackedChunkBytesSaved", stats.bytesBefore - stats.bytesAfter);
+		}
+
+		const ssize_t idle_seconds = game.getRule("chunkIdleTime").value_or(DEFAULT_CHUNK_IDLE_SECONDS);
+		if (idle_seconds <= 0)
+			return;
+
+		// Nothing is paged out before the first pass, so this is the only place the loader has to be set up.
+		if (!tileProvider.pageLoader) {
+			tileProvider.pageLoader = [this](ChunkPosition chunk_position) {
+				return getGame()->toServer().getDatabase().getChunk(id, chunk_position);
+			};
+		}
+
+		Timer timer{"PagingPass"};
+
+		ChunkPager::Settings settings;
+		settings.idleTime = std::chrono::seconds(idle_seconds);
+		// The chunkMemoryBudget rule is in MiB.
+		if (const ssize_t budget = game.getRule("chunkMemoryBudget").value_or(0); 0 < budget)
+			settings.budget = std::max<size_t>(1, static_cast<size_t>(budget) * 1024 * 1024 / ChunkPager::CHUNK_BYTES);
+
+		const size_t paged_out_before = tileProvider.getPagedOutCount();
+		std::vector<ChunkPosition> unsaved = tileProvider.pageOut(chunkPager.collect(getPinnedChunks(), settings, now));
+		const size_t paged_out = tileProvider.getPagedOutCount() - paged_out_before;
+
+		// These are paged out by a later pass once they've been written.
+		if (!unsaved.empty())
+			game.getDatabase().saveChunks(shared_from_this(), unsaved);
+
+		Timer::count("PagedOutChunks", paged_out);
+	}
+
+	std::unordered_set<ChunkPosition> Realm::getPinnedChunks() {
+		std::unordered_set<ChunkPosition> out;
+
+		// Generation reads and writes the neighbors of the chunks it generates too.
+		for (const ChunkPosition chunk_position: chunksInGeneration) {
+			ChunkRange(chunk_position).iterate([&](ChunkPosition neighbor) {
+				out.insert(neighbor);
+			});
+		}
+
+		{
+			auto lock = visibleChunks.sharedLock();
+			out.insert(visibleChunks.begin(), visibleChunks.end());
+		}
+
+		{
+			auto lock = tileEntitiesByChunk.sharedLock();
+			for (const auto &[chunk_position, set]: tileEntitiesByChunk) {
+				if (!set)
+					continue;
+				auto set_lock = set->sharedLock();
+				if (!set->empty())
+					out.insert(chunk_position);
+			}
+		}
+
+		// Entities that are moving or following a path keep the chunks they're in and about to walk through. Their paths
+		// are looked at after the chunk locks are released, since moving along a path takes those locks the other way round.
+		std::vector<EntityPtr> entities;
+		{
+			auto lock = entitiesByChunk.sharedLock();
+			for (const auto &[chunk_position, set]: entitiesByChunk) {
+				if (!set)
+					continue;
+				auto set_lock = set->sharedLock();
+				entities.insert(entities.end(), set->begin(), set->end());
+			}
+		}
+
+		for (const EntityPtr &entity: entities) {
+			Position position = entity->getPosition();
+			const std::list<Direction> path = entity->copyPath<std::list>();
+			if (path.empty() && entity->isOffsetZero())
+				continue;
+
+			ChunkRange(position.getChunk()).iterate([&](ChunkPosition neighbor) {
+				out.insert(neighbor);
+			});
+
+			for (const Direction direction: path) {
+				position += direction;
+				out.insert(position.getChunk());
+			}
+		}
+
+		{
+			auto lock = villages.sharedLock();
+			for (const VillagePtr &village: villages) {
+				const Position position = village->getPosition();
+				const VillageOptions &options = village->getOptions();
+				const Position far_corner(position.row + options.height + options.padding, position.column + options.width + options.padding);
+				ChunkRange(position.getChunk(), far_corner.getChunk()).iterate([&](ChunkPosition chunk_position) {
+					out.insert(chunk_position);
+				});
+			}
+		}
+
+		return out;
+	}
+
 	void Realm::initEntity(const EntityPtr &entity, const Position &position) {
 		GamePtr game = getGame();
 		entity->init(game);
@@ -0,0 +1,98 @@
+#include "game/Game.h"
+#include "net/Buffer.h"
+#include "net/Frame.h"
+#include "packet/ChunkTilesPacket.h"
+#include "packet/TileUpdatePacket.h"
+#include "util/Math.h"
+
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Game3 {
+	namespace {
+		/** How many packets are sent between flushes, like a client's send buffer during a tick. */
+		constexpr size_t BATCH_SIZE = 64;
+
+		/** What RemoteClient::send did before frames: encode into a Buffer, copy it after a header into a new string and
+		 *  append that to the send buffer's string. */
+		void legacySend(Game &game, const Packet &packet, std::string &send_buffer) {
+			Buffer buffer;
+			packet.encode(game, buffer);
+			const auto size = toLittle(static_cast<uint32_t>(buffer.size()));
+			const auto packet_id = toLittle(packet.getID());
+			std::span span = buffer.getSpan();
+			std::string framed;
+			framed.reserve(span.size_bytes() + sizeof(packet_id) + sizeof(size));
+			framed.append(reinterpret_cast<const char *>(&packet_id), sizeof(packet_id));
+			framed.append(reinterpret_cast<const char *>(&size), sizeof(size));
+			framed.append(span.begin(), span.end());
+			send_buffer.insert(send_buffer.end(), framed.begin(), framed.end());
+		}
+
+		struct Result {
+			double nanosecondsPerPacket = 0;
+			double megabytesPerSecond = 0;
+		};
+
+		template <typename F>
+		Result measure(size_t count, F &&send) {
+			size_t bytes = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < count; i += BATCH_SIZE)
+				bytes += send(std::min(BATCH_SIZE, count - i));
+			const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+			return {seconds.count() * 1e9 / count, bytes / seconds.count() / 1e6};
+		}
+
+		void compare(Game &game, const Packet &packet, size_t count) {
+			const Result legacy = measure(count, [&](size_t batch) {
+				std::string send_buffer;
+				for (size_t i = 0; i < batch; ++i)
+					legacySend(game, packet, send_buffer);
+				// The flush moved the string onward; its size stands in for the write.
+				return std::string(std::move(send_buffer)).size();
+			});
+
+			FramePool &pool = FramePool::get();
+			const FramePool::Counters &counters = pool.getCounters(packet.getID());
+			const size_t allocations_before = counters.allocations + counters.reallocations;
+			std::vector<SharedFrame> send_buffer;
+			send_buffer.reserve(BATCH_SIZE);
+
+			const Result framed = measure(count, [&](size_t batch) {
+				size_t bytes = 0;
+				for (size_t i = 0; i < batch; ++i) {
+					send_buffer.push_back(pool.frame(game, packet));
+					bytes += send_buffer.back()->size();
+				}
+				// Completing the write releases every frame back to the pool.
+				send_buffer.clear();
+				return bytes;
+			});
+
+			const size_t allocations = counters.allocations + counters.reallocations - allocations_before;
+			std::cout << std::format("Packet {:2}: legacy {:8.1f} ns/packet ({:8.1f} MB/s), framed {:8.1f} ns/packet ({:8.1f} MB/s), {} frame allocations for {} packets\n",
+				packet.getID(), legacy.nanosecondsPerPacket, legacy.megabytesPerSecond, framed.nanosecondsPerPacket, framed.megabytesPerSecond, allocations, count);
+		}
+	}
+
+	/** Compares the throughput of encoding and buffering packets the old way (a string per packet, appended to a string
+	 *  per flush) against pooled frames, for a small and a large packet. */
+	void framingBenchmark() {
+		auto game = Game::create(Side::Client, nullptr);
+
+		const TileUpdatePacket tile_update(1, Layer::Terrain, Position(12, 34), 56);
+		compare(*game, tile_update, 2'000'000);
+
+		std::vector<TileID> tiles(CHUNK_SIZE * CHUNK_SIZE * LAYER_COUNT);
+		for (size_t i = 0; i < tiles.size(); ++i)
+			tiles[i] = static_cast<TileID>(i % 37);
+		const ChunkTilesPacket chunk_tiles(1, ChunkPosition{3, 4}, 5, std::move(tiles), std::vector<FluidTile>(CHUNK_SIZE * CHUNK_SIZE));
+		compare(*game, chunk_tiles, 5'000);
+
+		std::cout << FramePool::get().summarize();
+	}
+}
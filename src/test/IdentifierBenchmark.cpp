@@ -0,0 +1,130 @@
+#include "game/Game.h"
+#include "game/ServerInventory.h"
+#include "item/Item.h"
+
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace Game3 {
+	namespace {
+		constexpr size_t LOOKUPS = 2'000'000;
+		constexpr Slot SLOT_COUNT = 40;
+		constexpr size_t COUNTS = 200'000;
+
+		/** Identifier as it was before interning: two strings, compared and ordered character by character. */
+		struct LegacyIdentifier {
+			std::string space;
+			std::string name;
+
+			LegacyIdentifier(const Identifier &identifier):
+				space(identifier.getSpace()), name(identifier.getName()) {}
+
+			bool operator==(const LegacyIdentifier &other) const {
+				return this == &other || (space == other.space && name == other.name);
+			}
+
+			bool operator<(const LegacyIdentifier &other) const {
+				if (space != other.space)
+					return space < other.space;
+				return name < other.name;
+			}
+		};
+
+		template <typename F>
+		double millionsPerSecond(size_t count, F &&function) {
+			size_t checksum = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < count; ++i)
+				checksum += function(i);
+			const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+			// Keeps the work from being optimized away.
+			static volatile size_t sink;
+			sink = checksum;
+			return count / seconds.count() / 1e6;
+		}
+	}
+
+	/** Times the real registry lookups and Inventory::count overloads, which compare interned identifiers. The string
+	 *  columns aren't the old code, which is gone; they're a model of it: the same lookups and slot scans over a
+	 *  two-string identifier that compares character by character, as Identifier did before interning. */
+	void identifierBenchmark() {
+		auto game = Game::create(Side::Client, nullptr);
+		const ItemRegistry &items = game->registry<ItemRegistry>();
+
+		std::vector<Identifier> identifiers;
+		std::vector<LegacyIdentifier> legacy_identifiers;
+		std::map<LegacyIdentifier, std::shared_ptr<Item>> legacy_items;
+		for (const auto &[identifier, item]: items) {
+			identifiers.push_back(identifier);
+			legacy_identifiers.emplace_back(identifier);
+			legacy_items.emplace(identifier, item);
+		}
+
+		std::mt19937_64 rng(42);
+		std::vector<size_t> queries(LOOKUPS);
+		for (size_t &query: queries)
+			query = rng() % identifiers.size();
+
+		const double legacy_lookup = millionsPerSecond(LOOKUPS, [&](size_t i) {
+			return legacy_items.find(legacy_identifiers[queries[i]])->second->maxCount;
+		});
+
+		const double lookup = millionsPerSecond(LOOKUPS, [&](size_t i) {
+			return items.maybe(identifiers[queries[i]])->maxCount;
+		});
+
+		// A full inventory of a dozen kinds of items, like a busy player's.
+		ServerInventory inventory(nullptr, SLOT_COUNT);
+		std::vector<std::pair<LegacyIdentifier, ItemCount>> legacy_slots;
+		for (Slot slot = 0; slot < SLOT_COUNT; ++slot) {
+			const size_t index = queries[slot % 12];
+			inventory.add(ItemStack::create(game, identifiers[index], 1), slot);
+			legacy_slots.emplace_back(legacy_identifiers[index], 1);
+		}
+
+		std::vector<ItemStackPtr> stacks;
+		for (const Identifier &identifier: identifiers)
+			stacks.push_back(ItemStack::create(game, identifier, 1));
+
+		const double legacy_count = millionsPerSecond(COUNTS, [&](size_t i) {
+			const LegacyIdentifier &wanted = legacy_identifiers[queries[i]];
+			ItemCount out = 0;
+			for (const auto &[identifier, count]: legacy_slots)
+				if (identifier == wanted)
+					out += count;
+			return out;
+		});
+
+		const double count = millionsPerSecond(COUNTS, [&](size_t i) {
+			return inventory.count(identifiers[queries[i]]);
+		});
+
+		// Counting by stack goes through ItemStack::canMerge, which also compares the stacks' data.
+		const nlohmann::json data;
+		const nlohmann::json other_data;
+		const double legacy_stack_count = millionsPerSecond(COUNTS, [&](size_t i) {
+			const LegacyIdentifier &wanted = legacy_identifiers[queries[i]];
+			ItemCount out = 0;
+			for (const auto &[identifier, count]: legacy_slots)
+				if (identifier == wanted && data == other_data)
+					out += count;
+			return out;
+		});
+
+		const double stack_count = millionsPerSecond(COUNTS, [&](size_t i) {
+			return inventory.count(stacks[queries[i]]);
+		});
+
+		std::cout << std::format("Registry lookups:  strings {:7.2f} M/s, interned {:7.2f} M/s ({:.2f}x)\n", legacy_lookup, lookup, lookup / legacy_lookup);
+		std::cout << std::format("count(ItemID):     strings {:7.2f} M/s, interned {:7.2f} M/s ({:.2f}x)\n", legacy_count, count, count / legacy_count);
+		std::cout << std::format("count(ItemStack):  strings {:7.2f} M/s, interned {:7.2f} M/s ({:.2f}x)\n", legacy_stack_count, stack_count, stack_count / legacy_stack_count);
+		std::cout << std::format("{} identifiers interned\n", IdentifierTable::get().size());
+	}
+}
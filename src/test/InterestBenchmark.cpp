@@ -0,0 +1,156 @@
+#include "entity/ServerPlayer.h"
+#include "game/ServerGame.h"
+#include "net/RemoteClient.h"
+#include "net/Server.h"
+#include "packet/TileUpdatePacket.h"
+#include "realm/Overworld.h"
+#include "realm/Realm.h"
+#include "util/FS.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+namespace Game3 {
+	namespace {
+		/** Players wander around a square of this many chunks on a side. */
+		constexpr ChunkPosition::IntType WORLD_CHUNKS = 64;
+		constexpr size_t TICK_COUNT = 200;
+
+		struct Result {
+			double seconds = 0;
+			size_t recalculations = 0;
+			size_t encodes = 0;
+			size_t deliveries = 0;
+		};
+
+		Position randomPosition(std::mt19937_64 &rng, ChunkPosition chunk) {
+			return {chunk.y * CHUNK_SIZE + static_cast<Index>(rng() % CHUNK_SIZE), chunk.x * CHUNK_SIZE + static_cast<Index>(rng() % CHUNK_SIZE)};
+		}
+	}
+
+	/** Broadcasts tile updates to a server's worth of players through ServerGame::broadcast, with players crossing into
+	 *  other chunks now and then, which has Realm::recalculateVisibleChunks rebuild the subscriber index. The baseline is
+	 *  the broadcast as it was before the index: Entity::canSee on every player and an encode per recipient. Both runs
+	 *  recalculate on every chunk crossing, as the server does. Clients are never connected; their send buffers are
+	 *  counted and emptied after every update. */
+	void interestBenchmark(size_t player_count, size_t updates_per_tick) {
+		if (player_count == 0) {
+			std::cout << "Need at least one player.\n";
+			return;
+		}
+
+		auto server = std::make_shared<Server>("::1", 40000, "private.crt", "private.key", readFile(".secret"), 2, 1024);
+		// Players are declared before the game so that they outlive it and skip persisting themselves.
+		std::vector<ServerPlayerPtr> players;
+		std::vector<std::shared_ptr<RemoteClient>> clients;
+		auto game = std::dynamic_pointer_cast<ServerGame>(Game::create(Side::Server, std::make_pair(server, size_t(1))));
+		server->game = game;
+
+		RealmPtr realm = Realm::create<Overworld>(game, 1, Overworld::ID(), "base:tileset/monomap", 0);
+		game->addRealm(realm);
+
+		std::mt19937_64 rng(42);
+		std::uniform_int_distribution<ChunkPosition::IntType> chunk_distribution(0, WORLD_CHUNKS - 1);
+
+		for (size_t i = 0; i < player_count; ++i) {
+			auto client = std::make_shared<RemoteClient>(*server, "::1", static_cast<int>(i), asio::ip::tcp::socket(server->context));
+			client->startBuffering();
+
+			ServerPlayerPtr player = ServerPlayer::create(game);
+			player->weakClient = client;
+			client->setPlayer(player);
+			player->setRealm(realm);
+			player->position = randomPosition(rng, {chunk_distribution(rng), chunk_distribution(rng)});
+
+			{
+				auto lock = game->players.uniqueLock();
+				game->players.insert(player);
+			}
+			realm->addPlayer(player);
+
+			players.push_back(std::move(player));
+			clients.push_back(std::move(client));
+		}
+
+		std::vector<Position> starting_positions;
+		for (const ServerPlayerPtr &player: players)
+			starting_positions.push_back(player->getPosition());
+
+		auto run = [&](bool indexed) {
+			std::mt19937_64 rng(42);
+
+			for (size_t i = 0; i < players.size(); ++i)
+				players[i]->position = starting_positions[i];
+			{
+				auto lock = realm->players.sharedLock();
+				realm->recalculateVisibleChunks();
+			}
+
+			std::unordered_set<const FrameBytes *> frames;
+			Result result;
+			const auto start = std::chrono::steady_clock::now();
+
+			for (size_t tick = 0; tick < TICK_COUNT; ++tick) {
+				// About one player in twenty crosses into another chunk each tick, as ServerPlayer::movedToNewChunk does.
+				for (const ServerPlayerPtr &player: players) {
+					if (rng() % 20 == 0) {
+						ChunkPosition chunk = player->getChunk();
+						chunk.x = std::clamp<ChunkPosition::IntType>(chunk.x + static_cast<ChunkPosition::IntType>(rng() % 3) - 1, 0, WORLD_CHUNKS - 1);
+						chunk.y = std::clamp<ChunkPosition::IntType>(chunk.y + static_cast<ChunkPosition::IntType>(rng() % 3) - 1, 0, WORLD_CHUNKS - 1);
+						player->position = randomPosition(rng, chunk);
+						auto lock = realm->players.sharedLock();
+						realm->recalculateVisibleChunks();
+						++result.recalculations;
+					}
+				}
+
+				for (size_t update = 0; update < updates_per_tick; ++update) {
+					// Machines are usually near someone, so updates land around a random player's chunk.
+					ChunkPosition near = players[rng() % players.size()]->getChunk();
+					near.x += static_cast<ChunkPosition::IntType>(rng() % 3) - 1;
+					near.y += static_cast<ChunkPosition::IntType>(rng() % 3) - 1;
+					const Position position = randomPosition(rng, near);
+					const TileUpdatePacket packet(realm->id, Layer::Submerged, position, static_cast<TileID>(update));
+
+					if (indexed) {
+						game->broadcast(Place{position, realm}, packet);
+					} else {
+						auto lock = game->players.sharedLock();
+						for (const ServerPlayerPtr &player: game->players)
+							if (player->canSee(realm->id, position))
+								if (std::shared_ptr<RemoteClient> client = player->weakClient.lock())
+									client->send(packet);
+					}
+
+					for (const std::shared_ptr<RemoteClient> &client: clients) {
+						auto lock = client->sendBuffer.uniqueLock();
+						for (const SharedFrame &frame: client->sendBuffer.frames)
+							frames.insert(frame.get());
+						result.deliveries += client->sendBuffer.frames.size();
+						client->sendBuffer.frames.clear();
+					}
+
+					result.encodes += frames.size();
+					frames.clear();
+				}
+			}
+
+			result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			return result;
+		};
+
+		const size_t total_updates = TICK_COUNT * updates_per_tick;
+
+		for (const bool indexed: {false, true}) {
+			const Result result = run(indexed);
+			std::cout << std::format("{:8}: {:8.1f} ns/update, {:6.2f} ms/tick, {} recalculations, {} encodes, {} deliveries\n",
+				indexed? "indexed" : "scan", result.seconds * 1e9 / total_updates, result.seconds * 1e3 / TICK_COUNT,
+				result.recalculations, result.encodes, result.deliveries);
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#include "data/GameDB.h"
+#include "game/ServerGame.h"
+#include "net/Server.h"
+#include "realm/Realm.h"
+#include "util/FS.h"
+#include "util/Timer.h"
+
+#include <chrono>
+#include <format>
+#include <iostream>
+
+#include <unistd.h>
+
+namespace Game3 {
+	/** Times GameDB::readAllRealms on a copy of the given world. Opening a database migrates its schema and switches it to
+	 *  WAL, so the original file is never opened. */
+	void loadBenchmark(const std::filesystem::path &path) {
+		if (!std::filesystem::exists(path)) {
+			std::cerr << std::format("Can't find {}\n", path.string());
+			return;
+		}
+
+		auto server = std::make_shared<Server>("::1", 40000, "private.crt", "private.key", readFile(".secret"), 2, 1024);
+		auto game = std::dynamic_pointer_cast<ServerGame>(Game::create(Side::Server, std::make_pair(server, size_t(1))));
+		server->game = game;
+
+		const std::filesystem::path copy = std::filesystem::temp_directory_path() / std::format("game3-load-benchmark-{}.db", getpid());
+		std::filesystem::copy_file(path, copy, std::filesystem::copy_options::overwrite_existing);
+		// Changes the server hasn't checkpointed yet live in the write-ahead log.
+		if (std::filesystem::path wal = path.string() + "-wal"; std::filesystem::exists(wal))
+			std::filesystem::copy_file(wal, copy.string() + "-wal", std::filesystem::copy_options::overwrite_existing);
+
+		game->openDatabase(copy);
+		const auto start = std::chrono::steady_clock::now();
+		game->getDatabase().readAllRealms();
+		const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+		size_t realms = 0;
+		size_t chunks = 0;
+		game->iterateRealms([&](const RealmPtr &realm) {
+			++realms;
+			chunks += realm->tileProvider.getChunkPositions().size();
+		});
+
+		std::cout << std::format("Loaded {} chunks in {} realms in {:.3f} s: {:.1f} chunks/s\n", chunks, realms, seconds.count(), chunks / seconds.count());
+		Timer::summary();
+		Timer::clear();
+		game->getDatabase().close();
+
+		for (const char *suffix: {"", "-wal", "-shm"})
+			std::filesystem::remove(copy.string() + suffix);
+	}
+}
@@ -0,0 +1,157 @@
+#include "data/ChunkCodec.h"
+#include "game/ChunkPager.h"
+#include "game/TileProvider.h"
+
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <unistd.h>
+
+namespace Game3 {
+	namespace {
+		/** In chunks. */
+		constexpr ChunkPosition::IntType MAP_SIZE = 200;
+		constexpr size_t TILE_COUNT = CHUNK_SIZE * CHUNK_SIZE;
+		/** How many chunks the pager may keep resident. */
+		constexpr size_t BUDGET = 256;
+		/** How much the resident set may grow over the course of the walk. Without paging, it would grow by gigabytes. */
+		constexpr size_t RSS_CAP = 128 * 1024 * 1024;
+
+		size_t getRSS() {
+			std::ifstream statm("/proc/self/statm");
+			size_t size = 0;
+			size_t resident = 0;
+			statm >> size >> resident;
+			return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		}
+
+		TileID generatedTile(ChunkPosition chunk_position, size_t layer, size_t index) {
+			if (layer != 0)
+				return index % 97 == 0? static_cast<TileID>(layer + 100) : 0;
+			return static_cast<TileID>((chunk_position.x * 31 + chunk_position.y * 17 + index / CHUNK_SIZE) % 50 + 1);
+		}
+
+		/** The tile the walker places in the first slot of every chunk it stands in. */
+		TileID editedTile(ChunkPosition chunk_position) {
+			return static_cast<TileID>(1000 + (chunk_position.x + chunk_position.y) % 1000);
+		}
+
+		ChunkSet generateChunk(ChunkPosition chunk_position) {
+			ChunkSet chunk_set;
+			for (size_t layer = 0; layer < LAYER_COUNT; ++layer) {
+				chunk_set.terrain[layer].resize(TILE_COUNT);
+				for (size_t index = 0; index < TILE_COUNT; ++index)
+					chunk_set.terrain[layer][index] = generatedTile(chunk_position, layer, index);
+			}
+			chunk_set.biomes.assign(TILE_COUNT, static_cast<BiomeType>((chunk_position.x + chunk_position.y) % 5));
+			chunk_set.fluids.assign(TILE_COUNT, FluidTile{});
+			chunk_set.pathmap.assign(TILE_COUNT, 1);
+			return chunk_set;
+		}
+	}
+
+	/** Walks back and forth across a MAP_SIZE x MAP_SIZE chunk map, generating chunks as they come into view and
+	 *  editing the one underfoot, while a ChunkPager pages out everything behind. The rows walked on the way back
+	 *  overlap the ones before them, so chunks are faulted back in along the way. */
+	bool pagingTest() {
+		TileProvider provider;
+		ChunkCodec codec;
+		ChunkPager pager(provider);
+		const ChunkPager::Settings settings{BUDGET, std::chrono::seconds(30)};
+		/** Stands in for the database. */
+		std::unordered_map<ChunkPosition, EncodedChunk> store;
+		std::unordered_set<ChunkPosition> generated;
+		std::unordered_set<ChunkPosition> edited;
+		size_t saves = 0;
+		size_t mismatches = 0;
+		size_t peak_resident = 0;
+
+		provider.pageLoader = [&](ChunkPosition chunk_position) -> std::optional<ChunkSet> {
+			if (auto iter = store.find(chunk_position); iter != store.end())
+				return codec.decode(iter->second.terrain, iter->second.biomes, iter->second.fluids);
+			return std::nullopt;
+		};
+
+		auto verify = [&](ChunkPosition chunk_position) {
+			const TileChunk &chunk = provider.getTileChunk(Layer::Terrain, chunk_position);
+			const TileID first = edited.contains(chunk_position)? editedTile(chunk_position) : generatedTile(chunk_position, 0, 0);
+			if (chunk[0] != first || chunk[TILE_COUNT - 1] != generatedTile(chunk_position, 0, TILE_COUNT - 1))
+				++mismatches;
+		};
+
+		const size_t baseline = getRSS();
+		size_t peak_rss = baseline;
+		ChunkPager::Clock::time_point now{};
+		const auto start = std::chrono::steady_clock::now();
+
+		for (ChunkPosition::IntType y = 0; y < MAP_SIZE; ++y) {
+			for (ChunkPosition::IntType step = 0; step < MAP_SIZE; ++step) {
+				const ChunkPosition player{y % 2 == 0? step : MAP_SIZE - 1 - step, y};
+				std::unordered_set<ChunkPosition> pinned;
+
+				ChunkRange(player).iterate([&](ChunkPosition chunk_position) {
+					if (chunk_position.x < 0 || MAP_SIZE <= chunk_position.x || chunk_position.y < 0 || MAP_SIZE <= chunk_position.y)
+						return;
+					pinned.insert(chunk_position);
+					if (generated.insert(chunk_position).second)
+						provider.absorb(chunk_position, generateChunk(chunk_position));
+					else
+						provider.tryTile(Layer::Terrain, Position(chunk_position.y * CHUNK_SIZE, chunk_position.x * CHUNK_SIZE));
+				});
+
+				// The server reads faulted chunks in on a background thread; here they're read in right away.
+				for (const ChunkPosition chunk_position: provider.pageFaultQueue.steal()) {
+					if (std::optional<ChunkSet> chunk_set = provider.pageLoader(chunk_position)) {
+						provider.pageIn(chunk_position, std::move(*chunk_set));
+						verify(chunk_position);
+					} else {
+						++mismatches;
+					}
+				}
+
+				provider.pagedInQueue.steal();
+
+				{
+					std::unique_lock<std::shared_mutex> lock;
+					provider.findTile(Layer::Terrain, Position(player.y * CHUNK_SIZE, player.x * CHUNK_SIZE), &lock) = editedTile(player);
+					provider.updateChunk(player);
+					edited.insert(player);
+				}
+
+				now += std::chrono::seconds(1);
+
+				for (const ChunkPosition chunk_position: provider.pageOut(pager.collect(pinned, settings, now))) {
+					const uint64_t update_counter = provider.getUpdateCounter(chunk_position);
+					store[chunk_position] = codec.encode(provider.getChunkSet(chunk_position));
+					provider.markSaved(chunk_position, update_counter);
+					provider.pageOut(chunk_position);
+					++saves;
+				}
+
+				peak_resident = std::max(peak_resident, provider.getResidentCount());
+				if (step % 20 == 0)
+					peak_rss = std::max(peak_rss, getRSS());
+			}
+		}
+
+		const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+		// Accessing paged-out chunks through getTileChunk loads them synchronously.
+		for (ChunkPosition::IntType y = 0; y < MAP_SIZE; y += 7)
+			for (ChunkPosition::IntType x = 0; x < MAP_SIZE; x += 7)
+				verify({x, y});
+
+		const size_t growth = peak_rss - baseline;
+		std::cout << std::format("Walked {}x{} chunks in {:.2f} s: {} generated, {} saved, {} page faults\n", MAP_SIZE, MAP_SIZE, seconds.count(), generated.size(), saves, provider.getPageFaultCount());
+		std::cout << std::format("Peak resident chunks: {} (budget {}), paged out at the end: {}\n", peak_resident, BUDGET, provider.getPagedOutCount());
+		std::cout << std::format("RSS growth: {:.1f} MiB (cap {} MiB), mismatched chunks: {}\n", growth / 1048576., RSS_CAP / 1048576, mismatches);
+		const bool passed = growth <= RSS_CAP && mismatches == 0;
+		std::cout << (passed? "\e[32mPASS\e[39m\n" : "\e[31mFAIL\e[39m\n");
+		return passed;
+	}
+}
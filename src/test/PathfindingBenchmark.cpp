@@ -0,0 +1,156 @@
+#include "algorithm/AStar.h"
+#include "algorithm/PathGraph.h"
+#include "game/TileProvider.h"
+#include "tools/Mazer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Game3 {
+	namespace {
+		/** In maze cells. Each cell is two tiles wide, so the maze covers about seven chunks on each side. */
+		constexpr size_t MAZE_SIZE = 224;
+		constexpr size_t SHORT_QUERIES = 2'000;
+		constexpr size_t LONG_QUERIES = 50;
+		constexpr size_t LOOP_MAX = 100'000;
+
+		/** The hash map A* that simpleAStar used before it switched to a dense grid. */
+		bool legacyAStar(const TileProvider &provider, const Position &start, const Position &goal, std::vector<Position> &path, size_t loop_max) {
+			using Element = std::pair<size_t, Position>;
+			std::priority_queue<Element, std::vector<Element>, std::greater<Element>> frontier;
+			std::unordered_map<Position, Position> moves;
+			std::unordered_map<Position, size_t> costs;
+			frontier.emplace(0, start);
+			moves[start] = start;
+			costs[start] = 0;
+
+			for (size_t loops = 0; loops < loop_max && !frontier.empty(); ++loops) {
+				const Position current = frontier.top().second;
+				frontier.pop();
+
+				if (current == goal) {
+					path.clear();
+					for (Position position = goal; position != start; position = moves.at(position))
+						path.push_back(position);
+					path.push_back(start);
+					std::reverse(path.begin(), path.end());
+					return true;
+				}
+
+				for (const Position next: {Position{current.row - 1, current.column}, Position{current.row, current.column - 1}, Position{current.row + 1, current.column}, Position{current.row, current.column + 1}}) {
+					auto state = provider.copyPathState(next);
+					if (!state || *state == 0)
+						continue;
+					if (auto fluid = provider.copyFluidTile(next); fluid && fluid->level != 0)
+						continue;
+					const size_t new_cost = costs[current] + 1;
+					if (!costs.contains(next) || new_cost < costs[next]) {
+						costs[next] = new_cost;
+						frontier.emplace(new_cost + next.taxiDistance(goal), next);
+						moves[next] = current;
+					}
+				}
+			}
+
+			return false;
+		}
+
+		template <typename F>
+		std::pair<double, size_t> microsecondsPerQuery(const std::vector<PathRequest> &queries, F &&function) {
+			size_t found = 0;
+			std::vector<Position> path;
+			const auto start = std::chrono::steady_clock::now();
+			for (const PathRequest &query: queries)
+				found += function(query.start, query.goal, path);
+			const auto end = std::chrono::steady_clock::now();
+			return {std::chrono::duration<double, std::micro>(end - start).count() / queries.size(), found};
+		}
+	}
+
+	void pathfindingBenchmark() {
+		TileProvider provider;
+		std::vector<Position> open;
+
+		const auto rows = Mazer({MAZE_SIZE, MAZE_SIZE}, 666, {1, 0}).getRows(false);
+		const ChunkRange range(ChunkPosition(0, 0), ChunkPosition(Position(rows.size() - 1, rows.front().size() - 1)));
+		range.iterate([&](ChunkPosition chunk_position) {
+			provider.ensureAllChunks(chunk_position);
+		});
+
+		for (size_t row = 0; row < rows.size(); ++row) {
+			for (size_t column = 0; column < rows[row].size(); ++column) {
+				const bool is_open = rows[row][column] == 0;
+				const Position position(row, column);
+				std::unique_lock<std::shared_mutex> lock;
+				provider.findPathState(position, &lock) = is_open;
+				if (is_open)
+					open.push_back(position);
+			}
+		}
+
+		std::default_random_engine rng(42);
+		std::uniform_int_distribution<size_t> pick(0, open.size() - 1);
+
+		std::vector<PathRequest> short_queries;
+		while (short_queries.size() < SHORT_QUERIES) {
+			const Position start = open[pick(rng)];
+			const Position goal = open[pick(rng)];
+			if (start != goal && start.taxiDistance(goal) <= PathGraph::LOCAL_DISTANCE / 2)
+				short_queries.push_back(PathRequest{start, goal, LOOP_MAX, {}, false});
+		}
+
+		std::vector<PathRequest> long_queries;
+		while (long_queries.size() < LONG_QUERIES) {
+			const Position start = open[pick(rng)];
+			const Position goal = open[pick(rng)];
+			if (static_cast<Index>(rows.size()) <= static_cast<Index>(start.taxiDistance(goal)))
+				long_queries.push_back(PathRequest{start, goal, LOOP_MAX, {}, false});
+		}
+
+		const auto [legacy_time, legacy_found] = microsecondsPerQuery(short_queries, [&](const Position &start, const Position &goal, std::vector<Position> &path) {
+			return legacyAStar(provider, start, goal, path, LOOP_MAX);
+		});
+
+		const auto [grid_time, grid_found] = microsecondsPerQuery(short_queries, [&](const Position &start, const Position &goal, std::vector<Position> &path) {
+			return simpleAStar(provider, start, goal, path, LOOP_MAX);
+		});
+
+		std::vector<PathRequest> batch = short_queries;
+		const auto batch_start = std::chrono::steady_clock::now();
+		simpleAStar(provider, batch);
+		const auto batch_end = std::chrono::steady_clock::now();
+		const double batch_time = std::chrono::duration<double, std::micro>(batch_end - batch_start).count() / batch.size();
+		const size_t batch_found = std::count_if(batch.begin(), batch.end(), [](const PathRequest &request) { return request.found; });
+
+		const auto [long_legacy_time, long_legacy_found] = microsecondsPerQuery(long_queries, [&](const Position &start, const Position &goal, std::vector<Position> &path) {
+			return legacyAStar(provider, start, goal, path, LOOP_MAX);
+		});
+
+		PathGraph graph(provider);
+
+		const auto [cold_time, cold_found] = microsecondsPerQuery(long_queries, [&](const Position &start, const Position &goal, std::vector<Position> &path) {
+			return graph.findPath(start, goal, path, LOOP_MAX);
+		});
+
+		const auto [warm_time, warm_found] = microsecondsPerQuery(long_queries, [&](const Position &start, const Position &goal, std::vector<Position> &path) {
+			return graph.findPath(start, goal, path, LOOP_MAX);
+		});
+
+		std::cout << std::format("Maze: {}x{} tiles, {} open\n", rows.size(), rows.front().size(), open.size());
+		std::cout << std::format("{:>24} {:>12} {:>8}\n", "", "us/path", "found");
+		std::cout << std::format("{:>24} {:>12.2f} {:>8}\n", "short, hash map A*", legacy_time, legacy_found);
+		std::cout << std::format("{:>24} {:>12.2f} {:>8}\n", "short, grid A*", grid_time, grid_found);
+		std::cout << std::format("{:>24} {:>12.2f} {:>8}\n", "short, grid A* batch", batch_time, batch_found);
+		std::cout << std::format("{:>24} {:>12.2f} {:>8}\n", "long, hash map A*", long_legacy_time, long_legacy_found);
+		std::cout << std::format("{:>24} {:>12.2f} {:>8}\n", "long, PathGraph cold", cold_time, cold_found);
+		std::cout << std::format("{:>24} {:>12.2f} {:>8}\n", "long, PathGraph cached", warm_time, warm_found);
+		std::cout << std::format("Path cache hit rate: {:.1f}%\n", graph.getCacheHitRate() * 100);
+	}
+}
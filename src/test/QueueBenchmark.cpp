@@ -0,0 +1,115 @@
+#include "threading/MPSCQueue.h"
+#include "threading/MTQueue.h"
+#include "threading/WorkStealingDeque.h"
+
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace Game3 {
+	namespace {
+		constexpr size_t ITEMS_PER_THREAD = 200'000;
+
+		/** Runs `producers` threads that each push ITEMS_PER_THREAD values while one consumer drains them.
+		 *  Returns the average number of nanoseconds per item. */
+		template <typename Q>
+		double benchmarkQueue(size_t producers) {
+			Q queue;
+			std::atomic_bool go = false;
+			std::vector<std::thread> threads;
+			threads.reserve(producers);
+
+			for (size_t i = 0; i < producers; ++i) {
+				threads.emplace_back([&] {
+					while (!go.load(std::memory_order_acquire));
+					for (size_t j = 0; j < ITEMS_PER_THREAD; ++j)
+						queue.push(j);
+				});
+			}
+
+			const size_t total = producers * ITEMS_PER_THREAD;
+			size_t consumed = 0;
+			size_t checksum = 0;
+
+			const auto start = std::chrono::steady_clock::now();
+			go = true;
+
+			while (consumed < total) {
+				if (auto value = queue.tryTake()) {
+					checksum += *value;
+					++consumed;
+				}
+			}
+
+			const auto end = std::chrono::steady_clock::now();
+
+			for (auto &thread: threads)
+				thread.join();
+
+			if (checksum != producers * (ITEMS_PER_THREAD * (ITEMS_PER_THREAD - 1) / 2))
+				std::cerr << "Checksum mismatch!\n";
+
+			return std::chrono::duration<double, std::nano>(end - start).count() / total;
+		}
+
+		/** One owner pushes everything and pops what it can while `thieves` threads steal.
+		 *  Returns the average number of nanoseconds per item. */
+		double benchmarkDeque(size_t thieves) {
+			WorkStealingDeque<size_t> deque;
+			std::atomic_bool go = false;
+			std::atomic_size_t stolen = 0;
+			std::atomic_size_t consumed = 0;
+			const size_t total = thieves * ITEMS_PER_THREAD;
+			std::vector<std::thread> threads;
+			threads.reserve(thieves);
+
+			for (size_t i = 0; i < thieves; ++i) {
+				threads.emplace_back([&] {
+					while (!go.load(std::memory_order_acquire));
+					size_t local = 0;
+					while (consumed.load(std::memory_order_relaxed) < total) {
+						if (deque.steal()) {
+							++local;
+							consumed.fetch_add(1, std::memory_order_relaxed);
+						}
+					}
+					stolen += local;
+				});
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+			go = true;
+
+			for (size_t i = 0; i < total; ++i) {
+				deque.push(i);
+				if (i % 4 == 0 && deque.pop())
+					consumed.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			while (consumed.load(std::memory_order_relaxed) < total)
+				if (deque.pop())
+					consumed.fetch_add(1, std::memory_order_relaxed);
+
+			const auto end = std::chrono::steady_clock::now();
+
+			for (auto &thread: threads)
+				thread.join();
+
+			return std::chrono::duration<double, std::nano>(end - start).count() / total;
+		}
+	}
+
+	void queueBenchmark() {
+		std::cout << std::format("{:>10} {:>16} {:>16} {:>16}\n", "Threads", "MTQueue ns/op", "MPSCQueue ns/op", "Deque ns/op");
+
+		for (const size_t threads: {1, 2, 4, 8, 16, 32}) {
+			const double mt = benchmarkQueue<MTQueue<size_t>>(threads);
+			const double mpsc = benchmarkQueue<MPSCQueue<size_t>>(threads);
+			const double deque = benchmarkDeque(threads);
+			std::cout << std::format("{:>10} {:>16.2f} {:>16.2f} {:>16.2f}\n", threads, mt, mpsc, deque);
+		}
+	}
+}
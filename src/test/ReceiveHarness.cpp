@@ -0,0 +1,185 @@
+#include "game/Game.h"
+#include "net/Buffer.h"
+#include "net/Frame.h"
+#include "net/PacketReader.h"
+#include "packet/CachedChunkRequestPacket.h"
+#include "packet/ChunkRequestPacket.h"
+#include "packet/ClickPacket.h"
+#include "packet/CommandPacket.h"
+#include "packet/MovePlayerPacket.h"
+#include "packet/PacketFactory.h"
+#include "util/FS.h"
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace Game3 {
+	namespace {
+		/** The same limit RemoteClient puts on client payloads. */
+		constexpr size_t MAX_PAYLOAD_SIZE = 32768;
+
+		/** A stream of the small packets clients send most, standing in for a recording when none is given. */
+		std::vector<uint8_t> synthesizeStream(Game &game, size_t packet_count) {
+			std::vector<uint8_t> stream;
+			FramePool &pool = FramePool::get();
+			std::mt19937_64 rng(42);
+
+			auto append = [&](const Packet &packet) {
+				const SharedFrame frame = pool.frame(game, packet);
+				stream.insert(stream.end(), frame->begin(), frame->end());
+			};
+
+			for (size_t i = 0; i < packet_count; ++i) {
+				const Position position(static_cast<Index>(rng() % 1000), static_cast<Index>(rng() % 1000));
+				switch (i % 5) {
+					case 0: append(MovePlayerPacket(position, Direction::Down)); break;
+					case 1: append(ClickPacket(position, 0.5f, 0.5f, Modifiers{})); break;
+					case 2: append(ChunkRequestPacket(1, std::set<ChunkRequest>{ChunkRequest(position.getChunk(), i)})); break;
+					case 3: append(CachedChunkRequestPacket(1, std::map<ChunkPosition, uint64_t>{{position.getChunk(), rng()}})); break;
+					default: append(CommandPacket(static_cast<GlobalID>(i), std::format("say {}", i))); break;
+				}
+			}
+
+			return stream;
+		}
+
+		std::vector<uint8_t> loadStream(Game &game, const std::filesystem::path &recording) {
+			if (recording.empty())
+				return synthesizeStream(game, 200'000);
+			const std::string contents = readFile(recording);
+			return {contents.begin(), contents.end()};
+		}
+
+		struct FeedResult {
+			size_t packets = 0;
+			size_t rejected = 0;
+			/** Set when something other than a std::exception escaped the receive path. */
+			bool unexpected = false;
+		};
+
+		/** Feeds a stream through a PacketReader in chunks of the sizes `next_chunk` picks, decoding every packet the way
+		 *  RemoteClient does. Stops at the first error, as a server would after closing the connection. */
+		template <typename C>
+		FeedResult feed(Game &game, std::span<const uint8_t> stream, C &&next_chunk) {
+			PacketReader reader(MAX_PAYLOAD_SIZE);
+			Buffer buffer;
+			buffer.context = game.shared_from_this();
+			FeedResult result;
+			auto &factories = game.registry<PacketFactoryRegistry>();
+
+			try {
+				while (!stream.empty()) {
+					const size_t size = std::min(next_chunk(), stream.size());
+					reader.feed(stream.subspan(0, size), [&](PacketID packet_type, const PacketReader::Payload &payload) {
+						payload.copyTo(buffer.bytes);
+						buffer.skip = 0;
+						auto packet = (*factories[packet_type])();
+						packet->decode(game, buffer);
+						if (!buffer.empty())
+							throw PacketError("Packet left bytes undecoded");
+						++result.packets;
+					});
+					stream = stream.subspan(size);
+				}
+			} catch (const std::exception &) {
+				++result.rejected;
+			} catch (...) {
+				result.unexpected = true;
+			}
+
+			return result;
+		}
+	}
+
+	/** Measures how fast a recorded (or synthesized) client stream can be split and decoded when it arrives in reads of
+	 *  various sizes, and checks that the read size doesn't change which packets come out. Returns false if it does. */
+	bool receiveBenchmark(const std::filesystem::path &recording) {
+		auto game = Game::create(Side::Client, nullptr);
+		const std::vector<uint8_t> stream = loadStream(*game, recording);
+		std::optional<size_t> expected;
+		bool passed = true;
+
+		for (const size_t chunk_size: {size_t(1), size_t(7), size_t(64), size_t(1500), size_t(8192), size_t(65536)}) {
+			const auto start = std::chrono::steady_clock::now();
+			const FeedResult result = feed(*game, stream, [chunk_size] { return chunk_size; });
+			const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+			std::cout << std::format("Reads of {:5} bytes: {} packets in {:.3f} s ({:.1f} MB/s, {:.0f} packets/s){}\n", chunk_size, result.packets,
+				seconds.count(), stream.size() / seconds.count() / 1e6, result.packets / seconds.count(), result.rejected? " \e[31m(rejected)\e[39m" : "");
+
+			if (result.unexpected) {
+				std::cout << "\e[31mFAIL\e[39m: unexpected exception\n";
+				passed = false;
+			}
+
+			if (!expected) {
+				expected = result.packets;
+			} else if (*expected != result.packets) {
+				std::cout << "\e[31mFAIL\e[39m: packet count depends on read size\n";
+				passed = false;
+			}
+		}
+
+		return passed;
+	}
+
+	/** Feeds mutated copies of a recorded (or synthesized) stream through the receive path in random read sizes. Every
+	 *  malformed stream has to be rejected with a std::exception rather than a crash, a hang or a huge allocation.
+	 *  Returns false if the unmutated stream doesn't decode or anything else escapes the receive path. */
+	bool receiveFuzz(const std::filesystem::path &recording, size_t iterations) {
+		auto game = Game::create(Side::Client, nullptr);
+		std::vector<uint8_t> original = loadStream(*game, recording);
+		// Mutating a shorter prefix keeps each iteration quick while still covering every packet type in it.
+		if (recording.empty())
+			original.resize(std::min<size_t>(original.size(), 4096));
+
+		// A synthesized prefix can end partway through a packet, which leaves it buffered rather than rejected.
+		if (const FeedResult baseline = feed(*game, original, [] { return 1500; }); baseline.rejected || baseline.unexpected || baseline.packets == 0) {
+			std::cout << "\e[31mFAIL\e[39m: unmutated stream didn't decode\n";
+			return false;
+		}
+
+		std::mt19937_64 rng(std::random_device{}());
+		size_t accepted = 0;
+		size_t rejected = 0;
+		size_t unexpected = 0;
+
+		for (size_t iteration = 0; iteration < iterations; ++iteration) {
+			std::vector<uint8_t> stream = original;
+			const size_t mutations = 1 + rng() % 8;
+
+			for (size_t i = 0; i < mutations && !stream.empty(); ++i) {
+				const size_t position = rng() % stream.size();
+				switch (rng() % 4) {
+					case 0: stream[position] = static_cast<uint8_t>(rng()); break;
+					case 1: stream[position] ^= static_cast<uint8_t>(1 << (rng() % 8)); break;
+					case 2: stream.insert(stream.begin() + position, static_cast<uint8_t>(rng())); break;
+					default: stream.resize(position); break;
+				}
+			}
+
+			const FeedResult result = feed(*game, stream, [&] { return 1 + rng() % 2048; });
+			if (result.unexpected)
+				++unexpected;
+			else if (result.rejected)
+				++rejected;
+			else
+				++accepted;
+		}
+
+		std::cout << std::format("{} mutated streams: {} accepted, {} rejected, {} unexpected exceptions\n", iterations, accepted, rejected, unexpected);
+
+		if (unexpected != 0) {
+			std::cout << "\e[31mFAIL\e[39m\n";
+			return false;
+		}
+
+		std::cout << "\e[32mPASS\e[39m\n";
+		return true;
+	}
+}
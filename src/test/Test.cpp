@@ -1,5 +1,6 @@
 #include "Log.h"
 #include "container/Quadtree.h"
+#include "data/Identifier.h"
 #include "entity/ServerPlayer.h"
 #include "game/TileProvider.h"
 #include "net/Buffer.h"
@@ -226,10 +227,45 @@ namespace Game3 {
 		check(-1,  0, Direction::Up);
 	}
 
+	void testIdentifierBuffer() {
+		// Identifiers go over the wire as their combined strings, so these are never interned before they're decoded.
+		const std::string saved = "test:removed_item";
+		const std::string sent = "test:unknown_from_client";
+
+		Buffer trusted;
+		trusted << saved;
+		Identifier decoded;
+		trusted >> decoded;
+		if (decoded.str() == saved && Identifier::find(saved))
+			SUCCESS("Trusted buffer decoded and interned {}", decoded);
+		else
+			ERROR("Trusted buffer decoded {}, expected {}", decoded, saved);
+
+		Buffer untrusted;
+		untrusted.untrusted = true;
+		untrusted << sent << saved;
+		try {
+			untrusted >> decoded;
+			ERROR("Untrusted buffer decoded unknown identifier {}", decoded);
+		} catch (const std::invalid_argument &) {
+			if (Identifier::find(sent))
+				ERROR("Untrusted buffer interned {}", sent);
+			else
+				SUCCESS("Untrusted buffer rejected {}", sent);
+		}
+
+		untrusted >> decoded;
+		if (decoded.str() == saved)
+			SUCCESS("Untrusted buffer decoded known identifier {}", decoded);
+		else
+			ERROR("Untrusted buffer decoded {}, expected {}", decoded, saved);
+	}
+
 	void test() {
 		// testPlayerJSON();
 		// testLockableWeakPtr();
 		// LockableSharedPtr<int> lsp = std::make_shared<int>(42);
 		testGetFacing();
+		testIdentifierBuffer();
 	}
 }
@@ -0,0 +1,64 @@
+#include "Constants.h"
+#include "algorithm/NoiseGenerator.h"
+#include "threading/ThreadPool.h"
+#include "types/ChunkPosition.h"
+
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace Game3 {
+	namespace {
+		constexpr int32_t BENCHMARK_RADIUS = 8;
+
+		/** Mimics generateOverworld: one noise-filling job per chunk, a barrier, then one per-tile postgen job per chunk. */
+		double benchmarkOverworldPattern(size_t thread_count) {
+			ThreadPool pool{thread_count};
+			pool.start();
+
+			DefaultNoiseGenerator noisegen(42);
+			std::vector<ChunkPosition> chunk_positions;
+			for (int32_t y = -BENCHMARK_RADIUS; y < BENCHMARK_RADIUS; ++y)
+				for (int32_t x = -BENCHMARK_RADIUS; x < BENCHMARK_RADIUS; ++x)
+					chunk_positions.emplace_back(x, y);
+
+			std::vector<std::vector<float>> saved_noise(chunk_positions.size());
+
+			const auto start = std::chrono::steady_clock::now();
+
+			pool.parallelFor(0, chunk_positions.size(), [&](size_t index) {
+				const ChunkPosition chunk_position = chunk_positions[index];
+				noisegen.fill(saved_noise[index], chunk_position.x * CHUNK_SIZE, chunk_position.y * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE, 1.f / 100.f);
+			});
+
+			pool.parallelFor(0, chunk_positions.size(), [&](size_t index) {
+				const ChunkPosition chunk_position = chunk_positions[index];
+				std::vector<float> &noise = saved_noise[index];
+				for (Index row = 0; row < CHUNK_SIZE; ++row) {
+					for (Index column = 0; column < CHUNK_SIZE; ++column) {
+						float &value = noise[row * CHUNK_SIZE + column];
+						value += std::abs(noisegen((chunk_position.y * CHUNK_SIZE + row) / 20., (chunk_position.x * CHUNK_SIZE + column) / 20., 0.5));
+					}
+				}
+			});
+
+			const auto end = std::chrono::steady_clock::now();
+			pool.join();
+			return std::chrono::duration<double, std::milli>(end - start).count();
+		}
+	}
+
+	void threadPoolBenchmark() {
+		std::vector<size_t> thread_counts{1, 2, 4, 8};
+		if (const size_t hardware = std::thread::hardware_concurrency(); hardware > 8)
+			thread_counts.push_back(hardware);
+
+		std::cout << std::format("{:>10} {:>12}\n", "Threads", "Time (ms)");
+
+		for (const size_t thread_count: thread_counts)
+			std::cout << std::format("{:>10} {:>12.2f}\n", thread_count, benchmarkOverworldPattern(thread_count));
+	}
+}
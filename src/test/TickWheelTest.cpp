@@ -0,0 +1,223 @@
+#include "game/TickWheel.h"
+
+#include <format>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Game3 {
+	namespace {
+		/** Far enough out to start in the top level of the wheel. */
+		constexpr Tick FAR = Tick(1) << 25;
+
+		size_t failures = 0;
+
+		void check(bool condition, const std::string &what) {
+			if (!condition) {
+				std::cout << std::format("\e[31mFailed:\e[39m {}\n", what);
+				++failures;
+			}
+		}
+
+		/** Dispatches one tick at a time from the tick after `now` up to `to`, returning what ran on each tick. */
+		std::map<Tick, std::vector<int>> dispatchEach(TickWheel<> &wheel, Tick &now, Tick to, std::vector<int> &ran) {
+			std::map<Tick, std::vector<int>> out;
+			while (now < to) {
+				++now;
+				ran.clear();
+				wheel.dispatch(now);
+				if (!ran.empty())
+					out[now] = ran;
+			}
+			return out;
+		}
+
+		void testOrdering() {
+			TickWheel<> wheel;
+			Tick now = 0;
+			std::vector<int> ran;
+			const std::vector<Tick> dues{1, 2, 255, 256, 257, 65'535, 65'536, 70'000, 300'000};
+
+			for (size_t i = 0; i < dues.size(); ++i)
+				wheel.schedule(dues[i], [&ran, i] { ran.push_back(static_cast<int>(i)); });
+
+			check(wheel.size() == dues.size(), "size counts every scheduled task");
+
+			const auto runs = dispatchEach(wheel, now, dues.back(), ran);
+			check(runs.size() == dues.size(), std::format("{} ticks ran tasks, expected {}", runs.size(), dues.size()));
+
+			for (size_t i = 0; i < dues.size(); ++i) {
+				auto iter = runs.find(dues[i]);
+				check(iter != runs.end() && iter->second == std::vector<int>{static_cast<int>(i)}, std::format("task due at {} ran on its tick", dues[i]));
+			}
+
+			check(wheel.size() == 0, "the wheel is empty once everything ran");
+
+			// Skipping ahead runs everything due in between at once, and counts it as late.
+			for (const Tick due: {now + 10, now + FAR - 1, now + FAR + 1})
+				wheel.schedule(due, [&ran] { ran.push_back(0); });
+
+			ran.clear();
+			auto stats = wheel.dispatch(now + FAR);
+			check(ran.size() == 2 && stats.executed == 2 && stats.late == 2, "a jump of many ticks runs the tasks due by then");
+
+			ran.clear();
+			stats = wheel.dispatch(now + FAR + 1);
+			check(ran.size() == 1 && stats.late == 0, "a task cascaded down from the top level runs on its tick");
+		}
+
+		/** Tasks have to run in the order they come due, and in the order they were scheduled within a tick, as they did
+		 *  when tick queues were multimaps. */
+		void testOrder() {
+			TickWheel<> wheel;
+			std::vector<int> ran;
+
+			for (int i = 0; i < 10; ++i)
+				wheel.schedule(1, [&ran, i] { ran.push_back(i); });
+
+			wheel.dispatch(1);
+			check(ran == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}, "tasks due on the same tick run in the order they were scheduled");
+
+			// One dispatch covering several ticks, with the tasks scheduled out of order.
+			ran.clear();
+			const std::vector<std::pair<Tick, int>> spread{{5, 3}, {2, 0}, {4, 2}, {2, 1}, {9, 5}, {7, 4}, {9, 6}};
+			for (const auto &[due, value]: spread)
+				wheel.schedule(due, [&ran, value = value] { ran.push_back(value); });
+
+			wheel.dispatch(10);
+			check(ran == std::vector<int>{0, 1, 2, 3, 4, 5, 6}, "a dispatch spanning several ticks runs tasks in due order");
+
+			// These start in the second and third levels and get cascaded down.
+			ran.clear();
+			const Tick base = 10;
+			const std::vector<std::pair<Tick, int>> cascaded{{70'000, 6}, {300, 0}, {70'000, 7}, {600, 3}, {300, 1}, {65'600, 5}, {300, 2}, {600, 4}};
+			for (const auto &[due, value]: cascaded)
+				wheel.schedule(base + due, [&ran, value = value] { ran.push_back(value); });
+
+			Tick now = base;
+			std::vector<int> all;
+			for (const auto &[tick, tick_ran]: dispatchEach(wheel, now, base + 70'000, ran))
+				all.insert(all.end(), tick_ran.begin(), tick_ran.end());
+			check(all == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}, "tasks cascaded down from higher levels keep their order");
+
+			// A throw cuts off the rest of its tick. Those tasks still run before the next tick's.
+			ran.clear();
+			for (int i = 0; i < 3; ++i)
+				wheel.schedule(now + 1, [&ran, i] { ran.push_back(i); });
+			wheel.schedule(now + 1, [] { throw std::runtime_error("task failed"); });
+			wheel.schedule(now + 1, [&ran] { ran.push_back(3); });
+			wheel.schedule(now + 2, [&ran] { ran.push_back(4); });
+
+			try {
+				wheel.dispatch(now + 1);
+			} catch (const std::runtime_error &) {}
+
+			wheel.dispatch(now + 2);
+			check(ran == std::vector<int>{0, 1, 2, 3, 4}, "tasks cut off by a throw run ahead of the next tick's");
+		}
+
+		void testCancellation() {
+			TickWheel<> wheel;
+			Tick now = 0;
+			std::vector<int> ran;
+
+			auto first = wheel.schedule(5, [&ran] { ran.push_back(1); });
+			auto second = wheel.schedule(5, [&ran] { ran.push_back(2); });
+			auto far = wheel.schedule(FAR, [&ran] { ran.push_back(3); });
+
+			check(wheel.cancel(first), "cancelling a pending task succeeds");
+			check(!wheel.cancel(first), "cancelling it twice fails");
+			check(wheel.cancel(far), "cancelling a task in a higher level succeeds");
+			check(wheel.size() == 1, "cancelled tasks aren't counted");
+
+			auto runs = dispatchEach(wheel, now, 10, ran);
+			check(runs.size() == 1 && runs[5] == std::vector<int>{2}, "only the uncancelled task ran");
+			check(!wheel.cancel(second), "cancelling a task that already ran fails");
+
+			// The freed node gets reused; the old handle must not cancel the new task.
+			auto reused = wheel.schedule(now + 1, [&ran] { ran.push_back(4); });
+			check(reused.task == second.task || reused.task == first.task || reused.task == far.task, "freed nodes are reused");
+			check(!wheel.cancel(second) && !wheel.cancel(first), "stale handles don't cancel the node's new task");
+
+			// A task can cancel one that's due on the same tick but hasn't run yet.
+			TickWheel<>::Handle later;
+			bool cancelled = false;
+			wheel.schedule(now + 1, [&] { cancelled = wheel.cancel(later); ran.push_back(5); });
+			later = wheel.schedule(now + 1, [&ran] { ran.push_back(6); });
+
+			runs = dispatchEach(wheel, now, now + 1, ran);
+			check(runs.size() == 1 && runs.begin()->second == std::vector<int>{4, 5}, "the reused node's task ran, and the cancelled one didn't");
+			check(cancelled, "cancelling a task due on the tick being dispatched succeeds");
+			check(wheel.size() == 0, "nothing is left over");
+		}
+
+		void testRescheduling() {
+			TickWheel<> wheel;
+			Tick now = 0;
+			std::vector<int> ran;
+			std::vector<Tick> repeats;
+
+			std::function<void()> repeat = [&] {
+				repeats.push_back(now);
+				if (repeats.size() < 4)
+					wheel.schedule(now + 300, repeat);
+			};
+
+			wheel.schedule(1, repeat);
+			dispatchEach(wheel, now, 2'000, ran);
+			check(repeats == std::vector<Tick>{1, 301, 601, 901}, "a task that reschedules itself runs on each tick it asks for");
+
+			// Tasks scheduled for the tick being dispatched, or one before it, run at the next dispatch.
+			wheel.schedule(now, [&ran] { ran.push_back(1); });
+			wheel.schedule(now - 5, [&ran] { ran.push_back(2); });
+			ran.clear();
+			const auto stats = wheel.dispatch(now + 1);
+			check(ran.size() == 2 && stats.late == 2, "tasks scheduled in the past run at the next dispatch");
+		}
+
+		void testThrowing() {
+			TickWheel<> wheel;
+			size_t ran = 0;
+
+			for (int i = 0; i < 5; ++i)
+				wheel.schedule(1, [&ran] { ++ran; });
+			wheel.schedule(1, [] { throw std::runtime_error("task failed"); });
+			for (int i = 0; i < 5; ++i)
+				wheel.schedule(1, [&ran] { ++ran; });
+			wheel.schedule(2, [&ran] { ++ran; });
+
+			bool threw = false;
+			try {
+				wheel.dispatch(1);
+			} catch (const std::runtime_error &) {
+				threw = true;
+			}
+
+			check(threw, "a task's exception reaches the dispatcher");
+			check(wheel.size() == 11 - ran, std::format("{} tasks pending after the throw, expected {}", wheel.size(), 11 - ran));
+
+			// Without the running list being cleaned up, this would trip the assertion in dispatch or lose tasks.
+			const auto stats = wheel.dispatch(2);
+			check(ran == 11, std::format("{} tasks ran in all, expected 11", ran));
+			check(stats.late == stats.executed - 1, "the tasks cut off by the throw are reported as late");
+			check(wheel.size() == 0, "nothing is left over after the throw");
+		}
+	}
+
+	/** Checks that TickWheel runs tasks on the ticks they're due, honours cancellation, lets tasks schedule more tasks and
+	 *  recovers when one of them throws. */
+	bool tickWheelTest() {
+		failures = 0;
+		testOrdering();
+		testOrder();
+		testCancellation();
+		testRescheduling();
+		testThrowing();
+		const bool passed = failures == 0;
+		std::cout << (passed? "\e[32mPASS\e[39m\n" : "\e[31mFAIL\e[39m\n");
+		return passed;
+	}
+}
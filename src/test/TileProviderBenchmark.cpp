@@ -0,0 +1,181 @@
+#include "game/TileProvider.h"
+#include "game/TileView.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <random>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Game3 {
+	namespace {
+		constexpr int32_t BENCHMARK_RADIUS = 16;
+		constexpr size_t LOOKUPS = 10'000'000;
+
+		/** The per-layer unordered_map storage that TileProvider used before it switched to chunk records. */
+		struct LegacyProvider {
+			std::array<std::unordered_map<ChunkPosition, TileChunk>, LAYER_COUNT> chunkMaps;
+			std::unordered_map<ChunkPosition, PathChunk> pathMap;
+			std::unordered_map<ChunkPosition, FluidChunk> fluidMap;
+			mutable std::array<std::shared_mutex, LAYER_COUNT> chunkMutexes;
+			mutable std::shared_mutex pathMutex;
+			mutable std::shared_mutex fluidMutex;
+
+			TileID copyTile(Layer layer, Position position) const {
+				std::shared_lock lock(chunkMutexes[getIndex(layer)]);
+				const auto &map = chunkMaps[getIndex(layer)];
+				if (auto iter = map.find(position.getChunk()); iter != map.end())
+					return TileProvider::access(iter->second, TileProvider::remainder(position.row), TileProvider::remainder(position.column));
+				throw std::out_of_range("Couldn't copy tile");
+			}
+
+			uint8_t & findPathState(Position position, std::shared_lock<std::shared_mutex> *lock_out) {
+				std::shared_lock lock(pathMutex);
+				if (auto iter = pathMap.find(position.getChunk()); iter != pathMap.end()) {
+					*lock_out = std::move(lock);
+					return TileProvider::access(iter->second, TileProvider::remainder(position.row), TileProvider::remainder(position.column));
+				}
+				throw std::out_of_range("Couldn't find path state");
+			}
+
+			std::optional<FluidTile> copyFluidTile(Position position) const {
+				std::shared_lock lock(fluidMutex);
+				if (auto iter = fluidMap.find(position.getChunk()); iter != fluidMap.end())
+					return TileProvider::access(iter->second, TileProvider::remainder(position.row), TileProvider::remainder(position.column));
+				return std::nullopt;
+			}
+		};
+
+		/** A random walk, so consecutive lookups usually land in the same chunk like they do in pathfinding and autotiling. */
+		std::vector<Position> makeWalk() {
+			std::default_random_engine rng(42);
+			std::uniform_int_distribution<int> step(-1, 1);
+			constexpr Index limit = BENCHMARK_RADIUS * CHUNK_SIZE - 1;
+			std::vector<Position> walk;
+			walk.reserve(LOOKUPS);
+			Position position{0, 0};
+			for (size_t i = 0; i < LOOKUPS; ++i) {
+				position.row = std::clamp<Index>(position.row + step(rng), -limit, limit);
+				position.column = std::clamp<Index>(position.column + step(rng), -limit, limit);
+				walk.push_back(position);
+			}
+			return walk;
+		}
+
+		template <typename F>
+		double nanosecondsPerLookup(const std::vector<Position> &walk, F &&function) {
+			size_t checksum = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (const Position &position: walk)
+				checksum += function(position);
+			const auto end = std::chrono::steady_clock::now();
+			// Keeps the lookups from being optimized away.
+			static volatile size_t sink;
+			sink = checksum;
+			return std::chrono::duration<double, std::nano>(end - start).count() / walk.size();
+		}
+	}
+
+	void tileProviderBenchmark() {
+		TileProvider provider;
+		LegacyProvider legacy;
+
+		for (int32_t y = -BENCHMARK_RADIUS; y < BENCHMARK_RADIUS; ++y) {
+			for (int32_t x = -BENCHMARK_RADIUS; x < BENCHMARK_RADIUS; ++x) {
+				const ChunkPosition chunk_position{x, y};
+				provider.ensureAllChunks(chunk_position);
+				// A dozen distinct objects per chunk, so that packing has something to do besides uniform chunks.
+				TileChunk &objects = provider.getTileChunk(Layer::Objects, chunk_position);
+				for (size_t i = 0; i < objects.size(); ++i)
+					objects[i] = static_cast<TileID>((i / CHUNK_SIZE / 8 + i % CHUNK_SIZE / 8) % 12);
+				for (const Layer layer: allLayers)
+					legacy.chunkMaps[getIndex(layer)][chunk_position].resize(CHUNK_SIZE * CHUNK_SIZE, 1);
+				legacy.pathMap[chunk_position].resize(CHUNK_SIZE * CHUNK_SIZE, 1);
+				legacy.fluidMap[chunk_position].resize(CHUNK_SIZE * CHUNK_SIZE, {0, 0});
+			}
+		}
+
+		const std::vector<Position> walk = makeWalk();
+
+		const double legacy_tile = nanosecondsPerLookup(walk, [&](Position position) {
+			return legacy.copyTile(Layer::Objects, position);
+		});
+
+		const double new_tile = nanosecondsPerLookup(walk, [&](Position position) {
+			return provider.copyTile(Layer::Objects, position);
+		});
+
+		const double legacy_path = nanosecondsPerLookup(walk, [&](Position position) {
+			std::shared_lock<std::shared_mutex> lock;
+			return legacy.findPathState(position, &lock);
+		});
+
+		const double new_path = nanosecondsPerLookup(walk, [&](Position position) {
+			std::shared_lock<std::shared_mutex> lock;
+			return provider.findPathState(position, &lock, TileProvider::PathMode::Throw);
+		});
+
+		const double legacy_fluid = nanosecondsPerLookup(walk, [&](Position position) {
+			return legacy.copyFluidTile(position)->level;
+		});
+
+		const double new_fluid = nanosecondsPerLookup(walk, [&](Position position) {
+			return provider.copyFluidTile(position)->level;
+		});
+
+		double view_tile{}, view_path{}, view_fluid{};
+		{
+			TileView view(provider, ChunkRange({-BENCHMARK_RADIUS, -BENCHMARK_RADIUS}, {BENCHMARK_RADIUS - 1, BENCHMARK_RADIUS - 1}));
+
+			view_tile = nanosecondsPerLookup(walk, [&](Position position) {
+				return *view.tryTile(Layer::Objects, position);
+			});
+
+			view_path = nanosecondsPerLookup(walk, [&](Position position) {
+				return *view.copyPathState(position);
+			});
+
+			view_fluid = nanosecondsPerLookup(walk, [&](Position position) {
+				return view.copyFluidTile(position)->level;
+			});
+		}
+
+		std::cout << std::format("{:>16} {:>12} {:>12} {:>12}\n", "ns/lookup", "Before", "After", "TileView");
+		std::cout << std::format("{:>16} {:>12.2f} {:>12.2f} {:>12.2f}\n", "copyTile", legacy_tile, new_tile, view_tile);
+		std::cout << std::format("{:>16} {:>12.2f} {:>12.2f} {:>12.2f}\n", "findPathState", legacy_path, new_path, view_path);
+		std::cout << std::format("{:>16} {:>12.2f} {:>12.2f} {:>12.2f}\n", "copyFluidTile", legacy_fluid, new_fluid, view_fluid);
+
+		// The first pass notes each chunk's update counter and the second packs the chunks that haven't changed since.
+		provider.compact();
+		const TileProvider::CompactionStats stats = provider.compact();
+
+		const double packed_tile = nanosecondsPerLookup(walk, [&](Position position) {
+			return provider.copyTile(Layer::Objects, position);
+		});
+
+		const double packed_fluid = nanosecondsPerLookup(walk, [&](Position position) {
+			return provider.copyFluidTile(position)->level;
+		});
+
+		double packed_view_tile{}, packed_view_fluid{};
+		{
+			TileView view(provider, ChunkRange({-BENCHMARK_RADIUS, -BENCHMARK_RADIUS}, {BENCHMARK_RADIUS - 1, BENCHMARK_RADIUS - 1}));
+
+			packed_view_tile = nanosecondsPerLookup(walk, [&](Position position) {
+				return *view.tryTile(Layer::Objects, position);
+			});
+
+			packed_view_fluid = nanosecondsPerLookup(walk, [&](Position position) {
+				return view.copyFluidTile(position)->level;
+			});
+		}
+
+		std::cout << std::format("\nPacked {} parts: {:.2f} MiB -> {:.2f} MiB\n", stats.packed, stats.bytesBefore / 1048576., stats.bytesAfter / 1048576.);
+		std::cout << std::format("{:>16} {:>12} {:>12}\n", "ns/lookup", "Packed", "TileView");
+		std::cout << std::format("{:>16} {:>12.2f} {:>12.2f}\n", "copyTile", packed_tile, packed_view_tile);
+		std::cout << std::format("{:>16} {:>12.2f} {:>12.2f}\n", "copyFluidTile", packed_fluid, packed_view_fluid);
+	}
+}
@@ -0,0 +1,95 @@
+#include "game/Game.h"
+#include "game/TileProvider.h"
+#include "game/TileView.h"
+#include "graphics/Tileset.h"
+
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace Game3 {
+	namespace {
+		constexpr int32_t BENCHMARK_RADIUS = 4;
+		constexpr size_t PASSES = 20;
+
+		/** Regenerates the path map of every chunk the way Realm::remakePathMap does (minus tile entities) and returns
+		 *  how many chunks were regenerated per second. */
+		template <typename F>
+		double chunksPerSecond(TileProvider &provider, F &&is_walkable) {
+			size_t walkable = 0;
+			size_t chunks = 0;
+			const auto start = std::chrono::steady_clock::now();
+
+			for (size_t pass = 0; pass < PASSES; ++pass) {
+				for (int32_t y = -BENCHMARK_RADIUS; y < BENCHMARK_RADIUS; ++y) {
+					for (int32_t x = -BENCHMARK_RADIUS; x < BENCHMARK_RADIUS; ++x) {
+						const ChunkPosition chunk_position{x, y};
+						TileView view(provider, ChunkRange(chunk_position), TileView::TILES);
+						PathChunk &path_chunk = provider.getPathChunk(chunk_position);
+						auto lock = path_chunk.uniqueLock();
+						for (Index row = 0; row < CHUNK_SIZE; ++row) {
+							for (Index column = 0; column < CHUNK_SIZE; ++column) {
+								const Position position{y * CHUNK_SIZE + row, x * CHUNK_SIZE + column};
+								uint8_t state = 1;
+								for (const Layer layer: collidingLayers) {
+									if (std::optional<TileID> tile = view.tryTile(layer, position); !tile || !is_walkable(*tile)) {
+										state = 0;
+										break;
+									}
+								}
+								path_chunk[row * CHUNK_SIZE + column] = state;
+								walkable += state;
+							}
+						}
+						++chunks;
+					}
+				}
+			}
+
+			const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+			// Keeps the checks from being optimized away.
+			static volatile size_t sink;
+			sink = walkable;
+			return chunks / seconds.count();
+		}
+	}
+
+	/** Compares path map regeneration using tile names and identifier sets (how Tileset answered TileID queries before
+	 *  it had per-TileID tables) against the tables. */
+	void tilesetBenchmark() {
+		auto game = Game::create(Side::Client, nullptr);
+		const Tileset &tileset = *game->registry<TilesetRegistry>().at("base:tileset/monomap");
+
+		std::vector<TileID> tile_ids;
+		for (const auto &[tile_id, tilename]: tileset.getNames())
+			tile_ids.push_back(tile_id);
+
+		// Mostly empty upper layers over varied terrain, like a typical overworld chunk.
+		TileProvider provider;
+		std::mt19937_64 rng(42);
+		for (int32_t y = -BENCHMARK_RADIUS - 1; y <= BENCHMARK_RADIUS; ++y) {
+			for (int32_t x = -BENCHMARK_RADIUS - 1; x <= BENCHMARK_RADIUS; ++x) {
+				const ChunkPosition chunk_position{x, y};
+				provider.ensureAllChunks(chunk_position);
+				for (const Layer layer: allLayers) {
+					TileChunk &chunk = provider.getTileChunk(layer, chunk_position);
+					for (TileID &tile: chunk)
+						tile = layer == Layer::Terrain || rng() % 8 == 0? tile_ids[rng() % tile_ids.size()] : 0;
+				}
+			}
+		}
+
+		const double legacy = chunksPerSecond(provider, [&](TileID tile_id) {
+			const Identifier &tilename = tileset[tile_id];
+			return tileset.isWalkable(tilename) && !tileset.isSolid(tilename);
+		});
+
+		const double tables = chunksPerSecond(provider, [&](TileID tile_id) {
+			return tileset.isWalkable(tile_id) && !tileset.isSolid(tile_id);
+		});
+
+		std::cout << std::format("Path map regeneration: names and sets {:.0f} chunks/s, tables {:.0f} chunks/s ({:.2f}x)\n", legacy, tables, tables / legacy);
+	}
+}
@@ -1,8 +1,86 @@
+#include "threading/ThreadContext.h"
 #include "threading/ThreadPool.h"
 
+#include <utility>
+
 namespace Game3 {
+	namespace {
+		thread_local const ThreadPool *currentPool = nullptr;
+		thread_local size_t currentWorker = 0;
+
+		/** Gives a job that a waiting thread runs inline a fresh ThreadContext, and gives the waiter its own back afterward,
+		 *  so that the job can't clobber the waiter's generation guards, path scratch or random state. */
+		struct IsolatedContext {
+			ThreadContext saved = std::exchange(threadContext, ThreadContext{});
+
+			~IsolatedContext() {
+				threadContext = std::move(saved);
+			}
+		};
+	}
+
+	ThreadPool::TaskGroup::TaskGroup(ThreadPool &pool_):
+		pool(pool_),
+		state(std::make_shared<State>()) {}
+
+	ThreadPool::TaskGroup::~TaskGroup() {
+		waitForJobs();
+	}
+
+	void ThreadPool::TaskGroup::add(std::function<void()> function) {
+		++state->remaining;
+
+		Function job = [state = state, function = std::move(function)](ThreadPool &, size_t) {
+			try {
+				function();
+			} catch (...) {
+				std::unique_lock lock(state->exceptionMutex);
+				if (!state->exception)
+					state->exception = std::current_exception();
+			}
+
+			if (--state->remaining == 0)
+				state->remaining.notify_all();
+		};
+
+		if (!pool.add(job)) {
+			IsolatedContext isolated;
+			job(pool, pool.getSize());
+		}
+	}
+
+	void ThreadPool::TaskGroup::wait() {
+		waitForJobs();
+
+		std::exception_ptr exception;
+		{
+			std::unique_lock lock(state->exceptionMutex);
+			exception = std::exchange(state->exception, nullptr);
+		}
+
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+	void ThreadPool::TaskGroup::waitForJobs() {
+		if (pool.isWorkerThread()) {
+			// Sleeping here would take a worker away from the jobs we're waiting on.
+			while (state->remaining != 0)
+				if (!pool.runPendingJob())
+					std::this_thread::yield();
+			return;
+		}
+
+		while (const size_t remaining = state->remaining.load())
+			if (!pool.runPendingJob())
+				state->remaining.wait(remaining);
+	}
+
 	ThreadPool::ThreadPool(size_t size_): size(size_) {
 		pool.reserve(size);
+		deques.reserve(size);
+		for (size_t i = 0; i < size; ++i)
+			deques.emplace_back(std::make_unique<WorkStealingDeque<Function>>());
 	}
 
 	ThreadPool::~ThreadPool() {
@@ -13,57 +91,140 @@ namespace Game3 {
 		if (joining || active.exchange(true))
 			return;
 		assert(pool.empty());
+		accepting = true;
 		for (size_t thread_index = 0; thread_index < size; ++thread_index)
 			pool.emplace_back([this, thread_index] {
 				threadContext = {};
-				size_t last_jobs_done = jobsDone.load();
-				while (active) {
-					{
-						std::unique_lock lock(workMutex);
-						workCV.wait(lock, [this, &last_jobs_done] {
-							return joining.load() || newJobReady.load() || last_jobs_done < jobsDone;
-						});
+				currentPool = this;
+				currentWorker = thread_index;
+
+				while (true) {
+					if (auto job = findJob(thread_index)) {
+						runJob(*job, thread_index);
+						continue;
+					}
+
+					const uint32_t seen = wakeups.load();
+
+					if (pendingJobs != 0) {
+						// A job is on its way into a queue or a thief lost a race; try again.
+						std::this_thread::yield();
+						continue;
 					}
+
 					if (joining)
 						break;
-					if (auto job = workQueue.tryTake()) {
-						newJobReady = false;
-						assert(*job);
-						(*job)(*this, thread_index);
-						last_jobs_done = ++jobsDone;
-						// Issue when the thread pool contains only one worker?
-						workCV.notify_one();
-					} else {
-						last_jobs_done = jobsDone;
-					}
+
+					wakeups.wait(seen);
 				}
+
+				currentPool = nullptr;
 			});
 	}
 
 	void ThreadPool::join() {
-		if (active.exchange(false) && !joining.exchange(true)) {
-			workQueue.clear();
-			workCV.notify_all();
-			for (auto &thread: pool)
-				thread.join();
-			pool.clear();
-			joining = false;
-		}
+		if (!active || joining.exchange(true))
+			return;
+
+		accepting = false;
+		while (adding != 0)
+			std::this_thread::yield();
+
+		wake(true);
+		for (auto &thread: pool)
+			thread.join();
+		pool.clear();
+
+		// Only possible if the pool was stopped from one of its own jobs.
+		while (runPendingJob());
+
+		active = false;
+		joining = false;
 	}
 
-	bool ThreadPool::add(const Function &function) {
-		if (active) {
-			// TODO: race condition if active goes false during this block
-			workQueue.push(function);
-			newJobReady = true;
-			workCV.notify_one();
+	bool ThreadPool::add(Function function) {
+		assert(function);
+
+		if (size == 0)
+			return false;
+
+		if (isWorkerThread()) {
+			++pendingJobs;
+			deques[currentWorker]->push(std::move(function));
+			wake();
 			return true;
 		}
 
+		++adding;
+
+		if (!accepting) {
+			--adding;
+			return false;
+		}
+
+		++pendingJobs;
+		injectionQueue.push(std::move(function));
+		wake();
+		--adding;
+		return true;
+	}
+
+	bool ThreadPool::runPendingJob() {
+		const size_t thread_index = isWorkerThread()? currentWorker : size;
+		if (auto job = findJob(thread_index)) {
+			// Only called by threads that are waiting on something else, so the job mustn't see their context.
+			IsolatedContext isolated;
+			runJob(*job, thread_index);
+			return true;
+		}
 		return false;
 	}
 
+	bool ThreadPool::isWorkerThread() const {
+		return currentPool == this;
+	}
+
 	size_t ThreadPool::jobCount() const {
-		return workQueue.size();
+		return pendingJobs;
+	}
+
+	std::optional<ThreadPool::Function> ThreadPool::findJob(size_t thread_index) {
+		if (pendingJobs == 0)
+			return std::nullopt;
+
+		std::optional<Function> job;
+
+		if (thread_index < size)
+			job = deques[thread_index]->pop();
+
+		if (!job)
+			job = injectionQueue.tryTake();
+
+		for (size_t offset = 1; !job && offset < size + 1; ++offset) {
+			const size_t victim = (thread_index + offset) % size;
+			if (victim != thread_index)
+				job = deques[victim]->steal();
+		}
+
+		if (job)
+			--pendingJobs;
+
+		return job;
+	}
+
+	void ThreadPool::runJob(Function &job, size_t thread_index) {
+		try {
+			job(*this, thread_index);
+		} catch (const std::exception &err) {
+			ERROR("Uncaught exception in thread pool job: {}", err.what());
+		}
+	}
+
+	void ThreadPool::wake(bool all) {
+		++wakeups;
+		if (all)
+			wakeups.notify_all();
+		else
+			wakeups.notify_one();
 	}
 }
@@ -15,7 +15,7 @@ namespace Game3 {
 		if (!id)
 			return false;
 
-		const std::string &tile_name = id->get().name;
+		const std::string &tile_name = id->get().getName();
 		const bool is_closed = place.realm->getTileset().isInCategory(*id, "base:category/fence_gates_closed");
 
 		const Direction direction = place.player->getDirection();
@@ -66,7 +66,7 @@ namespace Game3 {
 
 		const bool is_closed = tileset.isInCategory(*id, "base:category/fence_gates_closed");
 
-		const std::string &tile_name = id->get().name;
+		const std::string &tile_name = id->get().getName();
 
 		if (tile_name.starts_with("tile/gate_horizontal")) {
 			if (is_vertical)
@@ -31,7 +31,7 @@ namespace Game3 {
 		constexpr static Index radius = 3;
 		for (Index y = row - radius; y <= row + radius; ++y)
 			for (Index x = column - radius; x <= column + radius; ++x)
-				if (auto tile_id = realm.tryTile(Layer::Submerged, {y, x}); tile_id && tileset.isInCategory(tileset[*tile_id], "base:category/flowers"))
+				if (auto tile_id = realm.tryTile(Layer::Submerged, {y, x}); tile_id && tileset.isInCategory(*tile_id, "base:category/flowers"))
 					return;
 
 		place.set(Layer::Submerged, choose(tileset.getTilesByCategory("base:category/flowers"), threadContext.rng));
@@ -65,6 +65,12 @@ namespace Game3 {
 		return 0.1;
 	}
 
+	bool Tile::hasRandomTick() const {
+		// The default randomTick only spawns monsters, and canSpawnMonsters never allows that at the moment.
+		// Tiles that override canSpawnMonsters should override this too.
+		return false;
+	}
+
 	void Tile::renderStaticLighting(const Place &, Layer, const RendererContext &) {}
 
 	void Tile::makeMonsterFactories(const GamePtr &game) {
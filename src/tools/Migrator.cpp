@@ -21,8 +21,14 @@ namespace Game3 {
 			INFO_("Reading...");
 			GameDB &database = game->getDatabase();
 			database.readAllRealms();
+			INFO_("Training chunk dictionary...");
+			if (const size_t dictionary_size = database.trainChunkDictionary(); dictionary_size != 0)
+				INFO("Trained a {}-byte dictionary.", dictionary_size);
+			else
+				WARN_("Not enough chunks to train a dictionary; compressing without one.");
 			INFO_("Writing...");
-			database.writeAllRealms();
+			// Rewriting everything upgrades chunks stored in older formats.
+			database.writeAllRealms(true);
 			SUCCESS_("Done.");
 			Timer::summary();
 			Timer::clear();
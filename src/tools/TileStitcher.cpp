@@ -274,6 +274,7 @@ namespace Game3 {
 		out.hash = hexString(hasher.value<std::string>(), false);
 		out.ids["base:tile/empty"] = 0;
 		out.names[0] = "base:tile/empty";
+		out.buildTables();
 
 		if (png_out != nullptr) {
 			for (const std::string &name: tall_autotiles)
@@ -403,6 +403,9 @@ namespace Game3 {
 		else
 			client->saveTokens("tokens.json");
 
+		if (0 < settings.chunkCacheSize)
+			game->openChunkCache("chunkcache.db", hostname.raw() + ":" + std::to_string(port), static_cast<size_t>(settings.chunkCacheSize) * 1024 * 1024);
+
 		activateContext();
 		onGameLoaded();
 
@@ -6,6 +6,8 @@
 namespace Game3 {
 	std::map<std::string, std::chrono::nanoseconds> Timer::times;
 	std::map<std::string, size_t> Timer::counts;
+	std::map<std::string, size_t> Timer::tallies;
+	std::map<std::string, size_t> Timer::tallySamples;
 	std::shared_mutex Timer::mutex;
 	std::atomic_bool Timer::globalEnabled{true};
 
@@ -34,6 +36,14 @@ namespace Game3 {
 		stopped = false;
 	}
 
+	void Timer::count(const std::string &name, size_t amount) {
+		if (!globalEnabled)
+			return;
+		auto lock = uniqueLock();
+		tallies[name] += amount;
+		++tallySamples[name];
+	}
+
 	void Timer::summary(double threshold) {
 		if (!globalEnabled)
 			return;
@@ -67,11 +77,26 @@ namespace Game3 {
 				std::cerr << '\n';
 			}
 		}
+
+		if (!tallies.empty()) {
+			std::cerr << "Tally summary:\n";
+
+			size_t max_length = 0;
+			for (const auto &[name, total]: tallies)
+				max_length = std::max(name.size(), max_length);
+
+			for (const auto &[name, total]: tallies) {
+				const size_t samples = tallySamples.at(name);
+				std::cerr << std::format("    \e[1m{}{}\e[22m: \e[32m{}\e[39m (average: \e[33m{}\e[39m over \e[1m{}\e[22m samples)\n", name, std::string(max_length - name.size(), ' '), total, static_cast<double>(total) / samples, samples);
+			}
+		}
 	}
 
 	void Timer::clear() {
 		auto lock = uniqueLock();
 		times.clear();
 		counts.clear();
+		tallies.clear();
+		tallySamples.clear();
 	}
 }
@@ -3,11 +3,12 @@
 #include <bit>
 #include <cstring>
 #include <memory>
+#include <stdexcept>
 
 #include <zstd.h>
 
 namespace Game3 {
-	std::vector<uint8_t> decompress8(std::span<const uint8_t> span) {
+	std::vector<uint8_t> decompress8(std::span<const uint8_t> span, size_t max_size) {
 		const size_t out_size = ZSTD_DStreamOutSize();
 		std::vector<uint8_t> out_buffer(out_size);
 		std::vector<uint8_t> out;
@@ -27,6 +28,8 @@ namespace Game3 {
 			last_result = result;
 
 			const uint8_t *raw_bytes = out_buffer.data();
+			if (max_size - out.size() < output.pos)
+				throw std::length_error("Decompressed data is too large");
 			out.insert(out.end(), raw_bytes, raw_bytes + output.pos / sizeof(uint8_t));
 		}
 
@@ -102,9 +105,13 @@ namespace Game3 {
 	}
 
 	std::vector<uint8_t> compress(std::span<const uint8_t> span) {
+		return compress(span, ZSTD_maxCLevel());
+	}
+
+	std::vector<uint8_t> compress(std::span<const uint8_t> span, int level) {
 		const auto buffer_size = ZSTD_compressBound(span.size_bytes());
 		auto buffer = std::vector<uint8_t>(buffer_size);
-		auto result = ZSTD_compress(&buffer[0], buffer_size, span.data(), span.size_bytes(), ZSTD_maxCLevel());
+		auto result = ZSTD_compress(&buffer[0], buffer_size, span.data(), span.size_bytes(), level);
 		if (ZSTD_isError(result))
 			throw std::runtime_error("Couldn't compress data");
 		buffer.resize(result);
@@ -159,7 +159,7 @@ namespace Game3::WorldGen {
 		auto keep_biomemap = std::make_shared<BiomeMap>(keep_width, keep_height);
 		auto keep_realm = Realm::create(game, keep_realm_id, "base:realm/keep"_id, "base:tileset/monomap"_id, -seed);
 		keep_realm->outdoors = false;
-		game->addRealm(keep_realm_id, keep_realm);
+		realm->addInteriorRealm(keep_realm);
 		WorldGen::generateKeep(keep_realm, rng, realm->id, keep_width, keep_height, keep_exit, village->getID());
 		keep_realm->remakePathMap(ChunkRange({-1, -1}, {1, 1}));
 
@@ -202,7 +202,7 @@ namespace Game3::WorldGen {
 				auto new_realm = Realm::create(game, realm_id, realm_type, details->tilesetName, -seed);
 				new_realm->outdoors = false;
 				gen_fn(new_realm, rng, realm, realm_width, realm_height, building_position + Position(1, 0));
-				game->addRealm(realm_id, new_realm);
+				realm->addInteriorRealm(new_realm);
 				new_realm->remakePathMap(ChunkRange({-1, -1}, {1, 1}));
 				realm->add(building);
 			};
@@ -1,9 +1,9 @@
 #include "game/ServerGame.h"
 #include "game/TileProvider.h"
+#include "game/TileView.h"
 #include "graphics/Tileset.h"
 #include "realm/Realm.h"
 #include "threading/ThreadPool.h"
-#include "threading/Waiter.h"
 #include "types/ChunkPosition.h"
 #include "util/Timer.h"
 #include "util/Util.h"
@@ -122,42 +122,52 @@ namespace Game3 {
 		candidates.reserve(starts->size() / GUESS_FACTOR);
 		const size_t sector_max = updiv(starts->size(), SECTOR_SIZE);
 
-		Waiter waiter(sector_max);
+		pool.parallelFor(0, sector_max, [&](size_t sector) {
+			std::vector<Position> thread_candidates;
+			const size_t first = sector * SECTOR_SIZE;
+			const size_t last = std::min((sector + 1) * SECTOR_SIZE, starts->size());
+
+			Position top_left = (*starts)[first];
+			Position bottom_right = top_left;
+			for (size_t i = first + 1; i < last; ++i) {
+				const Position &position = (*starts)[i];
+				top_left.row = std::min(top_left.row, position.row);
+				top_left.column = std::min(top_left.column, position.column);
+				bottom_right.row = std::max(bottom_right.row, position.row);
+				bottom_right.column = std::max(bottom_right.column, position.column);
+			}
 
-		for (size_t sector = 0; sector < sector_max; ++sector) {
-			pool.add([&, sector](ThreadPool &, size_t) {
-				std::vector<Position> thread_candidates;
+			bottom_right.row += options.padding + options.height;
+			bottom_right.column += options.padding + options.width;
+			TileView view(provider, ChunkRange(ChunkPosition(top_left), ChunkPosition(bottom_right)), TileView::TILES | TileView::FLUIDS);
 
-				for (size_t i = sector * SECTOR_SIZE, max = std::min((sector + 1) * SECTOR_SIZE, starts->size()); i < max; ++i) {
-					const auto position = (*starts)[i];
-					const Index row_start = position.row + options.padding;
-					const Index row_end = row_start + options.height;
-					const Index column_start = position.column + options.padding;
-					const Index column_end = column_start + options.width;
+			for (size_t i = first; i < last; ++i) {
+				const auto position = (*starts)[i];
+				const Index row_start = position.row + options.padding;
+				const Index row_end = row_start + options.height;
+				const Index column_start = position.column + options.padding;
+				const Index column_end = column_start + options.width;
 
-					for (Index row = row_start; row < row_end; row += 2) {
-						for (Index column = column_start; column < column_end; column += 2) {
-							if (auto tile = provider.tryTile(Layer::Terrain, {row, column}); !tile || !tileset.isLand(*tile))
-								goto failed;
+				for (Index row = row_start; row < row_end; row += 2) {
+					for (Index column = column_start; column < column_end; column += 2) {
+						if (auto tile = view.tryTile(Layer::Terrain, {row, column}); !tile || !tileset.isLand(*tile))
+							goto failed;
 
-							if (realm.hasFluid({row, column}))
-								goto failed;
-						}
+						if (view.hasFluid({row, column}))
+							goto failed;
 					}
+				}
 
-					thread_candidates.push_back(position);
+				thread_candidates.push_back(position);
 
-					failed:
-					continue;
-				}
+				failed:
+				continue;
+			}
 
-				std::unique_lock lock(candidates_mutex);
-				candidates.insert(candidates.end(), thread_candidates.begin(), thread_candidates.end());
-				--waiter;
-			});
-		}
+			std::unique_lock lock(candidates_mutex);
+			candidates.insert(candidates.end(), thread_candidates.begin(), thread_candidates.end());
+		});
 
-		waiter.wait();
 		return candidates;
 	}
 }
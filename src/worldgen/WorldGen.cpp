@@ -5,6 +5,7 @@
 namespace Game3 {
 	namespace WorldGen {
 		ThreadPool pool{5};
+		ThreadPool batchPool{1};
 	}
 
 	double getDefaultWetness() {